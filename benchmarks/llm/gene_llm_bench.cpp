@@ -0,0 +1,422 @@
+// Benchmarks the gene_llm shim on a tiny random-weight llama model, so it
+// runs anywhere without downloads. Built by tools/build_llama_runtime.sh.
+//
+//   gene_llm_bench --make-model PATH   write the tiny GGUF model
+//   gene_llm_bench [--model PATH] [--runs N] [--compare BASELINE]
+//
+// Times are best-of-runs. The last block of output uses the same
+// name<TAB>value format as benchmarks/baseline.txt.
+
+#include "gene_llm.h"
+
+#include "ggml.h"
+#include "gguf.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every C++ allocation in the process (shim and llama.cpp) goes through these.
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+}
+
+void *operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Tiny llama: big enough to exercise every kernel, small enough that the
+// shim's own overhead shows up in the numbers.
+constexpr int kVocab = 320;
+constexpr int kEmbd = 64;
+constexpr int kFf = 128;
+constexpr int kLayers = 2;
+constexpr int kHeads = 4;
+constexpr int kCtx = 1024;
+constexpr int kBos = 1;
+constexpr int kEos = 2;
+
+constexpr int kPrefillTokens = 512;
+constexpr int kDecodeTokens = 128;
+constexpr int kSessionTokens = 64;
+
+struct result {
+  std::string name;
+  double value; // seconds, or a count for *_allocs
+  std::string detail;
+};
+
+std::vector<result> g_results;
+
+void add_result(const std::string &name, double value,
+                const std::string &detail) {
+  g_results.push_back({name, value, detail});
+  std::printf("%-28s %12.6f   %s\n", name.c_str(), value, detail.c_str());
+}
+
+ggml_tensor *random_tensor(ggml_context *ctx, const std::string &name,
+                           int64_t ne0, int64_t ne1, std::mt19937 &rng,
+                           float scale) {
+  ggml_tensor *t = ne1 > 0 ? ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1)
+                           : ggml_new_tensor_1d(ctx, GGML_TYPE_F32, ne0);
+  ggml_set_name(t, name.c_str());
+  std::normal_distribution<float> dist(0.0f, scale);
+  auto *data = static_cast<float *>(t->data);
+  for (int64_t i = 0; i < ggml_nelements(t); ++i) {
+    data[i] = ne1 > 0 ? dist(rng) : 1.0f; // norms are all ones
+  }
+  return t;
+}
+
+bool make_model(const char *path) {
+  gguf_context *gguf = gguf_init_empty();
+  gguf_set_val_str(gguf, "general.architecture", "llama");
+  gguf_set_val_str(gguf, "general.name", "gene-bench-tiny");
+  gguf_set_val_u32(gguf, "llama.context_length", kCtx);
+  gguf_set_val_u32(gguf, "llama.embedding_length", kEmbd);
+  gguf_set_val_u32(gguf, "llama.feed_forward_length", kFf);
+  gguf_set_val_u32(gguf, "llama.block_count", kLayers);
+  gguf_set_val_u32(gguf, "llama.attention.head_count", kHeads);
+  gguf_set_val_u32(gguf, "llama.attention.head_count_kv", kHeads);
+  gguf_set_val_u32(gguf, "llama.rope.dimension_count", kEmbd / kHeads);
+  gguf_set_val_f32(gguf, "llama.attention.layer_norm_rms_epsilon", 1e-5f);
+
+  // SentencePiece vocabulary: control tokens, the 256 byte-fallback tokens
+  // and filler pieces, so any text tokenizes.
+  std::vector<std::string> tokens = {"<unk>", "<s>", "</s>"};
+  std::vector<float> scores = {0.0f, 0.0f, 0.0f};
+  std::vector<int32_t> types = {2, 3, 3}; // unknown, control, control
+  for (int b = 0; b < 256; ++b) {
+    char piece[8];
+    std::snprintf(piece, sizeof(piece), "<0x%02X>", b);
+    tokens.push_back(piece);
+    scores.push_back(0.0f);
+    types.push_back(6); // byte
+  }
+  for (int i = 0; static_cast<int>(tokens.size()) < kVocab; ++i) {
+    tokens.push_back("\xe2\x96\x81w" + std::to_string(i));
+    scores.push_back(-static_cast<float>(i));
+    types.push_back(1); // normal
+  }
+  std::vector<const char *> token_ptrs;
+  for (const auto &token : tokens) {
+    token_ptrs.push_back(token.c_str());
+  }
+  gguf_set_val_str(gguf, "tokenizer.ggml.model", "llama");
+  gguf_set_arr_str(gguf, "tokenizer.ggml.tokens", token_ptrs.data(),
+                   token_ptrs.size());
+  gguf_set_arr_data(gguf, "tokenizer.ggml.scores", GGUF_TYPE_FLOAT32,
+                    scores.data(), scores.size());
+  gguf_set_arr_data(gguf, "tokenizer.ggml.token_type", GGUF_TYPE_INT32,
+                    types.data(), types.size());
+  gguf_set_val_u32(gguf, "tokenizer.ggml.bos_token_id", kBos);
+  gguf_set_val_u32(gguf, "tokenizer.ggml.eos_token_id", kEos);
+  gguf_set_val_u32(gguf, "tokenizer.ggml.unknown_token_id", 0);
+
+  const size_t weights = static_cast<size_t>(kVocab) * kEmbd * 2 +
+                         static_cast<size_t>(kLayers) *
+                             (4 * kEmbd * kEmbd + 3 * kEmbd * kFf + 2 * kEmbd) +
+                         kEmbd;
+  ggml_init_params params = {
+      weights * sizeof(float) + (4 + 9 * kLayers) * ggml_tensor_overhead(),
+      nullptr, false};
+  ggml_context *ctx = ggml_init(params);
+  std::mt19937 rng(42);
+  const float scale = 0.02f;
+
+  std::vector<ggml_tensor *> tensors;
+  tensors.push_back(
+      random_tensor(ctx, "token_embd.weight", kEmbd, kVocab, rng, scale));
+  for (int l = 0; l < kLayers; ++l) {
+    const std::string blk = "blk." + std::to_string(l) + ".";
+    tensors.push_back(
+        random_tensor(ctx, blk + "attn_norm.weight", kEmbd, 0, rng, scale));
+    for (const char *w : {"attn_q", "attn_k", "attn_v", "attn_output"}) {
+      tensors.push_back(
+          random_tensor(ctx, blk + w + ".weight", kEmbd, kEmbd, rng, scale));
+    }
+    tensors.push_back(
+        random_tensor(ctx, blk + "ffn_norm.weight", kEmbd, 0, rng, scale));
+    tensors.push_back(
+        random_tensor(ctx, blk + "ffn_gate.weight", kEmbd, kFf, rng, scale));
+    tensors.push_back(
+        random_tensor(ctx, blk + "ffn_up.weight", kEmbd, kFf, rng, scale));
+    tensors.push_back(
+        random_tensor(ctx, blk + "ffn_down.weight", kFf, kEmbd, rng, scale));
+  }
+  tensors.push_back(
+      random_tensor(ctx, "output_norm.weight", kEmbd, 0, rng, scale));
+  ggml_tensor *output =
+      random_tensor(ctx, "output.weight", kEmbd, kVocab, rng, scale);
+  // Never pick EOS, so every request generates exactly max_tokens.
+  std::memset(static_cast<float *>(output->data) + kEos * kEmbd, 0,
+              kEmbd * sizeof(float));
+  tensors.push_back(output);
+
+  for (ggml_tensor *t : tensors) {
+    gguf_add_tensor(gguf, t);
+  }
+  const bool ok = gguf_write_to_file(gguf, path, false);
+  gguf_free(gguf);
+  ggml_free(ctx);
+  return ok;
+}
+
+// Random prompt tokens; first differs per call so no request reuses the
+// previous one's KV cache.
+std::vector<int32_t> prompt_tokens(int count, int variant) {
+  std::vector<int32_t> tokens(static_cast<size_t>(count));
+  std::mt19937 rng(static_cast<uint32_t>(variant));
+  std::uniform_int_distribution<int32_t> dist(3, kVocab - 1);
+  for (auto &t : tokens) {
+    t = dist(rng);
+  }
+  tokens[0] = kBos;
+  return tokens;
+}
+
+gene_llm_session *new_session(gene_llm_model *model) {
+  gene_llm_session_options options = {};
+  options.context_length = kCtx;
+  options.batch_size = kPrefillTokens;
+  options.temperature = 0.0f; // greedy: no sampling noise in the timings
+  gene_llm_session *session = nullptr;
+  gene_llm_error err = {};
+  if (gene_llm_new_session(model, &options, &session, &err) != GENE_LLM_OK) {
+    std::fprintf(stderr, "new_session failed: %s\n", err.message);
+    std::exit(1);
+  }
+  return session;
+}
+
+// Timings of one request; the completion itself is freed before returning.
+struct infer_timings {
+  double prefill_ms;
+  double decode_ms;
+  double ttft_ms;
+};
+
+infer_timings infer(gene_llm_session *session,
+                    const std::vector<int32_t> &tokens, int max_tokens) {
+  gene_llm_infer_options options = {};
+  options.prompt_tokens = tokens.data();
+  options.prompt_token_count = static_cast<int>(tokens.size());
+  options.max_tokens = max_tokens;
+  gene_llm_completion completion = {};
+  gene_llm_error err = {};
+  if (gene_llm_infer(session, &options, &completion, &err) != GENE_LLM_OK) {
+    std::fprintf(stderr, "infer failed: %s\n", err.message);
+    std::exit(1);
+  }
+  const infer_timings timings = {completion.prefill_ms, completion.decode_ms,
+                                 completion.ttft_ms};
+  gene_llm_free_completion(&completion);
+  return timings;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void bench_prefill(gene_llm_model *model, int runs) {
+  gene_llm_session *session = new_session(model);
+  double best = 1e30;
+  for (int run = 0; run <= runs; ++run) {
+    const infer_timings t =
+        infer(session, prompt_tokens(kPrefillTokens, run), 1);
+    if (run > 0) { // run 0 warms up
+      best = std::min(best, t.prefill_ms / 1000.0);
+    }
+  }
+  gene_llm_free_session(session);
+  add_result("llm_prefill_" + std::to_string(kPrefillTokens), best,
+             std::to_string(static_cast<int>(kPrefillTokens / best)) +
+                 " prompt tok/s");
+}
+
+void bench_decode(gene_llm_model *model, int runs) {
+  gene_llm_session *session = new_session(model);
+  double best_decode = 1e30;
+  double best_ttft = 1e30;
+  for (int run = 0; run <= runs; ++run) {
+    const infer_timings t =
+        infer(session, prompt_tokens(16, 1000 + run), kDecodeTokens);
+    if (run > 0) {
+      best_decode = std::min(best_decode, t.decode_ms / 1000.0);
+      best_ttft = std::min(best_ttft, t.ttft_ms / 1000.0);
+    }
+  }
+  gene_llm_free_session(session);
+  add_result("llm_decode_" + std::to_string(kDecodeTokens), best_decode,
+             std::to_string(static_cast<int>(kDecodeTokens / best_decode)) +
+                 " tok/s");
+  add_result("llm_ttft", best_ttft, "16-token prompt");
+}
+
+// n sessions generating at once, one thread each. Wall time for all of them;
+// on a shared threadpool the sessions take turns, so this shows whether
+// interleaving keeps the total throughput up.
+void bench_sessions(gene_llm_model *model, int n, int runs) {
+  std::vector<gene_llm_session *> sessions;
+  for (int i = 0; i < n; ++i) {
+    sessions.push_back(new_session(model));
+  }
+  double best = 1e30;
+  for (int run = 0; run <= runs; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i) {
+      threads.emplace_back([&, i] {
+        infer(sessions[i], prompt_tokens(32, 2000 + run * n + i),
+              kSessionTokens);
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    if (run > 0) {
+      best = std::min(best, seconds_since(start));
+    }
+  }
+  for (gene_llm_session *s : sessions) {
+    gene_llm_free_session(s);
+  }
+  add_result("llm_sessions_" + std::to_string(n), best,
+             std::to_string(static_cast<int>(n * kSessionTokens / best)) +
+                 " tok/s total");
+}
+
+// C++ allocations per request on a warm session.
+void bench_allocations(gene_llm_model *model) {
+  constexpr int kRequests = 10;
+  gene_llm_session *session = new_session(model);
+  infer(session, prompt_tokens(32, 3000), kSessionTokens);
+  std::vector<std::vector<int32_t>> prompts;
+  for (int i = 0; i < kRequests; ++i) {
+    prompts.push_back(prompt_tokens(32, 3001 + i));
+  }
+  const uint64_t before = g_allocations.load();
+  for (const auto &prompt : prompts) {
+    infer(session, prompt, kSessionTokens);
+  }
+  const double per_request =
+      static_cast<double>(g_allocations.load() - before) / kRequests;
+  gene_llm_free_session(session);
+  add_result("llm_allocs_per_request", per_request,
+             std::to_string(kSessionTokens) + " generated tokens");
+}
+
+void compare(const char *path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::printf("No baseline at %s\n\n", path);
+    return;
+  }
+  std::printf("Comparison vs baseline:\n");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string name;
+    double base = 0.0;
+    if (!std::getline(fields, name, '\t') || !(fields >> base) || base <= 0) {
+      continue;
+    }
+    for (const result &r : g_results) {
+      if (r.name == name) {
+        const double pct = (base - r.value) / base * 100.0;
+        const char *marker =
+            pct > 0.5 ? " FASTER" : (pct < -0.5 ? " SLOWER" : "");
+        std::printf("  %-28s %+6.1f%%%s\n", name.c_str(), pct, marker);
+      }
+    }
+  }
+  std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const char *model_path = "build/llama/bench-tiny.gguf";
+  const char *baseline = nullptr;
+  int runs = 3;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--make-model" && i + 1 < argc) {
+      if (!make_model(argv[i + 1])) {
+        std::fprintf(stderr, "failed to write %s\n", argv[i + 1]);
+        return 1;
+      }
+      return 0;
+    } else if (arg == "--model" && i + 1 < argc) {
+      model_path = argv[++i];
+    } else if (arg == "--runs" && i + 1 < argc) {
+      runs = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--compare" && i + 1 < argc) {
+      baseline = argv[++i];
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--make-model PATH] [--model PATH] [--runs N] "
+                   "[--compare BASELINE]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  gene_llm_backend_init();
+  gene_llm_model_options model_options = {};
+  model_options.context_length = kCtx;
+  model_options.use_mmap = true;
+  gene_llm_model *model = nullptr;
+  gene_llm_error err = {};
+  if (gene_llm_load_model(model_path, &model_options, &model, &err) !=
+      GENE_LLM_OK) {
+    std::fprintf(stderr, "cannot load %s: %s\n", model_path, err.message);
+    return 1;
+  }
+
+  std::printf("gene_llm shim benchmarks (%s, best of %d, %d threads)\n",
+              model_path, runs, gene_llm_threadpool_size());
+  std::printf("%s\n", std::string(65, '-').c_str());
+  bench_prefill(model, runs);
+  bench_decode(model, runs);
+  for (int n : {1, 2, 4}) {
+    bench_sessions(model, n, runs);
+  }
+  bench_allocations(model);
+  std::printf("%s\n\n", std::string(65, '-').c_str());
+  gene_llm_free_model(model);
+
+  if (baseline) {
+    compare(baseline);
+  }
+  std::printf("# Machine-readable results (name<TAB>best_seconds)\n");
+  for (const result &r : g_results) {
+    std::printf("%s\t%.6f\n", r.name.c_str(), r.value);
+  }
+  return 0;
+}
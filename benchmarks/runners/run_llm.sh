@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# LLM Shim Benchmark Runner
+# Runs the gene_llm shim benchmarks against the tiny generated model
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+BENCH_DIR="$(dirname "$SCRIPT_DIR")"
+ROOT_DIR="$(dirname "$BENCH_DIR")"
+LLAMA_BUILD_DIR="$ROOT_DIR/build/llama"
+BENCH_BIN="$LLAMA_BUILD_DIR/gene_llm_bench"
+MODEL="${GENE_LLM_BENCH_MODEL:-$LLAMA_BUILD_DIR/bench-tiny.gguf}"
+BASELINE="$BENCH_DIR/llm/baseline.txt"
+
+echo "========================================="
+echo "    LLM Shim Benchmarks"
+echo "========================================="
+echo ""
+
+if [ ! -x "$BENCH_BIN" ]; then
+    echo "Error: $BENCH_BIN not found. Build the runtime first:"
+    echo "  tools/build_llama_runtime.sh"
+    exit 1
+fi
+
+if [ ! -f "$MODEL" ]; then
+    echo "Generating tiny benchmark model: $MODEL"
+    "$BENCH_BIN" --make-model "$MODEL"
+fi
+
+ARGS=(--model "$MODEL" --runs "${GENE_LLM_BENCH_RUNS:-3}")
+if [ -f "$BASELINE" ]; then
+    ARGS+=(--compare "$BASELINE")
+fi
+
+"$BENCH_BIN" "${ARGS[@]}"
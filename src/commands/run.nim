@@ -283,7 +283,7 @@ proc handle*(cmd: string, args: seq[string]): CommandResult =
     let start = cpu_time()
     var compiled: CompilationUnit
     try:
-      compiled = load_gir(file)
+      compiled = load_gir(file, lazy = true)
     except CatchableError as e:
       return failure("Loading GIR file: " & e.msg)
 
@@ -315,7 +315,7 @@ proc handle*(cmd: string, args: seq[string]): CommandResult =
       let start = cpu_time()
       var compiled: CompilationUnit
       try:
-        compiled = load_gir(gir_path)
+        compiled = load_gir(gir_path, lazy = true)
       except CatchableError:
         compiled = nil
         if options.debugging:
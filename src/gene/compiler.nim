@@ -656,6 +656,14 @@ proc compile*(f: Function, eager_functions: bool) =
   if f.body_compiled != nil:
     ensure_inline_caches_ready(f.body_compiled)
     return
+  if f.lazy_body != nil:
+    let cu = force_lazy_body(f.lazy_body)
+    ensure_inline_caches_ready(cu)
+    f.body_compiled = cu
+    f.body_compiled.matcher = f.matcher
+    if f.matcher != nil and cu.type_descriptors.len > 0:
+      f.matcher.type_descriptors = cu.type_descriptors
+    return
 
   var self = Compiler(
     output: new_compilation_unit(),
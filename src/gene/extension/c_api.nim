@@ -1,8 +1,11 @@
 # C API implementation for Gene extensions
 # This module exports C-compatible functions for use by C extensions
 
+import tables
+
 import ../types
 import ../text_utils
+import ../native/trampoline
 
 # Export value conversion functions
 proc gene_to_value_int*(i: int64): Value {.exportc, dynlib.} =
@@ -82,6 +85,171 @@ proc gene_is_nil*(v: Value): bool {.exportc, dynlib.} =
   ## Check if value is NIL
   v == NIL
 
+# Bulk construction and borrowed access
+#
+# Values passed into gene_array_push* and gene_map_set_key are adopted: the
+# container takes over the caller's reference, so results of the
+# gene_to_value_* / gene_new_* constructors can be handed over without an
+# extra retain/release pair per element. When the target is not a mutable
+# container the adopted references are released instead.
+
+proc c_free(p: pointer) {.cdecl, importc: "free", header: "<stdlib.h>".}
+
+template adopt(v: Value): Value =
+  Value(raw: v.raw)
+
+proc gene_new_array_with_capacity*(capacity: int64): Value {.exportc, dynlib.} =
+  ## Create an empty array with room for `capacity` elements
+  result = new_array_value()
+  if capacity > 0 and capacity <= high(int).int64:
+    array_data(result) = newSeqOfCap[Value](capacity.int)
+
+proc gene_array_push*(arr: Value, value: Value) {.exportc, dynlib.} =
+  ## Append one value, adopting the caller's reference
+  if arr.kind != VkArray or array_is_frozen(arr):
+    release(value)
+    return
+  array_data(arr).add(adopt(value))
+
+proc gene_array_push_n*(arr: Value, values: ptr UncheckedArray[Value], count: int64): int64 {.exportc, dynlib.} =
+  ## Append `count` values with one resize, adopting the caller's references
+  if values == nil or count <= 0:
+    return 0
+  if arr.kind != VkArray or array_is_frozen(arr):
+    for i in 0..<count.int:
+      release(values[i])
+    return 0
+  let n = count.int
+  let start = array_data(arr).len
+  array_data(arr).setLen(start + n)
+  copyMem(addr array_data(arr)[start], addr values[0], n * sizeof(Value))
+  count
+
+proc gene_array_len*(arr: Value): int64 {.exportc, dynlib.} =
+  ## Return the number of elements, or 0 if not an array
+  if arr.kind == VkArray:
+    array_data(arr).len.int64
+  else:
+    0
+
+proc gene_array_get*(arr: Value, index: int64): Value {.exportc, dynlib.} =
+  ## Return the element at index, or NIL when out of range
+  if arr.kind != VkArray or index < 0 or index >= array_data(arr).len.int64:
+    return NIL
+  array_data(arr)[index.int]
+
+proc gene_array_data*(arr: Value, out_len: ptr int64): ptr Value {.exportc, dynlib.} =
+  ## Borrow the element storage; valid until the array is modified
+  if out_len != nil:
+    out_len[] = 0
+  if arr.kind != VkArray or array_data(arr).len == 0:
+    return nil
+  if out_len != nil:
+    out_len[] = array_data(arr).len.int64
+  addr array_data(arr)[0]
+
+proc gene_to_key*(s: cstring): Key {.exportc, dynlib.} =
+  ## Intern a symbol name as a map/namespace key
+  if s == nil:
+    return "".to_key()
+  ($s).to_key()
+
+proc gene_new_map*(capacity: int64): Value {.exportc, dynlib.} =
+  ## Create an empty map with room for `capacity` entries
+  if capacity > 0 and capacity <= high(int32).int64:
+    new_map_value(initTable[Key, Value](capacity.int))
+  else:
+    new_map_value()
+
+proc gene_map_set_key*(map: Value, key: Key, value: Value) {.exportc, dynlib.} =
+  ## Set an entry by pre-interned key, adopting the caller's reference
+  if map.kind != VkMap or map_is_frozen(map):
+    release(value)
+    return
+  map_data(map)[key] = adopt(value)
+
+proc gene_map_get_key*(map: Value, key: Key): Value {.exportc, dynlib.} =
+  ## Look up an entry by pre-interned key; NIL when missing
+  if map.kind != VkMap:
+    return NIL
+  map_data(map).getOrDefault(key, NIL)
+
+proc gene_map_len*(map: Value): int64 {.exportc, dynlib.} =
+  ## Return the number of entries, or 0 if not a map
+  if map.kind == VkMap:
+    map_data(map).len.int64
+  else:
+    0
+
+proc gene_new_bytes*(data: ptr uint8, len: int64): Value {.exportc, dynlib.} =
+  ## Copy a length-delimited binary buffer into a bytes value
+  if len < 0 or (data == nil and len > 0) or len > high(int).int64:
+    return NIL
+  if len == 0:
+    return new_bytes_value([])
+  new_bytes_value(toOpenArray(cast[ptr UncheckedArray[uint8]](data), 0, len.int - 1))
+
+proc gene_new_bytes_adopt*(data: ptr uint8, len: int64, release: BytesReleaseFn): Value {.exportc, dynlib.} =
+  ## Wrap an extension buffer without copying; `release` (free() when NULL)
+  ## runs when the value is collected
+  if data == nil or len < 0 or len > high(int).int64:
+    return NIL
+  let r = new_ref(VkBytes)
+  r.bytes_foreign = cast[ptr UncheckedArray[uint8]](data)
+  r.bytes_foreign_len = len.int
+  r.bytes_release = if release == nil: c_free else: release
+  r.to_ref_value()
+
+proc gene_bytes_data*(v: Value, out_len: ptr int64): ptr uint8 {.exportc, dynlib.} =
+  ## Borrow the bytes of a heap bytes value. Values of 6 bytes or less are
+  ## packed into the Value itself and return NULL; use gene_bytes_copy.
+  if out_len != nil:
+    out_len[] = 0
+  if v.kind != VkBytes:
+    return nil
+  if out_len != nil:
+    out_len[] = bytes_len(v).int64
+  if (v.raw and 0xFFFF_0000_0000_0000u64) != REF_TAG:
+    return nil
+  let r = v.ref
+  if r.bytes_foreign != nil:
+    return addr r.bytes_foreign[0]
+  if r.bytes_data.len == 0:
+    return nil
+  addr r.bytes_data[0]
+
+proc gene_bytes_copy*(v: Value, dest: ptr uint8, capacity: int64): int64 {.exportc, dynlib.} =
+  ## Copy up to `capacity` bytes into dest; returns the number copied
+  if v.kind != VkBytes or dest == nil or capacity <= 0:
+    return 0
+  let n = min(bytes_len(v).int64, capacity).int
+  let out_buf = cast[ptr UncheckedArray[uint8]](dest)
+  for i in 0 ..< n:
+    out_buf[i] = bytes_at(v, i)
+  n.int64
+
+proc gene_string_data*(v: Value, out_len: ptr int64): cstring {.exportc, dynlib.} =
+  ## Borrow a string's UTF-8 bytes (NUL-terminated, may contain NULs);
+  ## valid while the value is alive
+  if out_len != nil:
+    out_len[] = 0
+  let tag = v.raw and 0xFFFF_0000_0000_0000u64
+  if tag == STRING_TAG:
+    let s = cast[ptr String](v.raw and PAYLOAD_MASK)
+    if s == nil or s.str.len == 0:
+      return cstring("")
+    if out_len != nil:
+      out_len[] = s.str.len.int64
+    return cast[cstring](addr s.str[0])
+  if tag == REF_TAG and v.ref.kind == VkString:
+    let r = v.ref
+    if r.str.len == 0:
+      return cstring("")
+    if out_len != nil:
+      out_len[] = r.str.len.int64
+    return cast[cstring](addr r.str[0])
+  nil
+
 # Namespace functions
 proc gene_new_namespace*(name: cstring): Namespace {.exportc, dynlib.} =
   ## Create a new namespace
@@ -109,6 +277,17 @@ proc gene_wrap_native_fn*(fn: NativeFn): Value {.exportc, dynlib.} =
   r.native_fn = fn
   r.to_ref_value()
 
+proc gene_wrap_typed_native_fn*(fn: NativeFn, typed_fn: pointer, signature: cstring): Value {.exportc, dynlib.} =
+  ## Wrap a native function with a signature such as "i64,f64,string -> f64"
+  ## and an optional unboxed C entry; NIL on a malformed signature
+  if fn == nil or signature == nil:
+    return NIL
+  var arg_types: seq[CallArgType]
+  var return_type: CallReturnType
+  if not parse_native_signature($signature, arg_types, return_type):
+    return NIL
+  wrap_typed_native_fn(fn, typed_fn, arg_types, return_type)
+
 # Argument helpers
 proc gene_get_arg*(args: ptr Value, arg_count: cint, has_keyword_args: bool, index: cint): Value {.exportc, dynlib.} =
   ## Get positional argument at index
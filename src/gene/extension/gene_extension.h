@@ -47,7 +47,7 @@ typedef uint64_t Key;
 
 /* ========== ABI Types ========== */
 
-#define GENE_EXT_ABI_VERSION 8u
+#define GENE_EXT_ABI_VERSION 13u
 
 typedef enum GeneExtStatus {
     GENE_EXT_OK = 0,
@@ -75,6 +75,48 @@ typedef int32_t (*GeneHostActorReplyFn)(Value ctx, Value payload);
 typedef int32_t (*GeneHostActorReplySerializedFn)(Value ctx, const char* payload_ser);
 typedef int32_t (*GeneHostPollVmFn)(void* vm_user_data);
 
+/**
+ * Blocking work for submit_blocking_fn.
+ * work_fn runs on a host pool thread and must not touch Gene values.
+ * complete_fn runs on the submitting VM thread with work_fn's result; it
+ * sets *out_value and returns GENE_EXT_OK to resolve the future, or another
+ * status to fail it (a string *out_value becomes the error message).
+ * If the pool shuts down before work_fn runs, complete_fn still runs with a
+ * NULL work_result so it can release user_data; the future then fails.
+ */
+typedef void* (*GeneBlockingWorkFn)(void* user_data);
+typedef int32_t (*GeneBlockingCompleteFn)(void* work_result, void* user_data, Value* out_value);
+typedef int32_t (*GeneHostSubmitBlockingFn)(GeneBlockingWorkFn work_fn,
+                                            GeneBlockingCompleteFn complete_fn,
+                                            void* user_data, Value* out_future);
+
+/**
+ * Event channel: a bounded lock-free ring from extension threads to the VM
+ * thread that opened it. Pushes never block; a full ring returns
+ * GENE_EXT_OVERLOADED and a closed one GENE_EXT_STOPPED. The VM drains up
+ * to max_batch records at a time (0 picks the default) and calls handler
+ * with an array of them: bytes for byte records, the value otherwise.
+ * Pushed values must be immediates or shared, deep-frozen values; the
+ * channel takes over the caller's reference when the push succeeds. With
+ * GENE_EVENT_CHANNEL_SINGLE_PRODUCER only one thread may push at a time.
+ * Close drops the opener's reference; pending records are still delivered.
+ * A producer thread that may push after close must take its own reference
+ * with retain (while a reference is still held) and drop it with release
+ * when it stops; until then its pushes safely return GENE_EXT_STOPPED.
+ */
+typedef struct GeneEventChannel GeneEventChannel;
+
+#define GENE_EVENT_CHANNEL_SINGLE_PRODUCER 1u
+
+typedef int32_t (*GeneHostOpenEventChannelFn)(uint32_t capacity, uint32_t flags, uint32_t max_batch,
+                                              Value handler, GeneEventChannel** out_channel);
+typedef int32_t (*GeneHostEventChannelPushBytesFn)(GeneEventChannel* channel, const uint8_t* data,
+                                                   uint32_t len);
+typedef int32_t (*GeneHostEventChannelPushValueFn)(GeneEventChannel* channel, Value value);
+typedef void (*GeneHostEventChannelCloseFn)(GeneEventChannel* channel);
+typedef void (*GeneHostEventChannelRetainFn)(GeneEventChannel* channel);
+typedef void (*GeneHostEventChannelReleaseFn)(GeneEventChannel* channel);
+
 /**
  * Host ABI passed to gene_init.
  */
@@ -90,8 +132,15 @@ typedef struct GeneHostAbi {
     GeneHostCallPortFn call_port_fn;         /* optional extension port call hook */
     GeneHostCallPortAsyncFn call_port_async_fn; /* optional async extension port call hook */
     GeneHostActorReplyFn actor_reply_fn; /* optional host actor reply hook */
-    GeneHostActorReplySerializedFn actor_reply_serialized_fn; /* optional host actor reply hook for serialized payloads */
+    GeneHostActorReplySerializedFn actor_reply_serialized_fn; /* optional host actor reply hook for serialized payloads (Gene text or gene/serdes binary) */
     GeneHostPollVmFn poll_vm_fn; /* optional host VM/event-loop poll hook */
+    GeneHostSubmitBlockingFn submit_blocking_fn; /* run blocking work on the host pool; GENE_EXT_OVERLOADED when its queue is full */
+    GeneHostOpenEventChannelFn open_event_channel_fn; /* open a lock-free event channel drained on this VM */
+    GeneHostEventChannelPushBytesFn event_channel_push_bytes_fn; /* copy a byte record in; callable from any thread */
+    GeneHostEventChannelPushValueFn event_channel_push_value_fn; /* move a shared/immediate value in; callable from any thread */
+    GeneHostEventChannelCloseFn event_channel_close_fn; /* stop pushing; pending records are still delivered */
+    GeneHostEventChannelRetainFn event_channel_retain_fn; /* add a producer reference; callable from any thread */
+    GeneHostEventChannelReleaseFn event_channel_release_fn; /* drop a producer reference; callable from any thread */
     Namespace** result_namespace;  /* extension sets this to its namespace */
 } GeneHostAbi;
 
@@ -111,6 +160,11 @@ typedef Value (*NativeFn)(VirtualMachine* vm, Value* args,
 
 typedef int32_t (*GeneExtensionInitFn)(GeneHostAbi* host);
 
+/**
+ * GeneBytesReleaseFn - Frees a buffer adopted by gene_new_bytes_adopt
+ */
+typedef void (*GeneBytesReleaseFn)(void* data);
+
 /* ========== Value Conversion Functions ========== */
 
 /**
@@ -181,6 +235,118 @@ extern bool gene_to_bool(Value v);
  */
 extern bool gene_is_nil(Value v);
 
+/* ========== Arrays, Maps and Bytes ========== */
+
+/*
+ * Values passed to gene_array_push, gene_array_push_n and gene_map_set_key
+ * are adopted: the container takes over the caller's reference, so values
+ * fresh from gene_to_value_* / gene_new_* need no further bookkeeping. The
+ * reference is consumed even when the target is not a mutable container:
+ * the value is released then.
+ * Pointers returned by the *_data accessors are borrowed from the VM.
+ */
+
+/**
+ * Create an empty array with room for capacity elements
+ */
+extern Value gene_new_array_with_capacity(int64_t capacity);
+
+/**
+ * Append a value to an array
+ * If arr is not a mutable array, value is released instead
+ */
+extern void gene_array_push(Value arr, Value value);
+
+/**
+ * Append count values to an array with a single resize
+ * Returns the number of values appended; if arr is not a mutable array
+ * nothing is appended, the values are released and 0 is returned
+ */
+extern int64_t gene_array_push_n(Value arr, const Value* values, int64_t count);
+
+/**
+ * Return the number of elements in an array
+ * Returns 0 if value is not an array
+ */
+extern int64_t gene_array_len(Value arr);
+
+/**
+ * Get the element at index
+ * Returns NIL if value is not an array or index is out of range
+ */
+extern Value gene_array_get(Value arr, int64_t index);
+
+/**
+ * Borrow an array's element storage and store its length in out_len
+ * Returns NULL for empty arrays and non-arrays
+ * Note: Valid until the array is modified, do not free
+ */
+extern const Value* gene_array_data(Value arr, int64_t* out_len);
+
+/**
+ * Intern a symbol name as a Key
+ * Intern keys once (e.g. column names) and reuse them for every row
+ */
+extern Key gene_to_key(const char* name);
+
+/**
+ * Create an empty map with room for capacity entries
+ */
+extern Value gene_new_map(int64_t capacity);
+
+/**
+ * Set a map entry by key
+ * If map is not a mutable map, value is released instead
+ */
+extern void gene_map_set_key(Value map, Key key, Value value);
+
+/**
+ * Get a map entry by key
+ * Returns NIL if value is not a map or key is missing
+ */
+extern Value gene_map_get_key(Value map, Key key);
+
+/**
+ * Return the number of entries in a map
+ * Returns 0 if value is not a map
+ */
+extern int64_t gene_map_len(Value map);
+
+/**
+ * Copy a length-delimited binary buffer into a bytes value
+ * Returns NIL on NULL input with nonzero length or negative length
+ */
+extern Value gene_new_bytes(const uint8_t* data, int64_t len);
+
+/**
+ * Wrap a malloc'd buffer as a bytes value without copying
+ * The VM owns the buffer afterwards and calls release (free() when NULL)
+ * once the value is collected
+ */
+extern Value gene_new_bytes_adopt(uint8_t* data, int64_t len, GeneBytesReleaseFn release);
+
+/**
+ * Borrow the contents of a bytes value and store its length in out_len
+ * Returns NULL for non-bytes and for values of 6 bytes or less, which are
+ * stored inside the Value itself; use gene_bytes_copy for those
+ * Note: Valid while the value is alive, do not free
+ */
+extern const uint8_t* gene_bytes_data(Value v, int64_t* out_len);
+
+/**
+ * Copy up to capacity bytes of a bytes value into dest
+ * Returns the number of bytes copied
+ */
+extern int64_t gene_bytes_copy(Value v, uint8_t* dest, int64_t capacity);
+
+/**
+ * Borrow a string's UTF-8 bytes and store the byte length in out_len
+ * Unlike gene_to_string, works for strings with embedded NUL bytes
+ * Returns NULL if value is not a string
+ * Note: Valid while the value is alive, do not free
+ */
+extern const char* gene_string_data(Value v, int64_t* out_len);
+
 /* ========== Namespace Functions ========== */
 
 /**
@@ -211,6 +377,26 @@ extern Value gene_namespace_get(Namespace* ns, const char* key);
  */
 extern Value gene_wrap_native_fn(NativeFn fn);
 
+/**
+ * Wrap a C function pointer together with its signature
+ *
+ * signature lists argument types and the return type, e.g.
+ * "i64,f64,string -> f64". Types are i64 (int64_t), f64 (double) and
+ * value (Value; "string" and "any" are accepted as aliases, use
+ * gene_string_data to read strings).
+ *
+ * typed_fn, if not NULL, is the same function taking unboxed arguments:
+ *   double scale(int64_t n, double factor, Value label);
+ * Calls whose arguments match the signature go straight to typed_fn, from the
+ * interpreter and from natively compiled typed Gene code; all other calls use
+ * fn. Value arguments are borrowed; a Value result is owned by the caller.
+ * typed_fn is ignored for signatures with more than 6 i64/value or 8 f64
+ * arguments and on Windows.
+ *
+ * Returns NIL if the signature cannot be parsed
+ */
+extern Value gene_wrap_typed_native_fn(NativeFn fn, const void* typed_fn, const char* signature);
+
 /* ========== Argument Helpers ========== */
 
 /**
@@ -1,10 +1,16 @@
 # Gene Intermediate Representation (GIR) serialization/deserialization
-import streams, hashes, os, times, json, strutils, tables
+#
+# Loads map the file read-only instead of reading it through a FileStream,
+# so worker processes running the same `.gir` share its pages. Function
+# bodies are stored with their byte length; a lazy load records the offset
+# of each body and skips it, and the body's constants and instructions are
+# decoded on the function's first call.
+import streams, hashes, os, times, json, strutils, tables, memfiles, locks
 import ./types
 
 const
   GIR_MAGIC = "GENE"
-  GIR_VERSION* = 23'u32  # S05: legacy Gene-expression ADT pattern/type compatibility removed.
+  GIR_VERSION* = 24'u32  # Function bodies are length-prefixed for lazy loading.
   COMPILER_VERSION* = "0.1.3"
   VALUE_ABI_VERSION* = 2'u32  # Version 2: Value is object wrapper with GC
   INSTRUCTION_ABI_VERSION* = 3'u32  # Version 3: HashMap opcodes added
@@ -61,6 +67,79 @@ type
     type_registry*: ModuleTypeRegistry
     type_aliases*: Table[string, TypeId]
 
+type
+  # Keeps a mapped GIR file open while lazy bodies still point into it.
+  GirMappingObj = object
+    file: MemFile
+  GirMapping = ref GirMappingObj
+
+  GirMappedStream = ref object of StreamObj
+    mapping: GirMapping
+    data: ptr UncheckedArray[uint8]
+    size: int
+    pos: int
+    path: string
+    lazy: bool  # skip function bodies, decoding them on first call
+
+proc `=destroy`(m: GirMappingObj) =
+  if m.file.mem != nil:
+    var file = m.file
+    try:
+      file.close()
+    except CatchableError:
+      discard
+
+proc gir_mapped_read(s: Stream, buffer: pointer, buf_len: int): int =
+  let m = GirMappedStream(s)
+  result = max(0, min(buf_len, m.size - m.pos))
+  if result > 0:
+    copyMem(buffer, addr m.data[m.pos], result)
+    m.pos += result
+
+proc gir_mapped_peek(s: Stream, buffer: pointer, buf_len: int): int =
+  let m = GirMappedStream(s)
+  result = max(0, min(buf_len, m.size - m.pos))
+  if result > 0:
+    copyMem(buffer, addr m.data[m.pos], result)
+
+proc gir_mapped_set_position(s: Stream, pos: int) =
+  let m = GirMappedStream(s)
+  m.pos = clamp(pos, 0, m.size)
+
+proc gir_mapped_get_position(s: Stream): int =
+  GirMappedStream(s).pos
+
+proc gir_mapped_at_end(s: Stream): bool =
+  let m = GirMappedStream(s)
+  m.pos >= m.size
+
+proc gir_mapped_close(s: Stream) =
+  GirMappedStream(s).mapping = nil
+
+proc new_gir_mapped_stream(mapping: GirMapping, path: string, pos: int,
+                           lazy: bool): GirMappedStream =
+  result = GirMappedStream(
+    mapping: mapping,
+    data: cast[ptr UncheckedArray[uint8]](mapping.file.mem),
+    size: mapping.file.size,
+    pos: pos,
+    path: path,
+    lazy: lazy
+  )
+  result.readDataImpl = gir_mapped_read
+  result.peekDataImpl = gir_mapped_peek
+  result.setPositionImpl = gir_mapped_set_position
+  result.getPositionImpl = gir_mapped_get_position
+  result.atEndImpl = gir_mapped_at_end
+  result.closeImpl = gir_mapped_close
+
+proc map_gir_file(path: string): GirMapping =
+  result = GirMapping()
+  try:
+    result.file = memfiles.open(path, mode = fmRead)
+  except CatchableError as e:
+    raise new_exception(types.Exception, "Failed to open GIR file: " & path & ": " & e.msg)
+
 proc compute_source_hash(source_content: string): Hash =
   let raw_hash = cast[uint64](hash(source_content))
   let truncated = raw_hash and 0x7FFF_FFFF_FFFF_FFFF'u64
@@ -302,6 +381,24 @@ proc readCompilationUnitBlock(stream: Stream): CompilationUnit
 proc write_value(stream: Stream, v: Value)
 proc read_value(stream: Stream): Value
 
+proc function_def_body(info: FunctionDefInfo): CompilationUnit =
+  if info.compiled_body.kind == VkCompiledUnit:
+    return info.compiled_body.ref.cu
+  if info.lazy_body != nil:
+    acquire(body_publication_lock)
+    defer: release(body_publication_lock)
+    return force_lazy_body(info.lazy_body)
+
+proc lazy_gir_body(stream: GirMappedStream, offset: int): LazyCompiledBody =
+  let mapping = stream.mapping
+  let path = stream.path
+  LazyCompiledBody(decode: proc(): CompilationUnit {.gcsafe.} =
+    {.cast(gcsafe).}:
+      let body_stream = new_gir_mapped_stream(mapping, path, offset, lazy = true)
+      result = readCompilationUnitBlock(body_stream)
+      verify_type_metadata(result, phase = "GIR load", source_path = path)
+  )
+
 proc writeFunctionDef(stream: Stream, info: FunctionDefInfo) =
   write_value(stream, info.input)
   writeScopeTrackerSnapshot(stream, snapshot_scope_tracker(info.scope_tracker))
@@ -309,9 +406,17 @@ proc writeFunctionDef(stream: Stream, info: FunctionDefInfo) =
   for type_id in info.type_expectation_ids:
     stream.write(type_id.int32)
   stream.write(info.return_type_id.int32)
-  if info.compiled_body.kind == VkCompiledUnit:
+  let body = function_def_body(info)
+  if body != nil:
     stream.write(1'u8)
-    writeCompilationUnitBlock(stream, info.compiled_body.ref.cu)
+    # Byte length first, so lazy loads can step over the body.
+    let len_pos = stream.getPosition()
+    stream.write(0'u32)
+    writeCompilationUnitBlock(stream, body)
+    let end_pos = stream.getPosition()
+    stream.setPosition(len_pos)
+    stream.write(uint32(end_pos - len_pos - 4))
+    stream.setPosition(end_pos)
   else:
     stream.write(0'u8)
 
@@ -324,15 +429,23 @@ proc readFunctionDef(stream: Stream): FunctionDefInfo =
     type_expectation_ids.add(stream.readInt32())
   let return_type_id = stream.readInt32()
   var compiled_value = NIL
+  var lazy_body: LazyCompiledBody = nil
   if stream.readUint8() == 1:
-    let compiled = readCompilationUnitBlock(stream)
-    let ref_value = new_ref(VkCompiledUnit)
-    ref_value.cu = compiled
-    compiled_value = ref_value.to_ref_value()
+    let body_len = stream.readUint32().int
+    let body_start = stream.getPosition()
+    if stream of GirMappedStream and GirMappedStream(stream).lazy:
+      lazy_body = lazy_gir_body(GirMappedStream(stream), body_start)
+      stream.setPosition(body_start + body_len)
+    else:
+      let compiled = readCompilationUnitBlock(stream)
+      let ref_value = new_ref(VkCompiledUnit)
+      ref_value.cu = compiled
+      compiled_value = ref_value.to_ref_value()
   result = FunctionDefInfo(
     input: input,
     scope_tracker: materialize_scope_tracker(snapshot),
     compiled_body: compiled_value,
+    lazy_body: lazy_body,
     type_expectation_ids: type_expectation_ids,
     return_type_id: return_type_id
   )
@@ -637,17 +750,7 @@ proc build_trace_index(nodes: seq[SourceTrace]): Table[pointer, int] =
     result[cast[pointer](node)] = idx
 
 # Main serialization functions
-proc save_gir*(cu: CompilationUnit, path: string, source_path: string = "", debug: bool = false) =
-  ## Save a compilation unit to a GIR file
-  let dir = path.parentDir()
-  if dir != "" and not dirExists(dir):
-    createDir(dir)
-  
-  var stream = newFileStream(path, fmWrite)
-  if stream == nil:
-    raise new_exception(types.Exception, "Failed to open file for writing: " & path)
-  defer: stream.close()
-  
+proc write_gir(stream: Stream, cu: CompilationUnit, source_path: string, debug: bool) =
   # Write header
   var header: GirHeader
   header.magic = ['G', 'E', 'N', 'E']
@@ -733,14 +836,34 @@ proc save_gir*(cu: CompilationUnit, path: string, source_path: string = "", debu
   writeModuleTypeRegistry(stream, cu.type_registry)
   writeTypeAliases(stream, cu.type_aliases)
 
-proc load_gir_file*(path: string): GirFile =
-  ## Load a GIR file and return its structured contents
+proc save_gir*(cu: CompilationUnit, path: string, source_path: string = "", debug: bool = false) =
+  ## Save a compilation unit to a GIR file
+  let dir = path.parentDir()
+  if dir != "" and not dirExists(dir):
+    createDir(dir)
+
+  # Write next to the target and rename over it, so processes that still
+  # have the old file mapped keep reading the old contents.
+  let tmp_path = path & ".tmp" & $getCurrentProcessId()
+  var stream = newFileStream(tmp_path, fmWrite)
+  if stream == nil:
+    raise new_exception(types.Exception, "Failed to open file for writing: " & path)
+  try:
+    stream.write_gir(cu, source_path, debug)
+  except CatchableError:
+    stream.close()
+    removeFile(tmp_path)
+    raise
+  stream.close()
+  moveFile(tmp_path, path)
+
+proc load_gir_file*(path: string, lazy = false): GirFile =
+  ## Load a GIR file and return its structured contents. With `lazy`, the
+  ## compiled bodies of functions stay in the mapped file until first call.
   if not fileExists(path):
     raise new_exception(types.Exception, "GIR file not found: " & path)
 
-  var stream = newFileStream(path, fmRead)
-  if stream == nil:
-    raise new_exception(types.Exception, "Failed to open GIR file: " & path)
+  var stream: Stream = new_gir_mapped_stream(map_gir_file(path), path, 0, lazy)
   defer: stream.close()
 
   var header: GirHeader
@@ -847,9 +970,9 @@ proc load_gir_file*(path: string): GirFile =
   result.type_registry = type_registry
   result.type_aliases = type_aliases
 
-proc load_gir*(path: string): CompilationUnit =
+proc load_gir*(path: string, lazy = false): CompilationUnit =
   ## Load a compilation unit from a GIR file
-  let gir_file = load_gir_file(path)
+  let gir_file = load_gir_file(path, lazy)
   result = new_compilation_unit()
   result.instructions = gir_file.instructions
   result.inline_caches.setLen(result.instructions.len)
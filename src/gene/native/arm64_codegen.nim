@@ -715,7 +715,32 @@ proc genCall*(ctx: CodegenContext, op: HirOp) =
   ctx.recursiveCallFixups.add(offset)
   ctx.cachedStore(op.dest, X0)
 
+proc genDirectNativeCall(ctx: CodegenContext, op: HirOp, desc: CallDescriptor) =
+  ## Call a typed native fn's C entry with unboxed AAPCS64 arguments.
+  var nextInt = 0
+  var nextFloat = 0
+  for i in 0..<op.callVmArgs.len:
+    if desc.argTypes[i] == CatFloat64:
+      ctx.loadRegF64(DReg(nextFloat), op.callVmArgs[i])  # cache is write-through
+      nextFloat.inc()
+    else:
+      ctx.cachedLoad(Arm64Reg(nextInt), op.callVmArgs[i])
+      nextInt.inc()
+
+  ctx.invalidateCache()  # blr clobbers caller-saved regs
+  ctx.buf.emitMovImm64(X8, cast[int64](desc.directEntry))
+  ctx.buf.emitBlr(X8)
+
+  if desc.returnType == CrtFloat64:
+    ctx.buf.emitFmovToGpr(X0, D0)
+  ctx.cachedStore(op.dest, X0)
+
 proc genCallVM*(ctx: CodegenContext, op: HirOp) =
+  let desc = ctx.fn.callDescriptors[op.callVmDescIdx]
+  if desc.directEntry != nil:
+    ctx.genDirectNativeCall(op, desc)
+    return
+
   if op.callVmArgs.len > ctx.callArgSlots:
     raise newException(ValueError, "Too many arguments for trampoline call: " & $op.callVmArgs.len)
 
@@ -184,7 +184,11 @@ proc getDescriptorIndex(ctx: ConversionContext, callable: Value,
   if key in ctx.descriptorMap:
     return ctx.descriptorMap[key]
   let idx = ctx.descriptors.len.int32
-  ctx.descriptors.add(CallDescriptor(callable: callable, argTypes: argTypes, returnType: returnType))
+  var desc = CallDescriptor(callable: callable, argTypes: argTypes, returnType: returnType)
+  if callable.kind == VkNativeFn and callable.ref.native_typed != nil and
+      callable.ref.native_typed.argTypes == argTypes:
+    desc.directEntry = callable.ref.native_typed.entry
+  ctx.descriptors.add(desc)
   retain(callable)
   ctx.descriptorMap[key] = idx
   idx
@@ -1,7 +1,9 @@
-import std/tables
+import std/[tables, strutils]
 import ../types
 import ../types/core
 
+export CallDescriptor, CallArgType, CallReturnType
+
 type
   NativeFnSig* = object
     argTypes*: seq[CallArgType]
@@ -19,6 +21,101 @@ proc lookup_native_sig*(fn: NativeFn, sig: var NativeFnSig): bool =
     return true
   false
 
+# ==================== Typed Native Functions ====================
+#
+# A typed native fn carries, next to its boxed NativeFn, a plain C entry that
+# takes unboxed arguments. Only register-passed signatures qualify, so the
+# interpreter can reach any of them through one over-wide function type (unused
+# registers are ignored by the callee) and codegen can load the registers
+# directly. Windows x64 assigns registers by position and is not supported.
+
+const
+  MaxTypedIntArgs* = 6    # System V integer argument registers
+  MaxTypedFloatArgs* = 8  # xmm0-7 / d0-d7
+
+type
+  TypedInvokeI64 = proc(i0, i1, i2, i3, i4, i5: int64;
+                        f0, f1, f2, f3, f4, f5, f6, f7: float64): int64 {.cdecl.}
+  TypedInvokeF64 = proc(i0, i1, i2, i3, i4, i5: int64;
+                        f0, f1, f2, f3, f4, f5, f6, f7: float64): float64 {.cdecl.}
+
+proc typed_entry_supported*(argTypes: seq[CallArgType]): bool =
+  when defined(windows):
+    false
+  else:
+    var ints = 0
+    var floats = 0
+    for t in argTypes:
+      if t == CatFloat64: floats.inc() else: ints.inc()
+    ints <= MaxTypedIntArgs and floats <= MaxTypedFloatArgs
+
+proc parse_native_type(name: string, arg: var CallArgType, ret: var CallReturnType): bool =
+  case name
+  of "i64", "int":
+    arg = CatInt64
+    ret = CrtInt64
+  of "f64", "float":
+    arg = CatFloat64
+    ret = CrtFloat64
+  of "value", "any", "string":
+    arg = CatValue
+    ret = CrtValue
+  else:
+    return false
+  true
+
+proc parse_native_signature*(sig: string, argTypes: var seq[CallArgType],
+                             returnType: var CallReturnType): bool =
+  ## Parse "i64,f64,string -> f64". Types: i64/int, f64/float, value/any/string
+  ## (strings and other values travel as boxed Value bits).
+  let arrow = sig.find("->")
+  if arrow < 0:
+    return false
+  argTypes = @[]
+  var arg: CallArgType
+  var ret: CallReturnType
+  let params = sig[0 ..< arrow].strip()
+  if params.len > 0:
+    for part in params.split(','):
+      if not parse_native_type(part.strip(), arg, ret):
+        return false
+      argTypes.add(arg)
+  if not parse_native_type(sig[arrow + 2 .. ^1].strip(), arg, ret):
+    return false
+  returnType = ret
+  true
+
+proc wrap_typed_native_fn*(fn: NativeFn, entry: pointer, argTypes: seq[CallArgType],
+                           returnType: CallReturnType): Value =
+  ## Wrap a native fn together with its signature. The signature lets native
+  ## codegen lower calls to it; `entry`, when given and register-passable, is
+  ## called directly with unboxed arguments instead of going through `fn`.
+  let r = new_ref(VkNativeFn)
+  r.native_fn = fn
+  if entry != nil and typed_entry_supported(argTypes):
+    var typed = new NativeTypedEntry
+    typed.entry = entry
+    typed.argTypes = argTypes
+    typed.returnType = returnType
+    r.native_typed = typed
+  register_native_sig(fn, argTypes, returnType)
+  r.to_ref_value()
+
+proc invoke_typed_native*(typed: ref NativeTypedEntry, ints: openArray[int64],
+                          floats: openArray[float64]): int64 =
+  ## Call a typed entry; float results come back bitcast to int64.
+  var i: array[MaxTypedIntArgs, int64]
+  var f: array[MaxTypedFloatArgs, float64]
+  for k in 0 ..< min(ints.len, MaxTypedIntArgs): i[k] = ints[k]
+  for k in 0 ..< min(floats.len, MaxTypedFloatArgs): f[k] = floats[k]
+  if typed.returnType == CrtFloat64:
+    let r = cast[TypedInvokeF64](typed.entry)(i[0], i[1], i[2], i[3], i[4], i[5],
+                                              f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7])
+    cast[int64](r)
+  else:
+    cast[TypedInvokeI64](typed.entry)(i[0], i[1], i[2], i[3], i[4], i[5],
+                                      f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7])
+
 proc release_descriptors*(descs: seq[CallDescriptor]) =
   for desc in descs:
     release(desc.callable)
@@ -738,7 +738,32 @@ proc genCall*(ctx: CodegenContext, op: HirOp) =
   # Store result
   ctx.storeReg(op.dest, RAX)
 
+proc genDirectNativeCall(ctx: CodegenContext, op: HirOp, desc: CallDescriptor) =
+  ## Call a typed native fn's C entry with unboxed System V arguments.
+  const intRegs = [RDI, RSI, RDX, RCX, R8, R9]
+  var nextInt = 0
+  var nextFloat = 0
+  for i in 0..<op.callVmArgs.len:
+    if desc.argTypes[i] == CatFloat64:
+      ctx.loadRegF64(XmmReg(nextFloat), op.callVmArgs[i])
+      nextFloat.inc()
+    else:
+      ctx.loadReg(intRegs[nextInt], op.callVmArgs[i])
+      nextInt.inc()
+
+  ctx.buf.emitMovRegImm64(RAX, cast[int64](desc.directEntry))
+  ctx.buf.emitCallReg(RAX)
+
+  if desc.returnType == CrtFloat64:
+    ctx.buf.emitMovqXmmToGpr(RAX, XMM0)
+  ctx.storeReg(op.dest, RAX)
+
 proc genCallVM*(ctx: CodegenContext, op: HirOp) =
+  let desc = ctx.fn.callDescriptors[op.callVmDescIdx]
+  if desc.directEntry != nil:
+    ctx.genDirectNativeCall(op, desc)
+    return
+
   if op.callVmArgs.len > ctx.callArgSlots:
     raise newException(ValueError, "Too many arguments for trampoline call: " & $op.callVmArgs.len)
 
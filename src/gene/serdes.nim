@@ -67,6 +67,7 @@ proc is_literal_value*(v: Value): bool {.inline, gcsafe.}
 proc serialize_literal*(value: Value): Serialization {.gcsafe.}
 proc deserialize*(s: string): Value {.gcsafe.}
 proc deserialize_literal*(s: string): Value {.gcsafe.}
+proc deserialize_binary*(s: string): Value {.gcsafe.}
 proc to_s*(self: Serialization): string
 proc path_to_value*(path: string): Value {.gcsafe.}
 proc tag_namespace_serialization_origins*(ns: Namespace, module_path: string, prefix = "") {.gcsafe.}
@@ -1170,7 +1171,10 @@ proc write_serialized_file(path: string, value: Value) =
 
 proc read_serialized_file(path: string): Value {.gcsafe.} =
   count_tree_serialized_file_read()
-  deserialize(readFile(path))
+  let content = readFile(path)
+  if content.startsWith('\xFF'):
+    return deserialize_binary(content)
+  deserialize(content)
 
 proc remove_tree_dir(path: string) =
   if fileExists(path):
@@ -1674,6 +1678,379 @@ proc deserialize*(self: Serialization, value: Value): Value =
   else:
     return value
 
+#################### Binary format ###############
+#
+# Versioned binary encoding of literal values for host/extension bridges and
+# persisted values, where formatting and reparsing text dominates.
+#
+#   header: 0xFF 'G' 'B' <version:u8> <body length:u32 LE>
+#   body:   one value
+#
+# Each value is a tag byte followed by its payload. Lengths and counts are
+# LEB128 varints and ints are zigzag varints. Map and gene property keys go
+# through a per-payload key table: the first use of a key writes its name,
+# later uses write its index. Fixed-width fields are little-endian. 0xFF
+# never starts Gene text, so readers accept
+# either form. The length in the header lets a payload travel through a
+# `char*` even though the body may contain NUL bytes.
+
+type
+  SerdesFormat* = enum
+    SfText
+    SfBinary
+
+  BinaryWriter* = object
+    ## Reusable encode buffer; `buf` holds the last encoded payload.
+    buf*: string
+    keys: Table[Key, int]
+
+  BinaryTag = enum
+    BtNil = 0
+    BtVoid
+    BtFalse
+    BtTrue
+    BtInt
+    BtFloat
+    BtChar
+    BtString
+    BtSymbol
+    BtBytes
+    BtArray
+    BtMap
+    BtGene
+
+const
+  GeneBinaryVersion* = 1'u8
+  GeneBinaryHeaderLen* = 8
+  BinaryFrozenFlag = 0x80'u8
+  MaxBinaryDepth = 1024
+
+var bridge_format_setting = 0  # 0: not read yet, else ord(SerdesFormat) + 1
+var bridge_writer {.threadvar.}: BinaryWriter
+
+proc init_binary_writer*(capacity = 256): BinaryWriter =
+  result.buf = newStringOfCap(capacity)
+  result.keys = initTable[Key, int]()
+
+proc add_byte(w: var BinaryWriter, b: uint8) {.inline.} =
+  w.buf.add(char(b))
+
+proc add_varint(w: var BinaryWriter, value: uint64) {.inline.} =
+  var v = value
+  while v >= 0x80'u64:
+    w.buf.add(char((v and 0x7F'u64) or 0x80'u64))
+    v = v shr 7
+  w.buf.add(char(v))
+
+proc add_u64_le(w: var BinaryWriter, value: uint64, width: int) {.inline.} =
+  for i in 0..<width:
+    w.buf.add(char((value shr (8 * i)) and 0xFF'u64))
+
+proc add_raw(w: var BinaryWriter, data: pointer, len: int) {.inline.} =
+  if len <= 0:
+    return
+  let start = w.buf.len
+  w.buf.setLen(start + len)
+  copyMem(addr w.buf[start], data, len)
+
+proc add_text(w: var BinaryWriter, s: string) {.inline.} =
+  w.add_varint(s.len.uint64)
+  if s.len > 0:
+    w.add_raw(unsafeAddr s[0], s.len)
+
+proc add_key(w: var BinaryWriter, key: Key) =
+  let index = w.keys.getOrDefault(key, -1)
+  if index >= 0:
+    w.add_varint(uint64(index + 1))
+    return
+  w.keys[key] = w.keys.len
+  w.add_varint(0)
+  w.add_text(get_symbol(key.symbol_index))
+
+proc add_binary_value(w: var BinaryWriter, value: Value, depth: int) {.gcsafe.} =
+  if depth > MaxBinaryDepth:
+    not_allowed("Binary serialization nesting is deeper than " & $MaxBinaryDepth)
+  case value.kind
+  of VkNil:
+    w.add_byte(BtNil.uint8)
+  of VkVoid:
+    w.add_byte(BtVoid.uint8)
+  of VkBool:
+    w.add_byte(if value == TRUE: BtTrue.uint8 else: BtFalse.uint8)
+  of VkInt:
+    let i = value.to_int()
+    w.add_byte(BtInt.uint8)
+    w.add_varint((cast[uint64](i) shl 1) xor cast[uint64](i shr 63))
+  of VkFloat:
+    w.add_byte(BtFloat.uint8)
+    w.add_u64_le(cast[uint64](value.to_float()), 8)
+  of VkChar:
+    w.add_byte(BtChar.uint8)
+    w.add_varint(value.raw and PAYLOAD_MASK)
+  of VkString:
+    w.add_byte(BtString.uint8)
+    w.add_text(value.str)
+  of VkSymbol:
+    w.add_byte(BtSymbol.uint8)
+    w.add_text(value.str)
+  of VkBytes:
+    let n = bytes_len(value)
+    w.add_byte(BtBytes.uint8)
+    w.add_varint(n.uint64)
+    if isManaged(value):
+      let r = value.ref
+      if r.bytes_foreign != nil:
+        w.add_raw(r.bytes_foreign, n)
+      elif n > 0:
+        w.add_raw(addr r.bytes_data[0], n)
+    else:
+      for i in 0..<n:
+        w.add_byte(bytes_at(value, i))
+  of VkArray:
+    let frozen = if array_is_frozen(value): BinaryFrozenFlag else: 0'u8
+    w.add_byte(BtArray.uint8 or frozen)
+    w.add_varint(array_data(value).len.uint64)
+    for item in array_data(value):
+      w.add_binary_value(item, depth + 1)
+  of VkMap:
+    let frozen = if map_is_frozen(value): BinaryFrozenFlag else: 0'u8
+    w.add_byte(BtMap.uint8 or frozen)
+    w.add_varint(map_data(value).len.uint64)
+    for key, item in map_data(value):
+      w.add_key(key)
+      w.add_binary_value(item, depth + 1)
+  of VkGene:
+    let gene = value.gene
+    w.add_byte(BtGene.uint8 or (if gene.frozen: BinaryFrozenFlag else: 0'u8))
+    w.add_binary_value(gene.type, depth + 1)
+    w.add_varint(gene.props.len.uint64)
+    for key, item in gene.props:
+      w.add_key(key)
+      w.add_binary_value(item, depth + 1)
+    w.add_varint(gene.children.len.uint64)
+    for child in gene.children:
+      w.add_binary_value(child, depth + 1)
+  else:
+    not_allowed("Binary serialization does not support " & $value.kind)
+
+proc encode_binary*(w: var BinaryWriter, value: Value) {.gcsafe.} =
+  ## Encode `value` into `w.buf`, replacing its previous contents but keeping
+  ## its capacity, so one writer can be reused for a stream of payloads.
+  w.buf.setLen(0)
+  w.keys.clear()
+  w.add_byte(0xFF)
+  w.add_byte(uint8('G'))
+  w.add_byte(uint8('B'))
+  w.add_byte(GeneBinaryVersion)
+  w.add_u64_le(0, 4)  # body length, patched below
+  w.add_binary_value(value, 0)
+  let body_len = uint64(w.buf.len - GeneBinaryHeaderLen)
+  if body_len > uint64(high(uint32)):
+    not_allowed("Binary payload exceeds 4 GiB")
+  for i in 0..<4:
+    w.buf[4 + i] = char((body_len shr (8 * i)) and 0xFF'u64)
+
+proc serialize_binary*(value: Value): string {.gcsafe.} =
+  var w = init_binary_writer()
+  w.encode_binary(value)
+  move(w.buf)
+
+type BinaryReader = object
+  data: ptr UncheckedArray[uint8]
+  len: int
+  pos: int
+  keys: seq[Key]
+
+proc truncated_binary() {.noreturn.} =
+  not_allowed("Binary payload is truncated or corrupt")
+
+proc read_byte(r: var BinaryReader): uint8 {.inline.} =
+  if r.pos >= r.len:
+    truncated_binary()
+  result = r.data[r.pos]
+  r.pos.inc()
+
+proc read_u64_le(data: ptr UncheckedArray[uint8], pos, width: int): uint64 {.inline.} =
+  for i in 0..<width:
+    result = result or (data[pos + i].uint64 shl (8 * i))
+
+proc read_varint(r: var BinaryReader): uint64 =
+  var shift = 0
+  while true:
+    let b = r.read_byte()
+    if shift > 63:
+      truncated_binary()
+    result = result or ((b.uint64 and 0x7F'u64) shl shift)
+    if (b and 0x80'u8) == 0:
+      return
+    shift += 7
+
+proc read_len(r: var BinaryReader): int {.inline.} =
+  let n = r.read_varint()
+  if n > uint64(r.len - r.pos):
+    truncated_binary()
+  int(n)
+
+# Length-prefixed strings are read straight out of the input buffer; the
+# only copy is the one into the resulting string.
+proc read_text(r: var BinaryReader): string =
+  let n = r.read_len()
+  result = newString(n)
+  if n > 0:
+    copyMem(addr result[0], addr r.data[r.pos], n)
+  r.pos += n
+
+proc read_key(r: var BinaryReader): Key =
+  let index = r.read_varint()
+  if index == 0:
+    result = r.read_text().to_key()
+    r.keys.add(result)
+  elif index <= r.keys.len.uint64:
+    result = r.keys[int(index - 1)]
+  else:
+    truncated_binary()
+
+proc read_binary_value(r: var BinaryReader, depth: int): Value {.gcsafe.} =
+  if depth > MaxBinaryDepth:
+    not_allowed("Binary payload nesting is deeper than " & $MaxBinaryDepth)
+  let tag_byte = r.read_byte()
+  let frozen = (tag_byte and BinaryFrozenFlag) != 0
+  let tag = tag_byte and not BinaryFrozenFlag
+  if tag > BtGene.uint8:
+    truncated_binary()
+  case BinaryTag(tag)
+  of BtNil:
+    NIL
+  of BtVoid:
+    VOID
+  of BtFalse:
+    FALSE
+  of BtTrue:
+    TRUE
+  of BtInt:
+    let z = r.read_varint()
+    cast[int64]((z shr 1) xor (0'u64 - (z and 1'u64))).to_value()
+  of BtFloat:
+    if r.len - r.pos < 8:
+      truncated_binary()
+    let bits = read_u64_le(r.data, r.pos, 8)
+    r.pos += 8
+    cast[float64](bits).to_value()
+  of BtChar:
+    Value(raw: SPECIAL_TAG or (r.read_varint() and PAYLOAD_MASK))
+  of BtString:
+    r.read_text().to_value()
+  of BtSymbol:
+    r.read_text().to_symbol_value()
+  of BtBytes:
+    let n = r.read_len()
+    result = new_bytes_value(toOpenArray(r.data, r.pos, r.pos + n - 1))
+    r.pos += n
+    result
+  of BtArray:
+    let n = r.read_len()
+    var items = newSeqOfCap[Value](n)
+    for _ in 0..<n:
+      items.add(r.read_binary_value(depth + 1))
+    new_array_value(items, frozen)
+  of BtMap:
+    let n = r.read_len()
+    var map = initTable[Key, Value](n)
+    for _ in 0..<n:
+      let key = r.read_key()
+      map[key] = r.read_binary_value(depth + 1)
+    new_map_value(map, frozen)
+  of BtGene:
+    let gene = new_gene(r.read_binary_value(depth + 1), frozen = frozen)
+    let prop_count = r.read_len()
+    for _ in 0..<prop_count:
+      let key = r.read_key()
+      gene.props[key] = r.read_binary_value(depth + 1)
+    let child_count = r.read_len()
+    for _ in 0..<child_count:
+      gene.children.add(r.read_binary_value(depth + 1))
+    gene.to_gene_value()
+
+proc is_binary_payload*(data: ptr UncheckedArray[uint8]): bool {.inline.} =
+  ## True when `data` starts a binary payload. Stops at the first mismatch,
+  ## so it is safe on NUL-terminated text.
+  data != nil and data[0] == 0xFF'u8 and data[1] == uint8('G') and data[2] == uint8('B')
+
+proc binary_payload_len*(data: ptr UncheckedArray[uint8]): int =
+  ## Total size (header included) of the binary payload at `data`.
+  GeneBinaryHeaderLen + int(read_u64_le(data, 4, 4))
+
+proc deserialize_binary*(data: ptr UncheckedArray[uint8], len: int): Value {.gcsafe.} =
+  ## Decode a binary payload in place; `data` is only read.
+  if len < GeneBinaryHeaderLen or not is_binary_payload(data):
+    not_allowed("Not a binary Gene payload")
+  if data[3] > GeneBinaryVersion:
+    not_allowed("Binary Gene payload version " & $data[3] &
+                " is newer than supported version " & $GeneBinaryVersion)
+  let total = binary_payload_len(data)
+  if total > len:
+    truncated_binary()
+  var r = BinaryReader(data: data, len: total, pos: GeneBinaryHeaderLen)
+  result = r.read_binary_value(0)
+  if r.pos != total:
+    truncated_binary()
+
+proc deserialize_binary*(s: string): Value {.gcsafe.} =
+  if s.len == 0:
+    not_allowed("Not a binary Gene payload")
+  deserialize_binary(cast[ptr UncheckedArray[uint8]](unsafeAddr s[0]), s.len)
+
+proc bridge_serdes_format*(): SerdesFormat {.gcsafe.} =
+  ## Format used for values sent over host/extension bridges. Binary unless
+  ## GENE_BRIDGE_SERDES=text; readers accept both.
+  {.cast(gcsafe).}:
+    if bridge_format_setting == 0:
+      bridge_format_setting =
+        if getEnv("GENE_BRIDGE_SERDES").toLowerAscii() == "text": ord(SfText) + 1
+        else: ord(SfBinary) + 1
+    SerdesFormat(bridge_format_setting - 1)
+
+proc set_bridge_serdes_format*(format: SerdesFormat) =
+  bridge_format_setting = ord(format) + 1
+
+proc serialize_bridge_payload*(value: Value): string {.gcsafe.} =
+  ## Encode a literal value for a bridge call. Values with kinds the binary
+  ## format does not cover (dates, ...) fall back to text.
+  if bridge_serdes_format() == SfBinary:
+    try:
+      {.cast(gcsafe).}:
+        bridge_writer.encode_binary(value)
+        return bridge_writer.buf
+    except CatchableError:
+      discard
+  serialize_literal(value).to_s()
+
+proc deserialize_bridge_payload*(payload: cstring): Value {.gcsafe.} =
+  ## Decode a bridge payload in either format. Binary payloads are decoded
+  ## straight from `payload`; nil and empty payloads give NIL.
+  if payload == nil or payload[0] == '\0':
+    return NIL
+  let data = cast[ptr UncheckedArray[uint8]](payload)
+  if is_binary_payload(data):
+    return deserialize_binary(data, binary_payload_len(data))
+  deserialize_literal($payload)
+
+proc deserialize_bridge_payload*(payload: string): Value {.gcsafe.} =
+  if payload.len == 0:
+    return NIL
+  if payload.len >= GeneBinaryHeaderLen and payload[0] == '\xFF':
+    return deserialize_binary(payload)
+  deserialize_literal(payload)
+
+proc bridge_payload_len*(payload: cstring): int =
+  ## Byte size of a bridge payload, for copying one that may hold NULs.
+  if payload == nil:
+    return 0
+  let data = cast[ptr UncheckedArray[uint8]](payload)
+  if is_binary_payload(data):
+    return binary_payload_len(data)
+  payload.len
+
 # VM integration functions
 proc resolve_symbol_in_caller(caller_frame: Frame, name: string): Value =
   let key = name.to_key()
@@ -1908,6 +2285,30 @@ proc vm_deserialize(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg
     let s = get_positional_arg(args, 0, has_keyword_args).str
     return deserialize(s)
 
+proc vm_to_bytes(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+  {.cast(gcsafe).}:
+    if arg_count != 1:
+      not_allowed("to_bytes expects 1 argument")
+
+    let value = materialize_lazy_tree_deep(get_positional_arg(args, 0, has_keyword_args))
+    let encoded = serialize_binary(value)
+    return new_bytes_value(encoded.toOpenArrayByte(0, encoded.len - 1))
+
+proc vm_from_bytes(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+  {.cast(gcsafe).}:
+    if arg_count != 1:
+      not_allowed("from_bytes expects 1 argument")
+
+    let encoded = get_positional_arg(args, 0, has_keyword_args)
+    if encoded.kind != VkBytes or not isManaged(encoded):
+      not_allowed("from_bytes expects a binary payload")
+    let r = encoded.ref
+    if r.bytes_foreign != nil:
+      return deserialize_binary(r.bytes_foreign, r.bytes_foreign_len)
+    if r.bytes_data.len == 0:
+      not_allowed("from_bytes expects a binary payload")
+    return deserialize_binary(cast[ptr UncheckedArray[uint8]](addr r.bytes_data[0]), r.bytes_data.len)
+
 proc vm_write_tree_macro(vm: ptr VirtualMachine, gene_value: Value, caller_frame: Frame): Value {.gcsafe.} =
   {.cast(gcsafe).}:
     when defined(gene_wasm):
@@ -1949,6 +2350,8 @@ proc init_serdes*() =
   let serdes_ns = new_namespace("serdes")
   serdes_ns["serialize".to_key()] = NativeFn(vm_serialize).to_value()
   serdes_ns["deserialize".to_key()] = NativeFn(vm_deserialize).to_value()
+  serdes_ns["to_bytes".to_key()] = NativeFn(vm_to_bytes).to_value()
+  serdes_ns["from_bytes".to_key()] = NativeFn(vm_from_bytes).to_value()
   var write_tree_ref = new_ref(VkNativeMacro)
   write_tree_ref.native_macro = vm_write_tree_macro
   serdes_ns["write_tree".to_key()] = write_tree_ref.to_ref_value()
@@ -8,5 +8,6 @@ proc init_actor_namespace*() =
   let actor_ns = new_namespace("actor")
   actor_ns["enable".to_key()] = NativeFn(actor_enable_native).to_value()
   actor_ns["spawn".to_key()] = NativeFn(actor_spawn_native).to_value()
+  actor_ns["send_stats".to_key()] = NativeFn(actor_send_stats_native).to_value()
 
   App.app.gene_ns.ref.ns["actor".to_key()] = actor_ns.to_value()
@@ -962,7 +962,7 @@ proc check_import(self: TypeChecker, gene: ptr Gene): TypeExpr =
       let gir_path = self.resolve_import_gir_path(module_path)
       if gir_path.len > 0:
         try:
-          let imported = load_gir(gir_path)
+          let imported = load_gir(gir_path, lazy = true)
           if imported != nil and imported.module_types.len > 0:
             self.register_imported_types_from_module(imported.module_types, items)
         except CatchableError:
@@ -113,16 +113,17 @@ proc str*(v: Value): string =
     else:
       not_allowed(fmt"{v} is not a string.")
 
-converter to_value*(v: string): Value =
+converter to_value*(v: sink string): Value =
   if v.len == 0:
     return EMPTY_STRING
   else:
     let s = cast[ptr String](alloc0(sizeof(String)))
-    s.ref_count = 1
-    s.str = v
     let ptr_addr = cast[uint64](s)
     if (ptr_addr and 0xFFFF_0000_0000_0000u64) != 0:
+      dealloc(s)
       return new_ref_string_value(v)
+    s.ref_count = 1
+    s.str = v  # moved: callers passing a temporary give up their buffer
     result = cast[Value](STRING_TAG or ptr_addr)
 
 converter to_value*(v: Rune): Value =
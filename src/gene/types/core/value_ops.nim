@@ -355,6 +355,35 @@ proc setShared*(v: Value) {.inline.} =
     else:
       not_allowed("Cannot mark non-heap value as shared")
 
+proc managed_ref_count*(v: Value): int {.inline, noSideEffect.} =
+  ## Current reference count of a managed value; 0 for immediates.
+  let u = cast[uint64](v)
+  if (u and NAN_MASK) != NAN_MASK:
+    return 0
+
+  let tag = u and 0xFFFF_0000_0000_0000u64
+  case tag:
+    of ARRAY_TAG:
+      let arr = cast[ptr ArrayObj](u and PAYLOAD_MASK)
+      return if arr != nil: arr.ref_count else: 0
+    of MAP_TAG:
+      let m = cast[ptr MapObj](u and PAYLOAD_MASK)
+      return if m != nil: m.ref_count else: 0
+    of INSTANCE_TAG:
+      let inst = cast[ptr InstanceObj](u and PAYLOAD_MASK)
+      return if inst != nil: inst.ref_count else: 0
+    of GENE_TAG:
+      let g = cast[ptr Gene](u and PAYLOAD_MASK)
+      return if g != nil: g.ref_count else: 0
+    of STRING_TAG:
+      let s = cast[ptr String](u and PAYLOAD_MASK)
+      return if not s.is_nil: s.ref_count else: 0
+    of REF_TAG:
+      let r = cast[ptr Reference](u and PAYLOAD_MASK)
+      return if r != nil: r.ref_count else: 0
+    else:
+      return 0
+
 #################### Value ######################
 
 # Forward declaration
@@ -721,7 +750,10 @@ proc bytes_len*(v: Value): int {.inline.} =
   if tag == BYTES6_TAG: return 6
   if tag == BYTES_TAG:
     return int((v.raw and BYTES_SIZE_MASK) shr BYTES_SIZE_SHIFT)
-  return v.ref.bytes_data.len
+  let r = v.ref
+  if r.bytes_foreign != nil:
+    return r.bytes_foreign_len
+  return r.bytes_data.len
 
 proc bytes_at*(v: Value, i: int): uint8 {.inline.} =
   let tag = v.raw and 0xFFFF_0000_0000_0000u64
@@ -733,7 +765,10 @@ proc bytes_at*(v: Value, i: int): uint8 {.inline.} =
   elif tag == BYTES_TAG:
     return uint8((v.raw shr ((n - 1 - i) * 8)) and 0xFF)
   else:
-    return v.ref.bytes_data[i]
+    let r = v.ref
+    if r.bytes_foreign != nil:
+      return r.bytes_foreign[i]
+    return r.bytes_data[i]
 
 proc format_bytes(v: Value): string =
   let n = bytes_len(v)
@@ -1045,10 +1080,10 @@ proc `[]`*(self: Value, i: int): Value =
               j.inc()
             return NIL
           of VkBytes:
-            if i >= r.bytes_data.len:
+            if i >= bytes_len(self):
               return NIL
             else:
-              let b = r.bytes_data[i]
+              let b = bytes_at(self, i)
               return Value(raw: BYTES_TAG or (1u64 shl BYTES_SIZE_SHIFT) or b.uint64)
           of VkRange:
             # Calculate the i-th element in the range
@@ -1134,7 +1169,7 @@ proc size*(self: Value): int =
           of VkString:
             return r.str.to_runes().len
           of VkBytes:
-            return r.bytes_data.len
+            return bytes_len(self)
           of VkRange:
             # Calculate range size based on start, end, and step
             let start_int = r.range_start.int64
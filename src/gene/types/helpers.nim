@@ -42,6 +42,13 @@ proc publish_compiled_body*(b: Block, cu: CompilationUnit) =
   else:
     ensure_inline_caches_ready(b.body_compiled)
 
+proc force_lazy_body*(lazy: LazyCompiledBody): CompilationUnit =
+  ## Decode a lazily loaded GIR body once. Caller holds body_publication_lock.
+  if lazy.body == nil:
+    lazy.body = lazy.decode()
+    lazy.decode = nil  # drops the decoder's reference to the mapped file
+  lazy.body
+
 proc load_published_body*(f: Function): CompilationUnit =
   if f == nil:
     return nil
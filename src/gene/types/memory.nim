@@ -4,8 +4,11 @@
 ##
 ## Shared-RC publication invariant:
 ## - Any managed value observed with `shared == true` must have been published
-##   by `(freeze v)` or bootstrap publication, with the header bit written
-##   under the same publication barrier as the pointer store.
+##   by `(freeze v)`, bootstrap publication, or an actor ownership transfer,
+##   with the header bit written under the same publication barrier as the
+##   pointer store.
+## - A transferred graph stays mutable but belongs to the receiving actor;
+##   the sender only drops its last references to it.
 ## - Readers on other threads may only dereference managed values reached
 ##   through `shared == true` pointers, or through the same-thread owned heap.
 ## - Passing a managed value across threads while `shared == false` is a bug;
@@ -83,6 +86,9 @@ proc destroy_instance(inst: ptr InstanceObj) =
   destroyAndDealloc(inst)
 
 proc destroy_reference(ref_obj: ptr Reference) =
+  if ref_obj != nil and ref_obj.kind == VkBytes and ref_obj.bytes_foreign != nil and
+      ref_obj.bytes_release != nil:
+    ref_obj.bytes_release(ref_obj.bytes_foreign)
   destroyAndDealloc(ref_obj)
 
 when defined(phase1_rc_branch_probe):
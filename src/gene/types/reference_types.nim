@@ -8,6 +8,9 @@ const
   REGEX_FLAG_MULTILINE* = 0x2'u8
 
 type
+  ## Frees an extension-owned buffer adopted by a VkBytes value.
+  BytesReleaseFn* = proc(data: pointer) {.cdecl, gcsafe.}
+
   # Extended Reference type supporting all ValueKind variants
   Reference* = object
     ref_count*: int  # Reference count for GC
@@ -36,6 +39,9 @@ type
         byte_bit_size*: uint
       of VkBytes:
         bytes_data*: seq[uint8]
+        bytes_foreign*: ptr UncheckedArray[uint8]  # adopted buffer; bytes_data unused when set
+        bytes_foreign_len*: int
+        bytes_release*: BytesReleaseFn
 
       # Pattern and regex types
       of VkRegex:
@@ -176,6 +182,7 @@ type
         adapter_internal*: Adapter  # Reference to adapter for internal data access
       of VkNativeFn:
         native_fn*: NativeFn
+        native_typed*: ref NativeTypedEntry  # set by wrap_typed_native_fn
       of VkNativeMacro:
         native_macro*: NativeMacroFn
       of VkNativeMethod:
@@ -357,10 +357,18 @@ type
     type_expectation_ids*: seq[TypeId]
     parent*: ScopeTrackerSnapshot
 
+  # Function body still encoded in a mapped GIR file. `decode` runs once,
+  # under body_publication_lock, on the first call of any function made
+  # from the definition.
+  LazyCompiledBody* = ref object
+    decode*: proc(): CompilationUnit {.closure, gcsafe.}
+    body*: CompilationUnit
+
   FunctionDefInfo* = ref object
     input*: Value
     scope_tracker*: ScopeTracker
     compiled_body*: Value
+    lazy_body*: LazyCompiledBody  # set instead of compiled_body by lazy GIR loads
     type_expectation_ids*: seq[TypeId]
     return_type_id*: TypeId
 
@@ -627,6 +635,15 @@ type
     callable*: Value
     argTypes*: seq[CallArgType]
     returnType*: CallReturnType
+    directEntry*: pointer  # unboxed C entry of a typed native fn; nil = go through the trampoline
+
+  ## Unboxed entry point of a native function. Called with CatInt64/CatValue
+  ## arguments in integer registers and CatFloat64 arguments in float registers,
+  ## in declaration order, per the platform C calling convention.
+  NativeTypedEntry* = object
+    entry*: pointer
+    argTypes*: seq[CallArgType]
+    returnType*: CallReturnType
 
   FunctionExampleKind* = enum
     FekReturn
@@ -655,6 +672,7 @@ type
     # matching_hint*: MatchingHint
     body*: seq[Value]
     body_compiled*: CompilationUnit
+    lazy_body*: LazyCompiledBody  # decoded into body_compiled by compile()
     native_entry*: pointer  # JIT entry point (NativeFnPtr)
     native_ready*: bool
     native_failed*: bool
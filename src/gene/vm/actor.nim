@@ -1,4 +1,5 @@
-import locks, tables, osproc, os, times
+import locks, tables, osproc, os, times, deques
+import std/atomics
 import asyncfutures
 import std/exitprocs
 
@@ -12,6 +13,7 @@ type
     AstByValue
     AstSharedFrozen
     AstClonedMutable
+    AstMovedUnique
 
   ActorTrySendStatus* = enum
     AtsAccepted
@@ -30,8 +32,22 @@ type
     mailbox_len*: int
     pending_len*: int
     mailbox_limit*: int
-
-  ActorMailboxMessage = ref object
+    worker_thread_id*: int   # worker that last ran the actor
+    run_queue_len*: int      # runnable actors waiting on that worker
+    steals*: int             # turns this actor ran after being stolen
+
+  ActorWorkerSnapshot* = object
+    thread_id*: int
+    run_queue_len*: int
+    idle*: bool
+    turns*: int
+    steals*: int
+
+  # Messages link themselves into the mailbox; they live in shared memory
+  # and are freed by whoever consumes them.
+  ActorMailboxMessage = ptr ActorMailboxMessageObj
+  ActorMailboxMessageObj = object
+    next: Atomic[ActorMailboxMessage]
     payload: Value
     reply_requested: bool
     from_message_id: int
@@ -40,29 +56,53 @@ type
 
   ActorRuntimeRecord = ref object
     actor: Actor
-    thread_id: int
+    worker_index: Atomic[int]  # home worker; follows whoever ran the last turn
     handler: Value
-    state: Value
-    stopped: bool
+    state: Value               # only touched by the worker running a turn
+    stopped: Atomic[bool]
+    dispatched: Atomic[bool]   # queued on a worker or running a turn
+    # Intrusive MPSC mailbox: any thread links at mailbox_head, the worker
+    # running the turn pops at mailbox_tail.
+    mailbox_head: Atomic[ActorMailboxMessage]
+    mailbox_tail: ActorMailboxMessage
+    mailbox_stub: ActorMailboxMessageObj
+    mailbox_len: Atomic[int]   # reserved before linking, released after popping
+    mailbox_limit: int
+    # Slow paths: actor senders that overflowed, and blocked external senders.
     lock: Lock
     cond: Cond
-    mailbox: FifoQueue[ActorMailboxMessage]
     pending_sends: FifoQueue[ActorMailboxMessage]
-    mailbox_limit: int
-    dispatched: bool
+    pending_len: Atomic[int]
+    blocked_senders: Atomic[int]
+    steals: Atomic[int]
+
+  ActorWorker = ref object
+    thread_id: int
+    index: int
+    lock: Lock
+    runnable: Deque[ActorRuntimeRecord]
+    idle: Atomic[bool]
+    turns: Atomic[int]
+    steals: Atomic[int]
 
 const DEFAULT_ACTOR_MAILBOX_LIMIT* = 10_000
+const ActorTurnBudget = 32  # messages per turn before the worker moves on
 
 var actor_runtime_lock: Lock
 var actor_system_enabled = false
 var actor_spawned = false
 var actor_next_id = 1
 var actor_worker_ids: seq[int] = @[]
+var actor_workers: seq[ActorWorker] = @[]
+var actor_idle_workers: Atomic[int]
+var actor_workers_stopping: Atomic[bool]
 var actor_registry = initTable[int, ActorRuntimeRecord]()
 var actor_rr_index = 0
 var actor_mailbox_limit = DEFAULT_ACTOR_MAILBOX_LIMIT
 var actor_cleanup_registered = false
+var actor_send_tier_counts: array[ActorSendTier, Atomic[int]]
 
+var current_actor_worker {.threadvar.}: ActorWorker
 var current_actor_record {.threadvar.}: ActorRuntimeRecord
 
 initLock(actor_runtime_lock)
@@ -87,8 +127,15 @@ proc actor_transport_error(payload: Value): ref types.Exception {.noinline.} =
   )
 
 proc clone_actor_payload(payload: Value, seen: var Table[uint64, Value]): Value {.gcsafe.}
+proc transfer_actor_payload(payload: Value, seen: var Table[uint64, Value]): Value {.gcsafe.}
+
+proc clone_actor_bytes(payload: Value): Value {.gcsafe.} =
+  let r = payload.ref
+  if r.bytes_foreign != nil:
+    return new_bytes_value(toOpenArray(r.bytes_foreign, 0, r.bytes_foreign_len - 1))
+  new_bytes_value(r.bytes_data)
 
-proc prepare_actor_payload_for_send*(payload: Value): tuple[tier: ActorSendTier, value: Value] {.gcsafe.} =
+proc route_actor_payload(payload: Value, transfer: bool): tuple[tier: ActorSendTier, value: Value] {.gcsafe.} =
   case payload.kind
   of VkNil, VkBool, VkInt, VkFloat, VkChar, VkSymbol:
     (AstByValue, payload)
@@ -97,14 +144,16 @@ proc prepare_actor_payload_for_send*(payload: Value): tuple[tier: ActorSendTier,
       return (AstByValue, payload)
     if payload.deep_frozen and payload.shared:
       return (AstSharedFrozen, payload)
-
-    var cloned: seq[uint8] = @[]
-    for i in 0..<bytes_len(payload):
-      cloned.add(bytes_at(payload, i))
-    (AstClonedMutable, new_bytes_value(cloned))
+    if transfer and managed_ref_count(payload) == 1:
+      setShared(payload)
+      return (AstMovedUnique, payload)
+    (AstClonedMutable, clone_actor_bytes(payload))
   of VkString:
     if payload.deep_frozen and payload.shared:
       return (AstSharedFrozen, payload)
+    if transfer and managed_ref_count(payload) == 1:
+      setShared(payload)
+      return (AstMovedUnique, payload)
     (AstClonedMutable, payload.str.to_value())
   of VkFunction:
     if payload.deep_frozen and payload.shared:
@@ -118,10 +167,30 @@ proc prepare_actor_payload_for_send*(payload: Value): tuple[tier: ActorSendTier,
     if payload.deep_frozen and payload.shared:
       return (AstSharedFrozen, payload)
     var seen = initTable[uint64, Value]()
+    if transfer and managed_ref_count(payload) == 1:
+      return (AstMovedUnique, transfer_actor_payload(payload, seen))
     (AstClonedMutable, clone_actor_payload(payload, seen))
   else:
     raise actor_transport_error(payload)
 
+proc prepare_actor_payload_for_send*(payload: Value, transfer = false): tuple[tier: ActorSendTier, value: Value] {.gcsafe.} =
+  ## Route a payload to the receiving thread. With `transfer`, a graph whose
+  ## nodes are only referenced by their parent (and the root only by the
+  ## caller) is handed over without copying and the caller must not use it
+  ## afterwards. Nodes also referenced from elsewhere are cloned.
+  result = route_actor_payload(payload, transfer)
+  {.cast(gcsafe).}:
+    discard actor_send_tier_counts[result.tier].fetchAdd(1, moRelaxed)
+
+proc actor_send_tier_stats*(): array[ActorSendTier, int] =
+  ## Number of payloads routed through each send tier since the last reset.
+  for tier in ActorSendTier:
+    result[tier] = actor_send_tier_counts[tier].load(moRelaxed)
+
+proc reset_actor_send_tier_stats*() =
+  for tier in ActorSendTier:
+    actor_send_tier_counts[tier].store(0, moRelaxed)
+
 proc actor_payload_clone_id(payload: Value): uint64 {.inline.} =
   cast[uint64](payload) and PAYLOAD_MASK
 
@@ -134,10 +203,7 @@ proc clone_actor_payload(payload: Value, seen: var Table[uint64, Value]): Value
       return payload
     if payload.deep_frozen and payload.shared:
       return payload
-    var cloned: seq[uint8] = @[]
-    for i in 0..<bytes_len(payload):
-      cloned.add(bytes_at(payload, i))
-    new_bytes_value(cloned)
+    clone_actor_bytes(payload)
   of VkString:
     if payload.deep_frozen and payload.shared:
       return payload
@@ -192,6 +258,48 @@ proc clone_actor_payload(payload: Value, seen: var Table[uint64, Value]): Value
   else:
     raise actor_transport_error(payload)
 
+# Moves nodes referenced once (by their parent) and clones the rest. Moved
+# nodes switch to atomic reference counts, since the sender's last reference
+# may be dropped after the receiver has started using them.
+proc transfer_actor_payload(payload: Value, seen: var Table[uint64, Value]): Value {.gcsafe.} =
+  case payload.kind
+  of VkArray, VkMap, VkGene, VkString, VkBytes:
+    if not isManaged(payload) or (payload.deep_frozen and payload.shared):
+      return payload
+    if managed_ref_count(payload) != 1:
+      return clone_actor_payload(payload, seen)
+  else:
+    return clone_actor_payload(payload, seen)
+
+  setShared(payload)
+  case payload.kind
+  of VkArray:
+    for i in 0..<array_data(payload).len:
+      let moved = transfer_actor_payload(array_data(payload)[i], seen)
+      if moved.raw != array_data(payload)[i].raw:
+        array_data(payload)[i] = moved
+  of VkMap:
+    for key, value in map_data(payload).mpairs:
+      let moved = transfer_actor_payload(value, seen)
+      if moved.raw != value.raw:
+        value = moved
+  of VkGene:
+    if payload.gene.type != NIL:
+      let moved = transfer_actor_payload(payload.gene.type, seen)
+      if moved.raw != payload.gene.type.raw:
+        payload.gene.type = moved
+    for key, value in payload.gene.props.mpairs:
+      let moved = transfer_actor_payload(value, seen)
+      if moved.raw != value.raw:
+        value = moved
+    for i in 0..<payload.gene.children.len:
+      let moved = transfer_actor_payload(payload.gene.children[i], seen)
+      if moved.raw != payload.gene.children[i].raw:
+        payload.gene.children[i] = moved
+  else:
+    discard
+  payload
+
 proc ensure_actor_frame_pool() =
   if FRAMES.len == 0:
     FRAMES = newSeqOfCap[Frame](INITIAL_FRAME_POOL_SIZE)
@@ -210,7 +318,68 @@ proc set_actor_mailbox_limit_for_test*(limit: int) =
     raise new_exception(types.Exception, "actor mailbox limit must be positive")
   actor_mailbox_limit = limit
 
-proc actor_wake_worker(thread_id, actor_id: int) =
+proc new_mailbox_message(payload: Value, reply_requested: bool, from_message_id: int): ActorMailboxMessage =
+  result = cast[ActorMailboxMessage](allocShared0(sizeof(ActorMailboxMessageObj)))
+  result.payload = payload
+  result.reply_requested = reply_requested
+  result.from_message_id = from_message_id
+  result.from_thread_id = current_thread_id
+  result.from_thread_secret = THREADS[current_thread_id].secret
+
+proc free_mailbox_message(msg: ActorMailboxMessage) =
+  msg.payload = NIL
+  deallocShared(msg)
+
+proc init_actor_mailbox(record: ActorRuntimeRecord) =
+  let stub = addr record.mailbox_stub
+  stub.next.store(nil, moRelaxed)
+  record.mailbox_head.store(stub, moRelaxed)
+  record.mailbox_tail = stub
+
+proc actor_mailbox_link(record: ActorRuntimeRecord, msg: ActorMailboxMessage) {.inline.} =
+  msg.next.store(nil, moRelaxed)
+  let prev = record.mailbox_head.exchange(msg, moAcqRel)
+  prev.next.store(msg, moRelease)
+
+# Returns nil when the mailbox is empty or a producer is between swapping
+# the head and linking its predecessor.
+proc actor_mailbox_try_pop(record: ActorRuntimeRecord): ActorMailboxMessage =
+  let stub = addr record.mailbox_stub
+  var tail = record.mailbox_tail
+  var next = tail.next.load(moAcquire)
+  if tail == stub:
+    if next == nil:
+      return nil
+    record.mailbox_tail = next
+    tail = next
+    next = next.next.load(moAcquire)
+  if next != nil:
+    record.mailbox_tail = next
+    return tail
+  if tail != record.mailbox_head.load(moAcquire):
+    return nil
+  record.actor_mailbox_link(stub)
+  next = tail.next.load(moAcquire)
+  if next != nil:
+    record.mailbox_tail = next
+    return tail
+  nil
+
+proc actor_reserve_slot(record: ActorRuntimeRecord): bool {.inline.} =
+  if record.mailbox_len.fetchAdd(1) >= record.mailbox_limit:
+    discard record.mailbox_len.fetchSub(1)
+    return false
+  true
+
+proc actor_record_worker(record: ActorRuntimeRecord): ActorWorker =
+  {.cast(gcsafe).}:
+    let index = record.worker_index.load(moRelaxed)
+    if index >= 0 and index < actor_workers.len:
+      return actor_workers[index]
+  nil
+
+proc actor_nudge_worker(worker: ActorWorker) =
+  let thread_id = worker.thread_id
   if thread_id <= 0 or thread_id >= g_max_threads:
     return
   if THREAD_DATA[thread_id].channel == nil:
@@ -220,68 +389,120 @@ proc actor_wake_worker(thread_id, actor_id: int) =
   new(wake)
   wake.id = next_thread_message_id()
   wake.msg_type = MtSend
-  wake.payload = actor_id.to_value()
+  wake.payload = NIL
   wake.payload_bytes = ThreadPayload(bytes: @[])
   wake.from_thread_id = current_thread_id
   wake.from_thread_secret = THREADS[current_thread_id].secret
   THREAD_DATA[thread_id].channel.send(wake)
 
-proc actor_signal_space(record: ActorRuntimeRecord) =
-  while record.mailbox.len < record.mailbox_limit and record.pending_sends.len > 0:
-    record.mailbox.add(record.pending_sends.popFront())
-  broadcast(record.cond)
-
-proc actor_enqueue_message(record: ActorRuntimeRecord, msg: ActorMailboxMessage, from_actor: bool) =
-  var wake_thread_id = -1
-  var wake_actor_id = -1
-
-  acquire(record.lock)
-  while not from_actor and record.mailbox.len >= record.mailbox_limit and not record.stopped:
-    wait(record.cond, record.lock)
-
-  if record.stopped:
+proc actor_try_wake(worker: ActorWorker): bool =
+  var expected = true
+  if worker.idle.load(moRelaxed) and worker.idle.compareExchange(expected, false):
+    discard actor_idle_workers.fetchSub(1)
+    actor_nudge_worker(worker)
+    return true
+  false
+
+proc actor_schedule(record: ActorRuntimeRecord) =
+  ## Queue a record that just became runnable. A worker keeps what it
+  ## schedules itself; other threads queue on the actor's home worker. If
+  ## that worker is busy, an idle one is woken to steal.
+  {.cast(gcsafe).}:
+    var target = current_actor_worker
+    if target == nil:
+      target = actor_record_worker(record)
+      if target == nil:
+        return
+    acquire(target.lock)
+    target.runnable.addLast(record)
+    release(target.lock)
+    if actor_try_wake(target):
+      return
+    if actor_idle_workers.load() > 0:
+      for worker in actor_workers:
+        if worker != target and actor_try_wake(worker):
+          return
+
+proc actor_mark_runnable(record: ActorRuntimeRecord) {.inline.} =
+  var expected = false
+  if not record.dispatched.load(moRelaxed) and record.dispatched.compareExchange(expected, true):
+    actor_schedule(record)
+
+proc actor_push_message(record: ActorRuntimeRecord, msg: ActorMailboxMessage) {.inline.} =
+  ## Link a message whose slot was already reserved.
+  record.actor_mailbox_link(msg)
+  record.actor_mark_runnable()
+
+proc actor_release_slot(record: ActorRuntimeRecord) =
+  discard record.mailbox_len.fetchSub(1)
+  if record.blocked_senders.load() > 0:
+    acquire(record.lock)
+    broadcast(record.cond)
     release(record.lock)
-    raise new_exception(types.Exception, "Actor is stopped")
 
-  if from_actor and record.mailbox.len >= record.mailbox_limit:
-    if record.pending_sends.len >= record.mailbox_limit:
-      release(record.lock)
-      raise new_exception(types.Exception, "Actor mailbox is full")
-    record.pending_sends.add(msg)
-    release(record.lock)
+proc actor_refill_from_pending(record: ActorRuntimeRecord) =
+  if record.pending_len.load() == 0:
     return
-
-  record.mailbox.add(msg)
-  if not record.dispatched:
-    record.dispatched = true
-    wake_thread_id = record.thread_id
-    wake_actor_id = record.actor.id
+  acquire(record.lock)
+  while record.pending_sends.len > 0 and record.actor_reserve_slot():
+    record.actor_mailbox_link(record.pending_sends.popFront())
+    discard record.pending_len.fetchSub(1)
   release(record.lock)
 
-  if wake_thread_id != -1:
-    actor_wake_worker(wake_thread_id, wake_actor_id)
-
-proc actor_try_enqueue_message(record: ActorRuntimeRecord, msg: ActorMailboxMessage): ActorTrySendStatus =
-  var wake_thread_id = -1
-  var wake_actor_id = -1
+proc actor_enqueue_message(record: ActorRuntimeRecord, msg: ActorMailboxMessage, from_actor: bool) =
+  ## Takes ownership of `msg`. Senders outside actors wait while the mailbox
+  ## is full; actors park the message in pending_sends instead of blocking
+  ## their worker.
+  while true:
+    if record.stopped.load():
+      free_mailbox_message(msg)
+      raise new_exception(types.Exception, "Actor is stopped")
+    if from_actor and record.pending_len.load() > 0:
+      # Earlier sends are still parked; queue behind them so a slot freed in
+      # the meantime cannot let this one overtake them.
+      acquire(record.lock)
+      if record.pending_sends.len > 0:
+        if record.pending_sends.len >= record.mailbox_limit:
+          release(record.lock)
+          free_mailbox_message(msg)
+          raise new_exception(types.Exception, "Actor mailbox is full")
+        record.pending_sends.add(msg)
+        discard record.pending_len.fetchAdd(1)
+        release(record.lock)
+        record.actor_mark_runnable()
+        return
+      release(record.lock)
+    if record.actor_reserve_slot():
+      record.actor_push_message(msg)
+      return
+    if from_actor:
+      acquire(record.lock)
+      if record.pending_sends.len >= record.mailbox_limit:
+        release(record.lock)
+        free_mailbox_message(msg)
+        raise new_exception(types.Exception, "Actor mailbox is full")
+      record.pending_sends.add(msg)
+      discard record.pending_len.fetchAdd(1)
+      release(record.lock)
+      # The actor may have drained its mailbox meanwhile; make sure a turn
+      # runs to move the message over.
+      record.actor_mark_runnable()
+      return
 
-  acquire(record.lock)
-  if record.stopped:
+    acquire(record.lock)
+    discard record.blocked_senders.fetchAdd(1)
+    while record.mailbox_len.load() >= record.mailbox_limit and not record.stopped.load():
+      wait(record.cond, record.lock)
+    discard record.blocked_senders.fetchSub(1)
     release(record.lock)
+
+proc actor_try_enqueue_message(record: ActorRuntimeRecord, msg: ActorMailboxMessage): ActorTrySendStatus =
+  ## Takes ownership of `msg` only when the send is accepted.
+  if record.stopped.load():
     return AtsStopped
-  if record.mailbox.len >= record.mailbox_limit:
-    release(record.lock)
+  if not record.actor_reserve_slot():
     return AtsFull
-
-  record.mailbox.add(msg)
-  if not record.dispatched:
-    record.dispatched = true
-    wake_thread_id = record.thread_id
-    wake_actor_id = record.actor.id
-  release(record.lock)
-
-  if wake_thread_id != -1:
-    actor_wake_worker(wake_thread_id, wake_actor_id)
+  record.actor_push_message(msg)
   AtsAccepted
 
 proc actor_enable_workers(worker_count: int) =
@@ -302,13 +523,19 @@ proc actor_enable_workers(worker_count: int) =
     raise new_exception(types.Exception, "gene/actor/enable exceeds the configured worker pool")
 
   actor_worker_ids.setLen(0)
-  for _ in 0..<worker_count:
+  actor_workers.setLen(0)
+  for i in 0..<worker_count:
     let thread_id = get_free_thread()
     if thread_id == -1:
       raise new_exception(types.Exception, "Actor worker pool exhausted")
     init_thread(thread_id, current_thread_id)
-    createThread(THREAD_DATA[thread_id].thread, actor_worker_handler, thread_id)
+    let worker = ActorWorker(thread_id: thread_id, index: i, runnable: initDeque[ActorRuntimeRecord]())
+    initLock(worker.lock)
+    actor_workers.add(worker)
     actor_worker_ids.add(thread_id)
+  # Workers look each other up for stealing, so start them once all exist.
+  for thread_id in actor_worker_ids:
+    createThread(THREAD_DATA[thread_id].thread, actor_worker_handler, thread_id)
 
   if not actor_cleanup_registered:
     actor_cleanup_registered = true
@@ -335,70 +562,26 @@ proc actor_spawn_value*(handler: Value, state: Value = NIL, mailbox_limit = 0):
   let routed_state = prepare_actor_payload_for_send(state)
   let effective_mailbox_limit = if mailbox_limit > 0: mailbox_limit else: actor_mailbox_limit
 
-  let worker_id = actor_worker_ids[actor_rr_index mod actor_worker_ids.len]
+  let worker_index = actor_rr_index mod actor_workers.len
   actor_rr_index.inc()
 
   let actor_handle = Actor(id: actor_next_id)
   actor_next_id.inc()
   let record = ActorRuntimeRecord(
     actor: actor_handle,
-    thread_id: worker_id,
     handler: handler,
     state: routed_state.value,
-    stopped: false,
-    mailbox: initFifoQueue[ActorMailboxMessage](effective_mailbox_limit),
-    pending_sends: initFifoQueue[ActorMailboxMessage](effective_mailbox_limit),
-    mailbox_limit: effective_mailbox_limit,
-    dispatched: false
+    pending_sends: initFifoQueue[ActorMailboxMessage](),
+    mailbox_limit: effective_mailbox_limit
   )
+  record.worker_index.store(worker_index, moRelaxed)
+  record.init_actor_mailbox()
   initLock(record.lock)
   initCond(record.cond)
   actor_registry[actor_handle.id] = record
   actor_spawned = true
   actor_handle.to_value()
 
-proc actor_pop_message(record: ActorRuntimeRecord): ActorMailboxMessage =
-  acquire(record.lock)
-  if record.stopped or record.mailbox.len == 0:
-    record.dispatched = false
-    release(record.lock)
-    return nil
-
-  result = record.mailbox.popFront()
-  actor_signal_space(record)
-  release(record.lock)
-
-proc actor_finish_turn(record: ActorRuntimeRecord) =
-  var wake_thread_id = -1
-  var wake_actor_id = -1
-
-  acquire(record.lock)
-  actor_signal_space(record)
-  if record.stopped or record.mailbox.len == 0:
-    record.dispatched = false
-  else:
-    wake_thread_id = record.thread_id
-    wake_actor_id = record.actor.id
-  release(record.lock)
-
-  if wake_thread_id != -1:
-    actor_wake_worker(wake_thread_id, wake_actor_id)
-
-proc stop_actor_record(record: ActorRuntimeRecord): seq[ActorMailboxMessage] =
-  acquire(record.lock)
-  record.stopped = true
-  for msg in record.mailbox:
-    if msg.reply_requested:
-      result.add(msg)
-  for msg in record.pending_sends:
-    if msg.reply_requested:
-      result.add(msg)
-  record.mailbox.clear()
-  record.pending_sends.clear()
-  record.dispatched = false
-  broadcast(record.cond)
-  release(record.lock)
-
 proc send_actor_reply(msg: ActorMailboxMessage, payload: Value) {.gcsafe.} =
   if msg.from_thread_id < 0 or msg.from_thread_id >= g_max_threads:
     return
@@ -455,49 +638,118 @@ proc actor_lookup(actor_id: int): ActorRuntimeRecord =
   defer: release(actor_runtime_lock)
   actor_registry.getOrDefault(actor_id)
 
+proc actor_pop_message(record: ActorRuntimeRecord): ActorMailboxMessage =
+  ## Only called by the owner of the record's turn.
+  if record.mailbox_len.load() <= 0:
+    return nil
+  result = record.actor_mailbox_try_pop()
+  while result == nil:
+    # A producer reserved its slot but has not linked the message yet.
+    if record.mailbox_len.load() <= 0:
+      return nil
+    cpuRelax()
+    result = record.actor_mailbox_try_pop()
+  if record.pending_len.load() > 0:
+    # Hand the freed slot to the oldest parked send before new senders can
+    # take it.
+    acquire(record.lock)
+    if record.pending_sends.len > 0:
+      record.actor_mailbox_link(record.pending_sends.popFront())
+      discard record.pending_len.fetchSub(1)
+      release(record.lock)
+      return
+    release(record.lock)
+  record.actor_release_slot()
+
+proc actor_take_queued(record: ActorRuntimeRecord): seq[ActorMailboxMessage] =
+  while true:
+    let msg = actor_pop_message(record)
+    if msg == nil:
+      break
+    result.add(msg)
+  acquire(record.lock)
+  while record.pending_sends.len > 0:
+    result.add(record.pending_sends.popFront())
+    discard record.pending_len.fetchSub(1)
+  release(record.lock)
+
+proc actor_fail_queued(record: ActorRuntimeRecord) =
+  for msg in actor_take_queued(record):
+    if msg.reply_requested:
+      send_actor_failure(msg, "Actor is stopped")
+    free_mailbox_message(msg)
+
+proc actor_finish_turn(record: ActorRuntimeRecord) =
+  if record.stopped.load():
+    actor_fail_queued(record)
+  else:
+    actor_refill_from_pending(record)
+  record.dispatched.store(false)
+  # A sender that saw the turn still running did not schedule one.
+  if record.mailbox_len.load() > 0 or record.pending_len.load() > 0:
+    record.actor_mark_runnable()
+
+proc stop_actor_record(record: ActorRuntimeRecord) =
+  record.stopped.store(true)
+  acquire(record.lock)
+  broadcast(record.cond)
+  release(record.lock)
+  # Fail queued replies now if no turn is queued or running; otherwise that
+  # turn does it when it finishes.
+  var expected = false
+  if record.dispatched.compareExchange(expected, true):
+    actor_finish_turn(record)
+
+proc actor_record_snapshot(record: ActorRuntimeRecord): ActorQueueSnapshot =
+  result = ActorQueueSnapshot(
+    exists: true,
+    stopped: record.stopped.load(),
+    dispatched: record.dispatched.load(),
+    mailbox_len: max(0, record.mailbox_len.load()),
+    pending_len: record.pending_len.load(),
+    mailbox_limit: record.mailbox_limit,
+    worker_thread_id: -1,
+    run_queue_len: 0,
+    steals: record.steals.load()
+  )
+  let worker = actor_record_worker(record)
+  if worker != nil:
+    result.worker_thread_id = worker.thread_id
+    acquire(worker.lock)
+    result.run_queue_len = worker.runnable.len
+    release(worker.lock)
+
 proc actor_queue_snapshot*(actor_value: Value): ActorQueueSnapshot {.gcsafe.} =
   {.cast(gcsafe).}:
     result = ActorQueueSnapshot(exists: false, stopped: false, dispatched: false,
-                                mailbox_len: 0, pending_len: 0, mailbox_limit: 0)
+                                mailbox_len: 0, pending_len: 0, mailbox_limit: 0,
+                                worker_thread_id: -1, run_queue_len: 0, steals: 0)
     if actor_value.kind != VkActor or actor_value.ref.actor == nil:
       return
     let record = actor_lookup(actor_value.ref.actor.id)
     if record == nil:
       return
-    acquire(record.lock)
-    result.exists = true
-    result.stopped = record.stopped
-    result.dispatched = record.dispatched
-    result.mailbox_len = record.mailbox.len
-    result.pending_len = record.pending_sends.len
-    result.mailbox_limit = record.mailbox_limit
-    release(record.lock)
-
-proc actor_process_message(msg: ThreadMessage) =
-  if msg.payload.kind != VkInt:
-    return
-
-  let actor_id = msg.payload.int64.int
-  let record = actor_lookup(actor_id)
-  if record == nil:
-    return
-
-  let mailbox_msg = actor_pop_message(record)
-  if mailbox_msg == nil:
-    return
-
-  acquire(record.lock)
-  let actor_state = record.state
-  let handler = record.handler
-  let is_stopped = record.stopped
-  release(record.lock)
-
-  if is_stopped:
-    if mailbox_msg.reply_requested:
-      send_actor_failure(mailbox_msg, "Actor is stopped")
-    actor_finish_turn(record)
-    return
+    result = actor_record_snapshot(record)
 
+proc actor_scheduler_snapshot*(): seq[ActorWorkerSnapshot] {.gcsafe.} =
+  ## Per-worker run queue depth, turn and steal counters.
+  {.cast(gcsafe).}:
+    acquire(actor_runtime_lock)
+    let workers = actor_workers
+    release(actor_runtime_lock)
+    for worker in workers:
+      acquire(worker.lock)
+      let depth = worker.runnable.len
+      release(worker.lock)
+      result.add(ActorWorkerSnapshot(
+        thread_id: worker.thread_id,
+        run_queue_len: depth,
+        idle: worker.idle.load(),
+        turns: worker.turns.load(),
+        steals: worker.steals.load()
+      ))
+
+proc actor_handle_message(record: ActorRuntimeRecord, mailbox_msg: ActorMailboxMessage) =
   current_actor_record = record
   let ctx = ActorContext(
     actor: record.actor,
@@ -509,22 +761,20 @@ proc actor_process_message(msg: ThreadMessage) =
   )
 
   try:
+    let handler = record.handler
     let next_state =
       case handler.kind
       of VkFunction:
-        vm_exec_callable(VM, handler, @[ctx.to_value(), mailbox_msg.payload, actor_state])
+        vm_exec_callable(VM, handler, @[ctx.to_value(), mailbox_msg.payload, record.state])
       of VkNativeFn:
-        call_native_fn(handler.ref.native_fn, VM, @[ctx.to_value(), mailbox_msg.payload, actor_state])
+        call_native_fn(handler.ref.native_fn, VM, @[ctx.to_value(), mailbox_msg.payload, record.state])
       else:
         raise new_exception(types.Exception, "Actor handler must be callable")
 
-    acquire(record.lock)
     record.state = next_state
-    let is_stopped = record.stopped
-    release(record.lock)
 
     if mailbox_msg.reply_requested and not ctx.reply_sent:
-      if is_stopped:
+      if record.stopped.load():
         send_actor_failure(mailbox_msg, "Actor is stopped")
       else:
         send_actor_reply(mailbox_msg, NIL)
@@ -533,24 +783,84 @@ proc actor_process_message(msg: ThreadMessage) =
       send_actor_failure(mailbox_msg, exc.msg)
   finally:
     current_actor_record = nil
-    actor_finish_turn(record)
+    free_mailbox_message(mailbox_msg)
+
+proc actor_run_turn(worker: ActorWorker, record: ActorRuntimeRecord) =
+  # Later sends from outside the workers queue where the actor last ran.
+  record.worker_index.store(worker.index, moRelaxed)
+  discard worker.turns.fetchAdd(1)
+  var processed = 0
+  while processed < ActorTurnBudget and not record.stopped.load():
+    let msg = actor_pop_message(record)
+    if msg == nil:
+      break
+    processed.inc()
+    reset_vm_state()
+    actor_handle_message(record, msg)
+  actor_finish_turn(record)
+
+# Own queue first (oldest first), then the newest entry of another worker.
+proc actor_next_runnable(worker: ActorWorker): ActorRuntimeRecord =
+  acquire(worker.lock)
+  if worker.runnable.len > 0:
+    result = worker.runnable.popFirst()
+  release(worker.lock)
+  if result != nil:
+    return
+
+  let count = actor_workers.len
+  for offset in 1..<count:
+    let victim = actor_workers[(worker.index + offset) mod count]
+    acquire(victim.lock)
+    if victim.runnable.len > 0:
+      result = victim.runnable.popLast()
+    release(victim.lock)
+    if result != nil:
+      discard worker.steals.fetchAdd(1)
+      discard result.steals.fetchAdd(1)
+      return
+
+proc actor_has_runnable(): bool =
+  for worker in actor_workers:
+    acquire(worker.lock)
+    let queued = worker.runnable.len > 0
+    release(worker.lock)
+    if queued:
+      return true
+  false
 
 proc actor_worker_handler(thread_id: int) {.thread.} =
   {.cast(gcsafe).}:
     try:
       setup_actor_thread_vm(thread_id)
-      while true:
+      for candidate in actor_workers:
+        if candidate.thread_id == thread_id:
+          current_actor_worker = candidate
+      let worker = current_actor_worker
+      while worker != nil and not actor_workers_stopping.load():
+        let record = actor_next_runnable(worker)
+        if record != nil:
+          actor_run_turn(worker, record)
+          continue
+
+        # Advertise idleness, then look once more so a concurrent
+        # actor_schedule cannot slip between the two.
+        worker.idle.store(true)
+        discard actor_idle_workers.fetchAdd(1)
+        var expected = true
+        if actor_has_runnable() and worker.idle.compareExchange(expected, false):
+          discard actor_idle_workers.fetchSub(1)
+          continue
+
         let msg = THREAD_DATA[thread_id].channel.recv()
+        expected = true
+        if worker.idle.compareExchange(expected, false):
+          discard actor_idle_workers.fetchSub(1)
         if msg.msg_type == MtTerminate:
           break
-
-        reset_vm_state()
-        case msg.msg_type
-        of MtSend, MtSendExpectReply:
-          actor_process_message(msg)
-        else:
-          discard
+        # Anything else is a wakeup or a stray reply; neither carries work.
     finally:
+      current_actor_worker = nil
       if VM != nil:
         free_vm_ptr(VM)
         VM = nil
@@ -565,22 +875,18 @@ proc actor_record_from_value(value: Value): ActorRuntimeRecord =
   record
 
 proc actor_send_value*(vm: ptr VirtualMachine, actor_value: Value, payload: Value,
-                       reply_requested = false): Value =
+                       reply_requested = false, transfer = false): Value =
   let record = actor_record_from_value(actor_value)
 
-  acquire(record.lock)
-  let is_stopped = record.stopped
-  let thread_id = record.thread_id
-  release(record.lock)
-
-  if is_stopped:
+  if record.stopped.load():
     raise new_exception(types.Exception, "Actor is stopped")
-  if thread_id <= 0 or thread_id >= g_max_threads:
+  let worker = actor_record_worker(record)
+  if worker == nil:
     raise new_exception(types.Exception, "Actor worker is no longer valid")
-  if THREAD_DATA[thread_id].channel == nil:
+  if THREAD_DATA[worker.thread_id].channel == nil:
     raise new_exception(types.Exception, "Actor worker is unavailable")
 
-  let routed = prepare_actor_payload_for_send(payload)
+  let routed = prepare_actor_payload_for_send(payload, transfer)
 
   let message_id = next_thread_message_id()
   var future_obj: FutureObj = nil
@@ -598,13 +904,7 @@ proc actor_send_value*(vm: ptr VirtualMachine, actor_value: Value, payload: Valu
     vm.poll_enabled = true
     future_val.future = future_obj
 
-  let msg = ActorMailboxMessage(
-    payload: routed.value,
-    reply_requested: reply_requested,
-    from_message_id: message_id,
-    from_thread_id: current_thread_id,
-    from_thread_secret: THREADS[current_thread_id].secret
-  )
+  let msg = new_mailbox_message(routed.value, reply_requested, message_id)
   try:
     actor_enqueue_message(record, msg, current_actor_record != nil)
   except CatchableError:
@@ -617,7 +917,7 @@ proc actor_send_value*(vm: ptr VirtualMachine, actor_value: Value, payload: Valu
   NIL
 
 proc actor_try_send_value*(vm: ptr VirtualMachine, actor_value: Value, payload: Value,
-                           reply_requested = false): ActorTrySendResult =
+                           reply_requested = false, transfer = false): ActorTrySendResult =
   result = ActorTrySendResult(status: AtsInvalidTarget, future: NIL)
   if actor_value.kind != VkActor or actor_value.ref.actor == nil:
     return
@@ -628,22 +928,16 @@ proc actor_try_send_value*(vm: ptr VirtualMachine, actor_value: Value, payload:
   if record == nil:
     return
 
-  acquire(record.lock)
-  let is_stopped = record.stopped
-  let thread_id = record.thread_id
-  release(record.lock)
-
-  if is_stopped:
+  if record.stopped.load():
     result.status = AtsStopped
     return
-  if thread_id <= 0 or thread_id >= g_max_threads:
-    return
-  if THREAD_DATA[thread_id].channel == nil:
+  let worker = actor_record_worker(record)
+  if worker == nil or THREAD_DATA[worker.thread_id].channel == nil:
     return
 
   var routed: tuple[tier: ActorSendTier, value: Value]
   try:
-    routed = prepare_actor_payload_for_send(payload)
+    routed = prepare_actor_payload_for_send(payload, transfer)
   except CatchableError:
     return
 
@@ -663,15 +957,10 @@ proc actor_try_send_value*(vm: ptr VirtualMachine, actor_value: Value, payload:
     vm.poll_enabled = true
     future_val.future = future_obj
 
-  let msg = ActorMailboxMessage(
-    payload: routed.value,
-    reply_requested: reply_requested,
-    from_message_id: message_id,
-    from_thread_id: current_thread_id,
-    from_thread_secret: THREADS[current_thread_id].secret
-  )
+  let msg = new_mailbox_message(routed.value, reply_requested, message_id)
   result.status = actor_try_enqueue_message(record, msg)
   if result.status != AtsAccepted:
+    free_mailbox_message(msg)
     if reply_requested:
       vm.thread_futures.del(message_id)
     return
@@ -686,7 +975,9 @@ proc actor_send_internal(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value]
 
   let self_arg = get_self(args, has_keyword_args)
   let payload = get_method_arg(args, 0, has_keyword_args)
-  actor_send_value(vm, self_arg, payload, reply_requested)
+  let transfer = has_keyword_args and has_keyword_arg(args, "transfer") and
+    get_keyword_arg(args, "transfer").to_bool()
+  actor_send_value(vm, self_arg, payload, reply_requested, transfer)
 
 proc actor_send_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
                        has_keyword_args: bool): Value {.gcsafe.} =
@@ -765,6 +1056,20 @@ proc actor_enable_native*(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value
   {.cast(gcsafe).}:
     actor_enable_impl(vm, args, arg_count, has_keyword_args)
 
+proc actor_send_stats_native*(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                              has_keyword_args: bool): Value {.gcsafe, nimcall.} =
+  discard vm
+  discard args
+  discard arg_count
+  discard has_keyword_args
+  {.cast(gcsafe).}:
+    let counts = actor_send_tier_stats()
+    result = new_map_value()
+    map_data(result)["by_value".to_key()] = counts[AstByValue].to_value()
+    map_data(result)["shared_frozen".to_key()] = counts[AstSharedFrozen].to_value()
+    map_data(result)["cloned".to_key()] = counts[AstClonedMutable].to_value()
+    map_data(result)["moved".to_key()] = counts[AstMovedUnique].to_value()
+
 proc actor_enable_for_test*(workers: int) =
   actor_enable_workers(workers)
 
@@ -786,10 +1091,7 @@ proc actor_spawn_native*(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value]
     actor_spawn_impl(vm, args, arg_count, has_keyword_args)
 
 proc actor_stop_impl(args: ptr UncheckedArray[Value], has_keyword_args: bool): Value =
-  let record = actor_record_from_value(get_self(args, has_keyword_args))
-  let failed = stop_actor_record(record)
-  for msg in failed:
-    send_actor_failure(msg, "Actor is stopped")
+  stop_actor_record(actor_record_from_value(get_self(args, has_keyword_args)))
   NIL
 
 proc actor_stop_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
@@ -831,9 +1133,7 @@ proc actor_context_reply_native(vm: ptr VirtualMachine, args: ptr UncheckedArray
 
 proc actor_context_stop_impl(): Value =
   if current_actor_record != nil:
-    let failed = stop_actor_record(current_actor_record)
-    for msg in failed:
-      send_actor_failure(msg, "Actor is stopped")
+    stop_actor_record(current_actor_record)
   NIL
 
 proc actor_context_stop_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
@@ -853,6 +1153,7 @@ proc init_actor_runtime*() =
   actor_spawned = false
   actor_next_id = 1
   actor_worker_ids = @[]
+  actor_workers = @[]
   actor_registry = initTable[int, ActorRuntimeRecord]()
   actor_rr_index = 0
   actor_mailbox_limit = DEFAULT_ACTOR_MAILBOX_LIMIT
@@ -868,6 +1169,7 @@ proc shutdown_actor_runtime*() =
   actor_spawned = false
   actor_rr_index = 0
   release(actor_runtime_lock)
+  actor_workers_stopping.store(true)
 
   for thread_id in worker_ids:
     if thread_id <= 0 or thread_id >= g_max_threads:
@@ -887,6 +1189,13 @@ proc shutdown_actor_runtime*() =
     joinThread(THREAD_DATA[thread_id].thread)
     THREAD_DATA[thread_id].channel = nil
 
+  # Workers read each other's queues until they have all exited.
+  acquire(actor_runtime_lock)
+  actor_workers = @[]
+  release(actor_runtime_lock)
+  actor_idle_workers.store(0)
+  actor_workers_stopping.store(false)
+
 proc init_actor_class*() =
   if not gene_namespace_initialized:
     return
@@ -0,0 +1,282 @@
+## Bounded thread pool for blocking extension work.
+##
+## Extensions hand over a C `work_fn` that may block (database calls, file
+## parsing, ...). It runs on one of the pool threads and must not touch Gene
+## values. When it returns, the job goes back to the thread that submitted
+## it. That thread is woken through an AsyncEvent on its asyncdispatch loop,
+## so `await` and `run_forever` pick it up. It then runs `complete_fn` and
+## resolves the Gene future.
+##
+## The pool is sized separately from the actor workers and started on first
+## use. `GENE_BLOCKING_THREADS` and `GENE_BLOCKING_QUEUE_LIMIT` override the
+## defaults at startup.
+
+import std/[locks, os, strutils, tables]
+import asyncdispatch
+import ../types
+import ./fifo_queue
+import ./async
+
+const
+  DefaultBlockingPoolThreads* = 4
+  DefaultBlockingPoolQueueLimit* = 256
+  MaxBlockingPoolThreads = 64
+
+type
+  BlockingWorkFn* = proc(user_data: pointer): pointer {.cdecl, gcsafe.}
+  BlockingCompleteFn* = proc(work_result: pointer, user_data: pointer,
+                             out_value: ptr Value): int32 {.cdecl, gcsafe.}
+
+  # Completed jobs waiting for their submitting thread. Lives in shared
+  # memory so pool threads can push to it.
+  BlockingOwner = object
+    lock: Lock
+    done: FifoQueue[ptr BlockingJob]
+    event: AsyncEvent
+
+  BlockingJob = object
+    id: int64
+    work_fn: BlockingWorkFn
+    complete_fn: BlockingCompleteFn
+    user_data: pointer
+    work_result: pointer
+    cancelled: bool  # dropped by shutdown before work_fn ran
+    owner: ptr BlockingOwner
+
+  BlockingPool = object
+    lock: Lock
+    cond: Cond
+    queue: FifoQueue[ptr BlockingJob]
+    threads: ptr UncheckedArray[system.Thread[int]]
+    thread_count: int
+    queue_limit: int
+    running: int
+    completed: int64
+    rejected: int64
+    started: bool
+    stopping: bool
+
+  BlockingPoolStats* = object
+    threads*: int
+    queue_limit*: int
+    queued*: int
+    running*: int
+    completed*: int64
+    rejected*: int64
+
+  # Submitting-thread state; futures never leave the thread that made them.
+  BlockingWaiter = object
+    vm: ptr VirtualMachine
+    future: Value
+
+var blocking_pool: BlockingPool
+var blocking_pool_thread_target = DefaultBlockingPoolThreads
+var blocking_pool_cleanup_registered = false
+
+var blocking_owner {.threadvar.}: ptr BlockingOwner
+var blocking_waiters {.threadvar.}: Table[int64, BlockingWaiter]
+var blocking_next_job_id {.threadvar.}: int64
+
+initLock(blocking_pool.lock)
+initCond(blocking_pool.cond)
+blocking_pool.queue_limit = DefaultBlockingPoolQueueLimit
+
+proc env_int(name: string, fallback: int): int =
+  let raw = getEnv(name)
+  if raw.len == 0:
+    return fallback
+  try:
+    parseInt(raw.strip())
+  except ValueError:
+    fallback
+
+proc configure_blocking_pool*(threads = 0, queue_limit = -1) =
+  ## Set the pool size and queue limit. The thread count only takes effect
+  ## before the first submission; the queue limit applies immediately.
+  ## A queue limit of 0 rejects every submission while all threads are busy.
+  acquire(blocking_pool.lock)
+  if threads > 0 and not blocking_pool.started:
+    blocking_pool_thread_target = min(threads, MaxBlockingPoolThreads)
+  if queue_limit >= 0:
+    blocking_pool.queue_limit = queue_limit
+  release(blocking_pool.lock)
+
+proc blocking_pool_stats*(): BlockingPoolStats =
+  acquire(blocking_pool.lock)
+  result = BlockingPoolStats(
+    threads: blocking_pool.thread_count,
+    queue_limit: blocking_pool.queue_limit,
+    queued: blocking_pool.queue.len,
+    running: blocking_pool.running,
+    completed: blocking_pool.completed,
+    rejected: blocking_pool.rejected
+  )
+  release(blocking_pool.lock)
+
+proc blocking_worker(index: int) {.thread.} =
+  discard index
+  {.cast(gcsafe).}:
+    while true:
+      acquire(blocking_pool.lock)
+      while blocking_pool.queue.len == 0 and not blocking_pool.stopping:
+        wait(blocking_pool.cond, blocking_pool.lock)
+      if blocking_pool.stopping:
+        release(blocking_pool.lock)
+        return
+      let job = blocking_pool.queue.popFront()
+      blocking_pool.running.inc()
+      release(blocking_pool.lock)
+
+      job.work_result = job.work_fn(job.user_data)
+
+      acquire(blocking_pool.lock)
+      blocking_pool.running.dec()
+      blocking_pool.completed.inc()
+      release(blocking_pool.lock)
+
+      let owner = job.owner
+      acquire(owner.lock)
+      owner.done.add(job)
+      release(owner.lock)
+      owner.event.trigger()
+
+proc drain_blocking_completions() {.gcsafe.}
+
+proc shutdown_blocking_pool*() =
+  ## Stop the pool threads after their current job. Queued jobs never run:
+  ## they go back to their submitting thread, which calls `complete_fn` with
+  ## a nil work result and fails their future.
+  acquire(blocking_pool.lock)
+  if not blocking_pool.started:
+    release(blocking_pool.lock)
+    return
+  blocking_pool.stopping = true
+  while blocking_pool.queue.len > 0:
+    let job = blocking_pool.queue.popFront()
+    job.cancelled = true
+    let owner = job.owner
+    acquire(owner.lock)
+    owner.done.add(job)
+    release(owner.lock)
+    owner.event.trigger()
+  broadcast(blocking_pool.cond)
+  let threads = blocking_pool.threads
+  let count = blocking_pool.thread_count
+  release(blocking_pool.lock)
+
+  for i in 0..<count:
+    joinThread(threads[i])
+
+  acquire(blocking_pool.lock)
+  deallocShared(threads)
+  blocking_pool.threads = nil
+  blocking_pool.thread_count = 0
+  blocking_pool.running = 0
+  blocking_pool.started = false
+  blocking_pool.stopping = false
+  release(blocking_pool.lock)
+  # Jobs submitted from this thread are settled now; it may be exiting.
+  drain_blocking_completions()
+
+# Caller holds blocking_pool.lock.
+proc start_blocking_pool_locked() =
+  let count = max(1, min(env_int("GENE_BLOCKING_THREADS", blocking_pool_thread_target),
+                         MaxBlockingPoolThreads))
+  let env_limit = env_int("GENE_BLOCKING_QUEUE_LIMIT", -1)
+  if env_limit >= 0:
+    blocking_pool.queue_limit = env_limit
+  blocking_pool.threads = cast[ptr UncheckedArray[system.Thread[int]]](
+    allocShared0(sizeof(system.Thread[int]) * count))
+  blocking_pool.thread_count = count
+  blocking_pool.started = true
+  for i in 0..<count:
+    createThread(blocking_pool.threads[i], blocking_worker, i)
+  if not blocking_pool_cleanup_registered:
+    blocking_pool_cleanup_registered = true
+    addExitProc(shutdown_blocking_pool)
+
+proc drain_blocking_completions() {.gcsafe.} =
+  let owner = blocking_owner
+  if owner == nil:
+    return
+  var ready: seq[ptr BlockingJob] = @[]
+  acquire(owner.lock)
+  while owner.done.len > 0:
+    ready.add(owner.done.popFront())
+  release(owner.lock)
+
+  for job in ready:
+    var waiter: BlockingWaiter
+    {.cast(gcsafe).}:
+      discard blocking_waiters.pop(job.id, waiter)
+    var value = NIL
+    var status = 0'i32
+    if job.complete_fn != nil:
+      status = job.complete_fn(job.work_result, job.user_data, addr value)
+    let cancelled = job.cancelled
+    deallocShared(job)
+    if waiter.future.kind != VkFuture:
+      continue
+
+    let future_obj = waiter.future.ref.future
+    if cancelled:
+      # complete_fn only got the chance to release user_data.
+      discard future_obj.fail(new_async_error("GENE.EXT.BLOCKING_CANCELLED",
+        "blocking pool shut down before the work ran", "blocking_work"))
+    elif status == 0:
+      discard future_obj.complete(value)
+    else:
+      let message =
+        if value.kind == VkString: value.str
+        else: "blocking extension work failed with status " & $status
+      discard future_obj.fail(new_async_error("GENE.EXT.BLOCKING_FAILURE", message, "blocking_work"))
+    execute_future_callbacks(waiter.vm, future_obj)
+
+proc on_blocking_completion(fd: AsyncFD): bool {.gcsafe.} =
+  drain_blocking_completions()
+  false
+
+proc ensure_blocking_owner(): ptr BlockingOwner =
+  if blocking_owner == nil:
+    let owner = cast[ptr BlockingOwner](allocShared0(sizeof(BlockingOwner)))
+    initLock(owner.lock)
+    owner.done = initFifoQueue[ptr BlockingJob]()
+    owner.event = newAsyncEvent()
+    addEvent(owner.event, on_blocking_completion)
+    blocking_owner = owner
+  blocking_owner
+
+proc submit_blocking*(vm: ptr VirtualMachine, work_fn: BlockingWorkFn,
+                      complete_fn: BlockingCompleteFn,
+                      user_data: pointer): tuple[accepted: bool, future: Value] =
+  ## Queue `work_fn(user_data)` on the pool. The returned future resolves on
+  ## this thread's event loop with the value produced by
+  ## `complete_fn(work_result, user_data, out_value)`: status 0 completes it,
+  ## anything else fails it (a string out_value becomes the message). When
+  ## the queue is at its limit nothing is queued and `accepted` is false.
+  result = (false, NIL)
+  let owner = ensure_blocking_owner()
+  blocking_next_job_id.inc()
+  let job = cast[ptr BlockingJob](allocShared0(sizeof(BlockingJob)))
+  job.id = blocking_next_job_id
+  job.work_fn = work_fn
+  job.complete_fn = complete_fn
+  job.user_data = user_data
+  job.owner = owner
+
+  acquire(blocking_pool.lock)
+  if not blocking_pool.started:
+    start_blocking_pool_locked()
+  let idle = blocking_pool.thread_count - blocking_pool.running - blocking_pool.queue.len
+  if idle <= 0 and blocking_pool.queue.len >= blocking_pool.queue_limit:
+    blocking_pool.rejected.inc()
+    release(blocking_pool.lock)
+    deallocShared(job)
+    return
+  blocking_pool.queue.add(job)
+  signal(blocking_pool.cond)
+  release(blocking_pool.lock)
+
+  let future = new_future_value()
+  blocking_waiters[job.id] = BlockingWaiter(vm: vm, future: future)
+  result = (true, future)
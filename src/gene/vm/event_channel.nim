@@ -0,0 +1,287 @@
+## Bounded lock-free event channel from extension threads to a VM.
+##
+## Producers on any thread push raw byte records or Values. The VM thread
+## that opened the channel drains them in batches and hands each batch to
+## the channel handler as one array.
+##
+## The ring is a bounded queue with a sequence number per slot, used with a
+## single consumer, so producers never take a lock. Channels opened with
+## EventChannelSingleProducer also skip the CAS on the enqueue index. An
+## AsyncEvent (an eventfd on Linux) wakes the consumer's asyncdispatch loop
+## only when the channel goes from empty to non-empty.
+##
+## Lifetime: the channel header is reference counted. The owning VM holds
+## one reference until it has drained a closed channel, the opener holds one
+## until it closes it, and producer threads that may outlive close retain
+## their own. Pushes to a closed channel only touch the header and return
+## EpsClosed; the ring and its wakeup event are freed once the channel is
+## closed, drained and no push is in flight.
+
+import std/atomics
+import asyncdispatch
+import ../types
+import ../logging_core
+
+const
+  EventChannelSingleProducer* = 1'u32
+  DefaultEventChannelBatch* = 256
+  MaxEventChannelCapacity = 1 shl 24
+  EventRecordInlineBytes = 48
+  EventChannelLogger = "gene/vm/event_channel"
+
+type
+  EventRecordKind = enum
+    ErkBytes
+    ErkValue
+
+  EventSlot = object
+    sequence: Atomic[int]
+    kind: EventRecordKind
+    len: int
+    value_raw: uint64
+    heap: ptr UncheckedArray[uint8]
+    inline: array[EventRecordInlineBytes, uint8]
+
+  EventChannel* = object
+    # Producer side; kept apart from the consumer fields below.
+    enqueue_pos: Atomic[int]
+    pending: Atomic[int]
+    closed: Atomic[bool]
+    close_done: Atomic[bool]  # the closing thread no longer touches the event
+    in_flight: Atomic[int]    # pushes between their closed check and return
+    refs: Atomic[int]
+    pushed: Atomic[int64]
+    rejected: Atomic[int64]
+    pad: array[64, uint8]
+    # Consumer side, only touched on the owning VM thread.
+    dequeue_pos: int
+    drained: int64
+    batches: int64
+    vm: ptr VirtualMachine
+    handler: Value
+    event: AsyncEvent
+    capacity: int
+    mask: int
+    single_producer: bool
+    finished: bool
+    max_batch: int
+    slots: ptr UncheckedArray[EventSlot]
+
+  EventChannelStats* = object
+    capacity*: int
+    pushed*: int64
+    rejected*: int64
+    drained*: int64
+    batches*: int64
+
+  EventPushStatus* = enum
+    EpsAccepted
+    EpsFull
+    EpsClosed
+    EpsInvalid
+
+proc drain_event_channel*(ch: ptr EventChannel): int {.gcsafe.}
+
+proc event_channel_stats*(ch: ptr EventChannel): EventChannelStats =
+  EventChannelStats(
+    capacity: ch.capacity,
+    pushed: ch.pushed.load(moRelaxed),
+    rejected: ch.rejected.load(moRelaxed),
+    drained: ch.drained,
+    batches: ch.batches
+  )
+
+proc open_event_channel*(vm: ptr VirtualMachine, capacity: int, handler: Value,
+                         flags = 0'u32, max_batch = 0): ptr EventChannel =
+  ## Open a channel drained on the calling VM thread. `handler` receives an
+  ## array of records per batch: bytes for byte records, the pushed Value
+  ## otherwise. `capacity` is rounded up to a power of two.
+  if capacity <= 0 or capacity > MaxEventChannelCapacity:
+    raise new_exception(types.Exception, "event channel capacity must be between 1 and " & $MaxEventChannelCapacity)
+  if handler.kind notin {VkFunction, VkNativeFn, VkBlock}:
+    raise new_exception(types.Exception, "event channel handler must be callable")
+  var size = 2
+  while size < capacity:
+    size = size shl 1
+
+  let ch = cast[ptr EventChannel](allocShared0(sizeof(EventChannel)))
+  ch.slots = cast[ptr UncheckedArray[EventSlot]](allocShared0(sizeof(EventSlot) * size))
+  for i in 0..<size:
+    ch.slots[i].sequence.store(i, moRelaxed)
+  ch.capacity = size
+  ch.mask = size - 1
+  ch.single_producer = (flags and EventChannelSingleProducer) != 0
+  ch.max_batch = if max_batch > 0: max_batch else: DefaultEventChannelBatch
+  ch.vm = vm
+  ch.handler = handler
+  ch.refs.store(2, moRelaxed)  # the owning VM and the opener
+  ch.event = newAsyncEvent()
+  addEvent(ch.event, proc(fd: AsyncFD): bool {.gcsafe.} =
+    if not ch.finished:
+      discard drain_event_channel(ch)
+    false
+  )
+  ch
+
+proc retain_event_channel*(ch: ptr EventChannel) {.gcsafe.} =
+  ## Add a producer reference. Call it while holding a reference already,
+  ## e.g. before handing the channel to a new thread.
+  if ch != nil:
+    discard ch.refs.fetchAdd(1, moRelaxed)
+
+proc release_event_channel*(ch: ptr EventChannel) {.gcsafe.} =
+  ## Drop a reference; the header is freed with the last one.
+  if ch != nil and ch.refs.fetchSub(1, moAcqRel) == 1:
+    deallocShared(ch)
+
+# Registers a push with the drain side. Pairs with the closed store in
+# close_event_channel (both sequentially consistent): either the push sees
+# the close, or the owner sees the push in flight and keeps the ring.
+proc begin_push(ch: ptr EventChannel): bool {.inline.} =
+  discard ch.in_flight.fetchAdd(1)
+  if ch.closed.load():
+    discard ch.in_flight.fetchSub(1, moRelease)
+    return false
+  true
+
+proc end_push(ch: ptr EventChannel) {.inline.} =
+  discard ch.in_flight.fetchSub(1, moRelease)
+
+# Claims the next free slot, or returns nil when the ring is full.
+proc reserve_slot(ch: ptr EventChannel, pos: var int): ptr EventSlot {.inline.} =
+  pos = ch.enqueue_pos.load(moRelaxed)
+  while true:
+    let slot = addr ch.slots[pos and ch.mask]
+    let diff = slot.sequence.load(moAcquire) - pos
+    if diff == 0:
+      if ch.single_producer:
+        ch.enqueue_pos.store(pos + 1, moRelaxed)
+        return slot
+      if ch.enqueue_pos.compareExchangeWeak(pos, pos + 1, moRelaxed, moRelaxed):
+        return slot
+    elif diff < 0:
+      return nil
+    else:
+      pos = ch.enqueue_pos.load(moRelaxed)
+
+proc publish_slot(ch: ptr EventChannel, slot: ptr EventSlot, pos: int) {.inline.} =
+  slot.sequence.store(pos + 1, moRelease)
+  discard ch.pushed.fetchAdd(1, moRelaxed)
+  # Only the push that makes the channel non-empty pays for the wakeup.
+  if ch.pending.fetchAdd(1, moAcqRel) == 0:
+    ch.event.trigger()
+
+proc push_event_bytes*(ch: ptr EventChannel, data: ptr UncheckedArray[uint8],
+                       len: int): EventPushStatus {.gcsafe.} =
+  ## Copy a byte record into the channel. Safe from any thread.
+  if ch == nil or len < 0 or (data == nil and len > 0):
+    return EpsInvalid
+  if not ch.begin_push():
+    return EpsClosed
+  defer: ch.end_push()
+  var pos: int
+  let slot = ch.reserve_slot(pos)
+  if slot == nil:
+    discard ch.rejected.fetchAdd(1, moRelaxed)
+    return EpsFull
+  slot.kind = ErkBytes
+  slot.len = len
+  if len <= EventRecordInlineBytes:
+    slot.heap = nil
+    if len > 0:
+      copyMem(addr slot.inline[0], data, len)
+  else:
+    slot.heap = cast[ptr UncheckedArray[uint8]](allocShared(len))
+    copyMem(slot.heap, data, len)
+  ch.publish_slot(slot, pos)
+  EpsAccepted
+
+proc push_event_value*(ch: ptr EventChannel, value: Value): EventPushStatus {.gcsafe.} =
+  ## Move a Value into the channel. Safe from any thread for values that
+  ## other threads may hold: immediates and shared, deep-frozen graphs. The
+  ## caller's reference is taken over only when the push is accepted.
+  if ch == nil or (isManaged(value) and not (value.shared and value.deep_frozen)):
+    return EpsInvalid
+  if not ch.begin_push():
+    return EpsClosed
+  defer: ch.end_push()
+  var pos: int
+  let slot = ch.reserve_slot(pos)
+  if slot == nil:
+    discard ch.rejected.fetchAdd(1, moRelaxed)
+    return EpsFull
+  slot.kind = ErkValue
+  slot.value_raw = value.raw
+  ch.publish_slot(slot, pos)
+  EpsAccepted
+
+proc close_event_channel*(ch: ptr EventChannel) {.gcsafe.} =
+  ## Stop accepting records and drop the opener's reference. Records already
+  ## pushed are still delivered; later pushes through a retained reference
+  ## return EpsClosed.
+  if ch == nil:
+    return
+  ch.closed.store(true)
+  ch.event.trigger()
+  ch.close_done.store(true, moRelease)
+  ch.release_event_channel()
+
+# Deferred with callSoon: the event cannot be unregistered from its own
+# callback.
+proc free_event_channel(ch: ptr EventChannel) =
+  ch.event.unregister()
+  ch.event.close()
+  ch.handler = NIL
+  deallocShared(ch.slots)
+  ch.slots = nil
+  ch.release_event_channel()
+
+proc drain_event_channel*(ch: ptr EventChannel): int {.gcsafe.} =
+  ## Deliver up to one batch to the handler; returns the number of records.
+  ## Runs on the thread that opened the channel.
+  let batch = new_array_value()
+  while result < ch.max_batch:
+    let pos = ch.dequeue_pos
+    let slot = addr ch.slots[pos and ch.mask]
+    if slot.sequence.load(moAcquire) != pos + 1:
+      break
+    case slot.kind
+    of ErkBytes:
+      if slot.heap != nil:
+        array_data(batch).add(new_bytes_value(toOpenArray(slot.heap, 0, slot.len - 1)))
+        deallocShared(slot.heap)
+        slot.heap = nil
+      else:
+        array_data(batch).add(new_bytes_value(toOpenArray(slot.inline, 0, slot.len - 1)))
+    of ErkValue:
+      # Adopt the producer's reference.
+      array_data(batch).add(Value(raw: slot.value_raw))
+    slot.sequence.store(pos + ch.capacity, moRelease)
+    ch.dequeue_pos = pos + 1
+    result.inc()
+
+  if result > 0:
+    ch.drained += result
+    ch.batches.inc()
+    try:
+      {.cast(gcsafe).}:
+        discard vm_exec_callable(ch.vm, ch.handler, @[batch])
+    except CatchableError as exc:
+      log_message(LlError, EventChannelLogger, "event channel handler failed: " & exc.msg)
+
+  let left = ch.pending.fetchSub(result, moAcqRel) - result
+  if left > 0:
+    # More than one batch was waiting: yield to other work, then continue.
+    ch.event.trigger()
+  elif ch.closed.load(moAcquire):
+    # in_flight is read before the ring: once no push is in flight after the
+    # close, none can start and every finished one has published its slot.
+    # Until then (or while close_event_channel is still returning), look
+    # again next turn.
+    if not ch.close_done.load(moAcquire) or ch.in_flight.load() > 0 or
+        ch.slots[ch.dequeue_pos and ch.mask].sequence.load(moAcquire) == ch.dequeue_pos + 1:
+      ch.event.trigger()
+    else:
+      ch.finished = true
+      {.cast(gcsafe).}:
+        callSoon(proc() = free_event_channel(ch))
@@ -3651,6 +3651,8 @@ proc exec*(self: ptr VirtualMachine): Value =
           if info.compiled_body.kind == VkCompiledUnit:
             publish_compiled_body(f, info.compiled_body.ref.cu)
             # Store input back to function for reflection (already parsed above)
+          elif info.lazy_body != nil:
+            f.lazy_body = info.lazy_body
         of VkScopeTracker:
           scope_tracker_obj = new_scope_tracker(data_value.ref.scope_tracker)
         else:
@@ -5234,7 +5236,10 @@ proc exec*(self: ptr VirtualMachine): Value =
 
         of VkNativeFn:
           # Single argument - use new signature with helper
-          let result = call_native_fn(target.ref.native_fn, self, [arg])
+          let r = target.ref
+          let result =
+            if r.native_typed != nil: self.call_typed_native_fn(r, [arg])
+            else: call_native_fn(r.native_fn, self, [arg])
           self.frame.push(result)
 
         of VkBoundMethod:
@@ -5450,7 +5455,10 @@ proc exec*(self: ptr VirtualMachine): Value =
               continue
 
         of VkNativeFn:
-          let result = call_native_fn(target.ref.native_fn, self, args)
+          let r = target.ref
+          let result =
+            if r.native_typed != nil: self.call_typed_native_fn(r, args)
+            else: call_native_fn(r.native_fn, self, args)
           self.frame.push(result)
 
         of VkBoundMethod:
@@ -14,6 +14,10 @@ when not defined(gene_wasm):
   import ./actor
   import ./thread
   import ./llm_host_abi
+  import ./async
+  import ./blocking_pool
+  import ./event_channel
+  import asyncdispatch
 
   const VmExtensionLogger = "gene/vm/extension"
 
@@ -96,17 +100,35 @@ type
     mailbox_limit*: int
     handles*: seq[Value]
 
+  # An async inference request waiting for its DONE/ERROR event.
+  LlmAsyncRequest = ref object
+    vm: ptr VirtualMachine
+    future: Value
+    on_token: Value
+    callback_error: string  # set when on_token raised; the request is cancelled
+
   LlmHostBridge = ref object
     handle: LibHandle
     abi_version_fn: GeneLlmHostAbiVersionFn
     load_model_fn: GeneLlmHostLoadModelFn
     new_session_fn: GeneLlmHostNewSessionFn
     infer_fn: GeneLlmHostInferFn
+    call_method_fn: GeneLlmHostCallMethodFn  # optional; forwards extra Model/Session/Engine methods
     close_model_fn: GeneLlmHostCloseModelFn
     close_session_fn: GeneLlmHostCloseSessionFn
     free_cstring_fn: GeneLlmHostFreeCStringFn
+    # Optional async path; inference bypasses the actor when all four resolve.
+    infer_async_fn: GeneLlmHostInferAsyncFn
+    event_fd_fn: GeneLlmHostEventFdFn
+    next_event_fn: GeneLlmHostNextEventFn
+    cancel_fn: GeneLlmHostCancelFn
+    async_requests: Table[int64, LlmAsyncRequest]
+    events_watched: bool
+    event_fd: int32
+    event_timer_armed: bool
     model_class: Class
     session_class: Class
+    engine_class: Class
     actor_handle: Value
 
 var host_scheduler_callback_entries: seq[HostSchedulerCallbackEntry] = @[]
@@ -189,10 +211,9 @@ proc resolve_extension_symbol[T](handle: LibHandle, symbol_name: string): T =
     return cast[T](nil)
   cast[T](handle.symAddr(symbol_name))
 
-proc llm_take_cstring(p: cstring): string {.gcsafe.} =
+proc llm_free_cstring(p: cstring) {.gcsafe.} =
   if p == nil:
-    return ""
-  result = $p
+    return
   var free_fn: GeneLlmHostFreeCStringFn = nil
   {.cast(gcsafe).}:
     if llm_host_bridge != nil:
@@ -200,6 +221,21 @@ proc llm_take_cstring(p: cstring): string {.gcsafe.} =
   if free_fn != nil:
     free_fn(p)
 
+proc llm_take_cstring(p: cstring): string {.gcsafe.} =
+  if p == nil:
+    return ""
+  result = $p
+  llm_free_cstring(p)
+
+# Serialized payloads may be binary, with NUL bytes inside; decode them in
+# place before handing the buffer back.
+proc llm_take_payload(p: cstring): Value {.gcsafe.} =
+  try:
+    {.cast(gcsafe).}:
+      result = deserialize_bridge_payload(p)
+  finally:
+    llm_free_cstring(p)
+
 proc llm_expect_map_arg(args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool,
                         positional_index: int, context: string): Value =
   let positional = get_positional_count(arg_count, has_keyword_args)
@@ -216,10 +252,11 @@ proc llm_serialize_options(value: Value): string {.gcsafe.} =
   if value == NIL:
     return ""
   {.cast(gcsafe).}:
-    serialize_literal(value).to_s()
+    serialize_bridge_payload(value)
 
 proc llm_model_id_key(): Key = "__model_id__".to_key()
 proc llm_session_id_key(): Key = "__session_id__".to_key()
+proc llm_engine_id_key(): Key = "__engine_id__".to_key()
 
 proc llm_model_id(value: Value, context: string): int64 =
   if value.kind != VkInstance:
@@ -241,6 +278,16 @@ proc llm_session_id(value: Value, context: string): int64 =
     raise new_exception(types.Exception, context & " session id is missing")
   id_val.to_int()
 
+proc llm_engine_id(value: Value, context: string): int64 =
+  if value.kind != VkInstance:
+    raise new_exception(types.Exception, context & " requires an LLM engine instance")
+  if value.instance_class == nil or value.instance_class.name != "Engine":
+    raise new_exception(types.Exception, context & " requires an LLM engine instance")
+  let id_val = instance_props(value).getOrDefault(llm_engine_id_key(), NIL)
+  if id_val.kind != VkInt:
+    raise new_exception(types.Exception, context & " engine id is missing")
+  id_val.to_int()
+
 proc new_llm_model_instance(id: int64): Value =
   var cls: Class = nil
   {.cast(gcsafe).}:
@@ -257,6 +304,14 @@ proc new_llm_session_instance(id: int64): Value =
   instance_props(inst)[llm_session_id_key()] = id.to_value()
   inst
 
+proc new_llm_engine_instance(id: int64): Value =
+  var cls: Class = nil
+  {.cast(gcsafe).}:
+    cls = llm_host_bridge.engine_class
+  let inst = new_instance_value(cls)
+  instance_props(inst)[llm_engine_id_key()] = id.to_value()
+  inst
+
 proc llm_raise_bridge_error(message: string, fallback: string) {.noreturn.} =
   if message.len > 0:
     raise new_exception(types.Exception, message)
@@ -272,6 +327,32 @@ proc llm_model_close_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Val
                             has_keyword_args: bool): Value {.gcsafe.}
 proc llm_session_close_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
                               has_keyword_args: bool): Value {.gcsafe.}
+proc llm_model_embed_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                            has_keyword_args: bool): Value {.gcsafe.}
+proc llm_model_tokenize_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                               has_keyword_args: bool): Value {.gcsafe.}
+proc llm_model_detokenize_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                 has_keyword_args: bool): Value {.gcsafe.}
+proc llm_model_count_tokens_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                   has_keyword_args: bool): Value {.gcsafe.}
+proc llm_session_save_state_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                   has_keyword_args: bool): Value {.gcsafe.}
+proc llm_session_load_state_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                   has_keyword_args: bool): Value {.gcsafe.}
+proc llm_session_infer_async_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                    has_keyword_args: bool): Value {.gcsafe.}
+proc llm_model_new_engine_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                 has_keyword_args: bool): Value {.gcsafe.}
+proc llm_engine_submit_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                              has_keyword_args: bool): Value {.gcsafe.}
+proc llm_engine_poll_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                            has_keyword_args: bool): Value {.gcsafe.}
+proc llm_engine_cancel_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                              has_keyword_args: bool): Value {.gcsafe.}
+proc llm_engine_close_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                             has_keyword_args: bool): Value {.gcsafe.}
+proc llm_session_infer_streaming_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                        has_keyword_args: bool): Value {.gcsafe.}
 
 proc ensure_llm_host_classes(ext_ns: Namespace) =
   if llm_host_bridge == nil:
@@ -281,7 +362,12 @@ proc ensure_llm_host_classes(ext_ns: Namespace) =
     if App.app.object_class.kind == VkClass:
       model_class.parent = App.app.object_class.ref.class
     model_class.def_native_method("new_session", llm_model_new_session_native)
+    model_class.def_native_method("new_engine", llm_model_new_engine_native)
     model_class.def_native_method("close", llm_model_close_native)
+    model_class.def_native_method("embed", llm_model_embed_native)
+    model_class.def_native_method("tokenize", llm_model_tokenize_native)
+    model_class.def_native_method("detokenize", llm_model_detokenize_native)
+    model_class.def_native_method("count_tokens", llm_model_count_tokens_native)
     llm_host_bridge.model_class = model_class
   if llm_host_bridge.session_class == nil:
     let session_class = new_class("Session")
@@ -289,17 +375,33 @@ proc ensure_llm_host_classes(ext_ns: Namespace) =
       session_class.parent = App.app.object_class.ref.class
     session_class.def_native_method("infer", llm_session_infer_native)
     session_class.def_native_method("close", llm_session_close_native)
+    session_class.def_native_method("save_state", llm_session_save_state_native)
+    session_class.def_native_method("load_state", llm_session_load_state_native)
+    session_class.def_native_method("infer_async", llm_session_infer_async_native)
+    session_class.def_native_method("infer_streaming", llm_session_infer_streaming_native)
     llm_host_bridge.session_class = session_class
+  if llm_host_bridge.engine_class == nil:
+    let engine_class = new_class("Engine")
+    if App.app.object_class.kind == VkClass:
+      engine_class.parent = App.app.object_class.ref.class
+    engine_class.def_native_method("submit", llm_engine_submit_native)
+    engine_class.def_native_method("poll", llm_engine_poll_native)
+    engine_class.def_native_method("cancel", llm_engine_cancel_native)
+    engine_class.def_native_method("close", llm_engine_close_native)
+    llm_host_bridge.engine_class = engine_class
 
   let model_class_ref = new_ref(VkClass)
   model_class_ref.class = llm_host_bridge.model_class
   let session_class_ref = new_ref(VkClass)
   session_class_ref.class = llm_host_bridge.session_class
+  let engine_class_ref = new_ref(VkClass)
+  engine_class_ref.class = llm_host_bridge.engine_class
   let load_fn = new_ref(VkNativeFn)
   load_fn.native_fn = llm_load_model_native
 
   ext_ns["Model".to_key()] = model_class_ref.to_ref_value()
   ext_ns["Session".to_key()] = session_class_ref.to_ref_value()
+  ext_ns["Engine".to_key()] = engine_class_ref.to_ref_value()
   ext_ns["load_model".to_key()] = load_fn.to_ref_value()
 
 proc install_llm_host_bridge(ext_ns: Namespace, handle: LibHandle) =
@@ -318,9 +420,16 @@ proc install_llm_host_bridge(ext_ns: Namespace, handle: LibHandle) =
     load_model_fn: resolve_extension_symbol[GeneLlmHostLoadModelFn](handle, "gene_llm_host_load_model"),
     new_session_fn: resolve_extension_symbol[GeneLlmHostNewSessionFn](handle, "gene_llm_host_new_session"),
     infer_fn: resolve_extension_symbol[GeneLlmHostInferFn](handle, "gene_llm_host_infer"),
+    call_method_fn: resolve_extension_symbol[GeneLlmHostCallMethodFn](handle, "gene_llm_host_call_method"),
     close_model_fn: resolve_extension_symbol[GeneLlmHostCloseModelFn](handle, "gene_llm_host_close_model"),
     close_session_fn: resolve_extension_symbol[GeneLlmHostCloseSessionFn](handle, "gene_llm_host_close_session"),
     free_cstring_fn: resolve_extension_symbol[GeneLlmHostFreeCStringFn](handle, "gene_llm_host_free_cstring"),
+    infer_async_fn: resolve_extension_symbol[GeneLlmHostInferAsyncFn](handle, "gene_llm_host_infer_async"),
+    event_fd_fn: resolve_extension_symbol[GeneLlmHostEventFdFn](handle, "gene_llm_host_event_fd"),
+    next_event_fn: resolve_extension_symbol[GeneLlmHostNextEventFn](handle, "gene_llm_host_next_event"),
+    cancel_fn: resolve_extension_symbol[GeneLlmHostCancelFn](handle, "gene_llm_host_cancel"),
+    async_requests: initTable[int64, LlmAsyncRequest](),
+    event_fd: -1,
     actor_handle: NIL
   )
   if bridge.load_model_fn == nil or bridge.new_session_fn == nil or bridge.infer_fn == nil or
@@ -330,15 +439,7 @@ proc install_llm_host_bridge(ext_ns: Namespace, handle: LibHandle) =
   llm_host_bridge = bridge
   ensure_llm_host_classes(ext_ns)
 
-proc llm_bridge_poll_reply(vm: ptr VirtualMachine, future_value: Value, context: string): Value {.gcsafe.} =
-  let deadline = epochTime() + 10.0
-  let future_obj = future_value.ref.future
-  while future_obj.state == FsPending and epochTime() < deadline:
-    vm.event_loop_counter = 100
-    {.cast(gcsafe).}:
-      vm_poll_event_loop(vm)
-    sleep(10)
-
+proc llm_bridge_future_result(future_obj: FutureObj, context: string): Value {.gcsafe.} =
   case future_obj.state
   of FsSuccess:
     return future_obj.value
@@ -356,6 +457,126 @@ proc llm_bridge_poll_reply(vm: ptr VirtualMachine, future_value: Value, context:
   of FsPending:
     llm_raise_bridge_error(context & " timed out", context & " timed out")
 
+proc llm_bridge_poll_reply(vm: ptr VirtualMachine, future_value: Value, context: string): Value {.gcsafe.} =
+  let deadline = epochTime() + 10.0
+  let future_obj = future_value.ref.future
+  while future_obj.state == FsPending and epochTime() < deadline:
+    vm.event_loop_counter = 100
+    {.cast(gcsafe).}:
+      vm_poll_event_loop(vm)
+    sleep(10)
+  llm_bridge_future_result(future_obj, context)
+
+const LlmEventPollMs = 5
+
+proc llm_bridge_async_enabled(bridge: LlmHostBridge): bool =
+  bridge.infer_async_fn != nil and bridge.event_fd_fn != nil and
+    bridge.next_event_fn != nil and bridge.cancel_fn != nil
+
+# Routes queued extension events to their requests. Runs on the VM thread,
+# from the asyncdispatch loop that await and run_forever already poll.
+proc llm_bridge_pump(bridge: LlmHostBridge) {.gcsafe.} =
+  var request_id: int64
+  var kind: int32
+  var payload: cstring = nil
+  while bridge.next_event_fn(addr request_id, addr kind, addr payload) != 0:
+    let raw = payload
+    payload = nil
+    let request = bridge.async_requests.getOrDefault(request_id, nil)
+    if request == nil:
+      llm_free_cstring(raw)
+      continue
+    if kind == int32(GlheToken):
+      let text = llm_take_cstring(raw)
+      if request.on_token != NIL and request.callback_error.len == 0:
+        try:
+          {.cast(gcsafe).}:
+            discard vm_exec_callable(request.vm, request.on_token, @[text.to_value()])
+        except CatchableError as exc:
+          request.callback_error = exc.msg
+          var err: cstring = nil
+          discard bridge.cancel_fn(request_id, addr err)
+          discard llm_take_cstring(err)
+      continue
+
+    bridge.async_requests.del(request_id)
+    let future_obj = request.future.ref.future
+    if request.callback_error.len > 0:
+      llm_free_cstring(raw)
+      discard future_obj.fail(new_async_error("GENE.ASYNC.FAILURE", request.callback_error, "llm_stream_callback"))
+    elif kind == int32(GlheDone):
+      try:
+        discard future_obj.complete(llm_take_payload(raw))
+      except CatchableError as exc:
+        discard future_obj.fail(new_async_error("GENE.ASYNC.FAILURE", exc.msg, "llm_reply_decode"))
+    else:
+      discard future_obj.fail(new_async_error("GENE.ASYNC.FAILURE", llm_take_cstring(raw), "llm_infer"))
+    execute_future_callbacks(request.vm, future_obj)
+
+proc llm_bridge_on_readable(fd: AsyncFD): bool {.gcsafe.} =
+  let bridge = current_llm_bridge()
+  if bridge != nil:
+    llm_bridge_pump(bridge)
+  false
+
+proc llm_bridge_on_timer(fd: AsyncFD): bool {.gcsafe.} =
+  let bridge = current_llm_bridge()
+  if bridge == nil:
+    return true
+  llm_bridge_pump(bridge)
+  if bridge.async_requests.len == 0:
+    bridge.event_timer_armed = false
+    return true
+  false
+
+proc llm_bridge_watch_events(bridge: LlmHostBridge) =
+  if not bridge.events_watched:
+    bridge.events_watched = true
+    bridge.event_fd = bridge.event_fd_fn()
+    if bridge.event_fd >= 0:
+      let fd = AsyncFD(bridge.event_fd)
+      asyncdispatch.register(fd)
+      addRead(fd, llm_bridge_on_readable)
+  if bridge.event_fd < 0 and not bridge.event_timer_armed:
+    # No descriptor to wait on: poll on a short timer while requests are out.
+    bridge.event_timer_armed = true
+    addTimer(LlmEventPollMs, false, llm_bridge_on_timer)
+
+# Queues an inference request; the returned future resolves on this VM's
+# event loop. on_token (or NIL) receives streamed text pieces.
+proc llm_bridge_submit(vm: ptr VirtualMachine, bridge: LlmHostBridge, session_id: int64, prompt: string,
+                       opts: Value, on_token: Value, context: string): Value =
+  let options_ser = llm_serialize_options(opts)
+  var request_id: int64
+  var err: cstring = nil
+  let status = bridge.infer_async_fn(session_id, prompt.cstring,
+    if options_ser.len > 0: options_ser.cstring else: nil,
+    int32(on_token != NIL), addr request_id, addr err)
+  let err_msg = llm_take_cstring(err)
+  if status != int32(GlhsOk):
+    llm_raise_bridge_error(err_msg, context & " failed")
+  result = new_future_value()
+  bridge.async_requests[request_id] = LlmAsyncRequest(vm: vm, future: result, on_token: on_token)
+  llm_bridge_watch_events(bridge)
+  # Requests that finished before the watch was armed would otherwise wait
+  # for the next unrelated wakeup.
+  llm_bridge_pump(bridge)
+
+proc llm_bridge_wait(future_value: Value, context: string): Value {.gcsafe.} =
+  let future_obj = future_value.ref.future
+  while future_obj.state == FsPending:
+    try:
+      {.cast(gcsafe).}:
+        asyncdispatch.poll(50)
+    except ValueError:
+      # No handles registered; the pump below still makes progress.
+      discard
+    if future_obj.state == FsPending:
+      let bridge = current_llm_bridge()
+      if bridge != nil:
+        llm_bridge_pump(bridge)
+  llm_bridge_future_result(future_obj, context)
+
 proc llm_bridge_request_actor_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
                                      has_keyword_args: bool): Value {.gcsafe.} =
   discard arg_count
@@ -416,8 +637,27 @@ proc llm_bridge_request_actor_native(vm: ptr VirtualMachine, args: ptr Unchecked
       llm_raise_bridge_error(err_msg, "Session.infer failed")
     if result_ser == nil:
       llm_raise_bridge_error("", "Session.infer returned no payload")
-    let payload = llm_take_cstring(result_ser)
-    actor_reply_for_test(ctx, deserialize_literal(payload))
+    actor_reply_for_test(ctx, llm_take_payload(result_ser))
+  of "call":
+    let target_val = map_data(msg).getOrDefault("target".to_key(), NIL)
+    let target_id_val = map_data(msg).getOrDefault("target_id".to_key(), NIL)
+    let method_val = map_data(msg).getOrDefault("method".to_key(), NIL)
+    if target_val.kind != VkInt or target_id_val.kind != VkInt or method_val.kind != VkString:
+      raise new_exception(types.Exception, "LLM call requires target, target_id and method")
+    if bridge.call_method_fn == nil:
+      raise new_exception(types.Exception, "LLM extension does not support " & method_val.str)
+    let args_ser = llm_serialize_options(map_data(msg).getOrDefault("args".to_key(), NIL))
+    var result_ser: cstring = nil
+    var err: cstring = nil
+    let status = bridge.call_method_fn(int32(target_val.to_int()), target_id_val.to_int(),
+      method_val.str.cstring, if args_ser.len > 0: args_ser.cstring else: nil,
+      addr result_ser, addr err)
+    let err_msg = llm_take_cstring(err)
+    if status != int32(GlhsOk):
+      llm_raise_bridge_error(err_msg, method_val.str & " failed")
+    if result_ser == nil:
+      llm_raise_bridge_error("", method_val.str & " returned no payload")
+    actor_reply_for_test(ctx, llm_take_payload(result_ser))
   of "close_model":
     let model_id_val = map_data(msg).getOrDefault("model_id".to_key(), NIL)
     if model_id_val.kind != VkInt:
@@ -489,7 +729,15 @@ proc llm_model_new_session_native(vm: ptr VirtualMachine, args: ptr UncheckedArr
   if current_llm_bridge() == nil:
     raise new_exception(types.Exception, "LLM host bridge is not installed")
   let model_id = llm_model_id(get_positional_arg(args, 0, has_keyword_args), "Model.new_session")
-  let opts = llm_expect_map_arg(args, arg_count, has_keyword_args, 2, "new_session")
+  var opts = llm_expect_map_arg(args, arg_count, has_keyword_args, 2, "new_session")
+  # Model instances do not cross the bridge; a ^draft model travels as its id.
+  if opts != NIL and map_data(opts).hasKey("draft".to_key()):
+    let draft_id = llm_model_id(map_data(opts)["draft".to_key()], "new_session ^draft")
+    let forwarded = new_map_value()
+    for key, value in map_data(opts):
+      map_data(forwarded)[key] = value
+    map_data(forwarded)["draft".to_key()] = draft_id.to_value()
+    opts = forwarded
   var actor = NIL
   {.cast(gcsafe).}:
     actor = ensure_llm_host_actor(vm)
@@ -515,6 +763,14 @@ proc llm_session_infer_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[V
   if prompt_val.kind != VkString:
     raise new_exception(types.Exception, "Session.infer prompt must be a string")
   let opts = llm_expect_map_arg(args, arg_count, has_keyword_args, 3, "infer")
+  let bridge = current_llm_bridge()
+  # n-best requests return an array, which only the synchronous call carries.
+  let wants_branches = opts != NIL and map_data(opts).hasKey("n".to_key())
+  if bridge.llm_bridge_async_enabled() and not wants_branches:
+    var future = NIL
+    {.cast(gcsafe).}:
+      future = llm_bridge_submit(vm, bridge, session_id, prompt_val.str, opts, NIL, "Session.infer")
+    return llm_bridge_wait(future, "Session.infer")
   var actor = NIL
   {.cast(gcsafe).}:
     actor = ensure_llm_host_actor(vm)
@@ -565,6 +821,159 @@ proc llm_session_close_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[V
   discard llm_bridge_poll_reply(vm, future, "Session.close")
   NIL
 
+# Forwards self.method(args...) to the extension; self is args[0].
+proc llm_bridge_call_method(vm: ptr VirtualMachine, target: GeneLlmHostTarget, target_id: int64,
+                            method_name: string, args: ptr UncheckedArray[Value], arg_count: int,
+                            has_keyword_args: bool, context: string): Value {.gcsafe.} =
+  let rest = new_array_value()
+  for i in 1..<get_positional_count(arg_count, has_keyword_args):
+    array_data(rest).add(get_positional_arg(args, i, has_keyword_args))
+  var actor = NIL
+  {.cast(gcsafe).}:
+    actor = ensure_llm_host_actor(vm)
+  let msg = new_map_value()
+  map_data(msg)["op".to_key()] = "call".to_value()
+  map_data(msg)["target".to_key()] = target.ord.to_value()
+  map_data(msg)["target_id".to_key()] = target_id.to_value()
+  map_data(msg)["method".to_key()] = method_name.to_value()
+  map_data(msg)["args".to_key()] = rest
+  var future = NIL
+  {.cast(gcsafe).}:
+    future = actor_send_value(vm, actor, msg, true)
+  llm_bridge_poll_reply(vm, future, context)
+
+proc llm_model_embed_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                            has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let model_id = llm_model_id(get_positional_arg(args, 0, has_keyword_args), "Model.embed")
+  llm_bridge_call_method(vm, GlhtModel, model_id, "embed", args, arg_count, has_keyword_args, "Model.embed")
+
+proc llm_model_tokenize_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                               has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let model_id = llm_model_id(get_positional_arg(args, 0, has_keyword_args), "Model.tokenize")
+  llm_bridge_call_method(vm, GlhtModel, model_id, "tokenize", args, arg_count, has_keyword_args,
+    "Model.tokenize")
+
+proc llm_model_detokenize_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                 has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let model_id = llm_model_id(get_positional_arg(args, 0, has_keyword_args), "Model.detokenize")
+  llm_bridge_call_method(vm, GlhtModel, model_id, "detokenize", args, arg_count, has_keyword_args,
+    "Model.detokenize")
+
+proc llm_model_count_tokens_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                   has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let model_id = llm_model_id(get_positional_arg(args, 0, has_keyword_args), "Model.count_tokens")
+  llm_bridge_call_method(vm, GlhtModel, model_id, "count_tokens", args, arg_count, has_keyword_args,
+    "Model.count_tokens")
+
+proc llm_session_save_state_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                   has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let session_id = llm_session_id(get_positional_arg(args, 0, has_keyword_args), "Session.save_state")
+  llm_bridge_call_method(vm, GlhtSession, session_id, "save_state", args, arg_count, has_keyword_args,
+    "Session.save_state")
+
+proc llm_session_load_state_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                   has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let session_id = llm_session_id(get_positional_arg(args, 0, has_keyword_args), "Session.load_state")
+  llm_bridge_call_method(vm, GlhtSession, session_id, "load_state", args, arg_count, has_keyword_args,
+    "Session.load_state")
+
+# Engines run in the extension; the host holds an id and forwards each call.
+proc llm_model_new_engine_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                 has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let model_id = llm_model_id(get_positional_arg(args, 0, has_keyword_args), "Model.new_engine")
+  let reply = llm_bridge_call_method(vm, GlhtModel, model_id, "new_engine", args, arg_count, has_keyword_args,
+    "Model.new_engine")
+  if reply.kind != VkMap or map_data(reply).getOrDefault("engine_id".to_key(), NIL).kind != VkInt:
+    raise new_exception(types.Exception, "Model.new_engine returned no engine id")
+  new_llm_engine_instance(map_data(reply)["engine_id".to_key()].to_int())
+
+proc llm_engine_submit_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                              has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let engine_id = llm_engine_id(get_positional_arg(args, 0, has_keyword_args), "Engine.submit")
+  llm_bridge_call_method(vm, GlhtEngine, engine_id, "submit", args, arg_count, has_keyword_args,
+    "Engine.submit")
+
+proc llm_engine_poll_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                            has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let engine_id = llm_engine_id(get_positional_arg(args, 0, has_keyword_args), "Engine.poll")
+  llm_bridge_call_method(vm, GlhtEngine, engine_id, "poll", args, arg_count, has_keyword_args,
+    "Engine.poll")
+
+proc llm_engine_cancel_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                              has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let engine_id = llm_engine_id(get_positional_arg(args, 0, has_keyword_args), "Engine.cancel")
+  llm_bridge_call_method(vm, GlhtEngine, engine_id, "cancel", args, arg_count, has_keyword_args,
+    "Engine.cancel")
+
+proc llm_engine_close_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                             has_keyword_args: bool): Value {.gcsafe.} =
+  if current_llm_bridge() == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  let engine_id = llm_engine_id(get_positional_arg(args, 0, has_keyword_args), "Engine.close")
+  discard llm_bridge_call_method(vm, GlhtEngine, engine_id, "close", args, arg_count, has_keyword_args,
+    "Engine.close")
+  NIL
+
+proc llm_async_bridge(context: string): LlmHostBridge {.gcsafe.} =
+  result = current_llm_bridge()
+  if result == nil:
+    raise new_exception(types.Exception, "LLM host bridge is not installed")
+  if not result.llm_bridge_async_enabled():
+    raise new_exception(types.Exception, context & " is not supported by the loaded LLM extension")
+
+# (session .infer_async prompt [opts]) -> Future of the completion map
+proc llm_session_infer_async_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                    has_keyword_args: bool): Value {.gcsafe.} =
+  let bridge = llm_async_bridge("Session.infer_async")
+  if get_positional_count(arg_count, has_keyword_args) < 2:
+    raise new_exception(types.Exception, "Session.infer_async requires self and a prompt string")
+  let session_id = llm_session_id(get_positional_arg(args, 0, has_keyword_args), "Session.infer_async")
+  let prompt_val = get_positional_arg(args, 1, has_keyword_args)
+  if prompt_val.kind != VkString:
+    raise new_exception(types.Exception, "Session.infer_async prompt must be a string")
+  let opts = llm_expect_map_arg(args, arg_count, has_keyword_args, 3, "infer_async")
+  {.cast(gcsafe).}:
+    result = llm_bridge_submit(vm, bridge, session_id, prompt_val.str, opts, NIL, "Session.infer_async")
+
+# (session .infer_streaming prompt callback [opts]) -> completion map
+proc llm_session_infer_streaming_native(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                        has_keyword_args: bool): Value {.gcsafe.} =
+  let bridge = llm_async_bridge("Session.infer_streaming")
+  if get_positional_count(arg_count, has_keyword_args) < 3:
+    raise new_exception(types.Exception, "Session.infer_streaming requires self, prompt, and callback")
+  let session_id = llm_session_id(get_positional_arg(args, 0, has_keyword_args), "Session.infer_streaming")
+  let prompt_val = get_positional_arg(args, 1, has_keyword_args)
+  if prompt_val.kind != VkString:
+    raise new_exception(types.Exception, "Session.infer_streaming prompt must be a string")
+  let callback = get_positional_arg(args, 2, has_keyword_args)
+  if callback.kind notin {VkFunction, VkNativeFn, VkBlock}:
+    raise new_exception(types.Exception, "Session.infer_streaming callback must be a function")
+  let opts = llm_expect_map_arg(args, arg_count, has_keyword_args, 4, "infer_streaming")
+  var future = NIL
+  {.cast(gcsafe).}:
+    future = llm_bridge_submit(vm, bridge, session_id, prompt_val.str, opts, callback, "Session.infer_streaming")
+  llm_bridge_wait(future, "Session.infer_streaming")
+
 proc host_scheduler_dispatcher(vm: ptr VirtualMachine) {.gcsafe.} =
   {.cast(gcsafe).}:
     let vm_user_data = cast[pointer](vm)
@@ -749,7 +1158,7 @@ proc host_actor_reply_serialized_bridge*(ctx: Value, payload_ser: cstring): int3
     if payload_ser == nil:
       return int32(GeneExtErr)
     try:
-      actor_reply_for_test(ctx, deserialize_literal($payload_ser))
+      actor_reply_for_test(ctx, deserialize_bridge_payload(payload_ser))
       int32(GeneExtOk)
     except CatchableError:
       int32(GeneExtErr)
@@ -768,6 +1177,57 @@ proc host_poll_vm_bridge*(vm_user_data: pointer): int32 {.cdecl, gcsafe.} =
     except CatchableError:
       int32(GeneExtErr)
 
+proc host_submit_blocking_bridge*(work_fn: GeneBlockingWorkFn, complete_fn: GeneBlockingCompleteFn,
+                                  user_data: pointer, out_future: ptr Value): int32 {.cdecl, gcsafe.} =
+  {.cast(gcsafe).}:
+    if VM == nil or work_fn == nil:
+      return int32(GeneExtErr)
+    try:
+      let submitted = submit_blocking(VM, BlockingWorkFn(work_fn), BlockingCompleteFn(complete_fn), user_data)
+      if not submitted.accepted:
+        return int32(GeneExtOverloaded)
+      if out_future != nil:
+        out_future[] = submitted.future
+      int32(GeneExtOk)
+    except CatchableError:
+      int32(GeneExtErr)
+
+proc event_push_status(status: EventPushStatus): int32 =
+  case status
+  of EpsAccepted: int32(GeneExtOk)
+  of EpsFull: int32(GeneExtOverloaded)
+  of EpsClosed: int32(GeneExtStopped)
+  of EpsInvalid: int32(GeneExtErr)
+
+proc host_open_event_channel_bridge*(capacity: uint32, flags: uint32, max_batch: uint32,
+                                     handler: Value, out_channel: ptr pointer): int32 {.cdecl, gcsafe.} =
+  {.cast(gcsafe).}:
+    if VM == nil or out_channel == nil:
+      return int32(GeneExtErr)
+    try:
+      out_channel[] = open_event_channel(VM, int(capacity), handler, flags, int(max_batch))
+      int32(GeneExtOk)
+    except CatchableError:
+      int32(GeneExtErr)
+
+proc host_event_channel_push_bytes_bridge*(channel: pointer, data: ptr uint8,
+                                           len: uint32): int32 {.cdecl, gcsafe.} =
+  event_push_status(push_event_bytes(cast[ptr EventChannel](channel),
+    cast[ptr UncheckedArray[uint8]](data), int(len)))
+
+proc host_event_channel_push_value_bridge*(channel: pointer, value: Value): int32 {.cdecl, gcsafe.} =
+  # The caller's reference moves into the channel only on success.
+  event_push_status(push_event_value(cast[ptr EventChannel](channel), value))
+
+proc host_event_channel_close_bridge*(channel: pointer) {.cdecl, gcsafe.} =
+  close_event_channel(cast[ptr EventChannel](channel))
+
+proc host_event_channel_retain_bridge*(channel: pointer) {.cdecl, gcsafe.} =
+  retain_event_channel(cast[ptr EventChannel](channel))
+
+proc host_event_channel_release_bridge*(channel: pointer) {.cdecl, gcsafe.} =
+  release_event_channel(cast[ptr EventChannel](channel))
+
 proc load_extension*(vm: ptr VirtualMachine, path: string): Namespace =
   ## Load a dynamic library extension and return its namespace
   when defined(gene_wasm):
@@ -824,6 +1284,13 @@ proc load_extension*(vm: ptr VirtualMachine, path: string): Namespace =
       actor_reply_fn: host_actor_reply_bridge,
       actor_reply_serialized_fn: host_actor_reply_serialized_bridge,
       poll_vm_fn: host_poll_vm_bridge,
+      submit_blocking_fn: host_submit_blocking_bridge,
+      open_event_channel_fn: host_open_event_channel_bridge,
+      event_channel_push_bytes_fn: host_event_channel_push_bytes_bridge,
+      event_channel_push_value_fn: host_event_channel_push_value_bridge,
+      event_channel_close_fn: host_event_channel_close_bridge,
+      event_channel_retain_fn: host_event_channel_retain_bridge,
+      event_channel_release_fn: host_event_channel_release_bridge,
       result_namespace: addr ext_ns
     )
 
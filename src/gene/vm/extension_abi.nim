@@ -7,7 +7,7 @@ import ../types
 import ../logging_core
 
 const
-  GENE_EXT_ABI_VERSION* = 8'u32
+  GENE_EXT_ABI_VERSION* = 13'u32
 
 type
   GeneExtStatus* = enum
@@ -36,6 +36,21 @@ type
   GeneHostActorReplyFn* = proc(ctx: Value, payload: Value): int32 {.cdecl, gcsafe.}
   GeneHostActorReplySerializedFn* = proc(ctx: Value, payload_ser: cstring): int32 {.cdecl, gcsafe.}
   GeneHostPollVmFn* = proc(vm_user_data: pointer): int32 {.cdecl, gcsafe.}
+  GeneBlockingWorkFn* = proc(user_data: pointer): pointer {.cdecl, gcsafe.}
+  GeneBlockingCompleteFn* = proc(work_result: pointer, user_data: pointer,
+                                 out_value: ptr Value): int32 {.cdecl, gcsafe.}
+  GeneHostSubmitBlockingFn* = proc(work_fn: GeneBlockingWorkFn,
+                                   complete_fn: GeneBlockingCompleteFn,
+                                   user_data: pointer,
+                                   out_future: ptr Value): int32 {.cdecl, gcsafe.}
+  GeneHostOpenEventChannelFn* = proc(capacity: uint32, flags: uint32, max_batch: uint32,
+                                     handler: Value, out_channel: ptr pointer): int32 {.cdecl, gcsafe.}
+  GeneHostEventChannelPushBytesFn* = proc(channel: pointer, data: ptr uint8,
+                                          len: uint32): int32 {.cdecl, gcsafe.}
+  GeneHostEventChannelPushValueFn* = proc(channel: pointer, value: Value): int32 {.cdecl, gcsafe.}
+  GeneHostEventChannelCloseFn* = proc(channel: pointer) {.cdecl, gcsafe.}
+  GeneHostEventChannelRetainFn* = proc(channel: pointer) {.cdecl, gcsafe.}
+  GeneHostEventChannelReleaseFn* = proc(channel: pointer) {.cdecl, gcsafe.}
 
   GeneHostAbi* {.bycopy.} = object
     abi_version*: uint32
@@ -51,6 +66,13 @@ type
     actor_reply_fn*: GeneHostActorReplyFn
     actor_reply_serialized_fn*: GeneHostActorReplySerializedFn
     poll_vm_fn*: GeneHostPollVmFn
+    submit_blocking_fn*: GeneHostSubmitBlockingFn
+    open_event_channel_fn*: GeneHostOpenEventChannelFn
+    event_channel_push_bytes_fn*: GeneHostEventChannelPushBytesFn
+    event_channel_push_value_fn*: GeneHostEventChannelPushValueFn
+    event_channel_close_fn*: GeneHostEventChannelCloseFn
+    event_channel_retain_fn*: GeneHostEventChannelRetainFn
+    event_channel_release_fn*: GeneHostEventChannelReleaseFn
     result_namespace*: ptr Namespace
 
   GeneExtensionInitFn* = proc(host: ptr GeneHostAbi): int32 {.cdecl.}
@@ -171,3 +193,23 @@ proc reply_from_extension_context_serialized*(host: ptr GeneHostAbi, ctx: Value,
   if host == nil or host.actor_reply_serialized_fn == nil:
     return GeneExtErr
   cast[GeneExtStatus](host.actor_reply_serialized_fn(ctx, payload_ser.cstring))
+
+proc submit_blocking_work*(host: ptr GeneHostAbi, work_fn: GeneBlockingWorkFn,
+                           complete_fn: GeneBlockingCompleteFn,
+                           user_data: pointer): tuple[status: GeneExtStatus, future: Value] =
+  result = (GeneExtErr, NIL)
+  if host == nil or host.submit_blocking_fn == nil:
+    return
+  var res = NIL
+  let status = cast[GeneExtStatus](host.submit_blocking_fn(work_fn, complete_fn, user_data, addr res))
+  result = (status, if status == GeneExtOk: res else: NIL)
+
+proc open_extension_event_channel*(host: ptr GeneHostAbi, capacity: int, handler: Value,
+                                   flags = 0'u32, max_batch = 0): tuple[status: GeneExtStatus, channel: pointer] =
+  result = (GeneExtErr, nil)
+  if host == nil or host.open_event_channel_fn == nil or capacity <= 0:
+    return
+  var channel: pointer = nil
+  let status = cast[GeneExtStatus](host.open_event_channel_fn(
+    uint32(capacity), flags, uint32(max(0, max_batch)), handler, addr channel))
+  result = (status, if status == GeneExtOk: channel else: nil)
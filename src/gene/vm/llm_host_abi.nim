@@ -1,5 +1,8 @@
+## `*_ser` arguments and results carry serialized Gene values: Gene text, or
+## the binary form from gene/serdes, which may contain NUL bytes and must be
+## sized with `bridge_payload_len` rather than strlen.
 const
-  GENE_LLM_HOST_ABI_VERSION* = 1'u32
+  GENE_LLM_HOST_ABI_VERSION* = 4'u32
 
 type
   GeneLlmHostStatus* = enum
@@ -7,6 +10,16 @@ type
     GlhsErr = 1
     GlhsAbiMismatch = 2
 
+  GeneLlmHostTarget* = enum
+    GlhtModel = 0
+    GlhtSession = 1
+    GlhtEngine = 2
+
+  GeneLlmHostEventKind* = enum
+    GlheToken = 0   ## payload: UTF-8 text of one or more tokens
+    GlheDone = 1    ## payload: serialized completion map (text or binary)
+    GlheError = 2   ## payload: error message
+
   GeneLlmHostAbiVersionFn* = proc(): uint32 {.cdecl, gcsafe.}
   GeneLlmHostLoadModelFn* = proc(path: cstring, options_ser: cstring,
                                  out_model_id: ptr int64, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
@@ -14,6 +27,18 @@ type
                                   out_session_id: ptr int64, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
   GeneLlmHostInferFn* = proc(session_id: int64, prompt: cstring, options_ser: cstring,
                              out_result_ser: ptr cstring, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
+  GeneLlmHostCallMethodFn* = proc(target: int32, target_id: int64, method_name: cstring, args_ser: cstring,
+                                  out_result_ser: ptr cstring, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
+  ## Async inference: requests complete on the extension's worker thread and are
+  ## reported through next_event. event_fd is readable while events are pending
+  ## (-1 if the platform has no such descriptor).
+  GeneLlmHostInferAsyncFn* = proc(session_id: int64, prompt: cstring, options_ser: cstring, stream: int32,
+                                  out_request_id: ptr int64, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
+  GeneLlmHostEventFdFn* = proc(): int32 {.cdecl, gcsafe.}
+  ## Returns 1 and fills the outputs when an event was pending, 0 otherwise.
+  GeneLlmHostNextEventFn* = proc(out_request_id: ptr int64, out_kind: ptr int32,
+                                 out_payload: ptr cstring): int32 {.cdecl, gcsafe.}
+  GeneLlmHostCancelFn* = proc(request_id: int64, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
   GeneLlmHostCloseModelFn* = proc(model_id: int64, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
   GeneLlmHostCloseSessionFn* = proc(session_id: int64, out_error: ptr cstring): int32 {.cdecl, gcsafe.}
   GeneLlmHostFreeCStringFn* = proc(s: cstring) {.cdecl, gcsafe.}
@@ -1242,7 +1242,7 @@ proc compile_module*(path: string): CompilationUnit =
   # Read module file
   let abs_path = canonical_path(path)
   if abs_path.endsWith(".gir"):
-    let loaded = load_gir(abs_path)
+    let loaded = load_gir(abs_path, lazy = true)
     register_module_type_registry(abs_path, loaded)
     return loaded
 
@@ -1258,7 +1258,7 @@ proc compile_module*(path: string): CompilationUnit =
   let gir_path = get_gir_path(actual_path, "build")
   if gir_cache_reads_enabled() and fileExists(gir_path) and is_gir_up_to_date(gir_path, actual_path):
     try:
-      let loaded = load_gir(gir_path)
+      let loaded = load_gir(gir_path, lazy = true)
       register_module_type_registry(actual_path, loaded)
       return loaded
     except CatchableError:
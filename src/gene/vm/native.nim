@@ -90,6 +90,49 @@ proc native_trampoline*(
     retain(result_val)
     return cast[int64](result_val.raw)
 
+proc call_typed_native_fn(self: ptr VirtualMachine, r: ptr Reference, args: openArray[Value]): Value =
+  ## Call a typed native fn through its unboxed C entry when the arguments fit
+  ## the signature; otherwise fall back to the boxed NativeFn, which reports
+  ## argument errors the usual way.
+  let typed = r.native_typed
+  if args.len == typed.argTypes.len:
+    var ints: array[MaxTypedIntArgs, int64]
+    var floats: array[MaxTypedFloatArgs, float64]
+    var int_count = 0
+    var float_count = 0
+    var matched = true
+    for i, arg in args:
+      case typed.argTypes[i]
+      of CatInt64:
+        if arg.kind != VkInt:
+          matched = false
+          break
+        ints[int_count] = arg.to_int()
+        int_count.inc()
+      of CatFloat64:
+        case arg.kind
+        of VkFloat:
+          floats[float_count] = arg.to_float()
+        of VkInt:
+          floats[float_count] = arg.to_int().float64
+        else:
+          matched = false
+          break
+        float_count.inc()
+      of CatValue:
+        ints[int_count] = cast[int64](arg.raw)
+        int_count.inc()
+    if matched:
+      let raw = invoke_typed_native(typed, ints, floats)
+      case typed.returnType
+      of CrtInt64:
+        return raw.to_value()
+      of CrtFloat64:
+        return cast[float64](raw).to_value()
+      of CrtValue:
+        return Value(raw: cast[uint64](raw))  # entry returns an owned Value
+  call_native_fn(r.native_fn, self, args)
+
 proc prepare_native_ctx(self: ptr VirtualMachine, f: Function, out_ctx: var NativeContext): bool {.inline.} =
   ## Shared preamble: ensure native code is compiled and set up NativeContext.
   ## Returns false if native execution is not available for this function.
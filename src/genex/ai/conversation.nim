@@ -61,6 +61,35 @@ proc prune_session*(store: ConversationStore; session_id: string; keep_last: int
     return
   store.sessions[session_id] = events[events.len - keep_last .. ^1]
 
+type
+  # Token counts for a batch of texts, e.g. Model.count_tokens from
+  # genex/llm, which caches per message so repeated trims stay cheap.
+  TokenCounter* = proc(texts: seq[string]): seq[int] {.gcsafe.}
+
+# Newest events whose content fits in max_tokens, oldest first. Each event
+# also costs per_event_tokens (role markers of the chat template).
+proc get_recent_within_tokens*(store: ConversationStore; session_id: string; max_tokens: int;
+                               count_tokens: TokenCounter; per_event_tokens = 0): seq[ConversationEvent] =
+  if store.isNil or not store.sessions.hasKey(session_id) or max_tokens <= 0:
+    return @[]
+  let events = store.sessions[session_id]
+  var texts = newSeq[string](events.len)
+  for i, event in events:
+    texts[i] = event.content
+  let counts = count_tokens(texts)
+  if counts.len != events.len:
+    raise newException(ValueError, "token counter returned " & $counts.len & " counts for " & $events.len & " events")
+
+  var used = 0
+  var first = events.len
+  while first > 0:
+    let cost = counts[first - 1] + per_event_tokens
+    if used + cost > max_tokens:
+      break
+    used += cost
+    first.dec()
+  events[first .. ^1]
+
 proc summarize_recent*(store: ConversationStore; session_id: string; limit = 12): string =
   let recent = store.get_recent(session_id, limit)
   if recent.len == 0:
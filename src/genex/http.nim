@@ -515,7 +515,7 @@ proc dispatch_to_http_actor(vm: ptr VirtualMachine, request_data: Value): Value
 proc http_reply_from_context(ctx: Value, payload: Value) {.gcsafe.} =
   {.cast(gcsafe).}:
     if http_extension_host_ready:
-      let payload_ser = serialize_literal(payload).to_s()
+      let payload_ser = serialize_bridge_payload(payload)
       let serialized_status = reply_from_extension_context_serialized(addr http_extension_host, ctx, payload_ser)
       if serialized_status == GeneExtOk:
         return
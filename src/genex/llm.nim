@@ -1,18 +1,24 @@
-import os, tables, osproc, strutils
+import os, tables, osproc, strutils, deques
 import std/locks
 import ../gene/types
 import ../gene/vm/extension_abi
 import ../gene/vm/llm_host_abi
+import ../gene/logging_core
 import ../gene/serdes
-when not defined(GENE_LLM_MOCK):
+when defined(GENE_LLM_MOCK):
+  import std/math
+else:
   import std/exitprocs
   import ../gene/vm
+  when defined(posix):
+    from posix import TPollfd, POLLIN, poll
 
 # Global registries for cross-thread access
 # This allows worker threads to access models and create sessions
 var global_model_registry* {.global.}: Value = NIL
 var global_model_class* {.global.}: Class = nil
 var global_session_class* {.global.}: Class = nil
+var global_engine_class* {.global.}: Class = nil
 var global_model_lock* {.global.}: Lock  # Protects access to global_model_registry
 var global_llm_op_lock* {.global.}: Lock  # Serializes llama.cpp operations (not thread-safe)
 var llm_extension_host* {.global.}: GeneHostAbi
@@ -21,6 +27,26 @@ var llm_backend_model_handles* {.global.}: Table[system.int64, Value] = initTabl
 var llm_backend_session_handles* {.global.}: Table[system.int64, Value] = initTable[system.int64, Value]()
 var llm_backend_next_model_id* {.global.}: system.int64 = 1
 var llm_backend_next_session_id* {.global.}: system.int64 = 1
+# Engines created through the host bridge; only the bridge actor touches these.
+var llm_backend_engine_handles* {.global.}: Table[system.int64, Value] = initTable[system.int64, Value]()
+var llm_backend_next_engine_id* {.global.}: system.int64 = 1
+
+type
+  LlmHostEvent = object
+    request_id: system.int64
+    kind: GeneLlmHostEventKind
+    payload: string
+
+# Events waiting for the host's next_event calls.
+var llm_host_events {.global.}: Deque[LlmHostEvent] = initDeque[LlmHostEvent]()
+# Async requests are submitted from the VM thread while the bridge actor adds
+# and removes sessions on its worker, so session handle access is locked.
+var llm_backend_session_lock {.global.}: Lock
+initLock(llm_backend_session_lock)
+
+proc llm_session_handle(id: system.int64): Value =
+  withLock llm_backend_session_lock:
+    result = llm_backend_session_handles.getOrDefault(id, NIL)
 
 proc llm_host_vm(): ptr VirtualMachine =
   cast[ptr VirtualMachine](llm_extension_host.user_data)
@@ -41,44 +67,454 @@ proc llm_clear_error(out_error: ptr cstring) =
     out_error[] = nil
 
 proc llm_parse_options(options_ser: cstring): Value =
-  if options_ser == nil:
-    return NIL
-  let text = $options_ser
-  if text.len == 0:
-    return NIL
-  deserialize_literal(text)
+  deserialize_bridge_payload(options_ser)
 
 proc llm_serialize_reply(value: Value): cstring =
-  var text = ""
+  var payload = ""
   {.cast(gcsafe).}:
-    text = serialize_literal(value).to_s()
-  llm_alloc_cstring_copy(text)
+    payload = serialize_bridge_payload(value)
+  llm_alloc_cstring_copy(payload)
 
 proc gene_llm_host_abi_version*(): uint32 {.cdecl, exportc, dynlib.} =
   GENE_LLM_HOST_ABI_VERSION
 
+const LlmLogger = "genex/llm"
+
+# Process-wide counters returned by (genex/llm/stats).
+type LlmStatsSnapshot = object
+  requests: int64
+  failed_requests: int64
+  cancelled_requests: int64
+  prompt_tokens: int64
+  cached_tokens: int64
+  generated_tokens: int64
+  prefill_ms: float
+  decode_ms: float
+  models: int64
+  sessions: int64
+  engines: int64
+
+# Model registry counters returned by (genex/llm/registry_stats).
+type LlmRegistrySnapshot = object
+  loaded: int
+  in_use: int
+  resident_bytes: int64
+  budget_bytes: int64
+  hits: int64
+  misses: int64
+  evictions: int64
+
+proc llm_registry_stats_value(stats: LlmRegistrySnapshot): Value =
+  var map_table = initTable[Key, Value]()
+  map_table["loaded".to_key()] = stats.loaded.to_value()
+  map_table["in_use".to_key()] = stats.in_use.to_value()
+  map_table["resident_bytes".to_key()] = stats.resident_bytes.to_value()
+  map_table["budget_bytes".to_key()] = stats.budget_bytes.to_value()
+  map_table["hits".to_key()] = stats.hits.to_value()
+  map_table["misses".to_key()] = stats.misses.to_value()
+  map_table["evictions".to_key()] = stats.evictions.to_value()
+  new_map_value(map_table)
+
+# Budget in bytes from (genex/llm/configure {^memory_budget_mb n}); -1 if absent.
+proc llm_memory_budget_option(opts: Value): int64 =
+  if opts == NIL or not map_data(opts).hasKey("memory_budget_mb".to_key()):
+    return -1
+  let budget_val = map_data(opts)["memory_budget_mb".to_key()]
+  if budget_val.kind != VkInt or budget_val.to_int() < 0:
+    raise new_exception(types.Exception, "configure ^memory_budget_mb must be a non-negative integer")
+  int64(budget_val.to_int()) * 1024 * 1024
+
+# Preload entries are paths or {^path ...} maps of load_model options.
+proc llm_preload_entries(opts: Value): seq[(string, Value)] =
+  if opts == NIL or not map_data(opts).hasKey("preload".to_key()):
+    return @[]
+  let list = map_data(opts)["preload".to_key()]
+  if list.kind != VkArray:
+    raise new_exception(types.Exception, "configure ^preload must be an array")
+  for entry in array_data(list):
+    case entry.kind
+    of VkString:
+      result.add((entry.str, NIL))
+    of VkMap:
+      let path_val = map_data(entry).getOrDefault("path".to_key(), NIL)
+      if path_val.kind != VkString:
+        raise new_exception(types.Exception, "configure ^preload entries need a ^path string")
+      result.add((path_val.str, entry))
+    else:
+      raise new_exception(types.Exception, "configure ^preload entries must be paths or maps")
+
+type LlmThreadpoolConfig = object
+  given: bool  # false when no threadpool option is present
+  threads: int  # 0 = one per CPU in cpus (or per core)
+  cpus: seq[int]
+  strict_cpu: bool
+  priority: int  # gene_llm_thread_priority
+  poll: int  # -1 = ggml default
+
+const LlmThreadPriorities = ["low", "normal", "medium", "high", "realtime"]
+
+# "0-3,8" -> @[0, 1, 2, 3, 8]
+proc llm_parse_cpu_list(spec: string): seq[int] =
+  for part in spec.split(','):
+    let item = part.strip()
+    if item.len == 0:
+      continue
+    let bounds = item.split('-')
+    if bounds.len == 2:
+      for cpu in parseInt(bounds[0].strip()) .. parseInt(bounds[1].strip()):
+        result.add(cpu)
+    else:
+      result.add(parseInt(item))
+
+# Shared LLM threadpool from configure: ^threads, ^cpus (array or "0-3,8"),
+# ^reserve_cpus n (run on every CPU but the first n, leaving those to actor
+# workers), ^thread_priority, ^strict_cpu and ^poll.
+proc llm_threadpool_config(opts: Value): LlmThreadpoolConfig =
+  result.poll = -1
+  result.priority = 1  # "normal"
+  if opts == NIL:
+    return
+  let table = map_data(opts)
+  for name in ["threads", "cpus", "reserve_cpus", "thread_priority", "strict_cpu", "poll"]:
+    if table.hasKey(name.to_key()):
+      result.given = true
+  if not result.given:
+    return
+  let threads_val = table.getOrDefault("threads".to_key(), NIL)
+  if threads_val != NIL:
+    if threads_val.kind != VkInt or threads_val.to_int() < 0:
+      raise new_exception(types.Exception, "configure ^threads must be a non-negative integer")
+    result.threads = int(threads_val.to_int())
+  let cpus_val = table.getOrDefault("cpus".to_key(), NIL)
+  let reserve_val = table.getOrDefault("reserve_cpus".to_key(), NIL)
+  if cpus_val != NIL:
+    case cpus_val.kind
+    of VkArray:
+      for cpu in array_data(cpus_val):
+        if cpu.kind != VkInt:
+          raise new_exception(types.Exception, "configure ^cpus must hold integers")
+        result.cpus.add(int(cpu.to_int()))
+    of VkString:
+      try:
+        result.cpus = llm_parse_cpu_list(cpus_val.str)
+      except ValueError:
+        raise new_exception(types.Exception, "configure ^cpus is not a CPU list: " & cpus_val.str)
+    else:
+      raise new_exception(types.Exception, "configure ^cpus must be an array or a string like \"4-7\"")
+  elif reserve_val != NIL:
+    if reserve_val.kind != VkInt or reserve_val.to_int() < 0:
+      raise new_exception(types.Exception, "configure ^reserve_cpus must be a non-negative integer")
+    let first = int(reserve_val.to_int())
+    if first >= countProcessors():
+      raise new_exception(types.Exception, "configure ^reserve_cpus leaves no CPU for the LLM threadpool")
+    for cpu in first ..< countProcessors():
+      result.cpus.add(cpu)
+  for cpu in result.cpus:
+    if cpu < 0:
+      raise new_exception(types.Exception, "configure ^cpus must be non-negative")
+  if result.threads == 0 and result.cpus.len > 0:
+    result.threads = result.cpus.len
+  let priority_val = table.getOrDefault("thread_priority".to_key(), NIL)
+  if priority_val != NIL:
+    let name = if priority_val.kind in {VkString, VkSymbol}: priority_val.str else: ""
+    let index = LlmThreadPriorities.find(name)
+    if index < 0:
+      raise new_exception(types.Exception, "configure ^thread_priority must be one of " & LlmThreadPriorities.join(", "))
+    result.priority = index
+  result.priority -= 1  # "low" is -1
+  result.strict_cpu = table.getOrDefault("strict_cpu".to_key(), FALSE).to_bool()
+  let poll_val = table.getOrDefault("poll".to_key(), NIL)
+  if poll_val != NIL:
+    if poll_val.kind != VkInt or poll_val.to_int() notin 0 .. 100:
+      raise new_exception(types.Exception, "configure ^poll must be between 0 and 100")
+    result.poll = int(poll_val.to_int())
+
+const
+  LlmGrammarNone = 0
+  LlmGrammarGbnf = 1
+  LlmGrammarGeneLiteral = 2
+  LlmGrammarJson = 3
+  LlmGrammarJsonSchema = 4
+
+# Quoted with JSON escapes, which GBNF literals share.
+proc llm_json_string(s: string): string =
+  result = "\""
+  for ch in s:
+    case ch
+    of '"': result.add("\\\"")
+    of '\\': result.add("\\\\")
+    of '\n': result.add("\\n")
+    of '\r': result.add("\\r")
+    of '\t': result.add("\\t")
+    of '\b': result.add("\\b")
+    of '\f': result.add("\\f")
+    of '\0' .. '\x07', '\x0B', '\x0E' .. '\x1F':
+      result.add("\\u00" & toHex(ord(ch), 2).toLowerAscii())
+    else: result.add(ch)
+  result.add('"')
+
+proc llm_json_literal(value: Value): string =
+  case value.kind
+  of VkNil:
+    "null"
+  of VkBool:
+    $value.to_bool()
+  of VkInt:
+    $value.to_int()
+  of VkFloat:
+    $value.to_float()
+  of VkString, VkSymbol:
+    llm_json_string(value.str)
+  else:
+    raise new_exception(types.Exception, "json_schema const/enum values must be scalars")
+
+# GBNF expression for a JSON schema (type, properties, required, items, enum,
+# const, anyOf/oneOf), adding the rules it needs. Objects list their
+# properties in schema order and reject unknown keys.
+proc llm_schema_expr(schema: Value, rules: var seq[string]): string =
+  if schema.kind != VkMap:
+    raise new_exception(types.Exception, "json_schema must be a map")
+  let table = map_data(schema)
+  template field(name: string): Value = table.getOrDefault(name.to_key(), NIL)
+  template add_rule(body: string): string =
+    let rule_body = body
+    let rule_name = "s" & $rules.len
+    rules.add(rule_name & " ::= " & rule_body)
+    rule_name
+
+  if table.hasKey("const".to_key()):
+    return llm_json_string(llm_json_literal(field("const")))
+  let enum_val = field("enum")
+  if enum_val != NIL:
+    if enum_val.kind != VkArray or array_data(enum_val).len == 0:
+      raise new_exception(types.Exception, "json_schema enum must be a non-empty array")
+    var choices: seq[string]
+    for item in array_data(enum_val):
+      choices.add(llm_json_string(llm_json_literal(item)))
+    return "(" & choices.join(" | ") & ")"
+  for combinator in ["anyOf", "oneOf"]:
+    let options_val = field(combinator)
+    if options_val != NIL:
+      if options_val.kind != VkArray or array_data(options_val).len == 0:
+        raise new_exception(types.Exception, "json_schema " & combinator & " must be a non-empty array")
+      var choices: seq[string]
+      for item in array_data(options_val):
+        choices.add(llm_schema_expr(item, rules))
+      return "(" & choices.join(" | ") & ")"
+
+  let type_val = field("type")
+  if type_val == NIL:
+    return "value"
+  if type_val.kind == VkArray:
+    var choices: seq[string]
+    for item in array_data(type_val):
+      var single = initTable[Key, Value]()
+      for k, v in table:
+        single[k] = v
+      single["type".to_key()] = item
+      choices.add(llm_schema_expr(new_map_value(single), rules))
+    return "(" & choices.join(" | ") & ")"
+  if type_val.kind notin {VkString, VkSymbol}:
+    raise new_exception(types.Exception, "json_schema type must be a string")
+  case type_val.str
+  of "string", "number", "integer", "boolean", "null":
+    type_val.str
+  of "array":
+    let items = field("items")
+    let item = if items == NIL: "value" else: llm_schema_expr(items, rules)
+    add_rule("\"[\" ws ( " & item & " ( ws \",\" ws " & item & " )* )? ws \"]\"")
+  of "object":
+    let props = field("properties")
+    if props == NIL:
+      return "object"
+    if props.kind != VkMap:
+      raise new_exception(types.Exception, "json_schema properties must be a map")
+    var required: seq[string]
+    let required_val = field("required")
+    if required_val != NIL:
+      if required_val.kind != VkArray:
+        raise new_exception(types.Exception, "json_schema required must be an array")
+      for name in array_data(required_val):
+        if name.kind notin {VkString, VkSymbol}:
+          raise new_exception(types.Exception, "json_schema required entries must be strings")
+        required.add(name.str)
+    var required_kvs, optional_kvs: seq[string]
+    for k, v in map_data(props):
+      let name = get_symbol(k.symbol_index)
+      let kv = llm_json_string(llm_json_string(name)) & " ws \":\" ws " & llm_schema_expr(v, rules)
+      if name in required:
+        required_kvs.add(kv)
+      else:
+        optional_kvs.add(kv)
+    # Optional properties: rest_i matches a non-empty, in-order selection of
+    # optional_kvs[i .. ^1].
+    var rest = ""
+    for i in countdown(optional_kvs.high, 0):
+      rest =
+        if rest.len == 0:
+          add_rule(optional_kvs[i])
+        else:
+          add_rule(optional_kvs[i] & " ( ws \",\" ws " & rest & " )? | " & rest)
+    var body = required_kvs.join(" ws \",\" ws ")
+    if rest.len > 0:
+      body =
+        if body.len > 0:
+          body & " ( ws \",\" ws " & rest & " )?"
+        else:
+          "( " & rest & " )?"
+    add_rule("\"{\" ws " & body & " ws \"}\"")
+  else:
+    raise new_exception(types.Exception, "json_schema type not supported: " & type_val.str)
+
+# Structured output from ^grammar ("gene-literal", "json" or GBNF text) or
+# ^json_schema (a map); kind is one of the LlmGrammar* constants.
+proc llm_grammar_option(opts: Value): tuple[kind: int, text: string] =
+  if opts == NIL:
+    return (LlmGrammarNone, "")
+  let grammar_val = map_data(opts).getOrDefault("grammar".to_key(), NIL)
+  let schema_val = map_data(opts).getOrDefault("json_schema".to_key(), NIL)
+  if grammar_val != NIL and schema_val != NIL:
+    raise new_exception(types.Exception, "^grammar and ^json_schema cannot be combined")
+  if schema_val != NIL:
+    var rules: seq[string]
+    let root = llm_schema_expr(schema_val, rules)
+    return (LlmGrammarJsonSchema, "root ::= " & root & "\n" & rules.join("\n"))
+  if grammar_val == NIL:
+    return (LlmGrammarNone, "")
+  if grammar_val.kind notin {VkString, VkSymbol}:
+    raise new_exception(types.Exception, "^grammar must be \"gene-literal\", \"json\" or GBNF text")
+  case grammar_val.str
+  of "gene-literal", "gene":
+    (LlmGrammarGeneLiteral, "")
+  of "json":
+    (LlmGrammarJson, "")
+  else:
+    if "::=" notin grammar_val.str:
+      raise new_exception(types.Exception, "^grammar must be \"gene-literal\", \"json\" or GBNF text")
+    (LlmGrammarGbnf, grammar_val.str)
+
+# Prompts are strings or arrays of token ids from Model.tokenize; token
+# prompts skip tokenization in the backend.
+proc llm_prompt_input(prompt_val: Value, context: string): tuple[text: string, tokens: seq[int32]] =
+  case prompt_val.kind
+  of VkString:
+    result.text = prompt_val.str
+  of VkArray:
+    for item in array_data(prompt_val):
+      if item.kind != VkInt:
+        raise new_exception(types.Exception, context & " token ids must be integers")
+      result.tokens.add(int32(item.to_int()))
+    if result.tokens.len == 0:
+      raise new_exception(types.Exception, context & " prompt must not be empty")
+  else:
+    raise new_exception(types.Exception, context & " prompt must be a string or an array of token ids")
+
+# ^cache_type_k / ^cache_type_v (or ^cache_type for both): "f16", "q8_0" or
+# "q4_0". Returns the gene_llm_kv_type value.
+proc llm_kv_type_option(opts: Value, name: string): int =
+  var type_val = NIL
+  if opts != NIL and opts.kind == VkMap:
+    type_val = map_data(opts).getOrDefault(name.to_key(), NIL)
+    if type_val == NIL:
+      type_val = map_data(opts).getOrDefault("cache_type".to_key(), NIL)
+  if type_val == NIL:
+    return 0
+  if type_val.kind != VkString:
+    raise new_exception(types.Exception, "new_session ^" & name & " must be \"f16\", \"q8_0\" or \"q4_0\"")
+  case type_val.str.toLowerAscii()
+  of "f16": 0
+  of "q8_0": 1
+  of "q4_0": 2
+  else:
+    raise new_exception(types.Exception, "new_session ^" & name & " must be \"f16\", \"q8_0\" or \"q4_0\"")
+
+# ^flash_attn true/false, or "auto" (the default). Returns gene_llm_flash_attn.
+proc llm_flash_attn_option(opts: Value): int =
+  if opts == NIL or opts.kind != VkMap or not map_data(opts).hasKey("flash_attn".to_key()):
+    return 0
+  let flag = map_data(opts)["flash_attn".to_key()]
+  case flag.kind
+  of VkBool:
+    if flag.to_bool(): 2 else: 1
+  of VkString:
+    if flag.str != "auto":
+      raise new_exception(types.Exception, "new_session ^flash_attn must be true, false or \"auto\"")
+    0
+  else:
+    raise new_exception(types.Exception, "new_session ^flash_attn must be true, false or \"auto\"")
+
+# ^n asks for that many completions of one prompt; 1 when absent.
+proc llm_branch_option(opts: Value, context: string): int =
+  if opts == NIL or opts.kind != VkMap or not map_data(opts).hasKey("n".to_key()):
+    return 1
+  let n_val = map_data(opts)["n".to_key()]
+  if n_val.kind != VkInt or n_val.to_int() < 1:
+    raise new_exception(types.Exception, context & " ^n must be a positive integer")
+  n_val.to_int()
+
+proc llm_token_ids_value(tokens: openArray[int32]): Value =
+  result = new_array_value()
+  for token in tokens:
+    array_data(result).add(int(token).to_value())
+
+# count_tokens answers in the shape it was asked: an int for one text, an
+# array of ints for an array of texts.
+proc llm_token_counts_value(input_val: Value, counts: openArray[int32]): Value =
+  if input_val.kind == VkString:
+    return int(counts[0]).to_value()
+  llm_token_ids_value(counts)
+
+proc llm_stats_value(stats: LlmStatsSnapshot): Value =
+  var map_table = initTable[Key, Value]()
+  map_table["requests".to_key()] = stats.requests.to_value()
+  map_table["failed_requests".to_key()] = stats.failed_requests.to_value()
+  map_table["cancelled_requests".to_key()] = stats.cancelled_requests.to_value()
+  map_table["prompt_tokens".to_key()] = stats.prompt_tokens.to_value()
+  map_table["cached_tokens".to_key()] = stats.cached_tokens.to_value()
+  map_table["generated_tokens".to_key()] = stats.generated_tokens.to_value()
+  map_table["prefill_ms".to_key()] = stats.prefill_ms.to_value()
+  map_table["decode_ms".to_key()] = stats.decode_ms.to_value()
+  map_table["models".to_key()] = stats.models.to_value()
+  map_table["sessions".to_key()] = stats.sessions.to_value()
+  map_table["engines".to_key()] = stats.engines.to_value()
+  new_map_value(map_table)
+
 when defined(GENE_LLM_MOCK):
   type
     ModelState = ref object of CustomValue
       path: string
       context_len: int
       threads: int
+      state_cache_dir: string
       closed: bool
       open_sessions: int
 
     SessionState = ref object of CustomValue
       model: ModelState
+      draft: ModelState  # Speculative decoding draft model, if any
       context_len: int
       temperature: float
       top_p: float
       top_k: int
       seed: int
       max_tokens: int
+      # Stands in for the KV cache: the words of the last evaluated prompt.
+      cached_tokens: seq[string]
+      closed: bool
+
+    # Mock generation is instantaneous, so every submitted request has
+    # finished by the time submit returns; poll hands out the stored result.
+    EngineState = ref object of CustomValue
+      model: ModelState
+      max_tokens: int
+      next_request_id: system.int64
+      finished: Table[system.int64, Value]
       closed: bool
 
   var
     model_class_global {.threadvar.}: Class
     session_class_global {.threadvar.}: Class
+    engine_class_global {.threadvar.}: Class
 
   proc expect_map(val: Value, context: string): Value =
     if val == NIL:
@@ -136,6 +572,78 @@ when defined(GENE_LLM_MOCK):
     if result.len == 0:
       result = path
 
+  proc embed_inputs(input_val: Value, context: string): seq[string] =
+    case input_val.kind
+    of VkString:
+      result = @[input_val.str]
+    of VkArray:
+      for item in array_data(input_val):
+        if item.kind != VkString:
+          raise new_exception(types.Exception, context & " inputs must be strings")
+        result.add(item.str)
+    else:
+      raise new_exception(types.Exception, context & " requires a string or an array of strings")
+
+  # Vectors are packed as native-endian float32 in a single Bytes value.
+  proc embedding_value(dim: int, count: int, data: Value): Value =
+    var map_table = initTable[Key, Value]()
+    map_table["dim".to_key()] = dim.to_value()
+    map_table["count".to_key()] = count.to_value()
+    map_table["data".to_key()] = data
+    new_map_value(map_table)
+
+  const MockEmbeddingDim = 8
+
+  # Deterministic bag-of-bytes vectors so tests can compare inputs.
+  proc mock_embed(text: string, normalize: bool): array[MockEmbeddingDim, float32] =
+    for i, ch in text:
+      result[(ch.ord + i) mod MockEmbeddingDim] += 1.0'f32
+    if normalize:
+      var norm = 0.0
+      for x in result:
+        norm += float(x) * float(x)
+      if norm > 0:
+        let scale = float32(1.0 / sqrt(norm))
+        for x in result.mitems:
+          x *= scale
+
+  var mock_stats {.global.}: LlmStatsSnapshot
+  # Mirrors the shim registry's bookkeeping: users per resolved path.
+  var mock_registry {.global.}: Table[string, int] = initTable[string, int]()
+  var mock_registry_stats {.global.}: LlmRegistrySnapshot
+
+  # Mock vocabulary: whitespace-separated words get ids in order of first use.
+  var mock_vocab {.global.}: seq[string]
+  var mock_vocab_ids {.global.}: Table[string, int] = initTable[string, int]()
+
+  proc mock_tokenize(text: string): seq[int32] =
+    {.cast(gcsafe).}:
+      for word in text.splitWhitespace():
+        if not mock_vocab_ids.hasKey(word):
+          mock_vocab_ids[word] = mock_vocab.len
+          mock_vocab.add(word)
+        result.add(int32(mock_vocab_ids[word]))
+
+  proc mock_detokenize(tokens: openArray[int32]): string =
+    var words: seq[string]
+    {.cast(gcsafe).}:
+      for token in tokens:
+        if token < 0 or int(token) >= mock_vocab.len:
+          raise new_exception(types.Exception, "Model.detokenize token id out of range")
+        words.add(mock_vocab[token])
+    words.join(" ")
+
+  # Snapshots are text files named by a hash of the model path and prefix
+  # words; the first line is a version header, the rest the words.
+  const MockStateHeader = "gene-mock-state 1"
+
+  proc mock_state_path(model: ModelState, tokens: seq[string]): (string, string) =
+    var hash = 0xcbf29ce484222325'u64
+    for ch in model.path & "\0" & tokens.join("\0"):
+      hash = (hash xor uint64(ord(ch))) * 0x100000001b3'u64
+    let key = toHex(hash).toLowerAscii()
+    (key, model.state_cache_dir / key & ".state")
+
   proc mock_generate(prompt: string, max_tokens: int): (string, seq[string], bool) =
     var source = prompt.strip()
     if source.len == 0:
@@ -152,14 +660,18 @@ when defined(GENE_LLM_MOCK):
     let completion_text = capped.join(" ") & " [mock]"
     (completion_text, capped, truncated)
 
-  proc build_completion_value(text: string, tokens: seq[string], finish_reason: string, latency_ms: int): Value =
+  proc build_completion_value(text: string, tokens: seq[string], finish_reason: string, latency_ms: int,
+                              want_tokens = false): Value =
     var map_table = initTable[Key, Value]()
     map_table["text".to_key()] = text.to_value()
+    map_table["token_count".to_key()] = tokens.len.to_value()
 
-    var token_array = new_array_value(@[])
-    for token in tokens:
-      array_data(token_array).add(token.to_value())
-    map_table["tokens".to_key()] = token_array
+    # Mirrors the real backend: token strings only when asked for.
+    if want_tokens:
+      var token_array = new_array_value(@[])
+      for token in tokens:
+        array_data(token_array).add(token.to_value())
+      map_table["tokens".to_key()] = token_array
 
     map_table["finish_reason".to_key()] = finish_reason.to_symbol_value()
     if latency_ms >= 0:
@@ -186,6 +698,14 @@ when defined(GENE_LLM_MOCK):
       raise new_exception(types.Exception, context & " requires an LLM session instance")
     cast[SessionState](get_custom_data(val, "LLM session payload missing"))
 
+  proc expect_engine(val: Value, context: string): EngineState =
+    # Check by class name for cross-thread compatibility (engine_class_global is threadvar)
+    if val.kind != VkCustom:
+      raise new_exception(types.Exception, context & " requires an LLM engine instance")
+    if val.ref.custom_class == nil or val.ref.custom_class.name != "Engine":
+      raise new_exception(types.Exception, context & " requires an LLM engine instance")
+    cast[EngineState](get_custom_data(val, "LLM engine payload missing"))
+
   proc new_model_value(state: ModelState): Value {.gcsafe.} =
     {.cast(gcsafe).}:
       let cls = if model_class_global != nil: model_class_global else: global_model_class
@@ -200,21 +720,34 @@ when defined(GENE_LLM_MOCK):
     if state.closed:
       raise new_exception(types.Exception, "LLM model has been closed")
 
+  proc new_engine_value(state: EngineState): Value {.gcsafe.} =
+    {.cast(gcsafe).}:
+      let cls = if engine_class_global != nil: engine_class_global else: global_engine_class
+      new_custom_value(cls, state)
+
   proc ensure_session_open(state: SessionState) =
     if state.closed:
       raise new_exception(types.Exception, "LLM session has been closed")
 
+  proc ensure_engine_open(state: EngineState) =
+    if state.closed:
+      raise new_exception(types.Exception, "LLM engine has been closed")
   proc cleanup_session(state: SessionState) =
     if state == nil or state.closed:
       return
     state.closed = true
     if state.model != nil and state.model.open_sessions > 0:
       state.model.open_sessions.dec()
+    if state.draft != nil and state.draft.open_sessions > 0:
+      state.draft.open_sessions.dec()
 
   proc cleanup_model(state: ModelState) =
     if state == nil or state.closed:
       return
     state.closed = true
+    {.cast(gcsafe).}:
+      if mock_registry.getOrDefault(state.path, 0) > 0:
+        mock_registry[state.path].dec()
 
 
   proc vm_load_model(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
@@ -239,11 +772,26 @@ when defined(GENE_LLM_MOCK):
 
     let context_len = max(256, get_int_option(opts, "context", 2048))
     let threads = max(1, get_int_option(opts, "threads", countProcessors()))
+    var state_cache_dir = ""
+    if has_option(opts, "state_cache"):
+      let dir_val = map_data(opts)["state_cache".to_key()]
+      if dir_val.kind != VkString:
+        raise new_exception(types.Exception, "load_model ^state_cache must be a directory path")
+      state_cache_dir = normalize_path(dir_val.str)
+      createDir(state_cache_dir)
+
+    {.cast(gcsafe).}:
+      if mock_registry.hasKey(resolved_path):
+        mock_registry_stats.hits.inc()
+      else:
+        mock_registry_stats.misses.inc()
+      mock_registry[resolved_path] = mock_registry.getOrDefault(resolved_path, 0) + 1
 
     let state = ModelState(
       path: resolved_path,
       context_len: context_len,
-      threads: threads
+      threads: threads,
+      state_cache_dir: state_cache_dir
     )
     new_model_value(state)
 
@@ -275,6 +823,18 @@ when defined(GENE_LLM_MOCK):
         NIL
 
     let context_len = get_int_option(opts, "context", model_state.context_len)
+    # The mock keeps no KV cache; the options are only validated.
+    if llm_kv_type_option(opts, "cache_type_v") != 0 and llm_flash_attn_option(opts) == 1:
+      raise new_exception(types.Exception, "a quantized V cache needs flash attention")
+    discard llm_kv_type_option(opts, "cache_type_k")
+    # Mock generation is already greedy, so a draft model never changes the
+    # output; every drafted token is accepted.
+    var draft_state: ModelState = nil
+    if has_option(opts, "draft"):
+      draft_state = expect_model(map_data(opts)["draft".to_key()], "new_session ^draft")
+      ensure_model_open(draft_state)
+    if get_int_option(opts, "draft_tokens", 0) < 0:
+      raise new_exception(types.Exception, "new_session ^draft_tokens must not be negative")
     let temperature = get_float_option(opts, "temperature", 0.7)
     let top_p = get_float_option(opts, "top_p", 0.9)
     let top_k = get_int_option(opts, "top_k", 40)
@@ -283,6 +843,7 @@ when defined(GENE_LLM_MOCK):
 
     let session_state = SessionState(
       model: model_state,
+      draft: draft_state,
       context_len: context_len,
       temperature: temperature,
       top_p: top_p,
@@ -291,8 +852,65 @@ when defined(GENE_LLM_MOCK):
       max_tokens: max_tokens
     )
     model_state.open_sessions.inc()
+    if draft_state != nil:
+      draft_state.open_sessions.inc()
     new_session_value(session_state)
 
+  proc vm_model_embed(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Model.embed requires self and a string or an array of strings")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let model_state = expect_model(self_val, "Model.embed")
+    ensure_model_open(model_state)
+
+    let texts = embed_inputs(get_positional_arg(args, 1, has_keyword_args), "Model.embed")
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "embed")
+      else:
+        NIL
+    let normalize = get_bool_option(opts, "normalize", true)
+
+    let data = new_ref(VkBytes)
+    data.bytes_data = newSeq[uint8](texts.len * MockEmbeddingDim * sizeof(float32))
+    for i, text in texts:
+      let vec = mock_embed(text, normalize)
+      copyMem(addr data.bytes_data[i * MockEmbeddingDim * sizeof(float32)], unsafeAddr vec[0], sizeof(vec))
+    embedding_value(MockEmbeddingDim, texts.len, data.to_ref_value())
+
+  proc vm_model_tokenize(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    if get_positional_count(arg_count, has_keyword_args) < 2:
+      raise new_exception(types.Exception, "Model.tokenize requires self and a string")
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.tokenize")
+    ensure_model_open(model_state)
+    let text_val = get_positional_arg(args, 1, has_keyword_args)
+    if text_val.kind != VkString:
+      raise new_exception(types.Exception, "Model.tokenize requires a string")
+    llm_token_ids_value(mock_tokenize(text_val.str))
+
+  proc vm_model_detokenize(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    if get_positional_count(arg_count, has_keyword_args) < 2:
+      raise new_exception(types.Exception, "Model.detokenize requires self and an array of token ids")
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.detokenize")
+    ensure_model_open(model_state)
+    let input = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Model.detokenize")
+    if input.tokens.len == 0:
+      raise new_exception(types.Exception, "Model.detokenize requires an array of token ids")
+    mock_detokenize(input.tokens).to_value()
+
+  proc vm_model_count_tokens(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    if get_positional_count(arg_count, has_keyword_args) < 2:
+      raise new_exception(types.Exception, "Model.count_tokens requires self and a string or an array of strings")
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.count_tokens")
+    ensure_model_open(model_state)
+    let input_val = get_positional_arg(args, 1, has_keyword_args)
+    var counts: seq[int32]
+    for text in embed_inputs(input_val, "Model.count_tokens"):
+      counts.add(int32(text.splitWhitespace().len))
+    llm_token_counts_value(input_val, counts)
+
   proc vm_session_close(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
     let positional = get_positional_count(arg_count, has_keyword_args)
     if positional < 1:
@@ -312,9 +930,12 @@ when defined(GENE_LLM_MOCK):
     let session_state = expect_session(self_val, "Session.infer")
     ensure_session_open(session_state)
 
-    let prompt_val = get_positional_arg(args, 1, has_keyword_args)
-    if prompt_val.kind != VkString:
-      raise new_exception(types.Exception, "Session.infer prompt must be a string")
+    let prompt_input = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Session.infer")
+    let prompt =
+      if prompt_input.tokens.len > 0:
+        mock_detokenize(prompt_input.tokens)
+      else:
+        prompt_input.text
 
     let opts =
       if positional >= 3:
@@ -326,24 +947,192 @@ when defined(GENE_LLM_MOCK):
     var temperature = get_float_option(opts, "temperature", session_state.temperature)
     if temperature <= 0:
       temperature = 0.7
-    let timeout_provided = has_option(opts, "timeout") or has_option(opts, "timeout_ms")
-
-    if timeout_provided:
-      raise new_exception(types.Exception, "Session.infer timeout is not supported for local inference yet")
+    # Mock generation is instantaneous, so a deadline can never expire.
+    if get_int_option(opts, "timeout_ms", 0) < 0 or get_float_option(opts, "timeout", 0.0) < 0:
+      raise new_exception(types.Exception, "Session.infer timeout must not be negative")
+    discard llm_grammar_option(opts)  # validated; mock output is not constrained
 
+    let n = llm_branch_option(opts, "Session.infer")
     if max_tokens <= 0:
+      # Counted like the shim counts it: a request cancelled before any work.
+      {.cast(gcsafe).}:
+        mock_stats.requests.inc()
+        mock_stats.cancelled_requests.inc()
       return cancellation_value()
 
-    let (text, tokens, truncated) = mock_generate(prompt_val.str, max_tokens)
+    let (text, tokens, truncated) = mock_generate(prompt, max_tokens)
     let finish_reason =
       if truncated:
         ":length"
       else:
         ":stop"
 
-    let latency_ms = max(1, prompt_val.str.len * 2)
+    let latency_ms = max(1, prompt.len * 2)
+    let prompt_words = prompt.splitWhitespace()
+    let prompt_tokens = prompt_words.len
+    var cached_tokens = 0
+    while cached_tokens < min(prompt_tokens, session_state.cached_tokens.len) and
+        prompt_words[cached_tokens] == session_state.cached_tokens[cached_tokens]:
+      cached_tokens.inc()
+    session_state.cached_tokens = prompt_words
+    {.cast(gcsafe).}:
+      mock_stats.requests.inc()
+      mock_stats.prompt_tokens.inc(prompt_tokens)
+      mock_stats.generated_tokens.inc(tokens.len * n)
+
+    # Mock branches are identical, like greedy sampling in the real backend.
+    var completions: seq[Value]
+    for _ in 0..<n:
+      let completion = build_completion_value(text, tokens, finish_reason, latency_ms, get_bool_option(opts, "tokens", false))
+      if session_state.draft != nil and tokens.len > 0:
+        map_data(completion)["draft_tokens".to_key()] = tokens.len.to_value()
+        map_data(completion)["draft_accepted".to_key()] = tokens.len.to_value()
+      # Mock generation has no phases to time; only the token counts are real.
+      var perf = initTable[Key, Value]()
+      perf["prompt_tokens".to_key()] = prompt_tokens.to_value()
+      perf["cached_tokens".to_key()] = cached_tokens.to_value()
+      map_data(completion)["perf".to_key()] = new_map_value(perf)
+      completions.add(completion)
+    if n == 1:
+      return completions[0]
+    result = new_array_value()
+    for completion in completions:
+      array_data(result).add(completion)
+
+  proc expect_prefix(args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool, context: string): (SessionState, string) =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, context & " requires self and a prefix string")
+    let session_state = expect_session(get_positional_arg(args, 0, has_keyword_args), context)
+    ensure_session_open(session_state)
+    let prefix_val = get_positional_arg(args, 1, has_keyword_args)
+    if prefix_val.kind != VkString:
+      raise new_exception(types.Exception, context & " prefix must be a string")
+    if session_state.model.state_cache_dir.len == 0:
+      raise new_exception(types.Exception, "model was loaded without a state cache directory")
+    (session_state, prefix_val.str)
+
+  proc vm_session_save_state(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let (session_state, prefix) = expect_prefix(args, arg_count, has_keyword_args, "Session.save_state")
+    let tokens = prefix.splitWhitespace()
+    let (key, path) = mock_state_path(session_state.model, tokens)
+    # Write then rename, like the shim, so loaders never see a partial file.
+    let tmp_path = path & ".tmp"
+    writeFile(tmp_path, MockStateHeader & "\n" & tokens.join("\n"))
+    moveFile(tmp_path, path)
+    session_state.cached_tokens = tokens
+    key.to_value()
+
+  # Anything but an exact match is a miss that leaves the session untouched.
+  proc vm_session_load_state(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let (session_state, prefix) = expect_prefix(args, arg_count, has_keyword_args, "Session.load_state")
+    let tokens = prefix.splitWhitespace()
+    let (_, path) = mock_state_path(session_state.model, tokens)
+    if not fileExists(path):
+      return FALSE
+    let lines = readFile(path).split('\n')
+    if lines.len == 0 or lines[0] != MockStateHeader or lines[1 .. ^1].join(" ").splitWhitespace() != tokens:
+      return FALSE
+    session_state.cached_tokens = tokens
+    TRUE
+
+  proc vm_model_new_engine(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 1:
+      raise new_exception(types.Exception, "Model.new_engine requires self")
+
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.new_engine")
+    ensure_model_open(model_state)
+
+    let opts =
+      if positional >= 2:
+        expect_map(get_positional_arg(args, 1, has_keyword_args), "new_engine")
+      else:
+        NIL
+    # Batching options are only validated; mock requests never share a step.
+    if get_int_option(opts, "max_sequences", 4) < 1 or get_int_option(opts, "batch", 512) < 1:
+      raise new_exception(types.Exception, "Model.new_engine batch and max_sequences must be positive")
+
+    let engine_state = EngineState(
+      model: model_state,
+      max_tokens: max(1, get_int_option(opts, "max_tokens", 256)),
+      next_request_id: 1,
+      finished: initTable[system.int64, Value]()
+    )
+    model_state.open_sessions.inc()
+    new_engine_value(engine_state)
+
+  proc vm_engine_submit(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Engine.submit requires self and a prompt string")
+
+    let engine_state = expect_engine(get_positional_arg(args, 0, has_keyword_args), "Engine.submit")
+    ensure_engine_open(engine_state)
+
+    let prompt_input = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Engine.submit")
+    let prompt =
+      if prompt_input.tokens.len > 0:
+        mock_detokenize(prompt_input.tokens)
+      else:
+        prompt_input.text
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "submit")
+      else:
+        NIL
+    discard llm_grammar_option(opts)
+
+    let max_tokens = max(1, get_int_option(opts, "max_tokens", engine_state.max_tokens))
+    let (text, tokens, truncated) = mock_generate(prompt, max_tokens)
+    let finish_reason = if truncated: ":length" else: ":stop"
+    {.cast(gcsafe).}:
+      mock_stats.requests.inc()
+      mock_stats.prompt_tokens.inc(prompt.splitWhitespace().len)
+      mock_stats.generated_tokens.inc(tokens.len)
+
+    let request_id = engine_state.next_request_id
+    engine_state.next_request_id.inc()
+    engine_state.finished[request_id] = build_completion_value(text, tokens, finish_reason,
+      max(1, prompt.len * 2), get_bool_option(opts, "tokens", false))
+    request_id.to_value()
+
+  proc engine_request_id(args: ptr UncheckedArray[Value], has_keyword_args: bool, context: string): system.int64 =
+    let id_val = get_positional_arg(args, 1, has_keyword_args)
+    if id_val.kind != VkInt:
+      raise new_exception(types.Exception, context & " request id must be an int")
+    id_val.to_int()
+
+  proc vm_engine_poll(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    if get_positional_count(arg_count, has_keyword_args) < 2:
+      raise new_exception(types.Exception, "Engine.poll requires self and a request id")
+    let engine_state = expect_engine(get_positional_arg(args, 0, has_keyword_args), "Engine.poll")
+    ensure_engine_open(engine_state)
+    let request_id = engine_request_id(args, has_keyword_args, "Engine.poll")
+    # Like the shim, a finished request is forgotten once it has been polled.
+    if not engine_state.finished.pop(request_id, result):
+      raise new_exception(types.Exception, "unknown engine request id")
+
+  proc vm_engine_cancel(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    if get_positional_count(arg_count, has_keyword_args) < 2:
+      raise new_exception(types.Exception, "Engine.cancel requires self and a request id")
+    let engine_state = expect_engine(get_positional_arg(args, 0, has_keyword_args), "Engine.cancel")
+    ensure_engine_open(engine_state)
+    # Every mock request has already finished, so there is nothing to stop.
+    if not engine_state.finished.hasKey(engine_request_id(args, has_keyword_args, "Engine.cancel")):
+      raise new_exception(types.Exception, "unknown engine request id")
+    NIL
 
-    build_completion_value(text, tokens, finish_reason, latency_ms)
+  proc vm_engine_close(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    if get_positional_count(arg_count, has_keyword_args) < 1:
+      raise new_exception(types.Exception, "Engine.close requires self")
+    let engine_state = expect_engine(get_positional_arg(args, 0, has_keyword_args), "Engine.close")
+    ensure_engine_open(engine_state)
+    engine_state.closed = true
+    engine_state.finished.clear()
+    if engine_state.model != nil and engine_state.model.open_sessions > 0:
+      engine_state.model.open_sessions.dec()
+    NIL
 
   # Register a model globally for cross-thread access
   proc vm_register_model(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
@@ -367,6 +1156,74 @@ when defined(GENE_LLM_MOCK):
       release(global_model_lock)
       model_value
 
+  proc vm_llm_stats(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    {.cast(gcsafe).}:
+      llm_stats_value(mock_stats)
+
+  proc vm_llm_reset_stats(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    {.cast(gcsafe).}:
+      mock_stats = LlmStatsSnapshot()
+    NIL
+
+  # Mock weights take no memory, so the budget never evicts anything.
+  proc vm_llm_configure(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let opts =
+      if get_positional_count(arg_count, has_keyword_args) >= 1:
+        expect_map(get_positional_arg(args, 0, has_keyword_args), "configure")
+      else:
+        NIL
+    let budget = llm_memory_budget_option(opts)
+    discard llm_threadpool_config(opts)  # validated; mock inference is single-threaded
+    {.cast(gcsafe).}:
+      if budget >= 0:
+        mock_registry_stats.budget_bytes = budget
+      for (path, _) in llm_preload_entries(opts):
+        let resolved_path = normalize_path(path)
+        if not mock_registry.hasKey(resolved_path):
+          mock_registry_stats.misses.inc()
+          mock_registry[resolved_path] = 0
+    NIL
+
+  proc vm_llm_registry_stats(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    {.cast(gcsafe).}:
+      var stats = mock_registry_stats
+      stats.loaded = mock_registry.len
+      stats.in_use = 0
+      for users in mock_registry.values:
+        if users > 0:
+          stats.in_use.inc()
+      llm_registry_stats_value(stats)
+
+  # Async host requests: mock generation is instantaneous, so every request
+  # has finished (and queued its events) by the time it is submitted.
+  var mock_next_request_id {.global.}: system.int64 = 1
+
+  proc llm_async_submit(session: Value, prompt: string, options: Value, stream: bool): system.int64 =
+    if llm_branch_option(options, "Session.infer_async") > 1:
+      raise new_exception(types.Exception, "Session.infer_async does not support ^n; use infer")
+    var args = @[session, prompt.to_value()]
+    if options != NIL:
+      args.add(options)
+    let reply = call_native_fn(vm_session_infer, llm_host_vm(), args)
+    result = mock_next_request_id
+    mock_next_request_id.inc()
+    if stream:
+      let text = map_data(reply)["text".to_key()].str
+      for i, piece in text.split(' '):
+        let payload = if i == 0: piece else: " " & piece
+        llm_host_events.addLast(LlmHostEvent(request_id: result, kind: GlheToken, payload: payload))
+    llm_host_events.addLast(LlmHostEvent(request_id: result, kind: GlheDone,
+                                         payload: serialize_bridge_payload(reply)))
+
+  proc llm_async_event_fd(): int32 =
+    -1
+
+  proc llm_async_collect() =
+    discard
+
+  proc llm_async_cancel(request_id: system.int64) =
+    discard request_id
+
   proc init_llm_module*() =
     VmCreatedCallbacks.add proc() =
       {.cast(gcsafe).}:
@@ -382,6 +1239,11 @@ when defined(GENE_LLM_MOCK):
         if App.app.object_class.kind == VkClass:
           model_class_global.parent = App.app.object_class.ref.class
         model_class_global.def_native_method("new_session", vm_model_new_session)
+        model_class_global.def_native_method("new_engine", vm_model_new_engine)
+        model_class_global.def_native_method("embed", vm_model_embed)
+        model_class_global.def_native_method("tokenize", vm_model_tokenize)
+        model_class_global.def_native_method("detokenize", vm_model_detokenize)
+        model_class_global.def_native_method("count_tokens", vm_model_count_tokens)
         model_class_global.def_native_method("close", vm_model_close)
         # Set global for cross-thread access
         global_model_class = model_class_global
@@ -390,10 +1252,21 @@ when defined(GENE_LLM_MOCK):
         if App.app.object_class.kind == VkClass:
           session_class_global.parent = App.app.object_class.ref.class
         session_class_global.def_native_method("infer", vm_session_infer)
+        session_class_global.def_native_method("save_state", vm_session_save_state)
+        session_class_global.def_native_method("load_state", vm_session_load_state)
         session_class_global.def_native_method("close", vm_session_close)
         # Set global for cross-thread access
         global_session_class = session_class_global
 
+        engine_class_global = new_class("Engine")
+        if App.app.object_class.kind == VkClass:
+          engine_class_global.parent = App.app.object_class.ref.class
+        engine_class_global.def_native_method("submit", vm_engine_submit)
+        engine_class_global.def_native_method("poll", vm_engine_poll)
+        engine_class_global.def_native_method("cancel", vm_engine_cancel)
+        engine_class_global.def_native_method("close", vm_engine_close)
+        global_engine_class = engine_class_global
+
         let llm_ns = new_ref(VkNamespace)
         llm_ns.ns = new_namespace("llm")
 
@@ -409,6 +1282,22 @@ when defined(GENE_LLM_MOCK):
         get_fn.native_fn = vm_get_model
         llm_ns.ns["get_model".to_key()] = get_fn.to_ref_value()
 
+        let stats_fn = new_ref(VkNativeFn)
+        stats_fn.native_fn = vm_llm_stats
+        llm_ns.ns["stats".to_key()] = stats_fn.to_ref_value()
+
+        let reset_stats_fn = new_ref(VkNativeFn)
+        reset_stats_fn.native_fn = vm_llm_reset_stats
+        llm_ns.ns["reset_stats".to_key()] = reset_stats_fn.to_ref_value()
+
+        let configure_fn = new_ref(VkNativeFn)
+        configure_fn.native_fn = vm_llm_configure
+        llm_ns.ns["configure".to_key()] = configure_fn.to_ref_value()
+
+        let registry_stats_fn = new_ref(VkNativeFn)
+        registry_stats_fn.native_fn = vm_llm_registry_stats
+        llm_ns.ns["registry_stats".to_key()] = registry_stats_fn.to_ref_value()
+
         let model_class_ref = new_ref(VkClass)
         model_class_ref.class = model_class_global
         llm_ns.ns["Model".to_key()] = model_class_ref.to_ref_value()
@@ -417,6 +1306,10 @@ when defined(GENE_LLM_MOCK):
         session_class_ref.class = session_class_global
         llm_ns.ns["Session".to_key()] = session_class_ref.to_ref_value()
 
+        let engine_class_ref = new_ref(VkClass)
+        engine_class_ref.class = engine_class_global
+        llm_ns.ns["Engine".to_key()] = engine_class_ref.to_ref_value()
+
         App.app.genex_ns.ref.ns["llm".to_key()] = llm_ns.to_ref_value()
 
   init_llm_module()
@@ -467,10 +1360,12 @@ else:
   type
     GeneLlmModel {.importc: "struct gene_llm_model", header: "gene_llm.h".} = object
     GeneLlmSession {.importc: "struct gene_llm_session", header: "gene_llm.h".} = object
+    GeneLlmEngine {.importc: "struct gene_llm_engine", header: "gene_llm.h".} = object
 
     GeneLlmStatus {.size: sizeof(cint).} = enum
       glsOk = 0
       glsError = 1
+      glsPending = 2
 
     GeneLlmFinishReason {.size: sizeof(cint).} = enum
       glfStop = 0
@@ -484,17 +1379,40 @@ else:
       gpu_layers*: cint
       use_mmap*: bool
       use_mlock*: bool
+      state_cache_dir*: cstring
 
     GeneLlmSessionOptions {.importc: "gene_llm_session_options", header: "gene_llm.h".} = object
+      context_length*: cint
+      batch_size*: cint
+      ubatch_size*: cint
+      threads*: cint
+      seed*: cint
+      temperature*: cfloat
+      top_p*: cfloat
+      top_k*: cint
+      max_tokens*: cint
+      draft_model*: ptr GeneLlmModel
+      draft_tokens*: cint
+      max_branches*: cint
+      type_k*: cint
+      type_v*: cint
+      flash_attn*: cint
+      context_shift*: bool
+      keep_tokens*: cint
+
+    GeneLlmEngineOptions {.importc: "gene_llm_engine_options", header: "gene_llm.h".} = object
       context_length*: cint
       batch_size*: cint
       threads*: cint
+      max_sequences*: cint
       seed*: cint
       temperature*: cfloat
       top_p*: cfloat
       top_k*: cint
       max_tokens*: cint
 
+    GeneLlmProgressCallback = proc(decoded_tokens: cint, total_tokens: cint, user_data: pointer): cint {.cdecl.}
+
     GeneLlmInferOptions {.importc: "gene_llm_infer_options", header: "gene_llm.h".} = object
       prompt*: cstring
       max_tokens*: cint
@@ -502,6 +1420,25 @@ else:
       top_p*: cfloat
       top_k*: cint
       seed*: cint
+      timeout_ms*: cint
+      progress_callback*: GeneLlmProgressCallback
+      progress_user_data*: pointer
+      prompt_tokens*: ptr int32
+      prompt_token_count*: cint
+      n*: cint
+      grammar_kind*: cint
+      grammar*: cstring
+
+    GeneLlmPooling {.size: sizeof(cint).} = enum
+      glpMean = 1
+      glpCls = 2
+      glpLast = 3
+
+    GeneLlmEmbedOptions {.importc: "gene_llm_embed_options", header: "gene_llm.h".} = object
+      pooling*: GeneLlmPooling
+      normalize*: bool
+      batch_size*: cint
+      threads*: cint
 
     GeneLlmError {.importc: "gene_llm_error", header: "gene_llm.h".} = object
       code*: cint
@@ -509,22 +1446,136 @@ else:
 
     GeneLlmCompletion {.importc: "gene_llm_completion", header: "gene_llm.h".} = object
       text*: cstring
-      tokens*: ptr cstring
+      text_len*: csize_t
+      token_ids*: ptr UncheckedArray[int32]
+      token_offsets*: ptr UncheckedArray[int32]
       token_count*: cint
       latency_ms*: cint
       finish_reason*: GeneLlmFinishReason
+      draft_tokens*: cint
+      draft_accepted*: cint
+      prompt_tokens*: cint
+      cached_tokens*: cint
+      prefill_ms*: cdouble
+      decode_ms*: cdouble
+      ttft_ms*: cdouble
+      tokens_per_second*: cdouble
+      kv_used*: cint
+      kv_size*: cint
+      context_shifts*: cint
+
+    GeneLlmStats {.importc: "gene_llm_stats", header: "gene_llm.h".} = object
+      requests*: int64
+      failed_requests*: int64
+      cancelled_requests*: int64
+      prompt_tokens*: int64
+      cached_tokens*: int64
+      generated_tokens*: int64
+      prefill_ms*: cdouble
+      decode_ms*: cdouble
+      models*: int64
+      sessions*: int64
+      engines*: int64
+
+    GeneLlmLogCallback = proc(level: cint, message: cstring, user_data: pointer) {.cdecl, gcsafe.}
 
   proc gene_llm_backend_init() {.cdecl, importc: "gene_llm_backend_init", header: "gene_llm.h".}
+  proc gene_llm_set_log_callback(callback: GeneLlmLogCallback, user_data: pointer) {.cdecl, importc: "gene_llm_set_log_callback", header: "gene_llm.h".}
+  proc gene_llm_get_stats(out_stats: ptr GeneLlmStats) {.cdecl, importc: "gene_llm_get_stats", header: "gene_llm.h".}
+  proc gene_llm_reset_stats() {.cdecl, importc: "gene_llm_reset_stats", header: "gene_llm.h".}
   proc gene_llm_load_model(path: cstring, opts: ptr GeneLlmModelOptions, out_model: ptr ptr GeneLlmModel, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_load_model", header: "gene_llm.h".}
   proc gene_llm_free_model(model: ptr GeneLlmModel) {.cdecl, importc: "gene_llm_free_model", header: "gene_llm.h".}
+
+  # Process-wide model registry (shared weights, LRU eviction under a budget)
+  type
+    GeneLlmRegistryOptions {.importc: "gene_llm_registry_options", header: "gene_llm.h".} = object
+      memory_budget_bytes*: csize_t
+
+    GeneLlmRegistryStats {.importc: "gene_llm_registry_stats", header: "gene_llm.h".} = object
+      loaded*: cint
+      in_use*: cint
+      resident_bytes*: csize_t
+      budget_bytes*: csize_t
+      hits*: int64
+      misses*: int64
+      evictions*: int64
+
+  proc gene_llm_registry_configure(opts: ptr GeneLlmRegistryOptions) {.cdecl, importc: "gene_llm_registry_configure", header: "gene_llm.h".}
+  proc gene_llm_acquire_model(path: cstring, opts: ptr GeneLlmModelOptions, out_model: ptr ptr GeneLlmModel, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_acquire_model", header: "gene_llm.h".}
+  proc gene_llm_release_model(model: ptr GeneLlmModel) {.cdecl, importc: "gene_llm_release_model", header: "gene_llm.h".}
+  proc gene_llm_preload_model(path: cstring, opts: ptr GeneLlmModelOptions, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_preload_model", header: "gene_llm.h".}
+  proc gene_llm_registry_get_stats(out_stats: ptr GeneLlmRegistryStats) {.cdecl, importc: "gene_llm_registry_get_stats", header: "gene_llm.h".}
+
+  # Process-wide ggml threadpool shared by every context
+  type
+    GeneLlmThreadpoolOptions {.importc: "gene_llm_threadpool_options", header: "gene_llm.h".} = object
+      threads*: cint
+      cpus*: ptr cint
+      cpu_count*: cint
+      strict_cpu*: bool
+      priority*: cint
+      poll*: cint
+
+  proc gene_llm_configure_threadpool(opts: ptr GeneLlmThreadpoolOptions, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_configure_threadpool", header: "gene_llm.h".}
   proc gene_llm_new_session(model: ptr GeneLlmModel, opts: ptr GeneLlmSessionOptions, out_session: ptr ptr GeneLlmSession, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_new_session", header: "gene_llm.h".}
   proc gene_llm_free_session(session: ptr GeneLlmSession) {.cdecl, importc: "gene_llm_free_session", header: "gene_llm.h".}
   proc gene_llm_infer(session: ptr GeneLlmSession, opts: ptr GeneLlmInferOptions, completion: ptr GeneLlmCompletion, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_infer", header: "gene_llm.h".}
   proc gene_llm_free_completion(completion: ptr GeneLlmCompletion) {.cdecl, importc: "gene_llm_free_completion", header: "gene_llm.h".}
+  proc gene_llm_infer_n(session: ptr GeneLlmSession, opts: ptr GeneLlmInferOptions, completions: ptr GeneLlmCompletion, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_infer_n", header: "gene_llm.h".}
+
+  proc gene_llm_session_save_state(session: ptr GeneLlmSession, prefix: cstring, out_key: cstring, out_key_len: csize_t, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_session_save_state", header: "gene_llm.h".}
+  proc gene_llm_session_load_state(session: ptr GeneLlmSession, prefix: cstring, out_loaded: ptr bool, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_session_load_state", header: "gene_llm.h".}
+  proc gene_llm_tokenize(model: ptr GeneLlmModel, text: cstring, len: csize_t, add_special: bool, out_tokens: ptr int32, max_tokens: cint, out_count: ptr cint, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_tokenize", header: "gene_llm.h".}
+  proc gene_llm_detokenize(model: ptr GeneLlmModel, tokens: ptr int32, count: cint, remove_special: bool, output: cstring, out_size: csize_t, out_len: ptr csize_t, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_detokenize", header: "gene_llm.h".}
+  proc gene_llm_count_tokens_batch(model: ptr GeneLlmModel, texts: ptr cstring, count: cint, add_special: bool, out_counts: ptr int32, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_count_tokens_batch", header: "gene_llm.h".}
+  proc gene_llm_embedding_dim(model: ptr GeneLlmModel): cint {.cdecl, importc: "gene_llm_embedding_dim", header: "gene_llm.h".}
+  proc gene_llm_embed_batch(model: ptr GeneLlmModel, texts: ptr cstring, count: cint, opts: ptr GeneLlmEmbedOptions, output: ptr cfloat, out_len: csize_t, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_embed_batch", header: "gene_llm.h".}
+
+  # Continuous-batching engine (requests share one context; runs on its own thread)
+  proc gene_llm_new_engine(model: ptr GeneLlmModel, opts: ptr GeneLlmEngineOptions, out_engine: ptr ptr GeneLlmEngine, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_new_engine", header: "gene_llm.h".}
+  proc gene_llm_free_engine(engine: ptr GeneLlmEngine) {.cdecl, importc: "gene_llm_free_engine", header: "gene_llm.h".}
+  proc gene_llm_submit(engine: ptr GeneLlmEngine, opts: ptr GeneLlmInferOptions, out_request_id: ptr int64, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_submit", header: "gene_llm.h".}
+  proc gene_llm_poll(engine: ptr GeneLlmEngine, request_id: int64, timeout_ms: cint, completion: ptr GeneLlmCompletion, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_poll", header: "gene_llm.h".}
+  proc gene_llm_cancel(engine: ptr GeneLlmEngine, request_id: int64, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_cancel", header: "gene_llm.h".}
+
+  # Async queue: inference on a shim worker thread, completion signalled via an fd
+  type
+    GeneLlmAsyncQueue {.importc: "struct gene_llm_async_queue", header: "gene_llm.h", incompleteStruct.} = object
 
-  # Streaming callback: returns 0 to continue, non-zero to stop
-  type GeneLlmTokenCallback = proc(token: cstring, token_len: cint, user_data: pointer): cint {.cdecl.}
-  proc gene_llm_infer_streaming(session: ptr GeneLlmSession, opts: ptr GeneLlmInferOptions, callback: GeneLlmTokenCallback, user_data: pointer, completion: ptr GeneLlmCompletion, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_infer_streaming", header: "gene_llm.h".}
+    GeneLlmEventKind {.size: sizeof(cint).} = enum
+      gleToken = 0
+      gleDone = 1
+      gleError = 2
+
+    GeneLlmEvent {.importc: "gene_llm_event", header: "gene_llm.h".} = object
+      request_id*: int64
+      kind*: GeneLlmEventKind
+      text*: cstring
+      text_len*: csize_t
+      completion*: GeneLlmCompletion
+
+  proc gene_llm_new_async_queue(out_queue: ptr ptr GeneLlmAsyncQueue, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_new_async_queue", header: "gene_llm.h".}
+  proc gene_llm_async_shutdown(queue: ptr GeneLlmAsyncQueue) {.cdecl, importc: "gene_llm_async_shutdown", header: "gene_llm.h".}
+  proc gene_llm_free_async_queue(queue: ptr GeneLlmAsyncQueue) {.cdecl, importc: "gene_llm_free_async_queue", header: "gene_llm.h".}
+  proc gene_llm_async_fd(queue: ptr GeneLlmAsyncQueue): cint {.cdecl, importc: "gene_llm_async_fd", header: "gene_llm.h".}
+  proc gene_llm_infer_async(queue: ptr GeneLlmAsyncQueue, session: ptr GeneLlmSession, opts: ptr GeneLlmInferOptions, stream_tokens: bool, out_request_id: ptr int64, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_infer_async", header: "gene_llm.h".}
+  proc gene_llm_async_cancel(queue: ptr GeneLlmAsyncQueue, request_id: int64, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_async_cancel", header: "gene_llm.h".}
+  proc gene_llm_async_drain(queue: ptr GeneLlmAsyncQueue, events: ptr GeneLlmEvent, max_events: cint): cint {.cdecl, importc: "gene_llm_async_drain", header: "gene_llm.h".}
+
+  # Streamed output: a byte ring the worker fills without waiting on the reader
+  type
+    GeneLlmStream {.importc: "struct gene_llm_stream", header: "gene_llm.h", incompleteStruct.} = object
+
+    GeneLlmStreamOptions {.importc: "gene_llm_stream_options", header: "gene_llm.h".} = object
+      capacity*: csize_t
+      flush_bytes*: cint
+      flush_ms*: cint
+
+  proc gene_llm_new_stream(opts: ptr GeneLlmStreamOptions, out_stream: ptr ptr GeneLlmStream, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_new_stream", header: "gene_llm.h".}
+  proc gene_llm_free_stream(stream: ptr GeneLlmStream) {.cdecl, importc: "gene_llm_free_stream", header: "gene_llm.h".}
+  proc gene_llm_stream_read(stream: ptr GeneLlmStream, output: ptr char, max_len: csize_t): csize_t {.cdecl, importc: "gene_llm_stream_read", header: "gene_llm.h".}
+  proc gene_llm_stream_cancel(stream: ptr GeneLlmStream) {.cdecl, importc: "gene_llm_stream_cancel", header: "gene_llm.h".}
+  proc gene_llm_infer_async_stream(queue: ptr GeneLlmAsyncQueue, session: ptr GeneLlmSession, opts: ptr GeneLlmInferOptions, stream: ptr GeneLlmStream, out_request_id: ptr int64, err: ptr GeneLlmError): GeneLlmStatus {.cdecl, importc: "gene_llm_infer_async_stream", header: "gene_llm.h".}
 
   type
     ModelState = ref object of CustomValue
@@ -537,6 +1588,7 @@ else:
 
     SessionState = ref object of CustomValue
       model: ModelState
+      draft: ModelState  # Speculative decoding draft model, if any
       handle: ptr GeneLlmSession
       context_len: int
       temperature: float
@@ -545,18 +1597,107 @@ else:
       seed: int
       max_tokens: int
       closed: bool
+      pending_requests: int  # async requests still running on the shim worker
+
+    EngineState = ref object of CustomValue
+      model: ModelState
+      handle: ptr GeneLlmEngine
+      temperature: float
+      top_p: float
+      top_k: int
+      seed: int
+      max_tokens: int
+      closed: bool
 
   var
     model_class_global {.threadvar.}: Class
     session_class_global {.threadvar.}: Class
+    engine_class_global {.threadvar.}: Class
     backend_ready {.threadvar.}: bool
     tracked_models {.threadvar.}: seq[ModelState]
     tracked_sessions {.threadvar.}: seq[SessionState]
+    tracked_engines {.threadvar.}: seq[EngineState]
+
+  # Shim diagnostics, possibly raised on its worker threads.
+  proc llm_shim_log(level: cint, message: cstring, user_data: pointer) {.cdecl, gcsafe.} =
+    let log_level =
+      if level >= cint(ord(LlError)) and level <= cint(ord(LlTrace)):
+        LogLevel(level)
+      else:
+        LlDebug
+    {.cast(gcsafe).}:
+      if extension_log_enabled(log_level, LlmLogger):
+        extension_log_message(log_level, LlmLogger, $message)
+
+  proc preload_model(path: string, opts: Value)
+  proc raise_backend_error(err: GeneLlmError)
+
+  # GENE_LLM_MEMORY_BUDGET_MB and GENE_LLM_PRELOAD (paths separated like
+  # PATH) configure the registry before the first load. Preloading is best
+  # effort; a missing model is only logged.
+  proc apply_registry_env() =
+    let budget_mb = getEnv("GENE_LLM_MEMORY_BUDGET_MB").strip()
+    if budget_mb.len > 0:
+      try:
+        var registry_opts = GeneLlmRegistryOptions(
+          memory_budget_bytes: csize_t(max(0, parseInt(budget_mb))) * 1024 * 1024)
+        gene_llm_registry_configure(addr registry_opts)
+      except ValueError:
+        extension_log_message(LlWarn, LlmLogger, "ignoring GENE_LLM_MEMORY_BUDGET_MB=" & budget_mb)
+    for path in getEnv("GENE_LLM_PRELOAD").split(PathSep):
+      if path.strip().len == 0:
+        continue
+      try:
+        preload_model(path.strip(), NIL)
+      except CatchableError as e:
+        extension_log_message(LlWarn, LlmLogger, "preload failed: " & e.msg)
+
+  proc configure_threadpool(config: LlmThreadpoolConfig) =
+    var cpus = newSeq[cint](config.cpus.len)
+    for i, cpu in config.cpus:
+      cpus[i] = cint(cpu)
+    var pool_opts = GeneLlmThreadpoolOptions(
+      threads: cint(config.threads),
+      cpus: if cpus.len > 0: addr cpus[0] else: nil,
+      cpu_count: cint(cpus.len),
+      strict_cpu: config.strict_cpu,
+      priority: cint(config.priority),
+      poll: cint(config.poll)
+    )
+    var err: GeneLlmError
+    if gene_llm_configure_threadpool(addr pool_opts, addr err) != glsOk:
+      raise_backend_error(err)
+
+  # GENE_LLM_THREADS, GENE_LLM_CPUS, GENE_LLM_RESERVE_CPUS and
+  # GENE_LLM_THREAD_PRIORITY mirror the configure options.
+  proc apply_threadpool_env() =
+    var env = initTable[Key, Value]()
+    for (name, key) in [("GENE_LLM_THREADS", "threads"), ("GENE_LLM_RESERVE_CPUS", "reserve_cpus")]:
+      let text = getEnv(name).strip()
+      if text.len > 0:
+        try:
+          env[key.to_key()] = parseInt(text).to_value()
+        except ValueError:
+          extension_log_message(LlWarn, LlmLogger, "ignoring " & name & "=" & text)
+    for (name, key) in [("GENE_LLM_CPUS", "cpus"), ("GENE_LLM_THREAD_PRIORITY", "thread_priority")]:
+      let text = getEnv(name).strip()
+      if text.len > 0:
+        env[key.to_key()] = text.to_value()
+    if env.len == 0:
+      return
+    try:
+      configure_threadpool(llm_threadpool_config(new_map_value(env)))
+    except CatchableError as e:
+      extension_log_message(LlWarn, LlmLogger, "threadpool settings ignored: " & e.msg)
 
   proc ensure_backend() =
     if not backend_ready:
       gene_llm_backend_init()
+      gene_llm_set_log_callback(llm_shim_log, nil)
       backend_ready = true
+      {.cast(gcsafe).}:
+        apply_threadpool_env()
+        apply_registry_env()
 
   proc track_model(state: ModelState) =
     tracked_models.add(state)
@@ -576,6 +1717,15 @@ else:
         tracked_sessions.delete(i)
         break
 
+  proc track_engine(state: EngineState) =
+    tracked_engines.add(state)
+
+  proc untrack_engine(state: EngineState) =
+    for i in countdown(tracked_engines.len - 1, 0):
+      if tracked_engines[i] == state:
+        tracked_engines.delete(i)
+        break
+
   proc expect_model(val: Value, context: string): ModelState =
     # Check by class name for cross-thread compatibility (model_class_global is threadvar)
     if val.kind != VkCustom:
@@ -592,6 +1742,14 @@ else:
       raise new_exception(types.Exception, context & " requires an LLM session instance")
     cast[SessionState](get_custom_data(val, "LLM session payload missing"))
 
+  proc expect_engine(val: Value, context: string): EngineState =
+    # Check by class name for cross-thread compatibility (engine_class_global is threadvar)
+    if val.kind != VkCustom:
+      raise new_exception(types.Exception, context & " requires an LLM engine instance")
+    if val.ref.custom_class == nil or val.ref.custom_class.name != "Engine":
+      raise new_exception(types.Exception, context & " requires an LLM engine instance")
+    cast[EngineState](get_custom_data(val, "LLM engine payload missing"))
+
   proc new_model_value(state: ModelState): Value {.gcsafe.} =
     # Use threadvar class if available, fall back to global for worker threads
     {.cast(gcsafe).}:
@@ -604,6 +1762,12 @@ else:
       let cls = if session_class_global != nil: session_class_global else: global_session_class
       new_custom_value(cls, state)
 
+  proc new_engine_value(state: EngineState): Value {.gcsafe.} =
+    # Use threadvar class if available, fall back to global for worker threads
+    {.cast(gcsafe).}:
+      let cls = if engine_class_global != nil: engine_class_global else: global_engine_class
+      new_custom_value(cls, state)
+
   proc ensure_model_open(state: ModelState) =
     if state.closed:
       raise new_exception(types.Exception, "LLM model has been closed")
@@ -612,6 +1776,10 @@ else:
     if state.closed:
       raise new_exception(types.Exception, "LLM session has been closed")
 
+  proc ensure_engine_open(state: EngineState) =
+    if state.closed:
+      raise new_exception(types.Exception, "LLM engine has been closed")
+
   proc expect_map(val: Value, context: string): Value =
     if val == NIL:
       return NIL
@@ -667,6 +1835,55 @@ else:
     if result.len == 0:
       result = path
 
+  # ^timeout_ms wins over ^timeout (seconds); 0 means no deadline.
+  proc timeout_option_ms(opts: Value): int =
+    result =
+      if has_option(opts, "timeout_ms"):
+        get_int_option(opts, "timeout_ms", 0)
+      else:
+        int(get_float_option(opts, "timeout", 0.0) * 1000.0)
+    if result < 0:
+      raise new_exception(types.Exception, "LLM timeout must not be negative")
+
+  proc embed_inputs(input_val: Value, context: string): seq[string] =
+    case input_val.kind
+    of VkString:
+      result = @[input_val.str]
+    of VkArray:
+      for item in array_data(input_val):
+        if item.kind != VkString:
+          raise new_exception(types.Exception, context & " inputs must be strings")
+        result.add(item.str)
+    else:
+      raise new_exception(types.Exception, context & " requires a string or an array of strings")
+
+  # Vectors are packed as native-endian float32 in a single Bytes value.
+  proc embedding_value(dim: int, count: int, data: Value): Value =
+    var map_table = initTable[Key, Value]()
+    map_table["dim".to_key()] = dim.to_value()
+    map_table["count".to_key()] = count.to_value()
+    map_table["data".to_key()] = data
+    new_map_value(map_table)
+
+  proc pooling_option(opts: Value): GeneLlmPooling =
+    if not has_option(opts, "pooling"):
+      return glpMean
+    let val = map_data(opts)["pooling".to_key()]
+    let name =
+      if val.kind in {VkString, VkSymbol}:
+        val.str.strip(trailing = false, chars = {':'})
+      else:
+        ""
+    case name
+    of "mean":
+      glpMean
+    of "cls":
+      glpCls
+    of "last":
+      glpLast
+    else:
+      raise new_exception(types.Exception, "Model.embed ^pooling must be mean, cls or last")
+
   proc error_string(err: GeneLlmError): string =
     var buffer = newStringOfCap(512)
     for ch in err.message:
@@ -689,32 +1906,57 @@ else:
       state.handle = nil
     if state.model != nil and state.model.open_sessions > 0:
       state.model.open_sessions.dec()
+    if state.draft != nil and state.draft.open_sessions > 0:
+      state.draft.open_sessions.dec()
     untrack_session(state)
 
+  proc cleanup_engine(state: EngineState) =
+    if state == nil or state.closed:
+      return
+    state.closed = true
+    if state.handle != nil:
+      gene_llm_free_engine(state.handle)
+      state.handle = nil
+    if state.model != nil and state.model.open_sessions > 0:
+      state.model.open_sessions.dec()
+    untrack_engine(state)
+
   proc cleanup_model(state: ModelState) =
     if state == nil or state.closed:
       return
     state.closed = true
     if state.handle != nil:
-      gene_llm_free_model(state.handle)
+      gene_llm_release_model(state.handle)
       state.handle = nil
     untrack_model(state)
 
 
-  proc completion_to_value(completion: var GeneLlmCompletion): Value =
+  # Copies the completion out of the shim's arena: one string for the text and
+  # immediate ints for the token ids. Per-token strings are only built when the
+  # caller asks for them with ^tokens true.
+  proc completion_to_value(completion: var GeneLlmCompletion, want_tokens: bool): Value =
     var map_table = initTable[Key, Value]()
-    let text_value = if completion.text == nil: "" else: $completion.text
-    map_table["text".to_key()] = text_value.to_value()
-
-    var token_array = new_array_value(@[])
-    if completion.tokens != nil and completion.token_count > 0:
-      for i in 0..<completion.token_count:
-        let token_ptr = completion.tokens[i]
-        if token_ptr != nil:
-          array_data(token_array).add(($token_ptr).to_value())
-        else:
-          array_data(token_array).add("".to_value())
-    map_table["tokens".to_key()] = token_array
+    var text = newString(int(completion.text_len))
+    if text.len > 0:
+      copyMem(text[0].addr, completion.text, text.len)
+
+    let count = int(completion.token_count)
+    var token_ids = new_array_value()
+    array_data(token_ids).setLen(count)
+    for i in 0..<count:
+      array_data(token_ids)[i] = completion.token_ids[i].to_value()
+    map_table["token_ids".to_key()] = token_ids
+    map_table["token_count".to_key()] = count.to_value()
+
+    if want_tokens:
+      var tokens = new_array_value()
+      array_data(tokens).setLen(count)
+      for i in 0..<count:
+        let first = int(completion.token_offsets[i])
+        let last = int(completion.token_offsets[i + 1])
+        array_data(tokens)[i] = text[first ..< last].to_value()
+      map_table["tokens".to_key()] = tokens
+    map_table["text".to_key()] = text.to_value()
 
     let finish_symbol =
       case completion.finish_reason
@@ -729,9 +1971,51 @@ else:
 
     map_table["finish_reason".to_key()] = finish_symbol.to_symbol_value()
     map_table["latency_ms".to_key()] = completion.latency_ms.to_value()
+    if completion.draft_tokens > 0:
+      map_table["draft_tokens".to_key()] = completion.draft_tokens.to_value()
+      map_table["draft_accepted".to_key()] = completion.draft_accepted.to_value()
+
+    var perf = initTable[Key, Value]()
+    perf["prompt_tokens".to_key()] = completion.prompt_tokens.to_value()
+    perf["cached_tokens".to_key()] = completion.cached_tokens.to_value()
+    perf["prefill_ms".to_key()] = float(completion.prefill_ms).to_value()
+    perf["decode_ms".to_key()] = float(completion.decode_ms).to_value()
+    perf["ttft_ms".to_key()] = float(completion.ttft_ms).to_value()
+    perf["tokens_per_second".to_key()] = float(completion.tokens_per_second).to_value()
+    perf["kv_used".to_key()] = completion.kv_used.to_value()
+    perf["kv_size".to_key()] = completion.kv_size.to_value()
+    perf["context_shifts".to_key()] = completion.context_shifts.to_value()
+    map_table["perf".to_key()] = new_map_value(perf)
 
     new_map_value(map_table)
 
+  # state_cache_dir backs the returned cstring and must outlive the call.
+  proc build_model_options(opts: Value, state_cache_dir: var string): GeneLlmModelOptions =
+    # Session KV snapshots are content-addressed files under ^state_cache
+    state_cache_dir = ""
+    if has_option(opts, "state_cache"):
+      let dir_val = map_data(opts)["state_cache".to_key()]
+      if dir_val.kind != VkString:
+        raise new_exception(types.Exception, "load_model ^state_cache must be a directory path")
+      state_cache_dir = normalize_path(dir_val.str)
+      createDir(state_cache_dir)
+
+    GeneLlmModelOptions(
+      context_length: cint(max(256, get_int_option(opts, "context", 2048))),
+      threads: cint(max(0, get_int_option(opts, "threads", 0))),  # 0 = the shared pool
+      gpu_layers: cint(max(0, get_int_option(opts, "gpu_layers", 0))),
+      use_mmap: not get_bool_option(opts, "disable_mmap", false),
+      use_mlock: get_bool_option(opts, "mlock", false),
+      state_cache_dir: (if state_cache_dir.len > 0: state_cache_dir.cstring else: nil)
+    )
+
+  proc preload_model(path: string, opts: Value) =
+    var state_cache_dir = ""
+    var model_opts = build_model_options(opts, state_cache_dir)
+    var err: GeneLlmError
+    if gene_llm_preload_model(normalize_path(path).cstring, addr model_opts, addr err) != glsOk:
+      raise_backend_error(err)
+
   proc vm_load_model(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
     let positional = get_positional_count(arg_count, has_keyword_args)
     if positional < 1:
@@ -754,17 +2038,14 @@ else:
     if not allow_missing and not fileExists(resolved_path):
       raise new_exception(types.Exception, "LLM model not found: " & resolved_path)
 
-    var model_opts = GeneLlmModelOptions(
-      context_length: cint(max(256, get_int_option(opts, "context", 2048))),
-      threads: cint(max(1, get_int_option(opts, "threads", countProcessors()))),
-      gpu_layers: cint(max(0, get_int_option(opts, "gpu_layers", 0))),
-      use_mmap: not get_bool_option(opts, "disable_mmap", false),
-      use_mlock: get_bool_option(opts, "mlock", false)
-    )
+    var state_cache_dir = ""
+    var model_opts = build_model_options(opts, state_cache_dir)
 
+    # The registry hands out the already-loaded model for the same file and
+    # options; Model.close releases it.
     var err: GeneLlmError
     var handle: ptr GeneLlmModel
-    let status = gene_llm_load_model(resolved_path.cstring, addr model_opts, addr handle, addr err)
+    let status = gene_llm_acquire_model(resolved_path.cstring, addr model_opts, addr handle, addr err)
     if status != glsOk or handle == nil:
       raise_backend_error(err)
 
@@ -808,15 +2089,32 @@ else:
         NIL
 
     let ctx_len = get_int_option(opts, "context", model_state.context_len)
+    let batch_size = max(1, get_int_option(opts, "batch", min(512, ctx_len)))
+
+    # ^draft names a second (smaller) Model used for speculative decoding.
+    var draft_state: ModelState = nil
+    if has_option(opts, "draft"):
+      draft_state = expect_model(map_data(opts)["draft".to_key()], "new_session ^draft")
+      ensure_model_open(draft_state)
+
     var session_opts = GeneLlmSessionOptions(
       context_length: cint(ctx_len),
-      batch_size: cint(get_int_option(opts, "batch", ctx_len)),  # Default batch to context length
-      threads: cint(max(1, get_int_option(opts, "threads", model_state.threads))),
+      batch_size: cint(batch_size),  # Prompts are prefilled in chunks of this size
+      ubatch_size: cint(max(1, get_int_option(opts, "ubatch", batch_size))),
+      threads: cint(max(0, get_int_option(opts, "threads", model_state.threads))),
       seed: cint(get_int_option(opts, "seed", 42)),
       temperature: get_float_option(opts, "temperature", 0.7).cfloat,
       top_p: get_float_option(opts, "top_p", 0.9).cfloat,
       top_k: cint(get_int_option(opts, "top_k", 40)),
-      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", 256)))
+      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", 256))),
+      draft_model: (if draft_state != nil: draft_state.handle else: nil),
+      draft_tokens: cint(max(0, get_int_option(opts, "draft_tokens", 0))),
+      max_branches: cint(max(1, get_int_option(opts, "max_branches", 1))),
+      type_k: cint(llm_kv_type_option(opts, "cache_type_k")),
+      type_v: cint(llm_kv_type_option(opts, "cache_type_v")),
+      flash_attn: cint(llm_flash_attn_option(opts)),
+      context_shift: get_bool_option(opts, "context_shift", false),
+      keep_tokens: cint(max(0, get_int_option(opts, "keep_tokens", 0)))
     )
 
     var err: GeneLlmError
@@ -839,6 +2137,7 @@ else:
 
     let session_state = SessionState(
       model: model_state,
+      draft: draft_state,
       handle: handle,
       context_len: int(session_opts.context_length),
       temperature: cast[float](session_opts.temperature),
@@ -848,6 +2147,8 @@ else:
       max_tokens: int(session_opts.max_tokens)
     )
     model_state.open_sessions.inc()
+    if draft_state != nil:
+      draft_state.open_sessions.inc()
     track_session(session_state)
     new_session_value(session_state)
 
@@ -859,9 +2160,53 @@ else:
     let self_val = get_positional_arg(args, 0, has_keyword_args)
     let state = expect_session(self_val, "Session.close")
     ensure_session_open(state)
+    if state.pending_requests > 0:
+      raise new_exception(types.Exception, "Cannot close session while async requests are pending")
     cleanup_session(state)
     NIL
 
+  proc session_infer_options(session_state: SessionState, prompt: cstring, opts: Value): GeneLlmInferOptions =
+    GeneLlmInferOptions(
+      prompt: prompt,
+      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", session_state.max_tokens))),
+      temperature: get_float_option(opts, "temperature", session_state.temperature).cfloat,
+      top_p: get_float_option(opts, "top_p", session_state.top_p).cfloat,
+      top_k: cint(max(1, get_int_option(opts, "top_k", session_state.top_k))),
+      seed: cint(get_int_option(opts, "seed", session_state.seed)),
+      timeout_ms: cint(timeout_option_ms(opts))
+    )
+
+  # tokens must stay alive until the request has been handed to the shim.
+  proc attach_prompt_tokens(infer_opts: var GeneLlmInferOptions, tokens: var seq[int32]) =
+    if tokens.len > 0:
+      infer_opts.prompt_tokens = addr tokens[0]
+      infer_opts.prompt_token_count = cint(tokens.len)
+
+  # grammar must outlive the call; the shim parses it once per session.
+  proc attach_grammar(infer_opts: var GeneLlmInferOptions, grammar: var tuple[kind: int, text: string]) =
+    infer_opts.grammar_kind = cint(grammar.kind)
+    if grammar.text.len > 0:
+      infer_opts.grammar = grammar.text.cstring
+
+  # Array of n completion maps sampled from one prefill (^n on infer).
+  proc infer_branches(session_state: SessionState, infer_opts: var GeneLlmInferOptions, n: int,
+                      want_tokens: bool): Value =
+    var completions = newSeq[GeneLlmCompletion](n)
+    var err: GeneLlmError
+    {.cast(gcsafe).}:
+      acquire(global_llm_op_lock)
+    try:
+      if gene_llm_infer_n(session_state.handle, addr infer_opts, addr completions[0], addr err) != glsOk:
+        raise_backend_error(err)
+      # Branch arenas are reused by the next request; copy out under the lock.
+      result = new_array_value()
+      for completion in completions.mitems:
+        array_data(result).add(completion_to_value(completion, want_tokens))
+        gene_llm_free_completion(addr completion)
+    finally:
+      {.cast(gcsafe).}:
+        release(global_llm_op_lock)
+
   proc vm_session_infer(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
     let positional = get_positional_count(arg_count, has_keyword_args)
     if positional < 2:
@@ -871,9 +2216,7 @@ else:
     let session_state = expect_session(self_val, "Session.infer")
     ensure_session_open(session_state)
 
-    let prompt_val = get_positional_arg(args, 1, has_keyword_args)
-    if prompt_val.kind != VkString:
-      raise new_exception(types.Exception, "Session.infer prompt must be a string")
+    var prompt = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Session.infer")
 
     let opts =
       if positional >= 3:
@@ -881,17 +2224,14 @@ else:
       else:
         NIL
 
-    if has_option(opts, "timeout") or has_option(opts, "timeout_ms"):
-      raise new_exception(types.Exception, "Session.infer timeout is not supported for local inference yet")
-
-    var infer_opts = GeneLlmInferOptions(
-      prompt: prompt_val.str.cstring,
-      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", session_state.max_tokens))),
-      temperature: get_float_option(opts, "temperature", session_state.temperature).cfloat,
-      top_p: get_float_option(opts, "top_p", session_state.top_p).cfloat,
-      top_k: cint(max(1, get_int_option(opts, "top_k", session_state.top_k))),
-      seed: cint(get_int_option(opts, "seed", session_state.seed))
-    )
+    var infer_opts = session_infer_options(session_state, prompt.text.cstring, opts)
+    attach_prompt_tokens(infer_opts, prompt.tokens)
+    var grammar = llm_grammar_option(opts)
+    attach_grammar(infer_opts, grammar)
+    let n = llm_branch_option(opts, "Session.infer")
+    if n > 1:
+      infer_opts.n = cint(n)
+      return infer_branches(session_state, infer_opts, n, get_bool_option(opts, "tokens", false))
 
     var completion: GeneLlmCompletion
     var err: GeneLlmError
@@ -908,19 +2248,54 @@ else:
       {.cast(gcsafe).}:
         release(global_llm_op_lock)
       raise
+    # The completion points into the session's arena; copy it out before
+    # another request can reuse it.
+    let result_value = completion_to_value(completion, get_bool_option(opts, "tokens", false))
+    gene_llm_free_completion(addr completion)
     {.cast(gcsafe).}:
       release(global_llm_op_lock)
-
-    let result_value = completion_to_value(completion)
-    gene_llm_free_completion(addr completion)
     result_value
 
-  # Context for streaming callback
-  type StreamCallbackContext = object
-    vm: ptr VirtualMachine
-    callback: Value
-    cancelled: bool
-    utf8_buffer: string  # Buffer for incomplete UTF-8 sequences
+  proc expect_prefix(args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool, context: string): (SessionState, string) =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, context & " requires self and a prefix string")
+    let session_state = expect_session(get_positional_arg(args, 0, has_keyword_args), context)
+    ensure_session_open(session_state)
+    let prefix_val = get_positional_arg(args, 1, has_keyword_args)
+    if prefix_val.kind != VkString:
+      raise new_exception(types.Exception, context & " prefix must be a string")
+    (session_state, prefix_val.str)
+
+  # Prefills the prefix and snapshots the KV cache; returns the snapshot key.
+  proc vm_session_save_state(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let (session_state, prefix) = expect_prefix(args, arg_count, has_keyword_args, "Session.save_state")
+    var key: array[32, char]
+    var err: GeneLlmError
+    # Serialize llama.cpp operations - not thread-safe
+    {.cast(gcsafe).}:
+      acquire(global_llm_op_lock)
+    let status = gene_llm_session_save_state(session_state.handle, prefix.cstring, cast[cstring](addr key[0]), csize_t(key.len), addr err)
+    {.cast(gcsafe).}:
+      release(global_llm_op_lock)
+    if status != glsOk:
+      raise_backend_error(err)
+    ($cast[cstring](addr key[0])).to_value()
+
+  # Restores a snapshot saved for the same prefix; returns false on a miss.
+  proc vm_session_load_state(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let (session_state, prefix) = expect_prefix(args, arg_count, has_keyword_args, "Session.load_state")
+    var loaded = false
+    var err: GeneLlmError
+    # Serialize llama.cpp operations - not thread-safe
+    {.cast(gcsafe).}:
+      acquire(global_llm_op_lock)
+    let status = gene_llm_session_load_state(session_state.handle, prefix.cstring, addr loaded, addr err)
+    {.cast(gcsafe).}:
+      release(global_llm_op_lock)
+    if status != glsOk:
+      raise_backend_error(err)
+    loaded.to_value()
 
   # Find the boundary of complete UTF-8 characters in a byte sequence
   # Returns the number of bytes that form complete UTF-8 characters
@@ -966,44 +2341,75 @@ else:
     # All continuation bytes with no lead - return all
     return data.len
 
-  # C callback that invokes the Gene callback
-  proc stream_token_callback(token: cstring, token_len: cint, user_data: pointer): cint {.cdecl.} =
-    if user_data == nil:
-      return 0
-    let ctx = cast[ptr StreamCallbackContext](user_data)
-    if ctx.cancelled:
-      return 1
-
-    # Append new bytes to buffer
-    if token_len > 0:
-      var bytes = newString(token_len)
-      copyMem(addr bytes[0], token, token_len)
-      ctx.utf8_buffer.add(bytes)
-
-    # Find boundary of complete UTF-8 characters
-    let boundary = find_utf8_boundary(ctx.utf8_buffer)
-    if boundary == 0:
-      # No complete characters yet, wait for more
-      return 0
+  const DefaultStreamFlushMs = 20
 
-    # Extract complete characters to send
-    let complete_str = ctx.utf8_buffer[0..<boundary]
-    ctx.utf8_buffer = ctx.utf8_buffer[boundary..^1]
+  proc stream_options(opts: Value): GeneLlmStreamOptions =
+    GeneLlmStreamOptions(
+      flush_bytes: cint(get_int_option(opts, "flush_bytes", 0)),
+      flush_ms: cint(get_int_option(opts, "flush_ms", 0)),
+    )
 
-    let token_value = complete_str.to_value()
+  proc new_stream(opts: Value): ptr GeneLlmStream =
+    var stream_opts = stream_options(opts)
+    var err: GeneLlmError
+    if gene_llm_new_stream(addr stream_opts, addr result, addr err) != glsOk:
+      raise_backend_error(err)
+
+  # Appends everything the worker has written so far to buffer.
+  proc read_stream(stream: ptr GeneLlmStream, buffer: var string) =
+    var chunk: array[4096, char]
+    while true:
+      let n = int(gene_llm_stream_read(stream, addr chunk[0], csize_t(chunk.len)))
+      if n > 0:
+        let start = buffer.len
+        buffer.setLen(start + n)
+        copyMem(addr buffer[start], addr chunk[0], n)
+      if n < chunk.len:
+        break
+
+  # Removes and returns the complete UTF-8 characters at the front of buffer.
+  proc take_utf8_chunk(buffer: var string): string =
+    let boundary = find_utf8_boundary(buffer)
+    if boundary == 0:
+      return ""
+    result = buffer[0 ..< boundary]
+    buffer = buffer[boundary .. ^1]
+
+  proc wait_readable(fd: cint, timeout_ms: int) =
+    when defined(posix):
+      if fd >= 0:
+        var pfd = TPollfd(fd: fd, events: POLLIN)
+        discard poll(addr pfd, 1, cint(timeout_ms))
+        return
+    sleep(timeout_ms)
+
+  proc event_text(event: GeneLlmEvent): string =
+    result = newString(int(event.text_len))
+    if event.text_len > 0:
+      copyMem(addr result[0], event.text, int(event.text_len))
+
+  # Returns false when the callback raised.
+  proc call_stream_callback(vm: ptr VirtualMachine, callback: Value, text: string): bool =
+    let token_value = text.to_value()
     {.cast(gcsafe).}:
       try:
-        case ctx.callback.kind
+        case callback.kind
         of VkFunction:
-          discard ctx.vm.exec_function(ctx.callback, @[token_value])
+          discard vm.exec_function(callback, @[token_value])
         of VkNativeFn:
-          discard call_native_fn(ctx.callback.ref.native_fn, ctx.vm, [token_value])
+          discard call_native_fn(callback.ref.native_fn, vm, [token_value])
         else:
-          discard ctx.vm.exec_callable(ctx.callback, @[token_value])
+          discard vm.exec_callable(callback, @[token_value])
+        true
       except:
-        ctx.cancelled = true
-        return 1
-    return 0
+        false
+
+  # infer_streaming runs the request on a per-thread async queue: the shim
+  # worker decodes into the stream's ring while this thread sleeps on the
+  # queue's fd and hands the callback coalesced chunks, so a slow callback no
+  # longer slows down decoding.
+  var llm_stream_queue {.threadvar.}: ptr GeneLlmAsyncQueue
+  var llm_stream_active {.threadvar.}: bool
 
   proc vm_session_infer_streaming(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
     let positional = get_positional_count(arg_count, has_keyword_args)
@@ -1014,9 +2420,7 @@ else:
     let session_state = expect_session(self_val, "Session.infer_streaming")
     ensure_session_open(session_state)
 
-    let prompt_val = get_positional_arg(args, 1, has_keyword_args)
-    if prompt_val.kind != VkString:
-      raise new_exception(types.Exception, "Session.infer_streaming prompt must be a string")
+    var prompt = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Session.infer_streaming")
 
     let callback_val = get_positional_arg(args, 2, has_keyword_args)
     if callback_val.kind notin {VkFunction, VkNativeFn, VkBlock, VkBoundMethod, VkNativeMethod}:
@@ -1027,63 +2431,369 @@ else:
         expect_map(get_positional_arg(args, 3, has_keyword_args), "infer_streaming")
       else:
         NIL
+    if llm_stream_active:
+      raise new_exception(types.Exception, "Session.infer_streaming cannot be called from its own callback")
 
-    if has_option(opts, "timeout") or has_option(opts, "timeout_ms"):
-      raise new_exception(types.Exception, "Session.infer_streaming timeout is not supported for local inference yet")
+    var infer_opts = session_infer_options(session_state, prompt.text.cstring, opts)
+    attach_prompt_tokens(infer_opts, prompt.tokens)
+    var grammar = llm_grammar_option(opts)
+    attach_grammar(infer_opts, grammar)
 
-    var infer_opts = GeneLlmInferOptions(
-      prompt: prompt_val.str.cstring,
-      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", session_state.max_tokens))),
-      temperature: get_float_option(opts, "temperature", session_state.temperature).cfloat,
-      top_p: get_float_option(opts, "top_p", session_state.top_p).cfloat,
-      top_k: cint(max(1, get_int_option(opts, "top_k", session_state.top_k))),
-      seed: cint(get_int_option(opts, "seed", session_state.seed))
+    var err: GeneLlmError
+    if llm_stream_queue == nil:
+      if gene_llm_new_async_queue(addr llm_stream_queue, addr err) != glsOk:
+        raise_backend_error(err)
+    let stream = new_stream(opts)
+    var request_id: int64
+    # The worker serializes on the session, so the op lock is not held here.
+    if gene_llm_infer_async_stream(llm_stream_queue, session_state.handle, addr infer_opts, stream,
+                                   addr request_id, addr err) != glsOk:
+      gene_llm_free_stream(stream)
+      raise_backend_error(err)
+    session_state.pending_requests.inc()
+    llm_stream_active = true
+
+    let fd = gene_llm_async_fd(llm_stream_queue)
+    let wait_ms = max(1, get_int_option(opts, "flush_ms", DefaultStreamFlushMs))
+    let want_tokens = get_bool_option(opts, "tokens", false)
+    var events: array[4, GeneLlmEvent]
+    var buffer = ""
+    var delivering = true
+    var finished = false
+    var failure = ""
+    var result_value = NIL
+
+    # Waits for the next wakeup and records the request's DONE or ERROR.
+    proc poll_request() =
+      wait_readable(fd, wait_ms)
+      let count = int(gene_llm_async_drain(llm_stream_queue, addr events[0], cint(events.len)))
+      for i in 0 ..< count:
+        if events[i].request_id != request_id:
+          continue
+        case events[i].kind
+        of gleDone:
+          # The completion points into the session's arena; copy it out now.
+          result_value = completion_to_value(events[i].completion, want_tokens)
+          finished = true
+        of gleError:
+          failure = event_text(events[i])
+          finished = true
+        of gleToken:
+          discard
+
+    try:
+      while not finished:
+        poll_request()
+        # Everything is in the ring by the time DONE is queued.
+        read_stream(stream, buffer)
+        if delivering:
+          let chunk = if finished: move(buffer) else: take_utf8_chunk(buffer)
+          if chunk.len > 0 and not call_stream_callback(vm, callback_val, chunk):
+            # A failing callback stops generation, as before.
+            delivering = false
+            gene_llm_stream_cancel(stream)
+    finally:
+      if not finished:
+        gene_llm_stream_cancel(stream)
+        while not finished:
+          poll_request()
+      llm_stream_active = false
+      session_state.pending_requests.dec()
+      gene_llm_free_stream(stream)
+
+    if failure.len > 0:
+      raise new_exception(types.Exception, failure)
+    result_value
+
+  proc vm_model_embed(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Model.embed requires self and a string or an array of strings")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let model_state = expect_model(self_val, "Model.embed")
+    ensure_model_open(model_state)
+
+    let texts = embed_inputs(get_positional_arg(args, 1, has_keyword_args), "Model.embed")
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "embed")
+      else:
+        NIL
+
+    var embed_opts = GeneLlmEmbedOptions(
+      pooling: pooling_option(opts),
+      normalize: get_bool_option(opts, "normalize", true),
+      batch_size: cint(max(0, get_int_option(opts, "batch", 0))),
+      threads: cint(max(0, get_int_option(opts, "threads", model_state.threads)))
     )
 
-    var ctx = StreamCallbackContext(
-      vm: vm,
-      callback: callback_val,
-      cancelled: false,
-      utf8_buffer: ""
+    let dim = int(gene_llm_embedding_dim(model_state.handle))
+    if dim <= 0:
+      raise new_exception(types.Exception, "Model.embed: model has no embedding dimension")
+    # The shim writes straight into the Bytes payload; no per-float boxing.
+    let data = new_ref(VkBytes)
+    data.bytes_data = newSeq[uint8](texts.len * dim * sizeof(cfloat))
+    if data.bytes_data.len > 0:
+      var text_ptrs = newSeq[cstring](texts.len)
+      for i in 0..<texts.len:
+        text_ptrs[i] = texts[i].cstring
+
+      var err: GeneLlmError
+      # Serialize llama.cpp operations - not thread-safe
+      {.cast(gcsafe).}:
+        acquire(global_llm_op_lock)
+      let status = gene_llm_embed_batch(model_state.handle, addr text_ptrs[0], cint(texts.len),
+        addr embed_opts, cast[ptr cfloat](addr data.bytes_data[0]), csize_t(texts.len * dim), addr err)
+      {.cast(gcsafe).}:
+        release(global_llm_op_lock)
+      if status != glsOk:
+        raise_backend_error(err)
+
+    embedding_value(dim, texts.len, data.to_ref_value())
+
+  # Tokenizer calls only read the vocabulary and the shim's cache has its own
+  # lock, so they skip global_llm_op_lock and never wait behind inference.
+  proc vm_model_tokenize(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Model.tokenize requires self and a string")
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.tokenize")
+    ensure_model_open(model_state)
+    let text_val = get_positional_arg(args, 1, has_keyword_args)
+    if text_val.kind != VkString:
+      raise new_exception(types.Exception, "Model.tokenize requires a string")
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "tokenize")
+      else:
+        NIL
+    let add_special = get_bool_option(opts, "add_special", true)
+    let text = text_val.str
+
+    # Sized for one token per byte; a second call only happens when the
+    # guess is short, and then it is served from the cache.
+    var tokens = newSeq[int32](text.len + 4)
+    var count: cint
+    var err: GeneLlmError
+    if gene_llm_tokenize(model_state.handle, text.cstring, csize_t(text.len), add_special,
+        addr tokens[0], cint(tokens.len), addr count, addr err) != glsOk:
+      raise_backend_error(err)
+    if int(count) > tokens.len:
+      tokens.setLen(int(count))
+      if gene_llm_tokenize(model_state.handle, text.cstring, csize_t(text.len), add_special,
+          addr tokens[0], cint(tokens.len), addr count, addr err) != glsOk:
+        raise_backend_error(err)
+    tokens.setLen(int(count))
+    llm_token_ids_value(tokens)
+
+  proc vm_model_detokenize(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Model.detokenize requires self and an array of token ids")
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.detokenize")
+    ensure_model_open(model_state)
+    var input = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Model.detokenize")
+    if input.tokens.len == 0:
+      raise new_exception(types.Exception, "Model.detokenize requires an array of token ids")
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "detokenize")
+      else:
+        NIL
+    let remove_special = get_bool_option(opts, "remove_special", false)
+
+    var text = newString(input.tokens.len * 8)
+    var text_len: csize_t
+    var err: GeneLlmError
+    if gene_llm_detokenize(model_state.handle, addr input.tokens[0], cint(input.tokens.len), remove_special,
+        text.cstring, csize_t(text.len + 1), addr text_len, addr err) != glsOk:
+      raise_backend_error(err)
+    if int(text_len) > text.len:
+      text.setLen(int(text_len))
+      if gene_llm_detokenize(model_state.handle, addr input.tokens[0], cint(input.tokens.len), remove_special,
+          text.cstring, csize_t(text.len + 1), addr text_len, addr err) != glsOk:
+        raise_backend_error(err)
+    text.setLen(int(text_len))
+    text.to_value()
+
+  proc vm_model_count_tokens(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Model.count_tokens requires self and a string or an array of strings")
+    let model_state = expect_model(get_positional_arg(args, 0, has_keyword_args), "Model.count_tokens")
+    ensure_model_open(model_state)
+    let input_val = get_positional_arg(args, 1, has_keyword_args)
+    let texts = embed_inputs(input_val, "Model.count_tokens")
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "count_tokens")
+      else:
+        NIL
+
+    var counts = newSeq[int32](texts.len)
+    if texts.len > 0:
+      var text_ptrs = newSeq[cstring](texts.len)
+      for i in 0..<texts.len:
+        text_ptrs[i] = texts[i].cstring
+      var err: GeneLlmError
+      if gene_llm_count_tokens_batch(model_state.handle, addr text_ptrs[0], cint(texts.len),
+          get_bool_option(opts, "add_special", true), addr counts[0], addr err) != glsOk:
+        raise_backend_error(err)
+    llm_token_counts_value(input_val, counts)
+
+  proc vm_model_new_engine(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 1:
+      raise new_exception(types.Exception, "Model.new_engine requires self")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let model_state = expect_model(self_val, "Model.new_engine")
+    ensure_model_open(model_state)
+
+    let opts =
+      if positional >= 2:
+        expect_map(get_positional_arg(args, 1, has_keyword_args), "new_engine")
+      else:
+        NIL
+
+    var engine_opts = GeneLlmEngineOptions(
+      context_length: cint(get_int_option(opts, "context", model_state.context_len)),
+      batch_size: cint(max(1, get_int_option(opts, "batch", 512))),
+      threads: cint(max(0, get_int_option(opts, "threads", model_state.threads))),
+      max_sequences: cint(max(1, get_int_option(opts, "max_sequences", 4))),
+      seed: cint(get_int_option(opts, "seed", 42)),
+      temperature: get_float_option(opts, "temperature", 0.7).cfloat,
+      top_p: get_float_option(opts, "top_p", 0.9).cfloat,
+      top_k: cint(get_int_option(opts, "top_k", 40)),
+      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", 256)))
     )
 
-    var completion: GeneLlmCompletion
     var err: GeneLlmError
-    # Serialize llama.cpp operations - not thread-safe
+    var handle: ptr GeneLlmEngine
+    # Context creation goes through the shared lock; the engine decodes on its own thread afterwards
     {.cast(gcsafe).}:
       acquire(global_llm_op_lock)
-    try:
-      let status = gene_llm_infer_streaming(session_state.handle, addr infer_opts, stream_token_callback, addr ctx, addr completion, addr err)
-      if status != glsOk:
-        {.cast(gcsafe).}:
-          release(global_llm_op_lock)
-        raise_backend_error(err)
-    except:
-      {.cast(gcsafe).}:
-        release(global_llm_op_lock)
-      raise
+    let status = gene_llm_new_engine(model_state.handle, addr engine_opts, addr handle, addr err)
     {.cast(gcsafe).}:
       release(global_llm_op_lock)
+    if status != glsOk or handle == nil:
+      raise_backend_error(err)
 
-    # Flush any remaining buffered UTF-8 content
-    if ctx.utf8_buffer.len > 0 and not ctx.cancelled:
-      let token_value = ctx.utf8_buffer.to_value()
-      {.cast(gcsafe).}:
-        try:
-          case ctx.callback.kind
-          of VkFunction:
-            discard vm.exec_function(ctx.callback, @[token_value])
-          of VkNativeFn:
-            discard call_native_fn(ctx.callback.ref.native_fn, vm, [token_value])
-          else:
-            discard vm.exec_callable(ctx.callback, @[token_value])
-        except:
-          discard  # Ignore errors during final flush
+    let engine_state = EngineState(
+      model: model_state,
+      handle: handle,
+      temperature: float(engine_opts.temperature),
+      top_p: float(engine_opts.top_p),
+      top_k: int(engine_opts.top_k),
+      seed: int(engine_opts.seed),
+      max_tokens: int(engine_opts.max_tokens)
+    )
+    model_state.open_sessions.inc()
+    track_engine(engine_state)
+    new_engine_value(engine_state)
+
+  proc vm_engine_submit(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Engine.submit requires self and a prompt string")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let engine_state = expect_engine(self_val, "Engine.submit")
+    ensure_engine_open(engine_state)
+
+    var prompt = llm_prompt_input(get_positional_arg(args, 1, has_keyword_args), "Engine.submit")
+
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "submit")
+      else:
+        NIL
+
+    var infer_opts = GeneLlmInferOptions(
+      prompt: prompt.text.cstring,
+      max_tokens: cint(max(1, get_int_option(opts, "max_tokens", engine_state.max_tokens))),
+      temperature: get_float_option(opts, "temperature", engine_state.temperature).cfloat,
+      top_p: get_float_option(opts, "top_p", engine_state.top_p).cfloat,
+      top_k: cint(max(1, get_int_option(opts, "top_k", engine_state.top_k))),
+      seed: cint(get_int_option(opts, "seed", engine_state.seed)),
+      timeout_ms: cint(timeout_option_ms(opts))
+    )
+    attach_prompt_tokens(infer_opts, prompt.tokens)
+    var grammar = llm_grammar_option(opts)
+    attach_grammar(infer_opts, grammar)
+
+    var err: GeneLlmError
+    var request_id: int64
+    if gene_llm_submit(engine_state.handle, addr infer_opts, addr request_id, addr err) != glsOk:
+      raise_backend_error(err)
+    request_id.to_value()
+
+  # Returns the completion map once the request finishes, NIL while it is still running.
+  proc vm_engine_poll(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Engine.poll requires self and a request id")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let engine_state = expect_engine(self_val, "Engine.poll")
+    ensure_engine_open(engine_state)
 
-    let result_value = completion_to_value(completion)
+    let id_val = get_positional_arg(args, 1, has_keyword_args)
+    if id_val.kind != VkInt:
+      raise new_exception(types.Exception, "Engine.poll request id must be an int")
+
+    let opts =
+      if positional >= 3:
+        expect_map(get_positional_arg(args, 2, has_keyword_args), "poll")
+      else:
+        NIL
+    let timeout_ms = max(0, get_int_option(opts, "timeout_ms", 0))
+
+    var completion: GeneLlmCompletion
+    var err: GeneLlmError
+    let status = gene_llm_poll(engine_state.handle, id_val.to_int(), cint(timeout_ms), addr completion, addr err)
+    case status
+    of glsPending:
+      return NIL
+    of glsError:
+      raise_backend_error(err)
+    of glsOk:
+      discard
+
+    let result_value = completion_to_value(completion, get_bool_option(opts, "tokens", false))
     gene_llm_free_completion(addr completion)
     result_value
 
+  proc vm_engine_cancel(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 2:
+      raise new_exception(types.Exception, "Engine.cancel requires self and a request id")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let engine_state = expect_engine(self_val, "Engine.cancel")
+    ensure_engine_open(engine_state)
+
+    let id_val = get_positional_arg(args, 1, has_keyword_args)
+    if id_val.kind != VkInt:
+      raise new_exception(types.Exception, "Engine.cancel request id must be an int")
+
+    var err: GeneLlmError
+    if gene_llm_cancel(engine_state.handle, id_val.to_int(), addr err) != glsOk:
+      raise_backend_error(err)
+    NIL
+
+  proc vm_engine_close(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let positional = get_positional_count(arg_count, has_keyword_args)
+    if positional < 1:
+      raise new_exception(types.Exception, "Engine.close requires self")
+
+    let self_val = get_positional_arg(args, 0, has_keyword_args)
+    let state = expect_engine(self_val, "Engine.close")
+    ensure_engine_open(state)
+    cleanup_engine(state)
+    NIL
+
   # Register a model globally for cross-thread access
   proc vm_register_model(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
     let positional = get_positional_count(arg_count, has_keyword_args)
@@ -1106,7 +2816,189 @@ else:
       release(global_model_lock)
       model_value
 
+  # Async host requests run on the shim's worker thread. Their events are
+  # drained into llm_host_events whenever the host asks for the next one.
+  type LlmAsyncRequest = object
+    session: SessionState
+    want_tokens: bool
+    stream: ptr GeneLlmStream  # nil unless the host wants token events
+    utf8_buffer: string  # read from the stream, not yet sent as a token event
+
+  var llm_async_queue {.global.}: ptr GeneLlmAsyncQueue = nil
+  var llm_async_requests {.global.}: Table[system.int64, LlmAsyncRequest] = initTable[system.int64, LlmAsyncRequest]()
+
+  proc ensure_async_queue(): ptr GeneLlmAsyncQueue =
+    if llm_async_queue == nil:
+      var err: GeneLlmError
+      if gene_llm_new_async_queue(addr llm_async_queue, addr err) != glsOk:
+        raise_backend_error(err)
+    llm_async_queue
+
+  proc llm_async_submit(session: Value, prompt: string, options: Value, stream: bool): system.int64 =
+    let session_state = expect_session(session, "Session.infer_async")
+    ensure_session_open(session_state)
+    let opts =
+      if options != NIL:
+        expect_map(options, "infer_async")
+      else:
+        NIL
+    if llm_branch_option(opts, "Session.infer_async") > 1:
+      raise new_exception(types.Exception, "Session.infer_async does not support ^n; use infer")
+    var infer_opts = session_infer_options(session_state, prompt.cstring, opts)
+    var grammar = llm_grammar_option(opts)
+    attach_grammar(infer_opts, grammar)
+    var request_id: int64
+    var err: GeneLlmError
+    # Only queues the request (the shim copies the prompt), so the op lock is
+    # not needed; the worker serializes on the session itself. Streamed tokens
+    # go through a ring and reach the host as coalesced chunks.
+    let token_stream = if stream: new_stream(opts) else: nil
+    let status =
+      if token_stream != nil:
+        gene_llm_infer_async_stream(ensure_async_queue(), session_state.handle, addr infer_opts, token_stream,
+                                    addr request_id, addr err)
+      else:
+        gene_llm_infer_async(ensure_async_queue(), session_state.handle, addr infer_opts, false,
+                             addr request_id, addr err)
+    if status != glsOk:
+      if token_stream != nil:
+        gene_llm_free_stream(token_stream)
+      raise_backend_error(err)
+    session_state.pending_requests.inc()
+    llm_async_requests[request_id] = LlmAsyncRequest(
+      session: session_state,
+      want_tokens: get_bool_option(opts, "tokens", false),
+      stream: token_stream
+    )
+    request_id
+
+  proc llm_async_event_fd(): int32 =
+    try:
+      int32(gene_llm_async_fd(ensure_async_queue()))
+    except CatchableError:
+      -1
+
+  proc llm_async_collect() =
+    if llm_async_queue == nil:
+      return
+    var events: array[32, GeneLlmEvent]
+    while true:
+      let count = int(gene_llm_async_drain(llm_async_queue, addr events[0], cint(events.len)))
+      for i in 0 ..< count:
+        let id = system.int64(events[i].request_id)
+        if not llm_async_requests.hasKey(id):
+          continue
+        case events[i].kind
+        of gleToken:
+          discard
+        of gleDone, gleError:
+          var request = llm_async_requests[id]
+          llm_async_requests.del(id)
+          request.session.pending_requests.dec()
+          if request.stream != nil:
+            read_stream(request.stream, request.utf8_buffer)
+            gene_llm_free_stream(request.stream)
+          if request.utf8_buffer.len > 0:
+            llm_host_events.addLast(LlmHostEvent(request_id: id, kind: GlheToken, payload: request.utf8_buffer))
+          if events[i].kind == gleDone:
+            let reply = completion_to_value(events[i].completion, request.want_tokens)
+            llm_host_events.addLast(LlmHostEvent(request_id: id, kind: GlheDone,
+                                                 payload: serialize_bridge_payload(reply)))
+          else:
+            llm_host_events.addLast(LlmHostEvent(request_id: id, kind: GlheError, payload: event_text(events[i])))
+      if count < events.len:
+        break
+    # One coalesced token event per stream and wakeup, holding back split
+    # multi-byte characters until the rest arrives.
+    for id, request in llm_async_requests.mpairs:
+      if request.stream == nil:
+        continue
+      read_stream(request.stream, request.utf8_buffer)
+      let chunk = take_utf8_chunk(request.utf8_buffer)
+      if chunk.len > 0:
+        llm_host_events.addLast(LlmHostEvent(request_id: id, kind: GlheToken, payload: chunk))
+
+  proc llm_async_cancel(request_id: system.int64) =
+    if llm_async_queue == nil:
+      return
+    var err: GeneLlmError
+    if gene_llm_async_cancel(llm_async_queue, request_id, addr err) != glsOk:
+      raise_backend_error(err)
+
+  proc vm_llm_stats(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    var stats: GeneLlmStats
+    gene_llm_get_stats(addr stats)
+    llm_stats_value(LlmStatsSnapshot(
+      requests: stats.requests,
+      failed_requests: stats.failed_requests,
+      cancelled_requests: stats.cancelled_requests,
+      prompt_tokens: stats.prompt_tokens,
+      cached_tokens: stats.cached_tokens,
+      generated_tokens: stats.generated_tokens,
+      prefill_ms: float(stats.prefill_ms),
+      decode_ms: float(stats.decode_ms),
+      models: stats.models,
+      sessions: stats.sessions,
+      engines: stats.engines
+    ))
+
+  proc vm_llm_reset_stats(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    gene_llm_reset_stats()
+    NIL
+
+  proc vm_llm_configure(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    let opts =
+      if get_positional_count(arg_count, has_keyword_args) >= 1:
+        expect_map(get_positional_arg(args, 0, has_keyword_args), "configure")
+      else:
+        NIL
+    ensure_backend()
+    let pool_config = llm_threadpool_config(opts)
+    if pool_config.given:
+      configure_threadpool(pool_config)
+    let budget = llm_memory_budget_option(opts)
+    if budget >= 0:
+      var registry_opts = GeneLlmRegistryOptions(memory_budget_bytes: csize_t(budget))
+      gene_llm_registry_configure(addr registry_opts)
+    for (path, entry_opts) in llm_preload_entries(opts):
+      {.cast(gcsafe).}:
+        acquire(global_llm_op_lock)
+      try:
+        preload_model(path, entry_opts)
+      finally:
+        {.cast(gcsafe).}:
+          release(global_llm_op_lock)
+    NIL
+
+  proc vm_llm_registry_stats(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int, has_keyword_args: bool): Value {.gcsafe.} =
+    var stats: GeneLlmRegistryStats
+    gene_llm_registry_get_stats(addr stats)
+    llm_registry_stats_value(LlmRegistrySnapshot(
+      loaded: int(stats.loaded),
+      in_use: int(stats.in_use),
+      resident_bytes: int64(stats.resident_bytes),
+      budget_bytes: int64(stats.budget_bytes),
+      hits: stats.hits,
+      misses: stats.misses,
+      evictions: stats.evictions
+    ))
+
   proc cleanup_llm_backend() {.noconv.} =
+    # Joins the worker first; it may still be running on a tracked session.
+    # Draining the final events releases each request's stream and session
+    # count.
+    if llm_async_queue != nil:
+      gene_llm_async_shutdown(llm_async_queue)
+      try:
+        llm_async_collect()
+      except CatchableError:
+        discard
+      gene_llm_free_async_queue(llm_async_queue)
+      llm_async_queue = nil
+    llm_async_requests.clear()
+    for state in tracked_engines:
+      cleanup_engine(state)
+    tracked_engines.setLen(0)
     for state in tracked_sessions:
       cleanup_session(state)
     tracked_sessions.setLen(0)
@@ -1134,6 +3026,11 @@ else:
         if App.app.object_class.kind == VkClass:
           model_class_global.parent = App.app.object_class.ref.class
         model_class_global.def_native_method("new_session", vm_model_new_session)
+        model_class_global.def_native_method("new_engine", vm_model_new_engine)
+        model_class_global.def_native_method("embed", vm_model_embed)
+        model_class_global.def_native_method("tokenize", vm_model_tokenize)
+        model_class_global.def_native_method("detokenize", vm_model_detokenize)
+        model_class_global.def_native_method("count_tokens", vm_model_count_tokens)
         model_class_global.def_native_method("close", vm_model_close)
         # Set global for cross-thread access
         global_model_class = model_class_global
@@ -1143,10 +3040,22 @@ else:
           session_class_global.parent = App.app.object_class.ref.class
         session_class_global.def_native_method("infer", vm_session_infer)
         session_class_global.def_native_method("infer_streaming", vm_session_infer_streaming)
+        session_class_global.def_native_method("save_state", vm_session_save_state)
+        session_class_global.def_native_method("load_state", vm_session_load_state)
         session_class_global.def_native_method("close", vm_session_close)
         # Set global for cross-thread access
         global_session_class = session_class_global
 
+        engine_class_global = new_class("Engine")
+        if App.app.object_class.kind == VkClass:
+          engine_class_global.parent = App.app.object_class.ref.class
+        engine_class_global.def_native_method("submit", vm_engine_submit)
+        engine_class_global.def_native_method("poll", vm_engine_poll)
+        engine_class_global.def_native_method("cancel", vm_engine_cancel)
+        engine_class_global.def_native_method("close", vm_engine_close)
+        # Set global for cross-thread access
+        global_engine_class = engine_class_global
+
         let llm_ns = new_ref(VkNamespace)
         llm_ns.ns = new_namespace("llm")
 
@@ -1162,6 +3071,22 @@ else:
         get_fn.native_fn = vm_get_model
         llm_ns.ns["get_model".to_key()] = get_fn.to_ref_value()
 
+        let stats_fn = new_ref(VkNativeFn)
+        stats_fn.native_fn = vm_llm_stats
+        llm_ns.ns["stats".to_key()] = stats_fn.to_ref_value()
+
+        let reset_stats_fn = new_ref(VkNativeFn)
+        reset_stats_fn.native_fn = vm_llm_reset_stats
+        llm_ns.ns["reset_stats".to_key()] = reset_stats_fn.to_ref_value()
+
+        let configure_fn = new_ref(VkNativeFn)
+        configure_fn.native_fn = vm_llm_configure
+        llm_ns.ns["configure".to_key()] = configure_fn.to_ref_value()
+
+        let registry_stats_fn = new_ref(VkNativeFn)
+        registry_stats_fn.native_fn = vm_llm_registry_stats
+        llm_ns.ns["registry_stats".to_key()] = registry_stats_fn.to_ref_value()
+
         let model_class_ref = new_ref(VkClass)
         model_class_ref.class = model_class_global
         llm_ns.ns["Model".to_key()] = model_class_ref.to_ref_value()
@@ -1170,6 +3095,10 @@ else:
         session_class_ref.class = session_class_global
         llm_ns.ns["Session".to_key()] = session_class_ref.to_ref_value()
 
+        let engine_class_ref = new_ref(VkClass)
+        engine_class_ref.class = engine_class_global
+        llm_ns.ns["Engine".to_key()] = engine_class_ref.to_ref_value()
+
         App.app.genex_ns.ref.ns["llm".to_key()] = llm_ns.to_ref_value()
 
   init_llm_module()
@@ -1222,13 +3151,26 @@ proc gene_llm_host_new_session*(model_id: int64, options_ser: cstring,
       llm_set_error(out_error, "LLM model handle is no longer valid")
       return int32(GlhsErr)
     let options = llm_parse_options(options_ser)
+    # The host sends a ^draft Model as its handle id.
+    if options != NIL and map_data(options).hasKey("draft".to_key()):
+      let draft_val = map_data(options)["draft".to_key()]
+      let draft =
+        if draft_val.kind == VkInt:
+          llm_backend_model_handles.getOrDefault(draft_val.to_int(), NIL)
+        else:
+          NIL
+      if draft == NIL:
+        llm_set_error(out_error, "LLM draft model handle is no longer valid")
+        return int32(GlhsErr)
+      map_data(options)["draft".to_key()] = draft
     var args = @[model]
     if options != NIL:
       args.add(options)
     let session = call_native_fn(vm_model_new_session, llm_host_vm(), args)
     let id = llm_backend_next_session_id
     llm_backend_next_session_id.inc()
-    llm_backend_session_handles[id] = session
+    withLock llm_backend_session_lock:
+      llm_backend_session_handles[id] = session
     if out_session_id != nil:
       out_session_id[] = id
     int32(GlhsOk)
@@ -1248,7 +3190,7 @@ proc gene_llm_host_infer*(session_id: int64, prompt: cstring, options_ser: cstri
     if prompt == nil:
       llm_set_error(out_error, "Session.infer prompt must be a string")
       return int32(GlhsErr)
-    let session = llm_backend_session_handles.getOrDefault(session_id, NIL)
+    let session = llm_session_handle(session_id)
     if session == NIL:
       llm_set_error(out_error, "LLM session handle is no longer valid")
       return int32(GlhsErr)
@@ -1264,6 +3206,89 @@ proc gene_llm_host_infer*(session_id: int64, prompt: cstring, options_ser: cstri
     llm_set_error(out_error, exc.msg)
     int32(GlhsErr)
 
+# Methods the host bridge may forward by name; everything else is rejected.
+proc llm_host_method(target: int32, name: string): NativeFn =
+  if target == int32(GlhtModel):
+    case name
+    of "embed":
+      return vm_model_embed
+    of "new_engine":
+      return vm_model_new_engine
+    of "tokenize":
+      return vm_model_tokenize
+    of "detokenize":
+      return vm_model_detokenize
+    of "count_tokens":
+      return vm_model_count_tokens
+    else:
+      discard
+  elif target == int32(GlhtSession):
+    case name
+    of "save_state":
+      return vm_session_save_state
+    of "load_state":
+      return vm_session_load_state
+    else:
+      discard
+  elif target == int32(GlhtEngine):
+    case name
+    of "submit":
+      return vm_engine_submit
+    of "poll":
+      return vm_engine_poll
+    of "cancel":
+      return vm_engine_cancel
+    of "close":
+      return vm_engine_close
+    else:
+      discard
+  nil
+
+proc gene_llm_host_call_method*(target: int32, target_id: int64, method_name: cstring, args_ser: cstring,
+                                out_result_ser: ptr cstring, out_error: ptr cstring): int32 {.cdecl, exportc, dynlib.} =
+  if not llm_extension_host_ready:
+    llm_set_error(out_error, "LLM host bridge is not initialized")
+    return int32(GlhsErr)
+  try:
+    llm_clear_error(out_error)
+    if out_result_ser != nil:
+      out_result_ser[] = nil
+    let name = if method_name == nil: "" else: $method_name
+    let fn = llm_host_method(target, name)
+    if fn == nil:
+      llm_set_error(out_error, "Unsupported LLM method: " & name)
+      return int32(GlhsErr)
+    let self_val =
+      if target == int32(GlhtModel):
+        llm_backend_model_handles.getOrDefault(target_id, NIL)
+      elif target == int32(GlhtEngine):
+        llm_backend_engine_handles.getOrDefault(target_id, NIL)
+      else:
+        llm_session_handle(target_id)
+    if self_val == NIL:
+      llm_set_error(out_error, "LLM handle is no longer valid")
+      return int32(GlhsErr)
+    var args = @[self_val]
+    let extra = llm_parse_options(args_ser)
+    if extra.kind == VkArray:
+      for item in array_data(extra):
+        args.add(item)
+    var reply = call_native_fn(fn, llm_host_vm(), args)
+    # Engines stay on this side of the bridge; the host only sees their id.
+    if target == int32(GlhtModel) and name == "new_engine":
+      let id = llm_backend_next_engine_id
+      llm_backend_next_engine_id.inc()
+      llm_backend_engine_handles[id] = reply
+      reply = new_map_value({"engine_id".to_key(): id.to_value()}.toTable())
+    elif target == int32(GlhtEngine) and name == "close":
+      llm_backend_engine_handles.del(target_id)
+    if out_result_ser != nil:
+      out_result_ser[] = llm_serialize_reply(reply)
+    int32(GlhsOk)
+  except CatchableError as exc:
+    llm_set_error(out_error, exc.msg)
+    int32(GlhsErr)
+
 proc gene_llm_host_close_model*(model_id: int64, out_error: ptr cstring): int32 {.cdecl, exportc, dynlib.} =
   if not llm_extension_host_ready:
     llm_set_error(out_error, "LLM host bridge is not initialized")
@@ -1287,12 +3312,72 @@ proc gene_llm_host_close_session*(session_id: int64, out_error: ptr cstring): in
     return int32(GlhsErr)
   try:
     llm_clear_error(out_error)
-    let session = llm_backend_session_handles.getOrDefault(session_id, NIL)
+    let session = llm_session_handle(session_id)
     if session == NIL:
       llm_set_error(out_error, "LLM session handle is no longer valid")
       return int32(GlhsErr)
     discard call_native_fn(vm_session_close, llm_host_vm(), @[session])
-    llm_backend_session_handles.del(session_id)
+    withLock llm_backend_session_lock:
+      llm_backend_session_handles.del(session_id)
+    int32(GlhsOk)
+  except CatchableError as exc:
+    llm_set_error(out_error, exc.msg)
+    int32(GlhsErr)
+
+proc gene_llm_host_infer_async*(session_id: int64, prompt: cstring, options_ser: cstring, stream: int32,
+                                out_request_id: ptr int64, out_error: ptr cstring): int32 {.cdecl, exportc, dynlib.} =
+  if not llm_extension_host_ready:
+    llm_set_error(out_error, "LLM host bridge is not initialized")
+    return int32(GlhsErr)
+  try:
+    llm_clear_error(out_error)
+    if prompt == nil:
+      llm_set_error(out_error, "Session.infer prompt must be a string")
+      return int32(GlhsErr)
+    let session = llm_session_handle(session_id)
+    if session == NIL:
+      llm_set_error(out_error, "LLM session handle is no longer valid")
+      return int32(GlhsErr)
+    let id = llm_async_submit(session, $prompt, llm_parse_options(options_ser), stream != 0)
+    if out_request_id != nil:
+      out_request_id[] = id
+    int32(GlhsOk)
+  except CatchableError as exc:
+    llm_set_error(out_error, exc.msg)
+    int32(GlhsErr)
+
+proc gene_llm_host_event_fd*(): int32 {.cdecl, exportc, dynlib.} =
+  if not llm_extension_host_ready:
+    return -1
+  llm_async_event_fd()
+
+proc gene_llm_host_next_event*(out_request_id: ptr int64, out_kind: ptr int32,
+                               out_payload: ptr cstring): int32 {.cdecl, exportc, dynlib.} =
+  if not llm_extension_host_ready:
+    return 0
+  if llm_host_events.len == 0:
+    try:
+      llm_async_collect()
+    except CatchableError:
+      return 0
+    if llm_host_events.len == 0:
+      return 0
+  let event = llm_host_events.popFirst()
+  if out_request_id != nil:
+    out_request_id[] = event.request_id
+  if out_kind != nil:
+    out_kind[] = int32(event.kind)
+  if out_payload != nil:
+    out_payload[] = llm_alloc_cstring_copy(event.payload)
+  1
+
+proc gene_llm_host_cancel*(request_id: int64, out_error: ptr cstring): int32 {.cdecl, exportc, dynlib.} =
+  if not llm_extension_host_ready:
+    llm_set_error(out_error, "LLM host bridge is not initialized")
+    return int32(GlhsErr)
+  try:
+    llm_clear_error(out_error)
+    llm_async_cancel(request_id)
     int32(GlhsOk)
   except CatchableError as exc:
     llm_set_error(out_error, exc.msg)
@@ -2,37 +2,347 @@
 
 #include "llama.h"
 
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <climits>
+#include <cstdlib>
 #include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <fstream>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+// Recent tokenizations of one model, most recently used first. Keys are the
+// text prefixed with the add_special flag; the cache is bounded by the bytes
+// of text and token ids it holds.
+struct gene_llm_token_cache {
+  using entry = std::pair<std::string, std::vector<llama_token>>;
+  std::mutex mutex;
+  std::list<entry> entries;
+  std::unordered_map<std::string, std::list<entry>::iterator> index;
+  size_t bytes = 0;
+};
+
+// One ggml threadpool shared by every context in the process, so sessions,
+// engines and embedding batches run on a fixed set of cores instead of each
+// spawning its own workers. Reconfiguring only affects contexts created
+// afterwards; older ones keep their pool alive through their owner's
+// reference.
+struct gene_llm_threadpool {
+  ggml_threadpool *pool = nullptr;
+  int threads = 0;
+  // A threadpool computes one graph at a time, so contexts attached to it
+  // take turns evaluating.
+  std::mutex compute_mutex;
+
+  ~gene_llm_threadpool() {
+    if (pool) {
+      ggml_threadpool_free(pool);
+    }
+  }
+};
+
+using threadpool_ref = std::shared_ptr<gene_llm_threadpool>;
+
+struct gene_llm_embed_context {
+  llama_context *ctx = nullptr;
+  threadpool_ref pool;
+  // Held while a batch is evaluated; the context keeps per-call state.
+  std::mutex mutex;
+};
+
+// Parsed grammars of one session or engine, keyed by kind and text, most
+// recently used first. Requests clone the cached sampler, which copies the
+// parsed rules instead of parsing the GBNF again.
+struct gene_llm_grammar_cache {
+  using entry = std::pair<std::string, llama_sampler *>;
+  std::mutex mutex;
+  std::list<entry> entries;
+  std::unordered_map<std::string, std::list<entry>::iterator> index;
+
+  ~gene_llm_grammar_cache() {
+    for (auto &e : entries) {
+      llama_sampler_free(e.second);
+    }
+  }
+};
+
 struct gene_llm_model {
   llama_model *model;
   const llama_vocab *vocab;
   int default_ctx;
+  // Identifies the weights in snapshot keys: path, size and mtime.
+  std::string fingerprint;
+  std::string state_cache_dir;
+  // Embedding contexts, created on first use and keyed by the options fixed
+  // at creation (pooling, batch size, threads). Guarded by embed_mutex.
+  std::mutex embed_mutex;
+  std::unordered_map<std::string, gene_llm_embed_context> embed_ctxs;
+  gene_llm_token_cache token_cache;
+  // Registry bookkeeping, guarded by the registry mutex. registry_key is
+  // empty for models loaded with gene_llm_load_model.
+  std::string registry_key;
+  int users = 0; // acquisitions plus open sessions and engines
+  uint64_t bytes = 0;
+  int64_t idle_since_us = 0;
+};
+
+// Backing storage for gene_llm_completion: generated text in one buffer plus
+// token ids and byte offsets. Reset (not freed) between requests so a warm
+// session generates without per-token allocations.
+struct gene_llm_completion_arena {
+  std::string text;
+  std::vector<int32_t> token_ids;
+  std::vector<int32_t> token_offsets = {0}; // token_ids.size() + 1 entries
+
+  void reset() {
+    text.clear();
+    token_ids.clear();
+    token_offsets.assign(1, 0);
+  }
+  int token_count() const { return static_cast<int>(token_ids.size()); }
 };
 
 struct gene_llm_session {
   gene_llm_model *model;
   llama_context *ctx;
+  threadpool_ref threadpool; // shared with draft_ctx
   int threads;
   int default_max_tokens;
   float default_temperature;
   float default_top_p;
   int default_top_k;
   uint32_t default_seed;
+  // Tokens resident in the KV cache for sequence 0, in position order. Lets
+  // the next request skip re-decoding the prefix it shares with this one.
+  std::vector<llama_token> cached_tokens;
+  // Held for the duration of a request so async and blocking calls on the
+  // same session never interleave.
+  std::mutex mutex;
+  // Holds the most recent completion returned for this session.
+  gene_llm_completion_arena arena;
+  // n-best sampling: sequences the context was created for, and one arena
+  // per branch of the most recent gene_llm_infer_n.
+  int max_branches = 1;
+  std::vector<gene_llm_completion_arena> branch_arenas;
+  gene_llm_grammar_cache grammars;
+  // Context shifting (see gene_llm_session_options).
+  bool context_shift = false;
+  int keep_tokens = 0;
+  // Speculative decoding: a draft model proposes draft_n tokens per step that
+  // the target verifies in one batch. draft_ctx is null when disabled.
+  gene_llm_model *draft_model = nullptr;
+  llama_context *draft_ctx = nullptr;
+  llama_sampler *draft_sampler = nullptr;
+  std::vector<llama_token> draft_cached;
+  int draft_n = 0;
+  llama_batch spec_batch = {};
+};
+
+// Per-request telemetry, filled in as the request progresses. Timestamps
+// are llama_time_us(); 0 means the phase has not been reached.
+struct gene_llm_request_timings {
+  int prompt_tokens = 0;
+  int cached_tokens = 0;
+  int64_t start_us = 0;
+  int64_t prefill_done_us = 0;
+  int64_t first_token_us = 0;
+  int64_t end_us = 0;
+  int kv_used = 0;
+  int kv_size = 0;
+};
+
+struct gene_llm_engine_request {
+  int64_t id;
+  std::vector<llama_token> prompt;
+  size_t n_prompt_decoded = 0;
+  int max_tokens = 0;
+  llama_sampler *sampler = nullptr;
+  llama_seq_id seq_id = -1;
+  llama_pos n_pos = 0;
+  llama_token pending_token = 0;  // sampled but not yet decoded
+  int32_t logits_index = -1;      // row in the current batch, -1 if none
+  bool cancel_requested = false;
+  bool done = false;
+  std::string error;
+  gene_llm_completion_arena output;
+  gene_llm_finish_reason finish_reason = GENE_LLM_FINISH_STOP;
+  int64_t start_us = 0;
+  int64_t deadline_us = 0;  // 0 = no deadline
+  int latency_ms = 0;
+  gene_llm_request_timings timings;
+};
+
+struct gene_llm_engine {
+  gene_llm_model *model;
+  llama_context *ctx;
+  threadpool_ref threadpool;
+  gene_llm_grammar_cache grammars;
+  int n_batch;
+  int n_ctx;
+  int default_max_tokens;
+  float default_temperature;
+  float default_top_p;
+  int default_top_k;
+  uint32_t default_seed;
+
+  // Guards everything below. The scheduler thread drops it while decoding;
+  // only it touches the per-request decode state of admitted requests.
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+  std::unordered_map<int64_t, std::unique_ptr<gene_llm_engine_request>>
+      requests;
+  std::deque<gene_llm_engine_request *> pending;
+  // Output of the last request returned by gene_llm_poll.
+  gene_llm_completion_arena poll_arena;
+  std::vector<gene_llm_engine_request *> active;
+  std::vector<llama_seq_id> free_seqs;
+  int64_t next_request_id = 1;
+  bool stopping = false;
+  std::thread worker;
+};
+
+// Token pieces of one streamed request. The decode thread appends to a
+// single-producer/single-consumer byte ring and never waits for the reader:
+// when the ring is full, pieces spill into a locked overflow string until
+// the reader catches up. The reader takes whatever is there in one go.
+struct gene_llm_stream {
+  std::vector<char> ring; // power-of-two size
+  size_t mask = 0;
+  std::atomic<uint64_t> head{0}; // bytes written, producer only
+  std::atomic<uint64_t> tail{0}; // bytes read, consumer only
+  // Overflow, in order after everything in the ring. While spilling is set
+  // the producer writes only here.
+  std::mutex spill_mutex;
+  std::string spill;
+  std::atomic<bool> spilling{false};
+  std::atomic<bool> cancelled{false};
+  // Set by the producer when it signals the queue, cleared by the reader
+  // before it reads, so there is at most one wakeup per read.
+  std::atomic<bool> wake_pending{false};
+  // Producer-side coalescing: the queue is signalled once flush_bytes have
+  // accumulated or flush_us have passed since the last signal. The worker
+  // checks as each piece arrives; the queue's flusher covers bytes left
+  // waiting through a slow decode step.
+  size_t flush_bytes = 0;
+  int64_t flush_us = 0;
+  std::atomic<size_t> unsignalled{0};
+  std::atomic<int64_t> last_signal_us{0};
+};
+
+struct gene_llm_async_job {
+  int64_t id;
+  gene_llm_session *session;
+  gene_llm_infer_options options;
+  std::string prompt;
+  std::string grammar;
+  std::vector<int32_t> prompt_tokens;
+  bool stream_tokens;
+  gene_llm_stream *stream = nullptr; // owned by the caller
+  std::atomic<bool> cancel_requested{false};
+  gene_llm_async_queue *queue;
+};
+
+struct gene_llm_async_event_record {
+  int64_t request_id;
+  gene_llm_event_kind kind;
+  std::string text; // token piece or error message
+  gene_llm_completion_arena arena;
+  // Everything but the arena views, which are re-pointed on drain.
+  gene_llm_completion summary{};
+};
+
+struct gene_llm_async_queue {
+  // Readable while events are queued: an eventfd on Linux, a pipe elsewhere
+  // on POSIX. read_fd == -1 means callers have to poll.
+  int read_fd = -1;
+  int write_fd = -1;
+  bool signalled = false;
+
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  // Wakes the flusher when a streamed job starts or the queue stops.
+  std::condition_variable flush_cv;
+  std::deque<std::unique_ptr<gene_llm_async_job>> jobs;
+  gene_llm_async_job *running = nullptr;
+  std::deque<gene_llm_async_event_record> events;
+  // Events handed out by the last gene_llm_async_drain.
+  std::vector<gene_llm_async_event_record> drained;
+  int64_t next_id = 1;
+  bool stopping = false;
+  std::thread worker;
+  std::thread flusher;
 };
 
 namespace {
 
+constexpr int kDefaultBatchSize = 512;
+constexpr int kDefaultEmbedBatchSize = 2048;
+constexpr int kMaxEmbedSequences = 64;
+constexpr int kDefaultDraftTokens = 4;
+constexpr size_t kDefaultStreamCapacity = 16u << 10;
+constexpr int kDefaultStreamFlushBytes = 256;
+constexpr int kDefaultStreamFlushMs = 20;
+constexpr int kMaxDraftVocabDelta = 128;
+// Bytes reserved per token before rendering; longer pieces are retried.
+constexpr int kPieceReserve = 32;
+
 std::once_flag g_backend_once;
 
+struct gene_llm_counters {
+  std::atomic<int64_t> requests{0};
+  std::atomic<int64_t> failed_requests{0};
+  std::atomic<int64_t> cancelled_requests{0};
+  std::atomic<int64_t> prompt_tokens{0};
+  std::atomic<int64_t> cached_tokens{0};
+  std::atomic<int64_t> generated_tokens{0};
+  std::atomic<int64_t> prefill_us{0};
+  std::atomic<int64_t> decode_us{0};
+  std::atomic<int64_t> models{0};
+  std::atomic<int64_t> sessions{0};
+  std::atomic<int64_t> engines{0};
+};
+
+gene_llm_counters g_counters;
+
+std::mutex g_log_mutex;
+gene_llm_log_callback g_log_callback = nullptr;
+void *g_log_user_data = nullptr;
+
+void log_message(gene_llm_log_level level, const char *format, ...) {
+  std::lock_guard<std::mutex> lock(g_log_mutex);
+  if (!g_log_callback) {
+    return;
+  }
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  std::vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  g_log_callback(static_cast<int>(level), message, g_log_user_data);
+}
+
 void ensure_backend_init() {
   std::call_once(g_backend_once, []() {
     ggml_backend_load_all();
@@ -49,34 +359,245 @@ void set_error(gene_llm_error *err, int code, const std::string &message) {
   err->message[sizeof(err->message) - 1] = '\0';
 }
 
-char *dup_cstr(const std::string &src) {
-  char *buffer = static_cast<char *>(std::malloc(src.size() + 1));
-  if (!buffer) {
+// One ggml threadpool (gene_llm_threadpool) for the whole process.
+std::mutex g_threadpool_mutex;
+threadpool_ref g_threadpool; // guarded by g_threadpool_mutex
+
+threadpool_ref make_threadpool(const gene_llm_threadpool_options *options,
+                               gene_llm_error *err) {
+  int threads = options && options->threads > 0
+                    ? options->threads
+                    : static_cast<int>(std::thread::hardware_concurrency());
+  threads = std::max(1, std::min(threads, GGML_MAX_N_THREADS));
+  ggml_threadpool_params params = ggml_threadpool_params_default(threads);
+  if (options && options->cpu_count > 0) {
+    if (!options->cpus) {
+      set_error(err, 1, "threadpool cpus missing");
+      return nullptr;
+    }
+    std::fill(std::begin(params.cpumask), std::end(params.cpumask), false);
+    for (int i = 0; i < options->cpu_count; ++i) {
+      const int cpu = options->cpus[i];
+      if (cpu < 0 || cpu >= GGML_MAX_N_THREADS) {
+        set_error(err, 1, "threadpool cpu index out of range");
+        return nullptr;
+      }
+      params.cpumask[cpu] = true;
+    }
+    params.strict_cpu = options->strict_cpu;
+  }
+  if (options) {
+    if (options->priority < GENE_LLM_THREAD_PRIORITY_LOW ||
+        options->priority > GENE_LLM_THREAD_PRIORITY_REALTIME) {
+      set_error(err, 1, "invalid threadpool priority");
+      return nullptr;
+    }
+    params.prio = static_cast<ggml_sched_priority>(options->priority);
+    if (options->poll >= 0) {
+      params.poll = static_cast<uint32_t>(std::min(options->poll, 100));
+    }
+  }
+  auto pool = std::make_shared<gene_llm_threadpool>();
+  pool->pool = ggml_threadpool_new(&params);
+  if (!pool->pool) {
+    set_error(err, 1, "failed to create threadpool");
     return nullptr;
   }
-  std::memcpy(buffer, src.data(), src.size());
-  buffer[src.size()] = '\0';
-  return buffer;
+  pool->threads = threads;
+  return pool;
 }
 
-void free_tokens(char **tokens, int count) {
-  if (!tokens) {
-    return;
+// The current pool, created with default settings on first use. Null if
+// that fails; contexts then fall back to llama.cpp's own threads.
+threadpool_ref shared_threadpool() {
+  std::lock_guard<std::mutex> lock(g_threadpool_mutex);
+  if (!g_threadpool) {
+    gene_llm_error err = {};
+    g_threadpool = make_threadpool(nullptr, &err);
+    if (!g_threadpool) {
+      log_message(GENE_LLM_LOG_WARN, "%s", err.message);
+    }
   }
-  for (int i = 0; i < count; ++i) {
-    if (tokens[i]) {
-      std::free(tokens[i]);
+  return g_threadpool;
+}
+
+// Creates a context on the shared pool. Per-context thread counts are capped
+// at the pool size (0 uses the whole pool); out_pool keeps the pool alive for
+// as long as the context exists.
+llama_context *new_context(llama_model *model, llama_context_params &params,
+                           int requested_threads, threadpool_ref &out_pool) {
+  threadpool_ref pool = out_pool ? out_pool : shared_threadpool();
+  if (pool) {
+    params.n_threads = requested_threads > 0
+                           ? std::min(requested_threads, pool->threads)
+                           : pool->threads;
+  } else {
+    params.n_threads = requested_threads > 0 ? requested_threads
+                                             : params.n_threads;
+  }
+  params.n_threads_batch = params.n_threads;
+  llama_context *ctx = llama_init_from_model(model, params);
+  if (ctx && pool) {
+    llama_attach_threadpool(ctx, pool->pool, pool->pool);
+    out_pool = pool;
+  }
+  return ctx;
+}
+
+// Evaluates a batch on ctx. Only contexts sharing pool wait for each other;
+// a context without a pool runs on its own threads and takes no lock.
+int32_t decode_batch(const threadpool_ref &pool, llama_context *ctx,
+                     llama_batch batch) {
+  if (!pool) {
+    return llama_decode(ctx, batch);
+  }
+  std::lock_guard<std::mutex> lock(pool->compute_mutex);
+  return llama_decode(ctx, batch);
+}
+
+int32_t encode_batch(const threadpool_ref &pool, llama_context *ctx,
+                     llama_batch batch) {
+  if (!pool) {
+    return llama_encode(ctx, batch);
+  }
+  std::lock_guard<std::mutex> lock(pool->compute_mutex);
+  return llama_encode(ctx, batch);
+}
+
+// Appends the text of token to the arena and records its id and end offset.
+// Returns the piece length, or -1 if the token cannot be rendered.
+int append_token(const llama_vocab *vocab, llama_token token,
+                 gene_llm_completion_arena &arena) {
+  const size_t start = arena.text.size();
+  arena.text.resize(start + kPieceReserve);
+  int n = llama_token_to_piece(vocab, token, &arena.text[start], kPieceReserve,
+                               0, true);
+  if (n < 0) {
+    // Negative results report the size the piece actually needs.
+    arena.text.resize(start + static_cast<size_t>(-n));
+    n = llama_token_to_piece(vocab, token, &arena.text[start], -n, 0, true);
+  }
+  if (n < 0) {
+    arena.text.resize(start);
+    return -1;
+  }
+  arena.text.resize(start + static_cast<size_t>(n));
+  arena.token_ids.push_back(token);
+  arena.token_offsets.push_back(static_cast<int32_t>(arena.text.size()));
+  return n;
+}
+
+// Undoes the last append_token.
+void drop_last_token(gene_llm_completion_arena &arena) {
+  arena.token_ids.pop_back();
+  arena.token_offsets.pop_back();
+  arena.text.resize(static_cast<size_t>(arena.token_offsets.back()));
+}
+
+// Built-in grammars. Both end at the close of the top-level value, so the
+// only token allowed afterwards is end of generation.
+const char *const kJsonRules = R"gbnf(
+value   ::= object | array | string | number | boolean | null
+object  ::= "{" ws ( string ws ":" ws value ( ws "," ws string ws ":" ws value )* )? ws "}"
+array   ::= "[" ws ( value ( ws "," ws value )* )? ws "]"
+string  ::= "\"" ( [^"\\\x7F\x00-\x1F] | "\\" ( ["\\/bfnrt] | "u" [0-9a-fA-F]{4} ) )* "\""
+number  ::= integer ( "." [0-9]+ )? ( [eE] [-+]? [0-9]+ )?
+integer ::= "-"? ( [0-9] | [1-9] [0-9]* )
+boolean ::= "true" | "false"
+null    ::= "null"
+ws      ::= | " " | "\n" [ \t]{0,20}
+)gbnf";
+
+// Gene data as read by the parser: genes, arrays, maps, strings, numbers and
+// symbols (which covers nil, true and false).
+const char *const kGeneLiteralGrammar = R"gbnf(
+root   ::= value
+value  ::= gene | array | map | string | number | symbol
+gene   ::= "(" ws value ( ws1 item )* ws ")"
+array  ::= "[" ws ( value ( ws1 value )* )? ws "]"
+map    ::= "{" ws ( prop ( ws1 prop )* )? ws "}"
+item   ::= prop | value
+prop   ::= "^" symbol ws1 value
+string ::= "\"" ( [^"\\] | "\\" ["\\nrt] )* "\""
+number ::= "-"? [0-9]+ ( "." [0-9]+ )? ( [eE] [-+]? [0-9]+ )?
+symbol ::= [a-zA-Z_+*/<>=!?.$%&|~-] [a-zA-Z0-9_+*/<>=!?.$%&|~:-]*
+ws     ::= [ \t\n]{0,20}
+ws1    ::= [ \t\n]{1,20}
+)gbnf";
+
+constexpr size_t kMaxCachedGrammars = 16;
+
+// Sets *out to a fresh grammar sampler for the request (null when it has no
+// grammar). Returns false if the grammar does not parse.
+bool request_grammar(gene_llm_grammar_cache &cache, const llama_vocab *vocab,
+                     const gene_llm_infer_options *options, llama_sampler **out,
+                     gene_llm_error *err) {
+  *out = nullptr;
+  const gene_llm_grammar_kind kind = options->grammar_kind;
+  if (kind == GENE_LLM_GRAMMAR_NONE) {
+    return true;
+  }
+  const char *text = options->grammar ? options->grammar : "";
+  if ((kind == GENE_LLM_GRAMMAR_GBNF || kind == GENE_LLM_GRAMMAR_JSON_SCHEMA) &&
+      text[0] == '\0') {
+    set_error(err, 1, "grammar text is empty");
+    return false;
+  }
+  std::string key = std::to_string(static_cast<int>(kind)) + '\n' + text;
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto it = cache.index.find(key);
+  if (it != cache.index.end()) {
+    cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+  } else {
+    std::string gbnf;
+    switch (kind) {
+    case GENE_LLM_GRAMMAR_GBNF:
+      gbnf = text;
+      break;
+    case GENE_LLM_GRAMMAR_GENE_LITERAL:
+      gbnf = kGeneLiteralGrammar;
+      break;
+    case GENE_LLM_GRAMMAR_JSON:
+      gbnf = std::string("root ::= value\n") + kJsonRules;
+      break;
+    case GENE_LLM_GRAMMAR_JSON_SCHEMA:
+      gbnf = std::string(text) + "\n" + kJsonRules;
+      break;
+    default:
+      set_error(err, 1, "unknown grammar kind");
+      return false;
+    }
+    llama_sampler *parsed =
+        llama_sampler_init_grammar(vocab, gbnf.c_str(), "root");
+    if (!parsed) {
+      set_error(err, 1, "failed to parse grammar");
+      return false;
+    }
+    cache.entries.emplace_front(key, parsed);
+    cache.index.emplace(std::move(key), cache.entries.begin());
+    while (cache.entries.size() > kMaxCachedGrammars) {
+      const auto &last = cache.entries.back();
+      llama_sampler_free(last.second);
+      cache.index.erase(last.first);
+      cache.entries.pop_back();
     }
   }
-  std::free(tokens);
+  *out = llama_sampler_clone(cache.entries.front().second);
+  return true;
 }
 
+// grammar, if any, is owned by the returned chain and constrains the
+// candidates before the other samplers see them.
 llama_sampler *build_sampler(float temperature, float top_p, int top_k,
-                             uint32_t seed) {
+                             uint32_t seed, llama_sampler *grammar = nullptr) {
   auto params = llama_sampler_chain_default_params();
-  params.no_perf = true;
   llama_sampler *chain = llama_sampler_chain_init(params);
 
+  if (grammar) {
+    llama_sampler_chain_add(chain, grammar);
+  }
+
   if (top_k > 0) {
     llama_sampler_chain_add(chain, llama_sampler_init_top_k(top_k));
   }
@@ -97,180 +618,519 @@ llama_sampler *build_sampler(float temperature, float top_p, int top_k,
   return chain;
 }
 
+// Every token covers at least one byte of text, so a buffer of the text
+// length plus room for BOS/EOS is almost always enough and one llama_tokenize
+// call suffices. The size query only happens when that guess is short.
+int32_t tokenize_text(const llama_vocab *vocab, const char *text, size_t len,
+                      bool add_special, std::vector<llama_token> &out_tokens,
+                      gene_llm_error *err) {
+  if (len > static_cast<size_t>(INT32_MAX) - 8) {
+    set_error(err, 1, "text too long to tokenize");
+    return -1;
+  }
+  const int32_t text_len = static_cast<int32_t>(len);
+  out_tokens.resize(len + 4);
+  int32_t count = llama_tokenize(vocab, text, text_len, out_tokens.data(),
+                                 static_cast<int32_t>(out_tokens.size()),
+                                 add_special, true);
+  if (count < 0) {
+    if (count == INT32_MIN) {
+      set_error(err, 1, "tokenization overflow");
+      return -1;
+    }
+    out_tokens.resize(-count);
+    count = llama_tokenize(vocab, text, text_len, out_tokens.data(),
+                           static_cast<int32_t>(out_tokens.size()),
+                           add_special, true);
+    if (count < 0) {
+      set_error(err, 1, "failed to tokenize text");
+      return -1;
+    }
+  }
+  out_tokens.resize(count);
+  return count;
+}
+
 int32_t tokenize_prompt(const llama_vocab *vocab, const std::string &prompt,
                         std::vector<llama_token> &out_tokens,
                         gene_llm_error *err) {
-  const int32_t required =
-      llama_tokenize(vocab, prompt.c_str(), static_cast<int32_t>(prompt.size()),
-                     nullptr, 0, true, true);
-  if (required == INT32_MIN) {
-    set_error(err, 1, "tokenization overflow");
-    return -1;
-  }
-  const int32_t token_count = required < 0 ? -required : required;
-  if (token_count <= 0) {
+  const int32_t count = tokenize_text(vocab, prompt.data(), prompt.size(),
+                                      true, out_tokens, err);
+  if (count == 0) {
     set_error(err, 1, "prompt produced no tokens");
     return -1;
   }
+  return count;
+}
+
+constexpr size_t kTokenCacheBytes = 8u << 20;
+
+// Tokenizes through the model's cache. The returned ids are a copy, so the
+// cache can evict freely once the lock is dropped.
+int32_t tokenize_cached(gene_llm_model *model, const char *text, size_t len,
+                        bool add_special, std::vector<llama_token> &out_tokens,
+                        gene_llm_error *err) {
+  gene_llm_token_cache &cache = model->token_cache;
+  std::string key;
+  key.reserve(len + 1);
+  key.push_back(add_special ? '1' : '0');
+  key.append(text, len);
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+      cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+      out_tokens = it->second->second;
+      return static_cast<int32_t>(out_tokens.size());
+    }
+  }
+
+  const int32_t count =
+      tokenize_text(model->vocab, text, len, add_special, out_tokens, err);
+  if (count < 0) {
+    return count;
+  }
+  const size_t entry_bytes = key.size() + out_tokens.size() * sizeof(llama_token);
+  if (entry_bytes > kTokenCacheBytes / 4) {
+    return count; // would crowd out everything else
+  }
 
-  out_tokens.resize(token_count);
-  const int32_t actual =
-      llama_tokenize(vocab, prompt.c_str(), static_cast<int32_t>(prompt.size()),
-                     out_tokens.data(), token_count, true, true);
-  if (actual < 0) {
-    set_error(err, 1, "failed to tokenize prompt");
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (cache.index.count(key)) {
+    return count; // another thread got there first
+  }
+  cache.entries.emplace_front(key, out_tokens);
+  cache.index.emplace(std::move(key), cache.entries.begin());
+  cache.bytes += entry_bytes;
+  while (cache.bytes > kTokenCacheBytes) {
+    const auto &last = cache.entries.back();
+    cache.bytes -= last.first.size() + last.second.size() * sizeof(llama_token);
+    cache.index.erase(last.first);
+    cache.entries.pop_back();
+  }
+  return count;
+}
+
+bool has_prompt(const gene_llm_infer_options *options) {
+  return options->prompt || options->prompt_token_count > 0;
+}
+
+// The request's prompt as token ids: the pre-tokenized prompt when given,
+// otherwise options->prompt tokenized with special tokens.
+int32_t request_prompt_tokens(const gene_llm_model *model,
+                              const gene_llm_infer_options *options,
+                              std::vector<llama_token> &out_tokens,
+                              gene_llm_error *err) {
+  if (options->prompt_token_count <= 0) {
+    return tokenize_prompt(model->vocab, options->prompt, out_tokens, err);
+  }
+  if (!options->prompt_tokens) {
+    set_error(err, 1, "prompt_tokens is null");
     return -1;
   }
-  return actual;
+  const int32_t n_vocab = llama_vocab_n_tokens(model->vocab);
+  out_tokens.assign(options->prompt_tokens,
+                    options->prompt_tokens + options->prompt_token_count);
+  for (llama_token token : out_tokens) {
+    if (token < 0 || token >= n_vocab) {
+      set_error(err, 1, "prompt token id out of range");
+      return -1;
+    }
+  }
+  return options->prompt_token_count;
 }
 
-void fill_completion(const std::string &text,
-                     const std::vector<std::string> &tokens,
+// Points out_completion at the arena; nothing is copied.
+void fill_completion(const gene_llm_completion_arena &arena,
                      gene_llm_finish_reason reason, int latency_ms,
                      gene_llm_completion *out_completion) {
-  out_completion->text = dup_cstr(text);
-  out_completion->token_count = static_cast<int>(tokens.size());
+  out_completion->text = arena.text.c_str();
+  out_completion->text_len = arena.text.size();
+  out_completion->token_ids = arena.token_ids.data();
+  out_completion->token_offsets = arena.token_offsets.data();
+  out_completion->token_count = arena.token_count();
   out_completion->latency_ms = latency_ms;
   out_completion->finish_reason = reason;
-  out_completion->tokens = nullptr;
-
-  if (!tokens.empty()) {
-    out_completion->tokens =
-        static_cast<char **>(std::malloc(tokens.size() * sizeof(char *)));
-    if (out_completion->tokens) {
-      for (size_t i = 0; i < tokens.size(); ++i) {
-        out_completion->tokens[i] = dup_cstr(tokens[i]);
-      }
-    }
+  out_completion->draft_tokens = 0;
+  out_completion->draft_accepted = 0;
+  out_completion->prompt_tokens = 0;
+  out_completion->cached_tokens = 0;
+  out_completion->prefill_ms = 0.0;
+  out_completion->decode_ms = 0.0;
+  out_completion->ttft_ms = 0.0;
+  out_completion->tokens_per_second = 0.0;
+  out_completion->kv_used = 0;
+  out_completion->kv_size = 0;
+  out_completion->context_shifts = 0;
+}
+
+// Copies the telemetry of a finished request into out_completion.
+void fill_timings(const gene_llm_request_timings &t, int generated,
+                  gene_llm_completion *out_completion) {
+  out_completion->prompt_tokens = t.prompt_tokens;
+  out_completion->cached_tokens = t.cached_tokens;
+  if (t.prefill_done_us > 0) {
+    out_completion->prefill_ms = (t.prefill_done_us - t.start_us) / 1000.0;
+  }
+  if (t.first_token_us > 0) {
+    out_completion->ttft_ms = (t.first_token_us - t.start_us) / 1000.0;
+    out_completion->decode_ms = (t.end_us - t.first_token_us) / 1000.0;
   }
+  if (out_completion->decode_ms > 0.0) {
+    out_completion->tokens_per_second =
+        generated * 1000.0 / out_completion->decode_ms;
+  }
+  out_completion->kv_used = t.kv_used;
+  out_completion->kv_size = t.kv_size;
 }
 
-} // namespace
+// Adds a finished request to the process-wide counters.
+void record_request(const gene_llm_request_timings &t, int generated,
+                    gene_llm_status status, gene_llm_finish_reason reason) {
+  g_counters.requests.fetch_add(1, std::memory_order_relaxed);
+  if (status != GENE_LLM_OK || reason == GENE_LLM_FINISH_ERROR) {
+    g_counters.failed_requests.fetch_add(1, std::memory_order_relaxed);
+  } else if (reason == GENE_LLM_FINISH_CANCELLED) {
+    g_counters.cancelled_requests.fetch_add(1, std::memory_order_relaxed);
+  }
+  g_counters.prompt_tokens.fetch_add(t.prompt_tokens,
+                                     std::memory_order_relaxed);
+  g_counters.cached_tokens.fetch_add(t.cached_tokens,
+                                     std::memory_order_relaxed);
+  g_counters.generated_tokens.fetch_add(generated, std::memory_order_relaxed);
+  if (t.prefill_done_us > 0) {
+    g_counters.prefill_us.fetch_add(t.prefill_done_us - t.start_us,
+                                    std::memory_order_relaxed);
+  }
+  if (t.first_token_us > 0 && t.end_us > t.first_token_us) {
+    g_counters.decode_us.fetch_add(t.end_us - t.first_token_us,
+                                   std::memory_order_relaxed);
+  }
+}
 
-void gene_llm_backend_init(void) { ensure_backend_init(); }
+// KV cells holding positions of sequence 0 (sessions decode a single one).
+int session_kv_used(llama_context *ctx) {
+  auto *memory = llama_get_memory(ctx);
+  if (!memory) {
+    return 0;
+  }
+  return static_cast<int>(llama_memory_seq_pos_max(memory, 0)) + 1;
+}
 
-gene_llm_status gene_llm_load_model(const char *path,
-                                    const gene_llm_model_options *options,
-                                    gene_llm_model **out_model,
-                                    gene_llm_error *err) {
-  if (!path || !out_model) {
-    set_error(err, 1, "invalid arguments");
-    return GENE_LLM_ERR_GENERAL;
+void reset_context_cache(llama_context *ctx,
+                         std::vector<llama_token> &cached) {
+  auto *memory = llama_get_memory(ctx);
+  if (memory) {
+    llama_memory_clear(memory, true);
   }
+  cached.clear();
+}
 
-  ensure_backend_init();
+void reset_cached_tokens(gene_llm_session *session) {
+  reset_context_cache(session->ctx, session->cached_tokens);
+}
 
-  llama_model_params params = llama_model_default_params();
-  if (options) {
-    params.n_gpu_layers = std::max(0, options->gpu_layers);
-    params.use_mmap = options->use_mmap;
-    params.use_mlock = options->use_mlock;
+// Trims sequence 0 of ctx back to the longest common prefix of cached and
+// tokens. With redecode_last, a full match still leaves the last token to be
+// decoded again so its logits are available to the sampler. Returns how many
+// of tokens are already in the KV cache.
+size_t trim_to_common_prefix(llama_context *ctx,
+                             std::vector<llama_token> &cached,
+                             const std::vector<llama_token> &tokens,
+                             bool redecode_last) {
+  const size_t limit = std::min(cached.size(), tokens.size());
+  size_t n_past = 0;
+  while (n_past < limit && cached[n_past] == tokens[n_past]) {
+    ++n_past;
   }
-
-  llama_model *model = llama_model_load_from_file(path, params);
-  if (!model) {
-    set_error(err, 1, "failed to load GGUF model");
-    return GENE_LLM_ERR_GENERAL;
+  if (redecode_last && n_past == tokens.size() && n_past > 0) {
+    --n_past;
+  }
+  if (n_past == cached.size()) {
+    return n_past;
   }
 
-  auto *wrapper = new gene_llm_model();
-  wrapper->model = model;
-  wrapper->vocab = llama_model_get_vocab(model);
-  wrapper->default_ctx = llama_model_n_ctx_train(model);
-  if (wrapper->default_ctx <= 0) {
-    wrapper->default_ctx = 4096;
+  auto *memory = llama_get_memory(ctx);
+  if (n_past == 0 || !memory ||
+      !llama_memory_seq_rm(memory, 0, static_cast<llama_pos>(n_past), -1)) {
+    // Some memory types (e.g. recurrent) cannot drop a partial range.
+    reset_context_cache(ctx, cached);
+    return 0;
   }
+  cached.resize(n_past);
+  return n_past;
+}
 
-  *out_model = wrapper;
-  return GENE_LLM_OK;
+// Trims the session's sequence 0 back to the longest common prefix of the
+// cached tokens and the new prompt. Returns how many prompt tokens are already
+// in the KV cache.
+size_t reuse_cached_prefix(gene_llm_session *session,
+                           const std::vector<llama_token> &prompt_tokens) {
+  return trim_to_common_prefix(session->ctx, session->cached_tokens,
+                               prompt_tokens, true);
 }
 
-void gene_llm_free_model(gene_llm_model *model) {
-  if (!model) {
+// Tokens pinned at the start of the context when shifting: the configured
+// prefix, and at least the BOS token.
+size_t pinned_tokens(const gene_llm_session *session) {
+  const size_t bos = llama_vocab_get_add_bos(session->model->vocab) ? 1 : 0;
+  return std::max(static_cast<size_t>(std::max(0, session->keep_tokens)), bos);
+}
+
+// Cuts the middle out of a prompt that does not fit: keeps the pinned prefix
+// and as much of the end as fits while leaving room to generate.
+void fit_prompt(const gene_llm_session *session,
+                std::vector<llama_token> &tokens, int max_tokens) {
+  const size_t n_ctx = llama_n_ctx(session->ctx);
+  const size_t reserve = static_cast<size_t>(
+      std::max(1, std::min(max_tokens, static_cast<int>(n_ctx / 4))));
+  if (tokens.size() + reserve <= n_ctx) {
     return;
   }
-  if (model->model) {
-    llama_model_free(model->model);
+  const size_t n_keep = std::min(pinned_tokens(session), n_ctx / 2);
+  const size_t n_tail = n_ctx - reserve - n_keep;
+  const size_t n_drop = tokens.size() - n_keep - n_tail;
+  log_message(GENE_LLM_LOG_DEBUG,
+              "context shift: prompt of %zu tokens drops %zu after %zu",
+              tokens.size(), n_drop, n_keep);
+  tokens.erase(tokens.begin() + n_keep, tokens.begin() + n_keep + n_drop);
+}
+
+// Frees room in a full context: drops the older half of sequence 0 after the
+// pinned prefix and slides the rest down. Returns false when the memory type
+// cannot shift (e.g. recurrent models) or there is nothing left to drop.
+bool shift_context(gene_llm_session *session) {
+  auto *memory = llama_get_memory(session->ctx);
+  if (!memory || !llama_memory_can_shift(memory)) {
+    return false;
   }
-  delete model;
+  std::vector<llama_token> &cached = session->cached_tokens;
+  const size_t n_past = cached.size();
+  const size_t n_keep = std::min(pinned_tokens(session), n_past);
+  const size_t n_discard = (n_past - n_keep) / 2;
+  if (n_discard == 0) {
+    return false;
+  }
+  const auto keep = static_cast<llama_pos>(n_keep);
+  const auto discard = static_cast<llama_pos>(n_discard);
+  if (!llama_memory_seq_rm(memory, 0, keep, keep + discard)) {
+    return false;
+  }
+  llama_memory_seq_add(memory, 0, keep + discard,
+                       static_cast<llama_pos>(n_past), -discard);
+  cached.erase(cached.begin() + n_keep, cached.begin() + n_keep + n_discard);
+  log_message(GENE_LLM_LOG_DEBUG, "context shift: dropped %zu tokens after %zu",
+              n_discard, n_keep);
+  return true;
 }
 
-gene_llm_status gene_llm_new_session(gene_llm_model *model,
-                                     const gene_llm_session_options *options,
-                                     gene_llm_session **out_session,
-                                     gene_llm_error *err) {
-  if (!model || !out_session) {
-    set_error(err, 1, "invalid arguments");
-    return GENE_LLM_ERR_GENERAL;
+// True when the request's deadline has passed or its progress callback asks
+// to stop.
+bool should_cancel(const gene_llm_infer_options *options, int64_t deadline_us,
+                   size_t decoded, size_t total) {
+  if (deadline_us > 0 && llama_time_us() >= deadline_us) {
+    return true;
   }
+  if (options->progress_callback &&
+      options->progress_callback(static_cast<int>(decoded),
+                                 static_cast<int>(total),
+                                 options->progress_user_data) != 0) {
+    return true;
+  }
+  return false;
+}
 
-  llama_context_params ctx_params = llama_context_default_params();
-  const int ctx_len = options && options->context_length > 0
-                          ? options->context_length
-                          : model->default_ctx;
-  ctx_params.n_ctx = ctx_len;
-  // Set batch size to context length to allow processing full prompts
-  const int batch_size = options && options->batch_size > 0
-                             ? options->batch_size
-                             : ctx_len;
-  ctx_params.n_batch = batch_size;
-  ctx_params.n_ubatch = batch_size;  // Physical batch size must also be set
-  ctx_params.n_threads = options && options->threads > 0 ? options->threads : 0;
-  ctx_params.n_threads_batch = ctx_params.n_threads;
-  ctx_params.no_perf = true;
+enum class prefill_result { ok, cancelled, failed };
+
+// Decodes tokens[pos..] into sequence 0 of ctx in n_batch chunks so
+// cancellation and deadlines are honoured between chunks. Every decoded chunk
+// is appended to cached, so a cancelled prefill still warms the next call.
+// options may be null when there is nothing to check.
+prefill_result prefill_context(const threadpool_ref &pool,
+                               llama_context *ctx,
+                               std::vector<llama_token> &cached,
+                               const std::vector<llama_token> &tokens,
+                               size_t pos,
+                               const gene_llm_infer_options *options,
+                               int64_t deadline_us) {
+  const size_t n_batch = std::max<uint32_t>(1, llama_n_batch(ctx));
+  while (pos < tokens.size()) {
+    if (options && should_cancel(options, deadline_us, pos, tokens.size())) {
+      return prefill_result::cancelled;
+    }
+    const size_t n_chunk = std::min(n_batch, tokens.size() - pos);
+    llama_batch batch =
+        llama_batch_get_one(const_cast<llama_token *>(tokens.data()) + pos,
+                            static_cast<int32_t>(n_chunk));
+    if (decode_batch(pool, ctx, batch) != 0) {
+      reset_context_cache(ctx, cached);
+      return prefill_result::failed;
+    }
+    cached.insert(cached.end(), tokens.begin() + pos,
+                  tokens.begin() + pos + n_chunk);
+    pos += n_chunk;
+  }
+  return prefill_result::ok;
+}
 
-  fprintf(stderr, "[gene_llm] new_session: ctx_len=%d, batch_size=%d, n_batch=%d, n_ubatch=%d\n",
-          ctx_len, batch_size, ctx_params.n_batch, ctx_params.n_ubatch);
+prefill_result prefill_tokens(gene_llm_session *session,
+                              const std::vector<llama_token> &tokens,
+                              size_t pos,
+                              const gene_llm_infer_options *options,
+                              int64_t deadline_us) {
+  return prefill_context(session->threadpool, session->ctx,
+                         session->cached_tokens, tokens, pos,
+                         options, deadline_us);
+}
 
-  llama_context *ctx = llama_init_from_model(model->model, ctx_params);
-  if (!ctx) {
-    set_error(err, 1, "failed to create llama context");
-    return GENE_LLM_ERR_GENERAL;
+// Speculation only works when both models map token ids to the same text.
+// Small differences in vocabulary size (padding, extra control tokens) are
+// tolerated as long as the special tokens agree.
+bool draft_vocab_compatible(const gene_llm_model *target,
+                            const gene_llm_model *draft) {
+  const llama_vocab *a = target->vocab;
+  const llama_vocab *b = draft->vocab;
+  if (llama_vocab_type(a) != llama_vocab_type(b) ||
+      llama_vocab_bos(a) != llama_vocab_bos(b) ||
+      llama_vocab_eos(a) != llama_vocab_eos(b)) {
+    return false;
   }
+  return std::abs(llama_vocab_n_tokens(a) - llama_vocab_n_tokens(b)) <=
+         kMaxDraftVocabDelta;
+}
 
-  auto *session = new gene_llm_session();
-  session->model = model;
-  session->ctx = ctx;
-  session->threads = ctx_params.n_threads;
-  session->default_max_tokens =
-      options && options->max_tokens > 0 ? options->max_tokens : 256;
-  session->default_temperature = options ? options->temperature : 0.7f;
-  session->default_top_p = options ? options->top_p : 0.9f;
-  session->default_top_k = options && options->top_k > 0 ? options->top_k : 40;
-  session->default_seed = options && options->seed != 0
-                              ? static_cast<uint32_t>(options->seed)
-                              : LLAMA_DEFAULT_SEED;
+enum class step_result { next, stop, failed };
+
+// One round of speculative decoding. The draft model proposes up to n_draft
+// tokens after id_last; the target decodes id_last plus the proposals in one
+// batch and its own sampler walks them until it disagrees, so the output
+// follows the target's sampling chain exactly. Accepted tokens go through
+// emit; the first token the target picks itself is returned in next_token,
+// not yet decoded.
+template <typename Emit>
+step_result speculative_step(gene_llm_session *session, llama_sampler *sampler,
+                             llama_token id_last, int n_draft, Emit &&emit,
+                             llama_token *next_token, int *drafted,
+                             int *accepted) {
+  std::vector<llama_token> &history = session->cached_tokens;
+  const llama_vocab *vocab = session->model->vocab;
 
-  *out_session = session;
-  return GENE_LLM_OK;
-}
+  // Bring the draft context up to the target's history, then let it run
+  // ahead greedily.
+  const size_t n_synced = trim_to_common_prefix(
+      session->draft_ctx, session->draft_cached, history, false);
+  if (prefill_context(session->threadpool, session->draft_ctx,
+                      session->draft_cached, history, n_synced, nullptr,
+                      0) != prefill_result::ok) {
+    return step_result::failed;
+  }
+  std::vector<llama_token> draft;
+  llama_token cur = id_last;
+  for (int i = 0; i < n_draft; ++i) {
+    if (decode_batch(session->threadpool, session->draft_ctx,
+                     llama_batch_get_one(&cur, 1)) != 0) {
+      break;
+    }
+    session->draft_cached.push_back(cur);
+    cur = llama_sampler_sample(session->draft_sampler, session->draft_ctx, -1);
+    draft.push_back(cur);
+    if (llama_vocab_is_eog(vocab, cur)) {
+      break;
+    }
+  }
 
-void gene_llm_free_session(gene_llm_session *session) {
-  if (!session) {
-    return;
+  llama_batch &batch = session->spec_batch;
+  const llama_pos base = static_cast<llama_pos>(history.size());
+  batch.n_tokens = 0;
+  for (size_t i = 0; i <= draft.size(); ++i) {
+    const int32_t k = batch.n_tokens++;
+    batch.token[k] = i == 0 ? id_last : draft[i - 1];
+    batch.pos[k] = base + static_cast<llama_pos>(i);
+    batch.n_seq_id[k] = 1;
+    batch.seq_id[k][0] = 0;
+    batch.logits[k] = true;
   }
-  if (session->ctx) {
-    llama_free(session->ctx);
+  if (decode_batch(session->threadpool, session->ctx, batch) != 0) {
+    reset_cached_tokens(session);
+    return step_result::failed;
   }
-  delete session;
+  history.push_back(id_last);
+  history.insert(history.end(), draft.begin(), draft.end());
+
+  size_t n_accepted = 0;
+  step_result result = step_result::next;
+  for (size_t i = 0; i <= draft.size(); ++i) {
+    const llama_token token =
+        llama_sampler_sample(sampler, session->ctx, static_cast<int32_t>(i));
+    if (i < draft.size() && token == draft[i]) {
+      if (!emit(token)) {
+        result = step_result::stop;
+        break;
+      }
+      ++n_accepted;
+      continue;
+    }
+    *next_token = token;
+    break;
+  }
+  *drafted += static_cast<int>(draft.size());
+  *accepted += static_cast<int>(n_accepted);
+
+  // Drop the rejected proposals from the target cache.
+  const size_t keep = static_cast<size_t>(base) + 1 + n_accepted;
+  if (keep < history.size()) {
+    auto *memory = llama_get_memory(session->ctx);
+    if (!memory ||
+        !llama_memory_seq_rm(memory, 0, static_cast<llama_pos>(keep), -1)) {
+      reset_cached_tokens(session);
+      return step_result::failed;
+    }
+    history.resize(keep);
+  }
+  return result;
 }
 
-gene_llm_status gene_llm_infer(gene_llm_session *session,
-                               const gene_llm_infer_options *options,
-                               gene_llm_completion *out_completion,
-                               gene_llm_error *err) {
-  if (!session || !options || !out_completion || !options->prompt) {
+// Generates a completion for options->prompt. The result is written to
+// arena, or to the session's own arena when arena is null.
+gene_llm_status run_inference(gene_llm_session *session,
+                              const gene_llm_infer_options *options,
+                              gene_llm_token_callback callback,
+                              void *user_data,
+                              gene_llm_completion_arena *arena_out,
+                              gene_llm_completion *out_completion,
+                              gene_llm_error *err) {
+  if (!session || !options || !out_completion || !has_prompt(options)) {
     set_error(err, 1, "invalid arguments");
     return GENE_LLM_ERR_GENERAL;
   }
+  std::lock_guard<std::mutex> busy(session->mutex);
 
   const int max_tokens = options->max_tokens > 0 ? options->max_tokens
                                                  : session->default_max_tokens;
+  gene_llm_completion_arena &arena = arena_out ? *arena_out : session->arena;
+  arena.reset();
   if (max_tokens <= 0) {
-    fill_completion("", {}, GENE_LLM_FINISH_CANCELLED, 0, out_completion);
+    // Still a request in the counters, cancelled before any work.
+    record_request(gene_llm_request_timings(), 0, GENE_LLM_OK,
+                   GENE_LLM_FINISH_CANCELLED);
+    fill_completion(arena, GENE_LLM_FINISH_CANCELLED, 0, out_completion);
     return GENE_LLM_OK;
   }
 
+  gene_llm_request_timings timings;
+  timings.start_us = llama_time_us();
+  timings.kv_size = static_cast<int>(llama_n_ctx(session->ctx));
+  // Stamps the end of the request and adds it to the process counters.
+  auto finish = [&](gene_llm_status status, gene_llm_finish_reason reason) {
+    timings.end_us = llama_time_us();
+    timings.kv_used = session_kv_used(session->ctx);
+    record_request(timings, arena.token_count(), status, reason);
+    if (status == GENE_LLM_OK) {
+      fill_timings(timings, arena.token_count(), out_completion);
+    }
+    return status;
+  };
+
   const float temperature = options->temperature > 0.0f
                                 ? options->temperature
                                 : session->default_temperature;
@@ -283,127 +1143,239 @@ gene_llm_status gene_llm_infer(gene_llm_session *session,
 
   const llama_vocab *vocab = session->model->vocab;
   std::vector<llama_token> prompt_tokens;
-  if (tokenize_prompt(vocab, options->prompt, prompt_tokens, err) < 0) {
-    return GENE_LLM_ERR_GENERAL;
+  if (request_prompt_tokens(session->model, options, prompt_tokens, err) < 0) {
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
   }
-
-  auto *memory = llama_get_memory(session->ctx);
-  if (memory) {
-    llama_memory_clear(memory, true);
+  timings.prompt_tokens = static_cast<int>(prompt_tokens.size());
+  const bool has_encoder = llama_model_has_encoder(session->model->model);
+  const bool shifting = session->context_shift && !has_encoder;
+  if (shifting) {
+    fit_prompt(session, prompt_tokens, max_tokens);
   }
 
-  llama_sampler *sampler = build_sampler(temperature, top_p, top_k, seed);
+  llama_sampler *grammar = nullptr;
+  if (!request_grammar(session->grammars, vocab, options, &grammar, err)) {
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+  }
+  llama_sampler *sampler =
+      build_sampler(temperature, top_p, top_k, seed, grammar);
   if (!sampler) {
     set_error(err, 1, "failed to construct sampler chain");
-    return GENE_LLM_ERR_GENERAL;
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+  }
+
+  const int64_t start_us = timings.start_us;
+  const int64_t deadline_us =
+      options->timeout_ms > 0
+          ? start_us + static_cast<int64_t>(options->timeout_ms) * 1000
+          : 0;
+
+  // Encoder-decoder models restart the decoder on every request, so there is
+  // no reusable prefix.
+  size_t n_past = 0;
+  if (has_encoder) {
+    reset_cached_tokens(session);
+  } else {
+    n_past = reuse_cached_prefix(session, prompt_tokens);
   }
 
-  llama_batch batch = llama_batch_get_one(
-      prompt_tokens.data(), static_cast<int32_t>(prompt_tokens.size()));
+  timings.cached_tokens = static_cast<int>(n_past);
+  log_message(GENE_LLM_LOG_DEBUG, "infer: prompt_tokens=%zu, cached_tokens=%zu",
+              prompt_tokens.size(), n_past);
 
-  if (llama_model_has_encoder(session->model->model)) {
-    if (llama_encode(session->ctx, batch) != 0) {
+  if (has_encoder) {
+    // The encoder needs the whole input in one batch.
+    llama_batch batch = llama_batch_get_one(
+        prompt_tokens.data(), static_cast<int32_t>(prompt_tokens.size()));
+    if (encode_batch(session->threadpool, session->ctx, batch) != 0) {
       llama_sampler_free(sampler);
       set_error(err, 1, "encoder evaluation failed");
-      return GENE_LLM_ERR_GENERAL;
+      return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
     }
     llama_token decoder_start =
         llama_model_decoder_start_token(session->model->model);
     if (decoder_start == LLAMA_TOKEN_NULL) {
       decoder_start = llama_vocab_bos(vocab);
     }
-    batch = llama_batch_get_one(&decoder_start, 1);
+    if (decode_batch(session->threadpool, session->ctx,
+                     llama_batch_get_one(&decoder_start, 1)) != 0) {
+      llama_sampler_free(sampler);
+      set_error(err, 1, "failed to evaluate prompt");
+      return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+    }
+  } else {
+    switch (prefill_tokens(session, prompt_tokens, n_past, options,
+                           deadline_us)) {
+    case prefill_result::ok:
+      break;
+    case prefill_result::cancelled:
+      llama_sampler_free(sampler);
+      fill_completion(arena, GENE_LLM_FINISH_CANCELLED,
+                      static_cast<int>((llama_time_us() - start_us) / 1000),
+                      out_completion);
+      return finish(GENE_LLM_OK, GENE_LLM_FINISH_CANCELLED);
+    case prefill_result::failed:
+      llama_sampler_free(sampler);
+      set_error(err, 1, "failed to evaluate prompt");
+      return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+    }
   }
 
-  const int64_t start_us = llama_time_us();
-
-  fprintf(stderr, "[gene_llm] infer: prompt_tokens=%zu, batch.n_tokens=%d\n",
-          prompt_tokens.size(), batch.n_tokens);
+  timings.prefill_done_us = llama_time_us();
 
-  if (llama_decode(session->ctx, batch) != 0) {
-    llama_sampler_free(sampler);
-    set_error(err, 1, "failed to evaluate prompt");
-    return GENE_LLM_ERR_GENERAL;
-  }
-
-  std::string completion_text;
-  std::vector<std::string> token_texts;
   gene_llm_finish_reason finish_reason = GENE_LLM_FINISH_STOP;
-  llama_token new_token = 0;
+  const char *failure = nullptr;
 
-  for (int generated = 0; generated < max_tokens; ++generated) {
-    new_token = llama_sampler_sample(sampler, session->ctx, -1);
-    if (llama_vocab_is_eog(vocab, new_token)) {
+  // Appends a sampled token to the completion. Returns false once generation
+  // has to stop; finish_reason (or failure) says why.
+  auto emit = [&](llama_token token) {
+    if (timings.first_token_us == 0) {
+      timings.first_token_us = llama_time_us();
+    }
+    if (llama_vocab_is_eog(vocab, token)) {
       finish_reason = GENE_LLM_FINISH_STOP;
-      break;
+      return false;
     }
 
-    char buffer[384];
-    const int piece_len =
-        llama_token_to_piece(vocab, new_token, buffer, sizeof(buffer), 0, true);
+    const size_t start = arena.text.size();
+    const int piece_len = append_token(vocab, token, arena);
     if (piece_len < 0) {
-      llama_sampler_free(sampler);
-      set_error(err, 1, "failed to convert token to text");
-      return GENE_LLM_ERR_GENERAL;
+      failure = "failed to convert token to text";
+      return false;
     }
-    completion_text.append(buffer, piece_len);
-    token_texts.emplace_back(buffer, piece_len);
 
-    llama_batch next_batch = llama_batch_get_one(&new_token, 1);
-    if (llama_decode(session->ctx, next_batch) != 0) {
-      llama_sampler_free(sampler);
-      set_error(err, 1, "failed to evaluate generated token");
-      return GENE_LLM_ERR_GENERAL;
+    // Stream token via callback; the arena keeps the piece null-terminated.
+    if (callback && callback(&arena.text[start], piece_len, user_data) != 0) {
+      drop_last_token(arena);
+      finish_reason = GENE_LLM_FINISH_CANCELLED;
+      return false;
+    }
+
+    if (arena.token_count() >= max_tokens) {
+      finish_reason = GENE_LLM_FINISH_LENGTH;
+      return false;
+    }
+    return true;
+  };
+
+  const bool speculative = session->draft_ctx && !has_encoder;
+  const int n_ctx = static_cast<int>(llama_n_ctx(session->ctx));
+  int drafted = 0;
+  int accepted = 0;
+  int shifts = 0;
+
+  llama_token token = llama_sampler_sample(sampler, session->ctx, -1);
+  while (true) {
+    if (deadline_us > 0 && llama_time_us() >= deadline_us) {
+      finish_reason = GENE_LLM_FINISH_CANCELLED;
+      break;
+    }
+    if (!emit(token)) {
+      break;
+    }
+
+    // Make room before the next decode would overflow the context.
+    if (shifting &&
+        static_cast<int>(session->cached_tokens.size()) + 2 >= n_ctx) {
+      if (!shift_context(session)) {
+        finish_reason = GENE_LLM_FINISH_LENGTH;
+        break;
+      }
+      ++shifts;
+    }
+
+    if (speculative) {
+      const int room =
+          n_ctx - static_cast<int>(session->cached_tokens.size()) - 2;
+      const int n_draft = std::max(0, std::min(session->draft_n, room));
+      const step_result step =
+          speculative_step(session, sampler, token, n_draft, emit, &token,
+                           &drafted, &accepted);
+      if (step == step_result::failed) {
+        failure = "failed to evaluate speculative batch";
+      }
+      if (step != step_result::next) {
+        break;
+      }
+      continue;
+    }
+
+    if (decode_batch(session->threadpool, session->ctx,
+                     llama_batch_get_one(&token, 1)) != 0) {
+      reset_cached_tokens(session);
+      failure = "failed to evaluate generated token";
+      break;
+    }
+    if (!has_encoder) {
+      session->cached_tokens.push_back(token);
     }
+    token = llama_sampler_sample(sampler, session->ctx, -1);
   }
 
-  if (static_cast<int>(token_texts.size()) >= max_tokens) {
-    finish_reason = GENE_LLM_FINISH_LENGTH;
+  llama_sampler_free(sampler);
+  if (failure) {
+    set_error(err, 1, failure);
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
   }
 
   const int64_t end_us = llama_time_us();
   const int latency_ms = static_cast<int>((end_us - start_us) / 1000);
 
-  fill_completion(completion_text, token_texts, finish_reason, latency_ms,
-                  out_completion);
-
-  llama_sampler_free(sampler);
-  return GENE_LLM_OK;
+  fill_completion(arena, finish_reason, latency_ms, out_completion);
+  out_completion->draft_tokens = drafted;
+  out_completion->draft_accepted = accepted;
+  out_completion->context_shifts = shifts;
+  return finish(GENE_LLM_OK, finish_reason);
 }
 
-void gene_llm_free_completion(gene_llm_completion *completion) {
-  if (!completion) {
-    return;
-  }
-  if (completion->text) {
-    std::free(completion->text);
-    completion->text = nullptr;
+// n-best sampling: the prompt is prefilled once on sequence 0, its KV is
+// shared with sequences 1..n-1, and every branch then decodes one token per
+// step in a single batch. Branch i samples with seed + i (explicit seeds
+// only; the default seed is random per branch anyway). Afterwards the
+// branches are dropped and sequence 0 is trimmed back to the prompt, so the
+// prefix stays cached for the next request.
+gene_llm_status run_inference_n(gene_llm_session *session,
+                                const gene_llm_infer_options *options,
+                                gene_llm_completion *out_completions,
+                                gene_llm_error *err) {
+  if (!session || !options || !out_completions || !has_prompt(options)) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
   }
-  if (completion->tokens) {
-    free_tokens(completion->tokens, completion->token_count);
-    completion->tokens = nullptr;
+  const int n = options->n > 0 ? options->n : 1;
+  if (n > session->max_branches) {
+    set_error(err, 1, "n exceeds the session's max_branches");
+    return GENE_LLM_ERR_GENERAL;
   }
-  completion->token_count = 0;
-}
-
-gene_llm_status gene_llm_infer_streaming(gene_llm_session *session,
-                                         const gene_llm_infer_options *options,
-                                         gene_llm_token_callback callback,
-                                         void *user_data,
-                                         gene_llm_completion *out_completion,
-                                         gene_llm_error *err) {
-  if (!session || !options || !out_completion || !options->prompt) {
-    set_error(err, 1, "invalid arguments");
+  if (llama_model_has_encoder(session->model->model)) {
+    set_error(err, 1, "n-best sampling needs a decoder-only model");
     return GENE_LLM_ERR_GENERAL;
   }
+  std::lock_guard<std::mutex> busy(session->mutex);
 
+  std::vector<gene_llm_completion_arena> &arenas = session->branch_arenas;
+  if (static_cast<int>(arenas.size()) < n) {
+    arenas.resize(n);
+  }
+  for (int i = 0; i < n; ++i) {
+    arenas[i].reset();
+  }
   const int max_tokens = options->max_tokens > 0 ? options->max_tokens
                                                  : session->default_max_tokens;
   if (max_tokens <= 0) {
-    fill_completion("", {}, GENE_LLM_FINISH_CANCELLED, 0, out_completion);
+    record_request(gene_llm_request_timings(), 0, GENE_LLM_OK,
+                   GENE_LLM_FINISH_CANCELLED);
+    for (int i = 0; i < n; ++i) {
+      fill_completion(arenas[i], GENE_LLM_FINISH_CANCELLED, 0,
+                      &out_completions[i]);
+    }
     return GENE_LLM_OK;
   }
 
+  gene_llm_request_timings timings;
+  timings.start_us = llama_time_us();
+  timings.kv_size = static_cast<int>(llama_n_ctx(session->ctx));
+
   const float temperature = options->temperature > 0.0f
                                 ? options->temperature
                                 : session->default_temperature;
@@ -414,107 +1386,2181 @@ gene_llm_status gene_llm_infer_streaming(gene_llm_session *session,
   const uint32_t seed = options->seed > 0 ? static_cast<uint32_t>(options->seed)
                                           : session->default_seed;
 
-  const llama_vocab *vocab = session->model->vocab;
+  struct branch {
+    llama_sampler *sampler = nullptr;
+    llama_token token = 0;
+    int32_t row = -1;
+    bool done = false;
+    gene_llm_finish_reason reason = GENE_LLM_FINISH_STOP;
+  };
+  std::vector<branch> branches(n);
+  llama_batch batch = llama_batch_init(n, 0, 1);
+  auto *memory = llama_get_memory(session->ctx);
+  llama_pos n_prompt = 0;
+
+  // Releases the branches and reports the request as one in the counters,
+  // with the generated tokens of all branches.
+  auto finish = [&](gene_llm_status status, gene_llm_finish_reason reason) {
+    timings.end_us = llama_time_us();
+    timings.kv_used = 0;
+    int generated = 0;
+    for (int i = 0; i < n; ++i) {
+      generated += arenas[i].token_count();
+      if (memory && n_prompt > 0) {
+        const llama_pos pos_max = llama_memory_seq_pos_max(memory, i);
+        timings.kv_used += pos_max >= 0 ? static_cast<int>(pos_max) + 1 : 0;
+      }
+    }
+    for (branch &b : branches) {
+      if (b.sampler) {
+        llama_sampler_free(b.sampler);
+      }
+    }
+    llama_batch_free(batch);
+    if (memory && n_prompt > 0) {
+      for (int i = 1; i < n; ++i) {
+        llama_memory_seq_rm(memory, i, -1, -1);
+      }
+      if (llama_memory_seq_rm(memory, 0, n_prompt, -1)) {
+        session->cached_tokens.resize(static_cast<size_t>(n_prompt));
+      } else {
+        reset_cached_tokens(session);
+      }
+    }
+    record_request(timings, generated, status, reason);
+    if (status == GENE_LLM_OK) {
+      const int latency_ms =
+          static_cast<int>((timings.end_us - timings.start_us) / 1000);
+      for (int i = 0; i < n; ++i) {
+        fill_completion(arenas[i], branches[i].reason, latency_ms,
+                        &out_completions[i]);
+        fill_timings(timings, arenas[i].token_count(), &out_completions[i]);
+      }
+    }
+    return status;
+  };
+
   std::vector<llama_token> prompt_tokens;
-  if (tokenize_prompt(vocab, options->prompt, prompt_tokens, err) < 0) {
-    return GENE_LLM_ERR_GENERAL;
+  if (request_prompt_tokens(session->model, options, prompt_tokens, err) < 0) {
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+  }
+  timings.prompt_tokens = static_cast<int>(prompt_tokens.size());
+  for (int i = 0; i < n; ++i) {
+    const uint32_t branch_seed =
+        seed == LLAMA_DEFAULT_SEED ? seed : seed + static_cast<uint32_t>(i);
+    llama_sampler *grammar = nullptr;
+    if (!request_grammar(session->grammars, session->model->vocab, options,
+                         &grammar, err)) {
+      return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+    }
+    branches[i].sampler =
+        build_sampler(temperature, top_p, top_k, branch_seed, grammar);
+    if (!branches[i].sampler) {
+      set_error(err, 1, "failed to construct sampler chain");
+      return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+    }
   }
 
-  auto *memory = llama_get_memory(session->ctx);
-  if (memory) {
-    llama_memory_clear(memory, true);
+  const int64_t deadline_us =
+      options->timeout_ms > 0
+          ? timings.start_us + static_cast<int64_t>(options->timeout_ms) * 1000
+          : 0;
+  const size_t n_past = reuse_cached_prefix(session, prompt_tokens);
+  timings.cached_tokens = static_cast<int>(n_past);
+  log_message(GENE_LLM_LOG_DEBUG,
+              "infer_n: n=%d, prompt_tokens=%zu, cached_tokens=%zu", n,
+              prompt_tokens.size(), n_past);
+
+  switch (prefill_tokens(session, prompt_tokens, n_past, options,
+                         deadline_us)) {
+  case prefill_result::ok:
+    break;
+  case prefill_result::cancelled:
+    for (branch &b : branches) {
+      b.reason = GENE_LLM_FINISH_CANCELLED;
+    }
+    return finish(GENE_LLM_OK, GENE_LLM_FINISH_CANCELLED);
+  case prefill_result::failed:
+    set_error(err, 1, "failed to evaluate prompt");
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
   }
+  timings.prefill_done_us = llama_time_us();
+  n_prompt = static_cast<llama_pos>(session->cached_tokens.size());
 
-  llama_sampler *sampler = build_sampler(temperature, top_p, top_k, seed);
-  if (!sampler) {
-    set_error(err, 1, "failed to construct sampler chain");
-    return GENE_LLM_ERR_GENERAL;
+  if (!memory) {
+    set_error(err, 1, "context has no memory to share between branches");
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+  }
+  for (int i = 1; i < n; ++i) {
+    llama_memory_seq_cp(memory, 0, i, -1, -1);
   }
 
-  llama_batch batch = llama_batch_get_one(
-      prompt_tokens.data(), static_cast<int32_t>(prompt_tokens.size()));
+  const llama_vocab *vocab = session->model->vocab;
+  // Every branch draws its first token from the prompt's last logits.
+  for (branch &b : branches) {
+    b.token = llama_sampler_sample(b.sampler, session->ctx, -1);
+  }
 
-  if (llama_model_has_encoder(session->model->model)) {
-    if (llama_encode(session->ctx, batch) != 0) {
-      llama_sampler_free(sampler);
-      set_error(err, 1, "encoder evaluation failed");
-      return GENE_LLM_ERR_GENERAL;
+  // Appends the branch's pending token. Returns false once it is finished.
+  auto emit = [&](int i) {
+    branch &b = branches[i];
+    if (timings.first_token_us == 0) {
+      timings.first_token_us = llama_time_us();
     }
-    llama_token decoder_start =
-        llama_model_decoder_start_token(session->model->model);
-    if (decoder_start == LLAMA_TOKEN_NULL) {
-      decoder_start = llama_vocab_bos(vocab);
+    if (llama_vocab_is_eog(vocab, b.token)) {
+      b.reason = GENE_LLM_FINISH_STOP;
+      return false;
+    }
+    if (append_token(vocab, b.token, arenas[i]) < 0) {
+      b.reason = GENE_LLM_FINISH_ERROR;
+      return false;
+    }
+    if (arenas[i].token_count() >= max_tokens) {
+      b.reason = GENE_LLM_FINISH_LENGTH;
+      return false;
+    }
+    return true;
+  };
+
+  const char *failure = nullptr;
+  while (true) {
+    const bool expired = deadline_us > 0 && llama_time_us() >= deadline_us;
+    batch.n_tokens = 0;
+    for (int i = 0; i < n; ++i) {
+      branch &b = branches[i];
+      if (b.done) {
+        continue;
+      }
+      if (expired) {
+        b.reason = GENE_LLM_FINISH_CANCELLED;
+        b.done = true;
+        continue;
+      }
+      if (!emit(i)) {
+        b.done = true;
+        continue;
+      }
+      const int32_t k = batch.n_tokens++;
+      batch.token[k] = b.token;
+      batch.pos[k] = n_prompt + arenas[i].token_count() - 1;
+      batch.n_seq_id[k] = 1;
+      batch.seq_id[k][0] = i;
+      batch.logits[k] = true;
+      b.row = k;
+    }
+    if (batch.n_tokens == 0) {
+      break;
+    }
+    const int rc = decode_batch(session->threadpool, session->ctx, batch);
+    if (rc == 1) {
+      // No KV slot left for this step: the context is full.
+      for (branch &b : branches) {
+        if (!b.done) {
+          b.reason = GENE_LLM_FINISH_LENGTH;
+          b.done = true;
+        }
+      }
+      break;
+    }
+    if (rc != 0) {
+      failure = "failed to evaluate generated tokens";
+      break;
+    }
+    for (branch &b : branches) {
+      if (!b.done) {
+        b.token = llama_sampler_sample(b.sampler, session->ctx, b.row);
+      }
     }
-    batch = llama_batch_get_one(&decoder_start, 1);
   }
 
-  const int64_t start_us = llama_time_us();
+  if (failure) {
+    set_error(err, 1, failure);
+    return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+  }
+  for (const branch &b : branches) {
+    if (b.reason == GENE_LLM_FINISH_ERROR) {
+      set_error(err, 1, "failed to convert token to text");
+      return finish(GENE_LLM_ERR_GENERAL, GENE_LLM_FINISH_ERROR);
+    }
+  }
+  return finish(GENE_LLM_OK, branches[0].reason);
+}
 
-  fprintf(stderr, "[gene_llm] infer: prompt_tokens=%zu, batch.n_tokens=%d\n",
-          prompt_tokens.size(), batch.n_tokens);
+constexpr char kStateMagic[4] = {'G', 'L', 'S', 'T'};
+constexpr uint32_t kStateVersion = 1;
 
-  if (llama_decode(session->ctx, batch) != 0) {
-    llama_sampler_free(sampler);
-    set_error(err, 1, "failed to evaluate prompt");
-    return GENE_LLM_ERR_GENERAL;
+struct state_header {
+  char magic[4];
+  uint32_t version;
+  uint64_t model_hash;
+  uint64_t n_tokens;
+  uint64_t state_size;
+};
+
+uint64_t fnv1a(const void *data, size_t size,
+               uint64_t hash = 1469598103934665603ull) {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
   }
+  return hash;
+}
 
-  std::string completion_text;
-  std::vector<std::string> token_texts;
-  gene_llm_finish_reason finish_reason = GENE_LLM_FINISH_STOP;
-  llama_token new_token = 0;
-  bool cancelled = false;
+std::string model_fingerprint(const char *path) {
+  std::string fingerprint = path;
+  struct stat info;
+  if (stat(path, &info) == 0) {
+    fingerprint += "|" + std::to_string(static_cast<long long>(info.st_size)) +
+                   "|" + std::to_string(static_cast<long long>(info.st_mtime));
+  }
+  return fingerprint;
+}
 
-  for (int generated = 0; generated < max_tokens; ++generated) {
-    new_token = llama_sampler_sample(sampler, session->ctx, -1);
-    if (llama_vocab_is_eog(vocab, new_token)) {
-      finish_reason = GENE_LLM_FINISH_STOP;
+void destroy_model(gene_llm_model *model) {
+  for (auto &entry : model->embed_ctxs) {
+    llama_free(entry.second.ctx);
+  }
+  if (model->model) {
+    llama_model_free(model->model);
+  }
+  g_counters.models.fetch_sub(1, std::memory_order_relaxed);
+  delete model;
+}
+
+// A load in progress. Acquirers of the same key wait on done_cv for the
+// loader instead of mapping the weights twice; on failure they get its error.
+struct gene_llm_registry_load {
+  std::condition_variable done_cv;
+  bool done = false;
+  bool failed = false;
+  std::string error;
+};
+
+// Shared models, one per canonical path and weight-affecting load options.
+// Models nobody uses stay resident until the budget needs their memory.
+struct gene_llm_registry {
+  std::mutex mutex;
+  std::unordered_map<std::string, gene_llm_model *> models;
+  std::unordered_map<std::string, std::shared_ptr<gene_llm_registry_load>>
+      loading;
+  uint64_t budget_bytes = 0; // 0 = unlimited
+  uint64_t resident_bytes = 0;
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+};
+
+gene_llm_registry g_registry;
+
+std::string registry_key(const char *path,
+                         const gene_llm_model_options *options) {
+  std::string key = path;
+#if !defined(_WIN32)
+  if (char *resolved = realpath(path, nullptr)) {
+    key = resolved;
+    free(resolved);
+  }
+#endif
+  if (options) {
+    key += "|gpu=" + std::to_string(options->gpu_layers) +
+           "|mmap=" + std::to_string(options->use_mmap ? 1 : 0) +
+           "|mlock=" + std::to_string(options->use_mlock ? 1 : 0);
+    if (options->state_cache_dir) {
+      key += "|state=";
+      key += options->state_cache_dir;
+    }
+  }
+  return key;
+}
+
+// Unregisters idle models, least recently used first, until the resident
+// size fits the budget. Called with the registry mutex held; the caller frees
+// the returned models after unlocking, since freeing weights can be slow.
+std::vector<gene_llm_model *> registry_trim_locked() {
+  std::vector<gene_llm_model *> evicted;
+  if (g_registry.budget_bytes == 0) {
+    return evicted;
+  }
+  while (g_registry.resident_bytes > g_registry.budget_bytes) {
+    gene_llm_model *victim = nullptr;
+    for (const auto &entry : g_registry.models) {
+      gene_llm_model *candidate = entry.second;
+      if (candidate->users == 0 &&
+          (!victim || candidate->idle_since_us < victim->idle_since_us)) {
+        victim = candidate;
+      }
+    }
+    if (!victim) {
       break;
     }
+    log_message(GENE_LLM_LOG_DEBUG, "registry: evicting %s (%llu bytes)",
+                victim->registry_key.c_str(),
+                static_cast<unsigned long long>(victim->bytes));
+    g_registry.models.erase(victim->registry_key);
+    g_registry.resident_bytes -= victim->bytes;
+    ++g_registry.evictions;
+    evicted.push_back(victim);
+  }
+  return evicted;
+}
 
-    char buffer[384];
-    const int piece_len =
-        llama_token_to_piece(vocab, new_token, buffer, sizeof(buffer), 0, true);
-    if (piece_len < 0) {
-      llama_sampler_free(sampler);
-      set_error(err, 1, "failed to convert token to text");
-      return GENE_LLM_ERR_GENERAL;
+void destroy_models(const std::vector<gene_llm_model *> &models) {
+  for (gene_llm_model *model : models) {
+    destroy_model(model);
+  }
+}
+
+// Sessions and engines keep their model (and draft model) from eviction.
+void registry_retain(gene_llm_model *model) {
+  if (!model || model->registry_key.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(g_registry.mutex);
+  ++model->users;
+}
+
+void registry_release(gene_llm_model *model) {
+  if (!model || model->registry_key.empty()) {
+    return;
+  }
+  std::vector<gene_llm_model *> evicted;
+  {
+    std::lock_guard<std::mutex> lock(g_registry.mutex);
+    if (--model->users == 0) {
+      model->idle_since_us = llama_time_us();
+      evicted = registry_trim_locked();
     }
+  }
+  destroy_models(evicted);
+}
 
-    // Null-terminate for callback
-    buffer[piece_len] = '\0';
+// Content address of a snapshot: the model file plus the exact token ids.
+std::string state_key(const gene_llm_model *model,
+                      const std::vector<llama_token> &tokens) {
+  uint64_t hash = fnv1a(model->fingerprint.data(), model->fingerprint.size());
+  hash = fnv1a(tokens.data(), tokens.size() * sizeof(llama_token), hash);
+  char key[17];
+  std::snprintf(key, sizeof(key), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return key;
+}
 
-    // Stream token via callback
-    if (callback) {
-      int result = callback(buffer, piece_len, user_data);
-      if (result != 0) {
-        cancelled = true;
-        finish_reason = GENE_LLM_FINISH_CANCELLED;
-        break;
+std::string state_path(const gene_llm_model *model, const std::string &key) {
+  return model->state_cache_dir + "/" + key + ".glstate";
+}
+
+// Read-only view of a whole file; memory-mapped where available so pages are
+// shared between workers restoring the same snapshot.
+class mapped_file {
+public:
+  mapped_file() = default;
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() {
+#ifndef _WIN32
+    if (data_) {
+      munmap(const_cast<uint8_t *>(data_), size_);
+    }
+#endif
+  }
+
+  bool open(const std::string &path) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+      ::close(fd);
+      return false;
+    }
+    void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                        MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+      return false;
+    }
+    data_ = static_cast<const uint8_t *>(mapped);
+    size_ = static_cast<size_t>(info.st_size);
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+      return false;
+    }
+    buffer_.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(buffer_.data()), buffer_.size())) {
+      return false;
+    }
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return size_ > 0;
+#endif
+  }
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::vector<uint8_t> buffer_;
+#endif
+};
+
+gene_llm_embed_context *embed_context(gene_llm_model *model,
+                                      const gene_llm_embed_options *options,
+                                      gene_llm_error *err) {
+  const int pooling =
+      options && options->pooling > 0 ? options->pooling : GENE_LLM_POOLING_MEAN;
+  const int batch_size = std::min(
+      model->default_ctx, options && options->batch_size > 0
+                              ? options->batch_size
+                              : kDefaultEmbedBatchSize);
+  const int threads = options && options->threads > 0 ? options->threads : 0;
+  const std::string key = std::to_string(pooling) + ":" +
+                          std::to_string(batch_size) + ":" +
+                          std::to_string(threads);
+
+  std::lock_guard<std::mutex> lock(model->embed_mutex);
+  auto it = model->embed_ctxs.find(key);
+  if (it != model->embed_ctxs.end()) {
+    return &it->second;
+  }
+
+  llama_context_params ctx_params = llama_context_default_params();
+  // Every input must fit in one ubatch so non-causal models see it whole.
+  ctx_params.n_ctx = batch_size;
+  ctx_params.n_batch = batch_size;
+  ctx_params.n_ubatch = batch_size;
+  ctx_params.n_seq_max = kMaxEmbedSequences;
+  ctx_params.kv_unified = true;
+  ctx_params.embeddings = true;
+  ctx_params.pooling_type = static_cast<enum llama_pooling_type>(pooling);
+
+  threadpool_ref pool;
+  llama_context *ctx = new_context(model->model, ctx_params, threads, pool);
+  if (!ctx) {
+    set_error(err, 1, "failed to create embedding context");
+    return nullptr;
+  }
+  gene_llm_embed_context &entry = model->embed_ctxs[key];
+  entry.ctx = ctx;
+  entry.pool = std::move(pool);
+  return &entry;
+}
+
+// Copies the pooled vector of every sequence in the batch to out and clears
+// the context for the next batch.
+bool collect_embeddings(llama_context *ctx, int n_seqs, int first_index,
+                        int dim, bool normalize, float *out,
+                        gene_llm_error *err) {
+  for (int s = 0; s < n_seqs; ++s) {
+    const float *embd = llama_get_embeddings_seq(ctx, s);
+    if (!embd) {
+      set_error(err, 1, "model did not produce pooled embeddings");
+      return false;
+    }
+    float *dst = out + static_cast<size_t>(first_index + s) * dim;
+    double norm = 0.0;
+    for (int i = 0; i < dim; ++i) {
+      dst[i] = embd[i];
+      norm += static_cast<double>(embd[i]) * embd[i];
+    }
+    if (normalize && norm > 0.0) {
+      const float scale = static_cast<float>(1.0 / std::sqrt(norm));
+      for (int i = 0; i < dim; ++i) {
+        dst[i] *= scale;
       }
     }
+  }
+  auto *memory = llama_get_memory(ctx);
+  if (memory) {
+    llama_memory_clear(memory, true);
+  }
+  return true;
+}
 
-    completion_text.append(buffer, piece_len);
-    token_texts.emplace_back(buffer, piece_len);
+// Caller holds engine->mutex. Releases the request's sequence and sampler and
+// publishes it to pollers.
+void engine_finish_locked(gene_llm_engine *engine,
+                          gene_llm_engine_request *req,
+                          gene_llm_finish_reason reason) {
+  req->finish_reason = reason;
+  req->latency_ms =
+      static_cast<int>((llama_time_us() - req->start_us) / 1000);
+  // Occupancy is engine-wide: every admitted sequence shares the context.
+  int kv_used = 0;
+  for (const auto *active : engine->active) {
+    kv_used += static_cast<int>(active->n_pos);
+  }
+  req->timings.end_us = llama_time_us();
+  req->timings.kv_used = kv_used;
+  req->timings.kv_size = engine->n_ctx;
+  record_request(req->timings, req->output.token_count(), GENE_LLM_OK,
+                 req->error.empty() ? reason : GENE_LLM_FINISH_ERROR);
+  if (req->seq_id >= 0) {
+    auto *memory = llama_get_memory(engine->ctx);
+    if (memory) {
+      llama_memory_seq_rm(memory, req->seq_id, -1, -1);
+    }
+    engine->free_seqs.push_back(req->seq_id);
+    req->seq_id = -1;
+  }
+  if (req->sampler) {
+    llama_sampler_free(req->sampler);
+    req->sampler = nullptr;
+  }
+  req->done = true;
+}
 
-    llama_batch next_batch = llama_batch_get_one(&new_token, 1);
-    if (llama_decode(session->ctx, next_batch) != 0) {
-      llama_sampler_free(sampler);
-      set_error(err, 1, "failed to evaluate generated token");
-      return GENE_LLM_ERR_GENERAL;
+using engine_outcome =
+    std::pair<gene_llm_engine_request *, gene_llm_finish_reason>;
+
+// Runs one llama_decode over every admitted request: one token for each
+// request that is generating, then prompt chunks from requests still in
+// prefill until the batch is full. Only the scheduler thread calls this.
+void engine_step(gene_llm_engine *engine, llama_batch &batch,
+                 const std::vector<gene_llm_engine_request *> &step,
+                 std::vector<engine_outcome> &finished) {
+  std::vector<gene_llm_engine_request *> participants;
+  // Decode progress before this step, restored when the batch is rebuilt.
+  std::vector<std::pair<llama_pos, size_t>> saved;
+  saved.reserve(step.size());
+  for (const auto *req : step) {
+    saved.emplace_back(req->n_pos, req->n_prompt_decoded);
+  }
+
+  auto add_token = [&](gene_llm_engine_request *req, llama_token token,
+                       bool logits) {
+    const int32_t i = batch.n_tokens++;
+    batch.token[i] = token;
+    batch.pos[i] = req->n_pos++;
+    batch.n_seq_id[i] = 1;
+    batch.seq_id[i][0] = req->seq_id;
+    batch.logits[i] = logits;
+    return i;
+  };
+
+  auto build = [&](int budget) {
+    participants.clear();
+    batch.n_tokens = 0;
+    // Generating requests go first so long prefills cannot starve them.
+    for (auto *req : step) {
+      req->logits_index = -1;
+      if (req->n_prompt_decoded == req->prompt.size() &&
+          batch.n_tokens < budget) {
+        req->logits_index = add_token(req, req->pending_token, true);
+        participants.push_back(req);
+      }
+    }
+    for (auto *req : step) {
+      const size_t remaining = req->prompt.size() - req->n_prompt_decoded;
+      if (remaining == 0 || batch.n_tokens >= budget) {
+        continue;
+      }
+      const size_t take =
+          std::min(remaining, static_cast<size_t>(budget - batch.n_tokens));
+      for (size_t k = 0; k < take; ++k) {
+        const bool last = req->n_prompt_decoded + k + 1 == req->prompt.size();
+        const int32_t i =
+            add_token(req, req->prompt[req->n_prompt_decoded + k], last);
+        if (last) {
+          req->logits_index = i;
+        }
+      }
+      req->n_prompt_decoded += take;
+      participants.push_back(req);
+    }
+  };
+
+  int budget = engine->n_batch;
+  int32_t rc = 0;
+  while (true) {
+    build(budget);
+    if (batch.n_tokens == 0) {
+      return;
+    }
+    rc = decode_batch(engine->threadpool, engine->ctx, batch);
+    if (rc != 1) {
+      break;
+    }
+    // No KV slot for the batch. llama_decode left the cache as it was, so
+    // undo the positions handed out and retry with a smaller batch.
+    for (size_t k = 0; k < step.size(); ++k) {
+      step[k]->n_pos = saved[k].first;
+      step[k]->n_prompt_decoded = saved[k].second;
+      step[k]->logits_index = -1;
+    }
+    if (budget > 1) {
+      budget /= 2;
+      continue;
+    }
+    // Not even one token fits: fail the sequence holding the most cells.
+    // Its cells are released before the next step, so the others go on.
+    auto *victim = *std::max_element(
+        step.begin(), step.end(),
+        [](const gene_llm_engine_request *a,
+           const gene_llm_engine_request *b) { return a->n_pos < b->n_pos; });
+    victim->error = "engine context is full";
+    finished.emplace_back(victim, GENE_LLM_FINISH_ERROR);
+    return;
+  }
+  if (rc != 0) {
+    for (auto *req : participants) {
+      req->error = "failed to evaluate batch";
+      finished.emplace_back(req, GENE_LLM_FINISH_ERROR);
+    }
+    return;
+  }
+
+  const llama_vocab *vocab = engine->model->vocab;
+  for (auto *req : participants) {
+    if (req->logits_index < 0) {
+      continue;
+    }
+    const llama_token token =
+        llama_sampler_sample(req->sampler, engine->ctx, req->logits_index);
+    if (req->timings.first_token_us == 0) {
+      // Sampling follows the decode that finished the prompt.
+      req->timings.prefill_done_us = llama_time_us();
+      req->timings.first_token_us = req->timings.prefill_done_us;
+    }
+    if (llama_vocab_is_eog(vocab, token)) {
+      finished.emplace_back(req, GENE_LLM_FINISH_STOP);
+      continue;
+    }
+
+    if (append_token(vocab, token, req->output) < 0) {
+      req->error = "failed to convert token to text";
+      finished.emplace_back(req, GENE_LLM_FINISH_ERROR);
+      continue;
+    }
+    req->pending_token = token;
+
+    if (req->output.token_count() >= req->max_tokens ||
+        req->n_pos >= engine->n_ctx) {
+      finished.emplace_back(req, GENE_LLM_FINISH_LENGTH);
     }
   }
+}
+
+void engine_loop(gene_llm_engine *engine) {
+  llama_batch batch = llama_batch_init(engine->n_batch, 0, 1);
+  std::vector<gene_llm_engine_request *> step;
+  std::vector<engine_outcome> finished;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(engine->mutex);
+      engine->work_cv.wait(lock, [engine]() {
+        return engine->stopping || !engine->pending.empty() ||
+               !engine->active.empty();
+      });
+      if (engine->stopping) {
+        break;
+      }
+
+      bool retired = false;
+      const int64_t now_us = llama_time_us();
+      for (auto it = engine->active.begin(); it != engine->active.end();) {
+        if ((*it)->cancel_requested ||
+            ((*it)->deadline_us > 0 && now_us >= (*it)->deadline_us)) {
+          engine_finish_locked(engine, *it, GENE_LLM_FINISH_CANCELLED);
+          it = engine->active.erase(it);
+          retired = true;
+        } else {
+          ++it;
+        }
+      }
+      if (retired) {
+        engine->done_cv.notify_all();
+      }
+
+      // Admission happens only between decode steps.
+      while (!engine->pending.empty() && !engine->free_seqs.empty()) {
+        gene_llm_engine_request *req = engine->pending.front();
+        engine->pending.pop_front();
+        req->seq_id = engine->free_seqs.back();
+        engine->free_seqs.pop_back();
+        engine->active.push_back(req);
+      }
+      step = engine->active;
+    }
+
+    if (step.empty()) {
+      continue;
+    }
+
+    finished.clear();
+    engine_step(engine, batch, step, finished);
+    if (finished.empty()) {
+      continue;
+    }
 
-  if (!cancelled && static_cast<int>(token_texts.size()) >= max_tokens) {
-    finish_reason = GENE_LLM_FINISH_LENGTH;
+    std::lock_guard<std::mutex> lock(engine->mutex);
+    for (const auto &outcome : finished) {
+      engine_finish_locked(engine, outcome.first, outcome.second);
+      engine->active.erase(std::remove(engine->active.begin(),
+                                       engine->active.end(), outcome.first),
+                           engine->active.end());
+    }
+    engine->done_cv.notify_all();
   }
 
-  const int64_t end_us = llama_time_us();
-  const int latency_ms = static_cast<int>((end_us - start_us) / 1000);
+  llama_batch_free(batch);
+}
 
-  fill_completion(completion_text, token_texts, finish_reason, latency_ms,
-                  out_completion);
+bool async_open_fds(gene_llm_async_queue *queue) {
+#if defined(__linux__)
+  const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  queue->read_fd = fd;
+  queue->write_fd = fd;
+#elif !defined(_WIN32)
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  for (const int fd : fds) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+  queue->read_fd = fds[0];
+  queue->write_fd = fds[1];
+#else
+  (void)queue;
+#endif
+  return true;
+}
 
-  llama_sampler_free(sampler);
-  return GENE_LLM_OK;
+void async_close_fds(gene_llm_async_queue *queue) {
+#ifndef _WIN32
+  if (queue->read_fd >= 0) {
+    close(queue->read_fd);
+  }
+  if (queue->write_fd >= 0 && queue->write_fd != queue->read_fd) {
+    close(queue->write_fd);
+  }
+#endif
+  queue->read_fd = -1;
+  queue->write_fd = -1;
+}
+
+// Makes read_fd readable. The fd stays level-triggered until every event has
+// been drained, so a wakeup is never lost. Called with queue->mutex held.
+void async_signal_locked(gene_llm_async_queue *queue) {
+  if (queue->signalled || queue->write_fd < 0) {
+    return;
+  }
+  queue->signalled = true;
+#if defined(__linux__)
+  const uint64_t one = 1;
+  const ssize_t rc = write(queue->write_fd, &one, sizeof(one));
+  (void)rc;
+#elif !defined(_WIN32)
+  const char byte = 1;
+  const ssize_t rc = write(queue->write_fd, &byte, 1);
+  (void)rc;
+#endif
+}
+
+void async_clear_locked(gene_llm_async_queue *queue) {
+  if (!queue->signalled || queue->read_fd < 0) {
+    return;
+  }
+  queue->signalled = false;
+#if defined(__linux__)
+  uint64_t value = 0;
+  const ssize_t rc = read(queue->read_fd, &value, sizeof(value));
+  (void)rc;
+#elif !defined(_WIN32)
+  char buffer[64];
+  while (read(queue->read_fd, buffer, sizeof(buffer)) > 0) {
+  }
+#endif
+}
+
+void async_push_locked(gene_llm_async_queue *queue,
+                       gene_llm_async_event_record &&event) {
+  queue->events.push_back(std::move(event));
+  async_signal_locked(queue);
+}
+
+bool async_job_cancelled(const gene_llm_async_job *job) {
+  return job->cancel_requested.load(std::memory_order_relaxed) ||
+         (job->stream && job->stream->cancelled.load(std::memory_order_relaxed));
+}
+
+int async_progress_callback(int, int, void *user_data) {
+  auto *job = static_cast<gene_llm_async_job *>(user_data);
+  return async_job_cancelled(job) ? 1 : 0;
+}
+
+void stream_write(gene_llm_stream *stream, const char *data, size_t len) {
+  if (!stream->spilling.load(std::memory_order_acquire)) {
+    const uint64_t head = stream->head.load(std::memory_order_relaxed);
+    const uint64_t tail = stream->tail.load(std::memory_order_acquire);
+    if (stream->ring.size() - (head - tail) >= len) {
+      for (size_t i = 0; i < len; ++i) {
+        stream->ring[(head + i) & stream->mask] = data[i];
+      }
+      stream->head.store(head + len, std::memory_order_release);
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> lock(stream->spill_mutex);
+  stream->spill.append(data, len);
+  stream->spilling.store(true, std::memory_order_release);
+}
+
+// Claims the wakeup for the bytes written so far; false while one is
+// already outstanding. The caller then signals the queue.
+bool stream_claim_signal(gene_llm_stream *stream, int64_t now) {
+  if (stream->wake_pending.exchange(true, std::memory_order_acq_rel)) {
+    return false;
+  }
+  stream->unsignalled.store(0, std::memory_order_relaxed);
+  stream->last_signal_us.store(now, std::memory_order_relaxed);
+  return true;
+}
+
+// Wakes the reader through the queue's descriptor once enough output has
+// piled up (or enough time has passed) and no wakeup is outstanding.
+void stream_maybe_signal(gene_llm_async_queue *queue, gene_llm_stream *stream,
+                         size_t len) {
+  const size_t unsignalled =
+      stream->unsignalled.fetch_add(len, std::memory_order_relaxed) + len;
+  const int64_t now = llama_time_us();
+  if (unsignalled < stream->flush_bytes &&
+      now - stream->last_signal_us.load(std::memory_order_relaxed) <
+          stream->flush_us) {
+    return;
+  }
+  if (!stream_claim_signal(stream, now)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  async_signal_locked(queue);
+}
+
+// Signals streamed bytes that have waited flush_us without a later piece to
+// carry them. The running job is read under the queue mutex, which the
+// worker also holds while it retires the job, so the stream outlives the
+// check.
+void async_flusher(gene_llm_async_queue *queue) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  while (!queue->stopping) {
+    gene_llm_stream *stream =
+        queue->running ? queue->running->stream : nullptr;
+    if (!stream) {
+      queue->flush_cv.wait(lock);
+      continue;
+    }
+    const int64_t now = llama_time_us();
+    const int64_t due =
+        stream->last_signal_us.load(std::memory_order_relaxed) +
+        stream->flush_us;
+    if (now >= due &&
+        stream->unsignalled.load(std::memory_order_relaxed) > 0 &&
+        stream_claim_signal(stream, now)) {
+      async_signal_locked(queue);
+    }
+    // Not due yet, nothing pending, or a wakeup still unread: look again
+    // when the next interval could expire.
+    const int64_t wait_us = now < due ? due - now : stream->flush_us;
+    queue->flush_cv.wait_for(lock, std::chrono::microseconds(wait_us));
+  }
+}
+
+int async_token_callback(char *token, int token_len, void *user_data) {
+  auto *job = static_cast<gene_llm_async_job *>(user_data);
+  if (async_job_cancelled(job)) {
+    return 1;
+  }
+  if (job->stream) {
+    stream_write(job->stream, token, static_cast<size_t>(token_len));
+    stream_maybe_signal(job->queue, job->stream, static_cast<size_t>(token_len));
+  } else if (job->stream_tokens) {
+    gene_llm_async_event_record event;
+    event.request_id = job->id;
+    event.kind = GENE_LLM_EVENT_TOKEN;
+    event.text.assign(token, static_cast<size_t>(token_len));
+    std::lock_guard<std::mutex> lock(job->queue->mutex);
+    async_push_locked(job->queue, std::move(event));
+  }
+  return 0;
+}
+
+void async_worker(gene_llm_async_queue *queue) {
+  while (true) {
+    std::unique_ptr<gene_llm_async_job> job;
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      queue->work_cv.wait(
+          lock, [queue]() { return queue->stopping || !queue->jobs.empty(); });
+      if (queue->stopping) {
+        return;
+      }
+      job = std::move(queue->jobs.front());
+      queue->jobs.pop_front();
+      queue->running = job.get();
+    }
+    if (job->stream) {
+      queue->flush_cv.notify_one();
+    }
+
+    gene_llm_async_event_record event;
+    event.request_id = job->id;
+    event.kind = GENE_LLM_EVENT_DONE;
+    if (async_job_cancelled(job.get())) {
+      event.summary.finish_reason = GENE_LLM_FINISH_CANCELLED;
+    } else {
+      gene_llm_error err{};
+      // The completion is built straight into the event's arena, so it
+      // survives later requests on the same session.
+      if (run_inference(job->session, &job->options, async_token_callback,
+                        job.get(), &event.arena, &event.summary,
+                        &err) != GENE_LLM_OK) {
+        event.kind = GENE_LLM_EVENT_ERROR;
+        event.text = err.message;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->running = nullptr;
+    async_push_locked(queue, std::move(event));
+  }
+}
+
+ggml_type kv_cache_type(gene_llm_kv_type type) {
+  switch (type) {
+  case GENE_LLM_KV_Q8_0:
+    return GGML_TYPE_Q8_0;
+  case GENE_LLM_KV_Q4_0:
+    return GGML_TYPE_Q4_0;
+  default:
+    return GGML_TYPE_F16;
+  }
+}
+
+} // namespace
+
+void gene_llm_backend_init(void) { ensure_backend_init(); }
+
+gene_llm_status
+gene_llm_configure_threadpool(const gene_llm_threadpool_options *options,
+                              gene_llm_error *err) {
+  ensure_backend_init();
+  threadpool_ref pool = make_threadpool(options, err);
+  if (!pool) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  log_message(GENE_LLM_LOG_DEBUG, "threadpool: threads=%d, cpus=%d, prio=%d",
+              pool->threads, options ? options->cpu_count : 0,
+              options ? options->priority : 0);
+  std::lock_guard<std::mutex> lock(g_threadpool_mutex);
+  g_threadpool = std::move(pool);
+  return GENE_LLM_OK;
+}
+
+int gene_llm_threadpool_size(void) {
+  threadpool_ref pool = shared_threadpool();
+  return pool ? pool->threads : 0;
+}
+
+void gene_llm_set_log_callback(gene_llm_log_callback callback,
+                               void *user_data) {
+  std::lock_guard<std::mutex> lock(g_log_mutex);
+  g_log_callback = callback;
+  g_log_user_data = user_data;
+}
+
+void gene_llm_get_stats(gene_llm_stats *out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  const auto load = [](const std::atomic<int64_t> &counter) {
+    return counter.load(std::memory_order_relaxed);
+  };
+  out_stats->requests = load(g_counters.requests);
+  out_stats->failed_requests = load(g_counters.failed_requests);
+  out_stats->cancelled_requests = load(g_counters.cancelled_requests);
+  out_stats->prompt_tokens = load(g_counters.prompt_tokens);
+  out_stats->cached_tokens = load(g_counters.cached_tokens);
+  out_stats->generated_tokens = load(g_counters.generated_tokens);
+  out_stats->prefill_ms = load(g_counters.prefill_us) / 1000.0;
+  out_stats->decode_ms = load(g_counters.decode_us) / 1000.0;
+  out_stats->models = load(g_counters.models);
+  out_stats->sessions = load(g_counters.sessions);
+  out_stats->engines = load(g_counters.engines);
+}
+
+void gene_llm_reset_stats(void) {
+  for (auto *counter :
+       {&g_counters.requests, &g_counters.failed_requests,
+        &g_counters.cancelled_requests, &g_counters.prompt_tokens,
+        &g_counters.cached_tokens, &g_counters.generated_tokens,
+        &g_counters.prefill_us, &g_counters.decode_us}) {
+    counter->store(0, std::memory_order_relaxed);
+  }
+}
+
+gene_llm_status gene_llm_load_model(const char *path,
+                                    const gene_llm_model_options *options,
+                                    gene_llm_model **out_model,
+                                    gene_llm_error *err) {
+  if (!path || !out_model) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  ensure_backend_init();
+
+  llama_model_params params = llama_model_default_params();
+  if (options) {
+    params.n_gpu_layers = std::max(0, options->gpu_layers);
+    params.use_mmap = options->use_mmap;
+    params.use_mlock = options->use_mlock;
+  }
+
+  llama_model *model = llama_model_load_from_file(path, params);
+  if (!model) {
+    set_error(err, 1, "failed to load GGUF model");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  auto *wrapper = new gene_llm_model();
+  wrapper->model = model;
+  wrapper->vocab = llama_model_get_vocab(model);
+  wrapper->default_ctx = llama_model_n_ctx_train(model);
+  if (wrapper->default_ctx <= 0) {
+    wrapper->default_ctx = 4096;
+  }
+  wrapper->fingerprint = model_fingerprint(path);
+  if (options && options->state_cache_dir) {
+    wrapper->state_cache_dir = options->state_cache_dir;
+  }
+
+  g_counters.models.fetch_add(1, std::memory_order_relaxed);
+  *out_model = wrapper;
+  return GENE_LLM_OK;
+}
+
+void gene_llm_free_model(gene_llm_model *model) {
+  if (!model) {
+    return;
+  }
+  if (!model->registry_key.empty()) {
+    gene_llm_release_model(model);
+    return;
+  }
+  destroy_model(model);
+}
+
+void gene_llm_registry_configure(const gene_llm_registry_options *options) {
+  std::vector<gene_llm_model *> evicted;
+  {
+    std::lock_guard<std::mutex> lock(g_registry.mutex);
+    g_registry.budget_bytes = options ? options->memory_budget_bytes : 0;
+    evicted = registry_trim_locked();
+  }
+  destroy_models(evicted);
+}
+
+gene_llm_status gene_llm_acquire_model(const char *path,
+                                       const gene_llm_model_options *options,
+                                       gene_llm_model **out_model,
+                                       gene_llm_error *err) {
+  if (!path || !out_model) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  const std::string key = registry_key(path, options);
+
+  std::unique_lock<std::mutex> lock(g_registry.mutex);
+  for (;;) {
+    auto it = g_registry.models.find(key);
+    if (it != g_registry.models.end()) {
+      ++g_registry.hits;
+      ++it->second->users;
+      *out_model = it->second;
+      return GENE_LLM_OK;
+    }
+    auto pending = g_registry.loading.find(key);
+    if (pending == g_registry.loading.end()) {
+      break;
+    }
+    std::shared_ptr<gene_llm_registry_load> load = pending->second;
+    load->done_cv.wait(lock, [&] { return load->done; });
+    if (load->failed) {
+      set_error(err, 1, load->error);
+      return GENE_LLM_ERR_GENERAL;
+    }
+  }
+
+  // Loads run without the registry lock so other models stay available;
+  // the loading entry makes later acquirers of this key wait instead.
+  ++g_registry.misses;
+  auto load = std::make_shared<gene_llm_registry_load>();
+  g_registry.loading.emplace(key, load);
+  lock.unlock();
+  gene_llm_model *model = nullptr;
+  gene_llm_error load_err{};
+  const gene_llm_status status =
+      gene_llm_load_model(path, options, &model, &load_err);
+  lock.lock();
+  g_registry.loading.erase(key);
+  load->done = true;
+  if (status != GENE_LLM_OK) {
+    load->failed = true;
+    load->error = load_err.message;
+    load->done_cv.notify_all();
+    set_error(err, load_err.code, load_err.message);
+    return GENE_LLM_ERR_GENERAL;
+  }
+  model->registry_key = key;
+  model->bytes = llama_model_size(model->model);
+  model->users = 1;
+  g_registry.models.emplace(key, model);
+  g_registry.resident_bytes += model->bytes;
+  load->done_cv.notify_all();
+  // Makes room by dropping idle models; the new one is in use.
+  const std::vector<gene_llm_model *> evicted = registry_trim_locked();
+  lock.unlock();
+  destroy_models(evicted);
+  *out_model = model;
+  return GENE_LLM_OK;
+}
+
+void gene_llm_release_model(gene_llm_model *model) {
+  registry_release(model);
+}
+
+gene_llm_status gene_llm_preload_model(const char *path,
+                                       const gene_llm_model_options *options,
+                                       gene_llm_error *err) {
+  gene_llm_model *model = nullptr;
+  if (gene_llm_acquire_model(path, options, &model, err) != GENE_LLM_OK) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  gene_llm_release_model(model);
+  return GENE_LLM_OK;
+}
+
+void gene_llm_registry_get_stats(gene_llm_registry_stats *out_stats) {
+  if (!out_stats) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(g_registry.mutex);
+  out_stats->loaded = static_cast<int>(g_registry.models.size());
+  out_stats->in_use = 0;
+  for (const auto &entry : g_registry.models) {
+    if (entry.second->users > 0) {
+      ++out_stats->in_use;
+    }
+  }
+  out_stats->resident_bytes = g_registry.resident_bytes;
+  out_stats->budget_bytes = g_registry.budget_bytes;
+  out_stats->hits = g_registry.hits;
+  out_stats->misses = g_registry.misses;
+  out_stats->evictions = g_registry.evictions;
+}
+
+gene_llm_status gene_llm_new_session(gene_llm_model *model,
+                                     const gene_llm_session_options *options,
+                                     gene_llm_session **out_session,
+                                     gene_llm_error *err) {
+  if (!model || !out_session) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  llama_context_params ctx_params = llama_context_default_params();
+  const int ctx_len = options && options->context_length > 0
+                          ? options->context_length
+                          : model->default_ctx;
+  ctx_params.n_ctx = ctx_len;
+  // Prompts are decoded in batch_size chunks, so compute buffers scale with
+  // the batch rather than the context length.
+  const int batch_size = std::min(
+      ctx_len, options && options->batch_size > 0 ? options->batch_size
+                                                  : kDefaultBatchSize);
+  const int ubatch_size = std::min(
+      batch_size, options && options->ubatch_size > 0 ? options->ubatch_size
+                                                      : batch_size);
+  ctx_params.n_batch = batch_size;
+  ctx_params.n_ubatch = ubatch_size;
+  llama_context_params draft_params = ctx_params;
+  // n-best branches are extra sequences over one unified KV cache, so the
+  // whole context stays available to a single branch as well.
+  const int max_branches =
+      options && options->max_branches > 1 ? options->max_branches : 1;
+  if (max_branches > 1) {
+    ctx_params.n_seq_max = static_cast<uint32_t>(max_branches);
+    ctx_params.kv_unified = true;
+  }
+  if (options) {
+    ctx_params.type_k = kv_cache_type(options->type_k);
+    ctx_params.type_v = kv_cache_type(options->type_v);
+    switch (options->flash_attn) {
+    case GENE_LLM_FLASH_ATTN_ON:
+      ctx_params.flash_attn_type = LLAMA_FLASH_ATTN_TYPE_ENABLED;
+      break;
+    case GENE_LLM_FLASH_ATTN_OFF:
+      ctx_params.flash_attn_type = LLAMA_FLASH_ATTN_TYPE_DISABLED;
+      break;
+    default:
+      ctx_params.flash_attn_type = LLAMA_FLASH_ATTN_TYPE_AUTO;
+      break;
+    }
+    if (options->type_v != GENE_LLM_KV_F16 &&
+        options->flash_attn == GENE_LLM_FLASH_ATTN_OFF) {
+      set_error(err, 1, "a quantized V cache needs flash attention");
+      return GENE_LLM_ERR_GENERAL;
+    }
+  }
+
+  log_message(GENE_LLM_LOG_DEBUG,
+              "new_session: ctx_len=%d, n_batch=%d, n_ubatch=%d, branches=%d",
+              ctx_len, ctx_params.n_batch, ctx_params.n_ubatch, max_branches);
+
+  const int threads = options ? options->threads : 0;
+  threadpool_ref pool;
+  llama_context *ctx = new_context(model->model, ctx_params, threads, pool);
+  if (!ctx) {
+    set_error(err, 1, "failed to create llama context");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  llama_context *draft_ctx = nullptr;
+  gene_llm_model *draft = options ? options->draft_model : nullptr;
+  if (draft && !llama_model_has_encoder(model->model)) {
+    if (!draft_vocab_compatible(model, draft)) {
+      llama_free(ctx);
+      set_error(err, 1, "draft model vocabulary does not match the model");
+      return GENE_LLM_ERR_GENERAL;
+    }
+    draft_ctx = new_context(draft->model, draft_params, threads, pool);
+    if (!draft_ctx) {
+      llama_free(ctx);
+      set_error(err, 1, "failed to create draft llama context");
+      return GENE_LLM_ERR_GENERAL;
+    }
+  }
+
+  auto *session = new gene_llm_session();
+  session->model = model;
+  session->ctx = ctx;
+  session->threadpool = std::move(pool);
+  registry_retain(model);
+  if (draft_ctx) {
+    session->draft_model = draft;
+    registry_retain(draft);
+    session->draft_ctx = draft_ctx;
+    session->draft_sampler = llama_sampler_init_greedy();
+    session->draft_n = options->draft_tokens > 0 ? options->draft_tokens
+                                                 : kDefaultDraftTokens;
+    session->spec_batch = llama_batch_init(session->draft_n + 1, 0, 1);
+  }
+  session->threads = ctx_params.n_threads;
+  session->max_branches = max_branches;
+  session->context_shift = options && options->context_shift;
+  session->keep_tokens = options ? std::max(0, options->keep_tokens) : 0;
+  session->default_max_tokens =
+      options && options->max_tokens > 0 ? options->max_tokens : 256;
+  session->default_temperature = options ? options->temperature : 0.7f;
+  session->default_top_p = options ? options->top_p : 0.9f;
+  session->default_top_k = options && options->top_k > 0 ? options->top_k : 40;
+  session->default_seed = options && options->seed != 0
+                              ? static_cast<uint32_t>(options->seed)
+                              : LLAMA_DEFAULT_SEED;
+
+  g_counters.sessions.fetch_add(1, std::memory_order_relaxed);
+  *out_session = session;
+  return GENE_LLM_OK;
+}
+
+void gene_llm_free_session(gene_llm_session *session) {
+  if (!session) {
+    return;
+  }
+  if (session->ctx) {
+    llama_free(session->ctx);
+  }
+  if (session->draft_ctx) {
+    llama_batch_free(session->spec_batch);
+    llama_sampler_free(session->draft_sampler);
+    llama_free(session->draft_ctx);
+  }
+  registry_release(session->draft_model);
+  registry_release(session->model);
+  g_counters.sessions.fetch_sub(1, std::memory_order_relaxed);
+  delete session;
+}
+
+gene_llm_status gene_llm_infer(gene_llm_session *session,
+                               const gene_llm_infer_options *options,
+                               gene_llm_completion *out_completion,
+                               gene_llm_error *err) {
+  return run_inference(session, options, nullptr, nullptr, nullptr,
+                       out_completion, err);
+}
+
+gene_llm_status gene_llm_infer_n(gene_llm_session *session,
+                                 const gene_llm_infer_options *options,
+                                 gene_llm_completion *out_completions,
+                                 gene_llm_error *err) {
+  return run_inference_n(session, options, out_completions, err);
+}
+
+void gene_llm_free_completion(gene_llm_completion *completion) {
+  if (!completion) {
+    return;
+  }
+  // The buffers belong to the session (or engine) arena; just detach.
+  completion->text = nullptr;
+  completion->text_len = 0;
+  completion->token_ids = nullptr;
+  completion->token_offsets = nullptr;
+  completion->token_count = 0;
+}
+
+gene_llm_status gene_llm_infer_streaming(gene_llm_session *session,
+                                         const gene_llm_infer_options *options,
+                                         gene_llm_token_callback callback,
+                                         void *user_data,
+                                         gene_llm_completion *out_completion,
+                                         gene_llm_error *err) {
+  return run_inference(session, options, callback, user_data, nullptr,
+                       out_completion, err);
+}
+
+gene_llm_status gene_llm_new_engine(gene_llm_model *model,
+                                    const gene_llm_engine_options *options,
+                                    gene_llm_engine **out_engine,
+                                    gene_llm_error *err) {
+  if (!model || !out_engine) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  if (llama_model_has_encoder(model->model)) {
+    set_error(err, 1, "engine does not support encoder-decoder models");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  const int max_sequences =
+      options && options->max_sequences > 0 ? options->max_sequences : 4;
+
+  llama_context_params ctx_params = llama_context_default_params();
+  ctx_params.n_ctx = options && options->context_length > 0
+                         ? options->context_length
+                         : model->default_ctx;
+  // Every generating sequence needs one slot per step.
+  const int batch_size = std::max(
+      max_sequences, options && options->batch_size > 0 ? options->batch_size
+                                                        : kDefaultBatchSize);
+  ctx_params.n_batch = batch_size;
+  ctx_params.n_ubatch = batch_size;
+  ctx_params.n_seq_max = max_sequences;
+  ctx_params.kv_unified = true;
+
+  threadpool_ref pool;
+  llama_context *ctx = new_context(model->model, ctx_params,
+                                   options ? options->threads : 0, pool);
+  if (!ctx) {
+    set_error(err, 1, "failed to create llama context");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  auto *engine = new gene_llm_engine();
+  engine->model = model;
+  registry_retain(model);
+  engine->ctx = ctx;
+  engine->threadpool = std::move(pool);
+  engine->n_batch = static_cast<int>(llama_n_batch(ctx));
+  engine->n_ctx = static_cast<int>(llama_n_ctx(ctx));
+  engine->default_max_tokens =
+      options && options->max_tokens > 0 ? options->max_tokens : 256;
+  engine->default_temperature = options ? options->temperature : 0.7f;
+  engine->default_top_p = options ? options->top_p : 0.9f;
+  engine->default_top_k = options && options->top_k > 0 ? options->top_k : 40;
+  engine->default_seed = options && options->seed != 0
+                             ? static_cast<uint32_t>(options->seed)
+                             : LLAMA_DEFAULT_SEED;
+  for (int seq = max_sequences - 1; seq >= 0; --seq) {
+    engine->free_seqs.push_back(seq);
+  }
+  engine->worker = std::thread(engine_loop, engine);
+
+  g_counters.engines.fetch_add(1, std::memory_order_relaxed);
+  *out_engine = engine;
+  return GENE_LLM_OK;
+}
+
+void gene_llm_free_engine(gene_llm_engine *engine) {
+  if (!engine) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(engine->mutex);
+    engine->stopping = true;
+  }
+  engine->work_cv.notify_all();
+  if (engine->worker.joinable()) {
+    engine->worker.join();
+  }
+  for (auto &entry : engine->requests) {
+    if (entry.second->sampler) {
+      llama_sampler_free(entry.second->sampler);
+    }
+  }
+  engine->requests.clear();
+  if (engine->ctx) {
+    llama_free(engine->ctx);
+  }
+  registry_release(engine->model);
+  g_counters.engines.fetch_sub(1, std::memory_order_relaxed);
+  delete engine;
+}
+
+gene_llm_status gene_llm_submit(gene_llm_engine *engine,
+                                const gene_llm_infer_options *options,
+                                int64_t *out_request_id,
+                                gene_llm_error *err) {
+  if (!engine || !options || !has_prompt(options) || !out_request_id) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  auto req = std::make_unique<gene_llm_engine_request>();
+  if (request_prompt_tokens(engine->model, options, req->prompt, err) < 0) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  if (static_cast<int>(req->prompt.size()) >= engine->n_ctx) {
+    set_error(err, 1, "prompt does not fit in the engine context");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  req->max_tokens = options->max_tokens > 0 ? options->max_tokens
+                                            : engine->default_max_tokens;
+  const float temperature = options->temperature > 0.0f
+                                ? options->temperature
+                                : engine->default_temperature;
+  const float top_p =
+      options->top_p > 0.0f ? options->top_p : engine->default_top_p;
+  const int top_k =
+      options->top_k > 0 ? options->top_k : engine->default_top_k;
+  const uint32_t seed = options->seed > 0 ? static_cast<uint32_t>(options->seed)
+                                          : engine->default_seed;
+  llama_sampler *grammar = nullptr;
+  if (!request_grammar(engine->grammars, engine->model->vocab, options,
+                       &grammar, err)) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  req->sampler = build_sampler(temperature, top_p, top_k, seed, grammar);
+  if (!req->sampler) {
+    set_error(err, 1, "failed to construct sampler chain");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  req->start_us = llama_time_us();
+  req->timings.start_us = req->start_us;
+  req->timings.prompt_tokens = static_cast<int>(req->prompt.size());
+  if (options->timeout_ms > 0) {
+    req->deadline_us =
+        req->start_us + static_cast<int64_t>(options->timeout_ms) * 1000;
+  }
+
+  std::lock_guard<std::mutex> lock(engine->mutex);
+  req->id = engine->next_request_id++;
+  *out_request_id = req->id;
+  gene_llm_engine_request *raw = req.get();
+  engine->requests.emplace(raw->id, std::move(req));
+  if (raw->max_tokens <= 0) {
+    engine_finish_locked(engine, raw, GENE_LLM_FINISH_CANCELLED);
+    return GENE_LLM_OK;
+  }
+  engine->pending.push_back(raw);
+  engine->work_cv.notify_one();
+  return GENE_LLM_OK;
+}
+
+gene_llm_status gene_llm_poll(gene_llm_engine *engine, int64_t request_id,
+                              int timeout_ms,
+                              gene_llm_completion *out_completion,
+                              gene_llm_error *err) {
+  if (!engine || !out_completion) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  std::unique_lock<std::mutex> lock(engine->mutex);
+  auto it = engine->requests.find(request_id);
+  if (it == engine->requests.end()) {
+    set_error(err, 1, "unknown engine request id");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  gene_llm_engine_request *req = it->second.get();
+  if (!req->done && timeout_ms > 0) {
+    engine->done_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                             [req]() { return req->done; });
+  }
+  if (!req->done) {
+    return GENE_LLM_PENDING;
+  }
+
+  gene_llm_status status = GENE_LLM_OK;
+  if (!req->error.empty()) {
+    set_error(err, 1, req->error);
+    status = GENE_LLM_ERR_GENERAL;
+  } else {
+    // Keep the result alive past erase; swapping recycles the buffers.
+    std::swap(engine->poll_arena, req->output);
+    fill_completion(engine->poll_arena, req->finish_reason, req->latency_ms,
+                    out_completion);
+    fill_timings(req->timings, engine->poll_arena.token_count(),
+                 out_completion);
+  }
+  engine->requests.erase(it);
+  return status;
+}
+
+gene_llm_status gene_llm_cancel(gene_llm_engine *engine, int64_t request_id,
+                                gene_llm_error *err) {
+  if (!engine) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  std::lock_guard<std::mutex> lock(engine->mutex);
+  auto it = engine->requests.find(request_id);
+  if (it == engine->requests.end()) {
+    set_error(err, 1, "unknown engine request id");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  gene_llm_engine_request *req = it->second.get();
+  if (req->done) {
+    return GENE_LLM_OK;
+  }
+
+  auto queued =
+      std::find(engine->pending.begin(), engine->pending.end(), req);
+  if (queued != engine->pending.end()) {
+    engine->pending.erase(queued);
+    engine_finish_locked(engine, req, GENE_LLM_FINISH_CANCELLED);
+    engine->done_cv.notify_all();
+  } else {
+    // The scheduler owns the sequence; it retires the request before the
+    // next step.
+    req->cancel_requested = true;
+    engine->work_cv.notify_one();
+  }
+  return GENE_LLM_OK;
+}
+
+gene_llm_status gene_llm_session_save_state(gene_llm_session *session,
+                                            const char *prefix, char *out_key,
+                                            size_t out_key_len,
+                                            gene_llm_error *err) {
+  if (!session || !prefix) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  std::lock_guard<std::mutex> busy(session->mutex);
+  const gene_llm_model *model = session->model;
+  if (model->state_cache_dir.empty()) {
+    set_error(err, 1, "model was loaded without a state cache directory");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  if (llama_model_has_encoder(model->model)) {
+    set_error(err, 1, "state snapshots are not supported for encoder models");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  std::vector<llama_token> tokens;
+  if (tokenize_prompt(model->vocab, prefix, tokens, err) < 0) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  const size_t n_past = reuse_cached_prefix(session, tokens);
+  if (prefill_tokens(session, tokens, n_past, nullptr, 0) !=
+      prefill_result::ok) {
+    set_error(err, 1, "failed to evaluate prefix");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  const size_t state_size = llama_state_seq_get_size(session->ctx, 0);
+  std::vector<uint8_t> state(state_size);
+  if (state_size == 0 ||
+      llama_state_seq_get_data(session->ctx, state.data(), state.size(), 0) !=
+          state_size) {
+    set_error(err, 1, "failed to copy sequence state");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  state_header header;
+  std::memcpy(header.magic, kStateMagic, sizeof(header.magic));
+  header.version = kStateVersion;
+  header.model_hash =
+      fnv1a(model->fingerprint.data(), model->fingerprint.size());
+  header.n_tokens = tokens.size();
+  header.state_size = state_size;
+
+  // Write then rename so concurrent loaders never map a partial file.
+  const std::string key = state_key(model, tokens);
+  const std::string path = state_path(model, key);
+  const std::string tmp_path =
+      path + ".tmp" + std::to_string(static_cast<long long>(llama_time_us()));
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(tokens.data()),
+              tokens.size() * sizeof(llama_token));
+    out.write(reinterpret_cast<const char *>(state.data()), state.size());
+    if (!out) {
+      std::remove(tmp_path.c_str());
+      set_error(err, 1, "failed to write state snapshot " + tmp_path);
+      return GENE_LLM_ERR_GENERAL;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    set_error(err, 1, "failed to publish state snapshot " + path);
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  if (out_key && out_key_len > 0) {
+    std::strncpy(out_key, key.c_str(), out_key_len - 1);
+    out_key[out_key_len - 1] = '\0';
+  }
+  return GENE_LLM_OK;
+}
+
+gene_llm_status gene_llm_session_load_state(gene_llm_session *session,
+                                            const char *prefix,
+                                            bool *out_loaded,
+                                            gene_llm_error *err) {
+  if (!session || !prefix || !out_loaded) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  *out_loaded = false;
+  std::lock_guard<std::mutex> busy(session->mutex);
+  const gene_llm_model *model = session->model;
+  if (model->state_cache_dir.empty()) {
+    set_error(err, 1, "model was loaded without a state cache directory");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  std::vector<llama_token> tokens;
+  if (tokenize_prompt(model->vocab, prefix, tokens, err) < 0) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  mapped_file file;
+  if (!file.open(state_path(model, state_key(model, tokens)))) {
+    return GENE_LLM_OK;
+  }
+
+  // Anything that does not match exactly (other model, other shim version,
+  // hash collision) is treated as a miss.
+  state_header header;
+  if (file.size() < sizeof(header)) {
+    return GENE_LLM_OK;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  const size_t tokens_bytes = tokens.size() * sizeof(llama_token);
+  if (std::memcmp(header.magic, kStateMagic, sizeof(header.magic)) != 0 ||
+      header.version != kStateVersion ||
+      header.model_hash !=
+          fnv1a(model->fingerprint.data(), model->fingerprint.size()) ||
+      header.n_tokens != tokens.size() ||
+      file.size() != sizeof(header) + tokens_bytes + header.state_size ||
+      std::memcmp(file.data() + sizeof(header), tokens.data(), tokens_bytes) !=
+          0) {
+    return GENE_LLM_OK;
+  }
+
+  reset_cached_tokens(session);
+  const uint8_t *state = file.data() + sizeof(header) + tokens_bytes;
+  if (llama_state_seq_set_data(session->ctx, state, header.state_size, 0) !=
+      header.state_size) {
+    // Produced by an incompatible llama.cpp build or context shape.
+    reset_cached_tokens(session);
+    return GENE_LLM_OK;
+  }
+  session->cached_tokens = std::move(tokens);
+  *out_loaded = true;
+  return GENE_LLM_OK;
+}
+
+gene_llm_status gene_llm_tokenize(gene_llm_model *model, const char *text,
+                                  size_t len, bool add_special,
+                                  int32_t *out_tokens, int max_tokens,
+                                  int *out_count, gene_llm_error *err) {
+  if (!model || (!text && len > 0) || !out_count ||
+      (max_tokens > 0 && !out_tokens)) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  std::vector<llama_token> tokens;
+  if (tokenize_cached(model, text ? text : "", len, add_special, tokens,
+                      err) < 0) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  *out_count = static_cast<int>(tokens.size());
+  if (static_cast<int>(tokens.size()) <= max_tokens) {
+    std::copy(tokens.begin(), tokens.end(), out_tokens);
+  }
+  return GENE_LLM_OK;
+}
+
+gene_llm_status gene_llm_detokenize(gene_llm_model *model,
+                                    const int32_t *tokens, int count,
+                                    bool remove_special, char *out,
+                                    size_t out_size, size_t *out_len,
+                                    gene_llm_error *err) {
+  if (!model || count < 0 || (count > 0 && !tokens) || !out_len ||
+      (out_size > 0 && !out)) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  const int32_t n_vocab = llama_vocab_n_tokens(model->vocab);
+  for (int i = 0; i < count; ++i) {
+    if (tokens[i] < 0 || tokens[i] >= n_vocab) {
+      set_error(err, 1, "token id out of range");
+      return GENE_LLM_ERR_GENERAL;
+    }
+  }
+  // Leaves room for the terminator.
+  const int32_t capacity = static_cast<int32_t>(
+      std::min<size_t>(out_size > 0 ? out_size - 1 : 0, INT32_MAX));
+  const int32_t n = llama_detokenize(model->vocab, tokens, count, out,
+                                     capacity, remove_special, true);
+  if (n == INT32_MIN) {
+    set_error(err, 1, "detokenization overflow");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  if (n >= 0) {
+    if (out_size > 0) {
+      out[n] = '\0';
+    }
+    *out_len = static_cast<size_t>(n);
+  } else {
+    if (out_size > 0) {
+      out[0] = '\0';
+    }
+    *out_len = static_cast<size_t>(-n);
+  }
+  return GENE_LLM_OK;
+}
+
+gene_llm_status gene_llm_count_tokens_batch(gene_llm_model *model,
+                                            const char *const *texts,
+                                            int count, bool add_special,
+                                            int32_t *out_counts,
+                                            gene_llm_error *err) {
+  if (!model || count < 0 || (count > 0 && (!texts || !out_counts))) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  std::vector<llama_token> tokens;
+  for (int i = 0; i < count; ++i) {
+    const char *text = texts[i] ? texts[i] : "";
+    const int32_t n = tokenize_cached(model, text, std::strlen(text),
+                                      add_special, tokens, err);
+    if (n < 0) {
+      return GENE_LLM_ERR_GENERAL;
+    }
+    out_counts[i] = n;
+  }
+  return GENE_LLM_OK;
+}
+
+int gene_llm_embedding_dim(gene_llm_model *model) {
+  return model ? llama_model_n_embd(model->model) : 0;
+}
+
+gene_llm_status gene_llm_embed(gene_llm_model *model, const char *text,
+                               const gene_llm_embed_options *options,
+                               float *out, size_t out_len,
+                               gene_llm_error *err) {
+  const char *texts[] = {text};
+  return gene_llm_embed_batch(model, texts, 1, options, out, out_len, err);
+}
+
+gene_llm_status gene_llm_embed_batch(gene_llm_model *model,
+                                     const char *const *texts, int count,
+                                     const gene_llm_embed_options *options,
+                                     float *out, size_t out_len,
+                                     gene_llm_error *err) {
+  if (!model || !texts || count < 0 || (count > 0 && !out)) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  const int dim = llama_model_n_embd(model->model);
+  if (out_len < static_cast<size_t>(count) * dim) {
+    set_error(err, 1, "embedding output buffer is too small");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  if (count == 0) {
+    return GENE_LLM_OK;
+  }
+
+  ensure_backend_init();
+  gene_llm_embed_context *embed = embed_context(model, options, err);
+  if (!embed) {
+    return GENE_LLM_ERR_GENERAL;
+  }
+  std::lock_guard<std::mutex> embed_lock(embed->mutex);
+  llama_context *ctx = embed->ctx;
+  const bool normalize = options && options->normalize;
+  const bool encoder_only = llama_model_has_encoder(model->model) &&
+                            !llama_model_has_decoder(model->model);
+  const int n_batch = static_cast<int>(llama_n_batch(ctx));
+  const int n_seq_max = static_cast<int>(llama_n_seq_max(ctx));
+
+  llama_batch batch = llama_batch_init(n_batch, 0, 1);
+  std::vector<llama_token> tokens;
+  int first_index = 0;  // index of the input held by sequence 0
+  int n_seqs = 0;
+
+  auto flush = [&]() {
+    if (n_seqs == 0) {
+      return true;
+    }
+    // Encoder-only models (BERT-style) run through llama_encode.
+    const int32_t rc = encoder_only ? encode_batch(embed->pool, ctx, batch)
+                                    : decode_batch(embed->pool, ctx, batch);
+    if (rc != 0) {
+      set_error(err, 1, "failed to evaluate embedding batch");
+      return false;
+    }
+    if (!collect_embeddings(ctx, n_seqs, first_index, dim, normalize, out,
+                            err)) {
+      return false;
+    }
+    first_index += n_seqs;
+    n_seqs = 0;
+    batch.n_tokens = 0;
+    return true;
+  };
+
+  batch.n_tokens = 0;
+  for (int i = 0; i < count; ++i) {
+    if (!texts[i] ||
+        tokenize_prompt(model->vocab, texts[i], tokens, err) < 0) {
+      if (!texts[i]) {
+        set_error(err, 1, "embedding input must be a string");
+      }
+      llama_batch_free(batch);
+      return GENE_LLM_ERR_GENERAL;
+    }
+    if (static_cast<int>(tokens.size()) > n_batch) {
+      set_error(err, 1,
+                "embedding input " + std::to_string(i) + " has " +
+                    std::to_string(tokens.size()) +
+                    " tokens, more than the batch size of " +
+                    std::to_string(n_batch));
+      llama_batch_free(batch);
+      return GENE_LLM_ERR_GENERAL;
+    }
+    if (n_seqs == n_seq_max ||
+        batch.n_tokens + static_cast<int>(tokens.size()) > n_batch) {
+      if (!flush()) {
+        llama_batch_free(batch);
+        return GENE_LLM_ERR_GENERAL;
+      }
+    }
+    for (size_t t = 0; t < tokens.size(); ++t) {
+      const int32_t k = batch.n_tokens++;
+      batch.token[k] = tokens[t];
+      batch.pos[k] = static_cast<llama_pos>(t);
+      batch.n_seq_id[k] = 1;
+      batch.seq_id[k][0] = n_seqs;
+      batch.logits[k] = true;
+    }
+    ++n_seqs;
+  }
+
+  const bool ok = flush();
+  llama_batch_free(batch);
+  return ok ? GENE_LLM_OK : GENE_LLM_ERR_GENERAL;
+}
+
+gene_llm_status gene_llm_new_async_queue(gene_llm_async_queue **out_queue,
+                                         gene_llm_error *err) {
+  if (!out_queue) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  auto queue = std::make_unique<gene_llm_async_queue>();
+  if (!async_open_fds(queue.get())) {
+    set_error(err, 1, "failed to create async wakeup descriptor");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  queue->worker = std::thread(async_worker, queue.get());
+  queue->flusher = std::thread(async_flusher, queue.get());
+  *out_queue = queue.release();
+  return GENE_LLM_OK;
+}
+
+void gene_llm_async_shutdown(gene_llm_async_queue *queue) {
+  if (!queue) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->stopping = true;
+    // Queued jobs end here the way the worker ends a job cancelled before
+    // it started; the running one reports its own DONE event.
+    for (const auto &job : queue->jobs) {
+      gene_llm_async_event_record event;
+      event.request_id = job->id;
+      event.kind = GENE_LLM_EVENT_DONE;
+      event.summary.finish_reason = GENE_LLM_FINISH_CANCELLED;
+      async_push_locked(queue, std::move(event));
+    }
+    queue->jobs.clear();
+    if (queue->running) {
+      queue->running->cancel_requested = true;
+    }
+  }
+  queue->work_cv.notify_all();
+  queue->flush_cv.notify_all();
+  if (queue->worker.joinable()) {
+    queue->worker.join();
+  }
+  if (queue->flusher.joinable()) {
+    queue->flusher.join();
+  }
+}
+
+void gene_llm_free_async_queue(gene_llm_async_queue *queue) {
+  if (!queue) {
+    return;
+  }
+  gene_llm_async_shutdown(queue);
+  async_close_fds(queue);
+  delete queue;
+}
+
+int gene_llm_async_fd(gene_llm_async_queue *queue) {
+  return queue ? queue->read_fd : -1;
+}
+
+namespace {
+
+gene_llm_status async_submit(gene_llm_async_queue *queue,
+                             gene_llm_session *session,
+                             const gene_llm_infer_options *options,
+                             bool stream_tokens, gene_llm_stream *stream,
+                             int64_t *out_request_id, gene_llm_error *err) {
+  if (!queue || !session || !options || !has_prompt(options) ||
+      !out_request_id) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+
+  auto job = std::make_unique<gene_llm_async_job>();
+  job->session = session;
+  job->options = *options;
+  if (options->prompt) {
+    job->prompt = options->prompt;
+    job->options.prompt = job->prompt.c_str();
+  }
+  if (options->prompt_token_count > 0 && options->prompt_tokens) {
+    job->prompt_tokens.assign(
+        options->prompt_tokens,
+        options->prompt_tokens + options->prompt_token_count);
+    job->options.prompt_tokens = job->prompt_tokens.data();
+  }
+  if (options->grammar) {
+    job->grammar = options->grammar;
+    job->options.grammar = job->grammar.c_str();
+  }
+  // Cancellation replaces the caller's progress callback, which could not be
+  // invoked safely from the worker thread anyway.
+  job->options.progress_callback = async_progress_callback;
+  job->options.progress_user_data = job.get();
+  job->stream_tokens = stream_tokens;
+  job->stream = stream;
+  job->queue = queue;
+
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->stopping) {
+      set_error(err, 1, "async queue has been shut down");
+      return GENE_LLM_ERR_GENERAL;
+    }
+    job->id = queue->next_id++;
+    *out_request_id = job->id;
+    queue->jobs.push_back(std::move(job));
+  }
+  queue->work_cv.notify_one();
+  return GENE_LLM_OK;
+}
+
+} // namespace
+
+gene_llm_status gene_llm_infer_async(gene_llm_async_queue *queue,
+                                     gene_llm_session *session,
+                                     const gene_llm_infer_options *options,
+                                     bool stream_tokens,
+                                     int64_t *out_request_id,
+                                     gene_llm_error *err) {
+  return async_submit(queue, session, options, stream_tokens, nullptr,
+                      out_request_id, err);
+}
+
+gene_llm_status gene_llm_new_stream(const gene_llm_stream_options *options,
+                                    gene_llm_stream **out_stream,
+                                    gene_llm_error *err) {
+  if (!out_stream) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  size_t capacity = options && options->capacity > 0 ? options->capacity
+                                                      : kDefaultStreamCapacity;
+  size_t size = 64;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  auto *stream = new gene_llm_stream();
+  stream->ring.resize(size);
+  stream->mask = size - 1;
+  stream->flush_bytes = options && options->flush_bytes > 0
+                            ? static_cast<size_t>(options->flush_bytes)
+                            : kDefaultStreamFlushBytes;
+  stream->flush_us = static_cast<int64_t>(options && options->flush_ms > 0
+                                              ? options->flush_ms
+                                              : kDefaultStreamFlushMs) *
+                     1000;
+  *out_stream = stream;
+  return GENE_LLM_OK;
+}
+
+void gene_llm_free_stream(gene_llm_stream *stream) { delete stream; }
+
+size_t gene_llm_stream_read(gene_llm_stream *stream, char *out,
+                            size_t max_len) {
+  if (!stream || !out || max_len == 0) {
+    return 0;
+  }
+  // Cleared first: anything written after this point signals again.
+  stream->wake_pending.store(false, std::memory_order_release);
+
+  auto read_ring = [&](size_t offset) {
+    const uint64_t tail = stream->tail.load(std::memory_order_relaxed);
+    const uint64_t head = stream->head.load(std::memory_order_acquire);
+    const size_t n =
+        std::min(static_cast<size_t>(head - tail), max_len - offset);
+    for (size_t i = 0; i < n; ++i) {
+      out[offset + i] = stream->ring[(tail + i) & stream->mask];
+    }
+    stream->tail.store(tail + n, std::memory_order_release);
+    return n;
+  };
+
+  size_t n = read_ring(0);
+  if (n < max_len && stream->spilling.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(stream->spill_mutex);
+    // The ring holds everything written before the spill started.
+    n += read_ring(n);
+    const uint64_t tail = stream->tail.load(std::memory_order_relaxed);
+    if (tail == stream->head.load(std::memory_order_acquire)) {
+      const size_t take = std::min(stream->spill.size(), max_len - n);
+      std::memcpy(out + n, stream->spill.data(), take);
+      stream->spill.erase(0, take);
+      n += take;
+      if (stream->spill.empty()) {
+        stream->spilling.store(false, std::memory_order_release);
+      }
+    }
+  }
+  return n;
+}
+
+void gene_llm_stream_cancel(gene_llm_stream *stream) {
+  if (stream) {
+    stream->cancelled.store(true, std::memory_order_relaxed);
+  }
+}
+
+gene_llm_status gene_llm_infer_async_stream(gene_llm_async_queue *queue,
+                                            gene_llm_session *session,
+                                            const gene_llm_infer_options *options,
+                                            gene_llm_stream *stream,
+                                            int64_t *out_request_id,
+                                            gene_llm_error *err) {
+  if (!stream) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  return async_submit(queue, session, options, false, stream, out_request_id,
+                      err);
+}
+
+gene_llm_status gene_llm_async_cancel(gene_llm_async_queue *queue,
+                                      int64_t request_id,
+                                      gene_llm_error *err) {
+  if (!queue) {
+    set_error(err, 1, "invalid arguments");
+    return GENE_LLM_ERR_GENERAL;
+  }
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if (queue->running && queue->running->id == request_id) {
+    queue->running->cancel_requested = true;
+    return GENE_LLM_OK;
+  }
+  for (auto &job : queue->jobs) {
+    if (job->id == request_id) {
+      job->cancel_requested = true;
+      break;
+    }
+  }
+  return GENE_LLM_OK;
+}
+
+int gene_llm_async_drain(gene_llm_async_queue *queue, gene_llm_event *out,
+                         int max_events) {
+  if (!queue || !out || max_events <= 0) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->drained.clear();
+  while (!queue->events.empty() &&
+         static_cast<int>(queue->drained.size()) < max_events) {
+    queue->drained.push_back(std::move(queue->events.front()));
+    queue->events.pop_front();
+  }
+  if (queue->events.empty()) {
+    async_clear_locked(queue);
+  }
+
+  const int count = static_cast<int>(queue->drained.size());
+  for (int i = 0; i < count; ++i) {
+    const gene_llm_async_event_record &record = queue->drained[i];
+    gene_llm_event &event = out[i];
+    event.request_id = record.request_id;
+    event.kind = record.kind;
+    event.text = record.text.c_str();
+    event.text_len = record.text.size();
+    // The record was moved since run_inference filled it in, so the views
+    // have to be taken again from its arena.
+    event.completion = record.summary;
+    event.completion.text = record.arena.text.c_str();
+    event.completion.text_len = record.arena.text.size();
+    event.completion.token_ids = record.arena.token_ids.data();
+    event.completion.token_offsets = record.arena.token_offsets.data();
+    event.completion.token_count = record.arena.token_count();
+  }
+  return count;
 }
@@ -11,8 +11,15 @@ extern "C" {
 
 struct gene_llm_model;
 struct gene_llm_session;
+struct gene_llm_engine;
+struct gene_llm_async_queue;
+struct gene_llm_stream;
 
-typedef enum { GENE_LLM_OK = 0, GENE_LLM_ERR_GENERAL = 1 } gene_llm_status;
+typedef enum {
+  GENE_LLM_OK = 0,
+  GENE_LLM_ERR_GENERAL = 1,
+  GENE_LLM_PENDING = 2
+} gene_llm_status;
 
 typedef enum {
   GENE_LLM_FINISH_STOP = 0,
@@ -27,19 +34,78 @@ typedef struct {
   int gpu_layers;
   bool use_mmap;
   bool use_mlock;
+  const char *state_cache_dir; // session snapshots; NULL disables them
 } gene_llm_model_options;
 
+// KV cache element types. Quantized caches take roughly 1/2 (q8_0) or 1/4
+// (q4_0) of the f16 memory; a quantized V cache needs flash attention.
+typedef enum {
+  GENE_LLM_KV_F16 = 0,
+  GENE_LLM_KV_Q8_0 = 1,
+  GENE_LLM_KV_Q4_0 = 2
+} gene_llm_kv_type;
+
+typedef enum {
+  GENE_LLM_FLASH_ATTN_AUTO = 0, // backend decides
+  GENE_LLM_FLASH_ATTN_OFF = 1,
+  GENE_LLM_FLASH_ATTN_ON = 2
+} gene_llm_flash_attn;
+
 typedef struct {
   int context_length;
-  int batch_size;
+  int batch_size;  // logical batch; prompts are decoded in chunks of this size
+  int ubatch_size; // physical batch; bounds compute buffers (0 = batch_size)
   int threads;
   int seed;
   float temperature;
   float top_p;
   int top_k;
   int max_tokens;
+  // Optional draft model for speculative decoding. It must share the target's
+  // vocabulary and stay loaded for the session's lifetime.
+  struct gene_llm_model *draft_model;
+  int draft_tokens; // proposals per step (0 = default)
+  int max_branches; // largest n for gene_llm_infer_n (0 = 1)
+  gene_llm_kv_type type_k;
+  gene_llm_kv_type type_v;
+  gene_llm_flash_attn flash_attn;
+  // When the context is full, drop the older half of the tokens after the
+  // first keep_tokens (e.g. the system prompt) instead of failing. Prompts
+  // longer than the context lose their middle the same way.
+  bool context_shift;
+  int keep_tokens;
 } gene_llm_session_options;
 
+typedef struct {
+  int context_length; // shared by all sequences in the engine
+  int batch_size;     // max tokens per decode step across all sequences
+  int threads;
+  int max_sequences;  // concurrently decoded requests
+  int seed;
+  float temperature;
+  float top_p;
+  int top_k;
+  int max_tokens;
+} gene_llm_engine_options;
+
+// Structured output: sampling is restricted to tokens that keep the text
+// inside the grammar, and generation ends once the top-level value is
+// complete. Grammars are parsed once per session (or engine) and cached.
+typedef enum {
+  GENE_LLM_GRAMMAR_NONE = 0,
+  GENE_LLM_GRAMMAR_GBNF = 1,         // grammar is GBNF text with a root rule
+  GENE_LLM_GRAMMAR_GENE_LITERAL = 2, // one Gene data literal
+  GENE_LLM_GRAMMAR_JSON = 3,         // any JSON value
+  // grammar is GBNF generated from a JSON schema; it may refer to the JSON
+  // rules value, object, array, string, number, integer, boolean, null, ws.
+  GENE_LLM_GRAMMAR_JSON_SCHEMA = 4,
+} gene_llm_grammar_kind;
+
+// Called before each prefill chunk with the number of prompt tokens already
+// in the KV cache. Returns 0 to continue, non-zero to cancel the request.
+typedef int (*gene_llm_progress_callback)(int decoded_tokens, int total_tokens,
+                                          void *user_data);
+
 typedef struct {
   const char *prompt;
   int max_tokens;
@@ -47,29 +113,168 @@ typedef struct {
   float top_p;
   int top_k;
   int seed;
+  int timeout_ms; // 0 = no deadline; checked per prefill chunk and per token
+  gene_llm_progress_callback progress_callback;
+  void *progress_user_data;
+  // Pre-tokenized prompt (e.g. from gene_llm_tokenize with add_special), used
+  // instead of prompt when prompt_token_count > 0.
+  const int32_t *prompt_tokens;
+  int prompt_token_count;
+  int n; // completions for gene_llm_infer_n (0 = 1); ignored elsewhere
+  gene_llm_grammar_kind grammar_kind;
+  const char *grammar;
 } gene_llm_infer_options;
 
+// Values match llama_pooling_type.
+typedef enum {
+  GENE_LLM_POOLING_MEAN = 1,
+  GENE_LLM_POOLING_CLS = 2,
+  GENE_LLM_POOLING_LAST = 3
+} gene_llm_pooling;
+
+typedef struct {
+  gene_llm_pooling pooling;
+  bool normalize; // L2-normalize each vector
+  int batch_size; // max tokens per decode (and per input); 0 = default
+  int threads;
+} gene_llm_embed_options;
+
 typedef struct {
   int code;
   char message[512];
 } gene_llm_error;
 
+// Completion results are views into an arena owned by the session (or, for
+// gene_llm_poll, the engine). They stay valid until the next request on the
+// same session / the next poll on the same engine, or until that session or
+// engine is freed. gene_llm_free_completion only detaches the views.
+// Token i spans text[token_offsets[i] .. token_offsets[i + 1]).
 typedef struct {
-  char *text;
-  char **tokens;
+  const char *text; // UTF-8, null-terminated
+  size_t text_len;
+  const int32_t *token_ids;
+  const int32_t *token_offsets; // token_count + 1 entries
   int token_count;
   int latency_ms;
   gene_llm_finish_reason finish_reason;
+  int draft_tokens;   // tokens proposed by the draft model
+  int draft_accepted; // of those, accepted by the target
+  // Telemetry; times are wall-clock milliseconds.
+  int prompt_tokens;        // prompt length in tokens
+  int cached_tokens;        // of those, reused from the KV cache
+  double prefill_ms;        // prompt evaluation
+  double decode_ms;         // generation, from first token to finish
+  double ttft_ms;           // request start to first generated token
+  double tokens_per_second; // generated tokens over decode time
+  int kv_used;              // KV cells occupied when the request finished
+  int kv_size;              // KV cells in the context
+  int context_shifts;       // times the context was shifted (context_shift)
 } gene_llm_completion;
 
+// Process-wide counters, updated as requests finish.
+typedef struct {
+  int64_t requests;           // finished requests, any outcome
+  int64_t failed_requests;
+  int64_t cancelled_requests; // includes timeouts
+  int64_t prompt_tokens;
+  int64_t cached_tokens;
+  int64_t generated_tokens;
+  double prefill_ms;
+  double decode_ms;
+  int64_t models;   // currently loaded
+  int64_t sessions; // currently open
+  int64_t engines;  // currently open
+} gene_llm_stats;
+
+// Levels match Gene's LogLevel.
+typedef enum {
+  GENE_LLM_LOG_ERROR = 0,
+  GENE_LLM_LOG_WARN = 1,
+  GENE_LLM_LOG_INFO = 2,
+  GENE_LLM_LOG_DEBUG = 3
+} gene_llm_log_level;
+
+// May be called from shim worker threads.
+typedef void (*gene_llm_log_callback)(int level, const char *message,
+                                      void *user_data);
+
 void gene_llm_backend_init(void);
 
+// Diagnostics are dropped until a callback is installed. NULL uninstalls.
+void gene_llm_set_log_callback(gene_llm_log_callback callback,
+                               void *user_data);
+
+void gene_llm_get_stats(gene_llm_stats *out_stats);
+// Zeroes the request counters; the live object counts are kept.
+void gene_llm_reset_stats(void);
+
 gene_llm_status gene_llm_load_model(const char *path,
                                     const gene_llm_model_options *options,
                                     struct gene_llm_model **out_model,
                                     gene_llm_error *error);
+// Frees a model from gene_llm_load_model; registry models are released.
 void gene_llm_free_model(struct gene_llm_model *model);
 
+// Model registry: one shared model per canonical path and load options, for
+// every VM and thread in the process. Acquire loads the weights only on a
+// miss; each acquire is paired with a release. Sessions and engines pin their
+// model too. Models nobody uses stay resident until the memory budget needs
+// their space, least recently used first.
+typedef struct {
+  size_t memory_budget_bytes; // 0 = unlimited
+} gene_llm_registry_options;
+
+typedef struct {
+  int loaded;             // resident models
+  int in_use;             // of those, acquired or pinned
+  size_t resident_bytes;  // weights of resident models
+  size_t budget_bytes;
+  int64_t hits;
+  int64_t misses;
+  int64_t evictions;
+} gene_llm_registry_stats;
+
+// Applies the budget immediately, evicting idle models if needed.
+void gene_llm_registry_configure(const gene_llm_registry_options *options);
+gene_llm_status gene_llm_acquire_model(const char *path,
+                                       const gene_llm_model_options *options,
+                                       struct gene_llm_model **out_model,
+                                       gene_llm_error *error);
+void gene_llm_release_model(struct gene_llm_model *model);
+// Loads a model into the registry without holding on to it.
+gene_llm_status gene_llm_preload_model(const char *path,
+                                       const gene_llm_model_options *options,
+                                       gene_llm_error *error);
+void gene_llm_registry_get_stats(gene_llm_registry_stats *out_stats);
+
+// Every context runs on one process-wide ggml threadpool, created with
+// hardware_concurrency threads on first use. Session, engine and embedding
+// thread counts are capped at its size (0 = all of it), and contexts on the
+// same pool take turns evaluating instead of oversubscribing the cores.
+// Configuring replaces the pool for contexts created afterwards.
+typedef enum {
+  GENE_LLM_THREAD_PRIORITY_LOW = -1,
+  GENE_LLM_THREAD_PRIORITY_NORMAL = 0,
+  GENE_LLM_THREAD_PRIORITY_MEDIUM = 1,
+  GENE_LLM_THREAD_PRIORITY_HIGH = 2,
+  GENE_LLM_THREAD_PRIORITY_REALTIME = 3,
+} gene_llm_thread_priority;
+
+typedef struct {
+  int threads;     // 0 = hardware_concurrency
+  const int *cpus; // affinity mask as CPU indices; none = any CPU
+  int cpu_count;
+  bool strict_cpu; // pin each worker to one CPU of the mask
+  int priority;    // gene_llm_thread_priority
+  int poll;        // 0-100: how long idle workers spin; < 0 = ggml default
+} gene_llm_threadpool_options;
+
+gene_llm_status
+gene_llm_configure_threadpool(const gene_llm_threadpool_options *options,
+                              gene_llm_error *error);
+// Threads in the current pool (creating the default one if needed).
+int gene_llm_threadpool_size(void);
+
 gene_llm_status gene_llm_new_session(struct gene_llm_model *model,
                                      const gene_llm_session_options *options,
                                      struct gene_llm_session **out_session,
@@ -82,6 +287,17 @@ gene_llm_status gene_llm_infer(struct gene_llm_session *session,
                                gene_llm_error *error);
 void gene_llm_free_completion(gene_llm_completion *completion);
 
+// Samples options->n completions of one prompt into out_completions[0..n).
+// The prompt is decoded once and its KV shared by all branches, which then
+// decode together, so n candidates cost about one request plus n-way
+// decoding. Needs a session created with max_branches >= n. The completions
+// stay valid until the next gene_llm_infer_n on the session. Greedy
+// sampling (temperature 0) yields n identical branches.
+gene_llm_status gene_llm_infer_n(struct gene_llm_session *session,
+                                 const gene_llm_infer_options *options,
+                                 gene_llm_completion *out_completions,
+                                 gene_llm_error *error);
+
 // Callback invoked for each generated token during streaming inference
 // token: the generated token text (null-terminated)
 // token_len: length of the token in bytes
@@ -98,6 +314,175 @@ gene_llm_status gene_llm_infer_streaming(struct gene_llm_session *session,
                                          gene_llm_completion *out_completion,
                                          gene_llm_error *error);
 
+// Prefills prefix (reusing whatever is already cached) and writes the KV state
+// of the session to the model's state cache directory. The file name is a
+// hash of the model file and the prefix tokens; it is copied to out_key when
+// out_key is non-NULL.
+gene_llm_status gene_llm_session_save_state(struct gene_llm_session *session,
+                                            const char *prefix, char *out_key,
+                                            size_t out_key_len,
+                                            gene_llm_error *error);
+
+// Restores the snapshot saved for prefix, if any, by memory-mapping it.
+// *out_loaded is false when no compatible snapshot exists.
+gene_llm_status gene_llm_session_load_state(struct gene_llm_session *session,
+                                            const char *prefix,
+                                            bool *out_loaded,
+                                            gene_llm_error *error);
+
+// Tokenizes len bytes of text with the model's vocabulary. Special tokens in
+// the text are parsed; add_special adds BOS/EOS as the model expects.
+// Results are cached per model (least recently used out first), so counting
+// the same message again is a lookup. *out_count receives the token count;
+// ids are written only when it is <= max_tokens.
+gene_llm_status gene_llm_tokenize(struct gene_llm_model *model,
+                                  const char *text, size_t len,
+                                  bool add_special, int32_t *out_tokens,
+                                  int max_tokens, int *out_count,
+                                  gene_llm_error *error);
+
+// Renders count tokens back to text. *out_len receives the byte length; the
+// null-terminated text is written only when out_size > *out_len.
+gene_llm_status gene_llm_detokenize(struct gene_llm_model *model,
+                                    const int32_t *tokens, int count,
+                                    bool remove_special, char *out,
+                                    size_t out_size, size_t *out_len,
+                                    gene_llm_error *error);
+
+// out_counts[i] = token count of texts[i], as gene_llm_tokenize reports it.
+gene_llm_status gene_llm_count_tokens_batch(struct gene_llm_model *model,
+                                            const char *const *texts,
+                                            int count, bool add_special,
+                                            int32_t *out_counts,
+                                            gene_llm_error *error);
+
+// Embedding width of the model (floats per vector).
+int gene_llm_embedding_dim(struct gene_llm_model *model);
+
+// Embeds one text into out (out_len >= gene_llm_embedding_dim floats).
+gene_llm_status gene_llm_embed(struct gene_llm_model *model, const char *text,
+                               const gene_llm_embed_options *options,
+                               float *out, size_t out_len,
+                               gene_llm_error *error);
+
+// Embeds count texts, decoding many of them per batch as separate sequences.
+// Vector i is written to out[i * dim .. (i + 1) * dim).
+gene_llm_status gene_llm_embed_batch(struct gene_llm_model *model,
+                                     const char *const *texts, int count,
+                                     const gene_llm_embed_options *options,
+                                     float *out, size_t out_len,
+                                     gene_llm_error *error);
+
+// Continuous-batching engine: many requests share one llama context as
+// separate sequences. A scheduler thread admits new requests between decode
+// steps and mixes prefill and decode tokens from all of them in each batch.
+gene_llm_status gene_llm_new_engine(struct gene_llm_model *model,
+                                    const gene_llm_engine_options *options,
+                                    struct gene_llm_engine **out_engine,
+                                    gene_llm_error *error);
+void gene_llm_free_engine(struct gene_llm_engine *engine);
+
+// Queue a request; returns immediately with an id for gene_llm_poll.
+gene_llm_status gene_llm_submit(struct gene_llm_engine *engine,
+                                const gene_llm_infer_options *options,
+                                int64_t *out_request_id,
+                                gene_llm_error *error);
+
+// Waits up to timeout_ms (0 = don't wait) for the request to finish.
+// Returns GENE_LLM_PENDING while it is still running; otherwise fills
+// out_completion (or error) and forgets the request id.
+gene_llm_status gene_llm_poll(struct gene_llm_engine *engine,
+                              int64_t request_id, int timeout_ms,
+                              gene_llm_completion *out_completion,
+                              gene_llm_error *error);
+
+// Stops a queued or running request; it completes as cancelled.
+gene_llm_status gene_llm_cancel(struct gene_llm_engine *engine,
+                                int64_t request_id, gene_llm_error *error);
+
+// Async inference: requests run on a worker thread owned by the queue and
+// report back as events. gene_llm_async_fd is readable whenever events are
+// waiting, so it can be handed to an event loop; it is -1 where no such
+// descriptor exists and callers have to drain periodically instead.
+typedef enum {
+  GENE_LLM_EVENT_TOKEN = 0, // text holds one generated piece
+  GENE_LLM_EVENT_DONE = 1,  // completion is filled in
+  GENE_LLM_EVENT_ERROR = 2  // text holds the error message
+} gene_llm_event_kind;
+
+typedef struct {
+  int64_t request_id;
+  gene_llm_event_kind kind;
+  const char *text;
+  size_t text_len;
+  gene_llm_completion completion;
+} gene_llm_event;
+
+gene_llm_status gene_llm_new_async_queue(struct gene_llm_async_queue **out_queue,
+                                         gene_llm_error *error);
+// Cancels outstanding requests and joins the worker. Every request still
+// gets its DONE (finish reason cancelled) or ERROR event, which stays
+// drainable; later submits fail.
+void gene_llm_async_shutdown(struct gene_llm_async_queue *queue);
+// Shuts the queue down if needed and frees it with any undrained events.
+void gene_llm_free_async_queue(struct gene_llm_async_queue *queue);
+int gene_llm_async_fd(struct gene_llm_async_queue *queue);
+
+// Queues a request and returns immediately. The prompt is copied; the
+// options' progress callback is replaced by the queue's cancellation check.
+// TOKEN events are only produced when stream_tokens is true. The session
+// must outlive the request.
+gene_llm_status gene_llm_infer_async(struct gene_llm_async_queue *queue,
+                                     struct gene_llm_session *session,
+                                     const gene_llm_infer_options *options,
+                                     bool stream_tokens,
+                                     int64_t *out_request_id,
+                                     gene_llm_error *error);
+
+// Stops a queued or running request; it still reports a DONE event (finish
+// reason cancelled). Unknown or finished ids are ignored.
+gene_llm_status gene_llm_async_cancel(struct gene_llm_async_queue *queue,
+                                      int64_t request_id,
+                                      gene_llm_error *error);
+
+// Streamed output without a TOKEN event per token: the worker appends pieces
+// to the stream (a lock-free ring; it never waits for the reader) and makes
+// the queue's fd readable once flush_bytes have accumulated or flush_ms have
+// passed since the last wakeup, including while decoding the next token is
+// still in progress. Readers take everything available with
+// gene_llm_stream_read, after each wakeup and once more on the DONE event.
+// Pieces are raw bytes and may end inside a UTF-8 character.
+typedef struct {
+  size_t capacity; // ring bytes before spilling (0 = 16 KiB)
+  int flush_bytes; // 0 = 256
+  int flush_ms;    // 0 = 20
+} gene_llm_stream_options;
+
+gene_llm_status gene_llm_new_stream(const gene_llm_stream_options *options,
+                                    struct gene_llm_stream **out_stream,
+                                    gene_llm_error *error);
+// Only after the request using the stream has reported DONE or ERROR.
+void gene_llm_free_stream(struct gene_llm_stream *stream);
+// Copies up to max_len pending bytes into out; returns the count.
+size_t gene_llm_stream_read(struct gene_llm_stream *stream, char *out,
+                            size_t max_len);
+// Asks the decode loop to stop; it checks the flag before every token.
+void gene_llm_stream_cancel(struct gene_llm_stream *stream);
+
+// Like gene_llm_infer_async with output going to stream instead of TOKEN
+// events. The stream must outlive the request.
+gene_llm_status gene_llm_infer_async_stream(struct gene_llm_async_queue *queue,
+                                            struct gene_llm_session *session,
+                                            const gene_llm_infer_options *options,
+                                            struct gene_llm_stream *stream,
+                                            int64_t *out_request_id,
+                                            gene_llm_error *error);
+
+// Moves up to max_events pending events into out, oldest first. Event text
+// and completions stay valid until the next drain on the same queue.
+int gene_llm_async_drain(struct gene_llm_async_queue *queue,
+                         gene_llm_event *out, int max_events);
+
 #ifdef __cplusplus
 }
 #endif
@@ -130,6 +130,104 @@ static Value c_utf8_char(VirtualMachine* vm, Value* args, int arg_count, bool ha
     return gene_to_value_string_n(bytes, 3);
 }
 
+/**
+ * range_array - Build [0 .. n-1] with one bulk push
+ * Usage: (c_ext/range_array 3) => [0 1 2]
+ */
+static Value c_range_array(VirtualMachine* vm, Value* args, int arg_count, bool has_keyword_args) {
+    int64_t n = gene_to_int(gene_get_arg(args, arg_count, has_keyword_args, 0));
+    if (n < 0) {
+        gene_raise_error("range_array requires a non-negative count");
+    }
+    Value arr = gene_new_array_with_capacity(n);
+    Value* values = (Value*)malloc(sizeof(Value) * (size_t)(n > 0 ? n : 1));
+    for (int64_t i = 0; i < n; i++) {
+        values[i] = gene_to_value_int(i);
+    }
+    gene_array_push_n(arr, values, n);
+    free(values);
+    return arr;
+}
+
+/**
+ * rows - Build n row maps sharing pre-interned keys
+ * Usage: (c_ext/rows 2) => [{^id 0 ^name "row"} {^id 1 ^name "row"}]
+ */
+static Value c_rows(VirtualMachine* vm, Value* args, int arg_count, bool has_keyword_args) {
+    int64_t n = gene_to_int(gene_get_arg(args, arg_count, has_keyword_args, 0));
+    Key id_key = gene_to_key("id");
+    Key name_key = gene_to_key("name");
+    Value rows = gene_new_array_with_capacity(n);
+    for (int64_t i = 0; i < n; i++) {
+        Value row = gene_new_map(2);
+        gene_map_set_key(row, id_key, gene_to_value_int(i));
+        gene_map_set_key(row, name_key, gene_to_value_string_n("row", 3));
+        gene_array_push(rows, row);
+    }
+    return rows;
+}
+
+/**
+ * sum_array - Sum an integer array through the borrowed element pointer
+ * Usage: (c_ext/sum_array [1 2 3]) => 6
+ */
+static Value c_sum_array(VirtualMachine* vm, Value* args, int arg_count, bool has_keyword_args) {
+    int64_t len = 0;
+    const Value* items = gene_array_data(gene_get_arg(args, arg_count, has_keyword_args, 0), &len);
+    int64_t sum = 0;
+    for (int64_t i = 0; i < len; i++) {
+        sum += gene_to_int(items[i]);
+    }
+    return gene_to_value_int(sum);
+}
+
+/**
+ * adopted_bytes - Hand a malloc'd buffer of n bytes (0, 1, 2, ...) to the VM
+ * Usage: (c_ext/adopted_bytes 8) => 8 bytes
+ */
+static Value c_adopted_bytes(VirtualMachine* vm, Value* args, int arg_count, bool has_keyword_args) {
+    int64_t n = gene_to_int(gene_get_arg(args, arg_count, has_keyword_args, 0));
+    uint8_t* buffer = (uint8_t*)malloc((size_t)(n > 0 ? n : 1));
+    for (int64_t i = 0; i < n; i++) {
+        buffer[i] = (uint8_t)i;
+    }
+    return gene_new_bytes_adopt(buffer, n, NULL);
+}
+
+/**
+ * byte_sum - Sum the bytes of a bytes value
+ * Usage: (c_ext/byte_sum (c_ext/adopted_bytes 4)) => 6
+ */
+static Value c_byte_sum(VirtualMachine* vm, Value* args, int arg_count, bool has_keyword_args) {
+    Value bytes = gene_get_arg(args, arg_count, has_keyword_args, 0);
+    int64_t len = 0;
+    const uint8_t* data = gene_bytes_data(bytes, &len);
+    uint8_t small[6];
+    if (data == NULL) {
+        len = gene_bytes_copy(bytes, small, sizeof(small));
+        data = small;
+    }
+    int64_t sum = 0;
+    for (int64_t i = 0; i < len; i++) {
+        sum += data[i];
+    }
+    return gene_to_value_int(sum);
+}
+
+/**
+ * scale - Multiply an integer by a factor; registered with a typed entry
+ * Usage: (c_ext/scale 3 0.5) => 1.5
+ */
+static double scale_typed(int64_t n, double factor) {
+    return (double)n * factor;
+}
+
+static Value c_scale(VirtualMachine* vm, Value* args, int arg_count, bool has_keyword_args) {
+    Value n = gene_get_arg(args, arg_count, has_keyword_args, 0);
+    Value factor = gene_get_arg(args, arg_count, has_keyword_args, 1);
+    return gene_to_value_float(scale_typed(gene_to_int(n), gene_to_float(factor)));
+}
+
 /* ========== Required Extension Exports ========== */
 
 /**
@@ -147,6 +245,13 @@ static Namespace* init(VirtualMachine* vm) {
     gene_namespace_set(ns, "is_even", gene_wrap_native_fn(c_is_even));
     gene_namespace_set(ns, "greet", gene_wrap_native_fn(c_greet));
     gene_namespace_set(ns, "utf8_char", gene_wrap_native_fn(c_utf8_char));
+    gene_namespace_set(ns, "range_array", gene_wrap_native_fn(c_range_array));
+    gene_namespace_set(ns, "rows", gene_wrap_native_fn(c_rows));
+    gene_namespace_set(ns, "sum_array", gene_wrap_native_fn(c_sum_array));
+    gene_namespace_set(ns, "adopted_bytes", gene_wrap_native_fn(c_adopted_bytes));
+    gene_namespace_set(ns, "byte_sum", gene_wrap_native_fn(c_byte_sum));
+    gene_namespace_set(ns, "scale",
+                       gene_wrap_typed_native_fn(c_scale, (const void*)scale_typed, "i64,f64 -> f64"));
     
     return ns;
 }
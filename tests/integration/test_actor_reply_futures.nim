@@ -120,3 +120,42 @@ suite "Actor reply futures":
     """, "actor_reply_sync.gene")
 
     check result == 11.to_value()
+
+  test "an idle worker steals runnable actors from a busy one":
+    actor_enable_for_test(2)
+    let handler = NativeFn(lifecycle_handler).to_value()
+    # Round-robin placement puts both actors on the first worker.
+    let sleeper = actor_spawn_value(handler, 0.to_value())
+    discard actor_spawn_value(handler, 0.to_value())
+    let counter = actor_spawn_value(handler, 0.to_value())
+    check actor_queue_snapshot(sleeper).worker_thread_id == actor_queue_snapshot(counter).worker_thread_id
+
+    # Let both workers park so only the scheduler decides who runs what.
+    let deadline = epochTime() + 1.0
+    while epochTime() < deadline:
+      var parked = 0
+      for worker in actor_scheduler_snapshot():
+        if worker.idle:
+          parked.inc()
+      if parked == 2:
+        break
+      sleep(5)
+
+    discard actor_send_value(VM, sleeper, actor_message("sleep"))
+    for _ in 0..<5:
+      discard actor_send_value(VM, counter, actor_message("increment"))
+    let count = await_vm_future(actor_send_value(VM, counter, actor_message("get"), true), 150)
+    check count == 5.to_value()
+
+    let snapshot = actor_queue_snapshot(counter)
+    check snapshot.steals >= 1
+    check snapshot.mailbox_len == 0
+    check snapshot.worker_thread_id != actor_queue_snapshot(sleeper).worker_thread_id
+
+    var steals = 0
+    var turns = 0
+    for worker in actor_scheduler_snapshot():
+      steals += worker.steals
+      turns += worker.turns
+    check steals >= 1
+    check turns >= 2
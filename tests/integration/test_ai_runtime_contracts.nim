@@ -84,3 +84,22 @@ suite "Conversation store":
     let after = store.get_recent("s-1", 10)
     check after.len == 1
     check after[0].content == "next"
+
+  test "recent within token budget":
+    let store = new_conversation_store()
+    store.append_message("s-2", "user", "one two three")
+    store.append_message("s-2", "assistant", "four five")
+    store.append_message("s-2", "user", "six")
+
+    let count_words: TokenCounter = proc(texts: seq[string]): seq[int] {.gcsafe.} =
+      for text in texts:
+        result.add(text.splitWhitespace().len)
+
+    let fit = store.get_recent_within_tokens("s-2", 4, count_words)
+    check fit.len == 2
+    check fit[0].content == "four five"
+    check fit[1].content == "six"
+
+    let with_overhead = store.get_recent_within_tokens("s-2", 4, count_words, per_event_tokens = 1)
+    check with_overhead.len == 1
+    check store.get_recent_within_tokens("s-2", 0, count_words).len == 0
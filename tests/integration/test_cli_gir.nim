@@ -1383,3 +1383,41 @@ suite "GIR CLI":
     checkpoint second.output
     check second.exitCode == 0
     check second.output == first.output
+
+  test "lazy GIR loads decode function bodies on first call":
+    init_all()
+    let source_path = absolutePath("tmp/gir_lazy_bodies.gene")
+    createDir(parentDir(source_path))
+    writeFile(source_path, "(fn used [x] (+ x 1))\n(fn unused [] 0)\n(used 41)\n")
+    let gir_path = "build/tests/gir_lazy_bodies.gir"
+    createDir(parentDir(gir_path))
+    defer:
+      if fileExists(source_path):
+        removeFile(source_path)
+      if fileExists(gir_path):
+        removeFile(gir_path)
+
+    let compiled = compiler.parse_and_compile(readFile(source_path), source_path, eager_functions = true)
+    gir.save_gir(compiled, gir_path, source_path)
+
+    let loaded = gir.load_gir(gir_path, lazy = true)
+    var lazy_bodies: seq[LazyCompiledBody] = @[]
+    for inst in loaded.instructions:
+      if inst.kind == IkFunction and inst.arg0.kind == VkFunctionDef:
+        let info = to_function_def_info(inst.arg0)
+        check info.compiled_body.kind != VkCompiledUnit
+        check info.lazy_body != nil
+        lazy_bodies.add(info.lazy_body)
+    check lazy_bodies.len == 2
+
+    VM.frame = new_frame(new_namespace(App.app.global_ns.ref.ns, "gir_lazy_bodies"))
+    VM.cu = loaded
+    check VM.exec() == 42.to_value()
+    check lazy_bodies[0].body != nil
+    check lazy_bodies[1].body == nil
+
+    # Eager loads of the same file still carry decoded bodies.
+    let eager = gir.load_gir(gir_path)
+    for inst in eager.instructions:
+      if inst.kind == IkFunction and inst.arg0.kind == VkFunctionDef:
+        check to_function_def_info(inst.arg0).compiled_body.kind == VkCompiledUnit
@@ -1,8 +1,10 @@
-import std/[os, tables, times, unittest]
+import std/[atomics, os, tables, times, unittest]
 
 import gene/types except Exception
 import gene/vm
 import gene/vm/actor
+import gene/vm/blocking_pool
+import gene/vm/event_channel
 import gene/vm/extension
 import gene/vm/extension_abi
 import gene/vm/thread
@@ -64,9 +66,87 @@ proc build_host(): GeneHostAbi =
     register_scheduler_callback_fn: nil,
     register_port_fn: host_register_port_bridge,
     call_port_fn: host_call_port_bridge,
+    submit_blocking_fn: host_submit_blocking_bridge,
+    open_event_channel_fn: host_open_event_channel_bridge,
+    event_channel_push_bytes_fn: host_event_channel_push_bytes_bridge,
+    event_channel_push_value_fn: host_event_channel_push_value_bridge,
+    event_channel_close_fn: host_event_channel_close_bridge,
+    event_channel_retain_fn: host_event_channel_retain_bridge,
+    event_channel_release_fn: host_event_channel_release_bridge,
     result_namespace: nil
   )
 
+var blocking_gate: Atomic[bool]
+
+proc double_work(user_data: pointer): pointer {.cdecl, gcsafe.} =
+  sleep(20)
+  cast[pointer](cast[int](user_data) * 2)
+
+proc gated_work(user_data: pointer): pointer {.cdecl, gcsafe.} =
+  while not blocking_gate.load():
+    sleep(1)
+  user_data
+
+proc int_complete(work_result: pointer, user_data: pointer, out_value: ptr Value): int32 {.cdecl, gcsafe.} =
+  out_value[] = cast[int](work_result).to_value()
+  0
+
+var released_user_data: Atomic[int]
+
+proc releasing_complete(work_result: pointer, user_data: pointer, out_value: ptr Value): int32 {.cdecl, gcsafe.} =
+  if work_result == nil:
+    discard released_user_data.fetchAdd(1)
+  out_value[] = cast[int](work_result).to_value()
+  0
+
+proc open_gate_later(delay_ms: int) {.thread.} =
+  sleep(delay_ms)
+  blocking_gate.store(true)
+
+proc failing_complete(work_result: pointer, user_data: pointer, out_value: ptr Value): int32 {.cdecl, gcsafe.} =
+  out_value[] = "disk on fire".to_value()
+  int32(GeneExtErr)
+
+proc settle_vm_future(future_value: Value, timeout_ms = 2_000): FutureObj =
+  let deadline = epochTime() + (timeout_ms.float / 1000.0)
+  result = future_value.ref.future
+  while result.state == FsPending and epochTime() < deadline:
+    VM.event_loop_counter = 100
+    VM.poll_enabled = true
+    VM.poll_event_loop()
+    sleep(1)
+
+var channel_records: seq[Value] = @[]
+var channel_batches = 0
+var channel_host: GeneHostAbi
+var channel_under_test: pointer
+const ChannelRecordsPerProducer = 5_000
+
+proc channel_handler(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                     has_keyword_args: bool): Value {.gcsafe, nimcall.} =
+  discard vm
+  discard arg_count
+  {.cast(gcsafe).}:
+    let batch = get_positional_arg(args, 0, has_keyword_args)
+    channel_batches.inc()
+    for record in array_data(batch):
+      channel_records.add(record)
+  NIL
+
+proc channel_producer(base: int) {.thread.} =
+  {.cast(gcsafe).}:
+    for i in 0..<ChannelRecordsPerProducer:
+      while channel_host.event_channel_push_value_fn(channel_under_test, (base + i).to_value()) ==
+          int32(GeneExtOverloaded):
+        sleep(0)
+
+proc pump_channel(expected: int, timeout_ms = 5_000) =
+  let deadline = epochTime() + (timeout_ms.float / 1000.0)
+  while channel_records.len < expected and epochTime() < deadline:
+    VM.event_loop_counter = 100
+    VM.poll_enabled = true
+    VM.poll_event_loop()
+
 suite "Extension port registration":
   setup:
     init_thread_pool()
@@ -161,3 +241,162 @@ suite "Extension port registration":
     discard actor_send_value(VM, first, port_message("increment"))
     check await_vm_future(actor_send_value(VM, first, port_message("get"), true)) == 10.to_value()
     check await_vm_future(actor_send_value(VM, second, port_message("get"), true)) == 2.to_value()
+
+suite "Extension blocking work":
+  setup:
+    init_thread_pool()
+    init_app_and_vm()
+    init_stdlib()
+
+  test "blocking work resolves its future on the submitting VM":
+    var host = build_host()
+    var futures: seq[Value] = @[]
+    for i in 1..8:
+      let submitted = submit_blocking_work(addr host, double_work, int_complete, cast[pointer](i))
+      check submitted.status == GeneExtOk
+      check submitted.future.kind == VkFuture
+      futures.add(submitted.future)
+
+    for i, future in futures:
+      let future_obj = settle_vm_future(future)
+      check future_obj.state == FsSuccess
+      check future_obj.value == ((i + 1) * 2).to_value()
+
+  test "a failing completion fails the future with its message":
+    var host = build_host()
+    let submitted = submit_blocking_work(addr host, double_work, failing_complete, cast[pointer](1))
+    check submitted.status == GeneExtOk
+    let future_obj = settle_vm_future(submitted.future)
+    check future_obj.state == FsFailure
+    check instance_props(future_obj.value)["message".to_key()] == "disk on fire".to_value()
+
+  test "a full queue reports overloaded without queueing":
+    var host = build_host()
+    blocking_gate.store(false)
+    configure_blocking_pool(queue_limit = 0)
+    # Start the pool so its size is known.
+    let warmup = submit_blocking_work(addr host, double_work, int_complete, cast[pointer](0))
+    check settle_vm_future(warmup.future).state == FsSuccess
+
+    var futures: seq[Value] = @[]
+    for i in 0..<blocking_pool_stats().threads:
+      let submitted = submit_blocking_work(addr host, gated_work, int_complete, cast[pointer](i))
+      check submitted.status == GeneExtOk
+      futures.add(submitted.future)
+
+    let rejected_before = blocking_pool_stats().rejected
+    let overflow = submit_blocking_work(addr host, gated_work, int_complete, cast[pointer](99))
+    check overflow.status == GeneExtOverloaded
+    check overflow.future == NIL
+    check blocking_pool_stats().rejected == rejected_before + 1
+
+    blocking_gate.store(true)
+    for i, future in futures:
+      let future_obj = settle_vm_future(future)
+      check future_obj.state == FsSuccess
+      check future_obj.value == i.to_value()
+    configure_blocking_pool(queue_limit = DefaultBlockingPoolQueueLimit)
+
+  test "shutdown settles queued jobs without running them":
+    var host = build_host()
+    blocking_gate.store(false)
+    released_user_data.store(0)
+    let warmup = submit_blocking_work(addr host, double_work, int_complete, cast[pointer](0))
+    check settle_vm_future(warmup.future).state == FsSuccess
+
+    var running: seq[Value] = @[]
+    for i in 1..blocking_pool_stats().threads:
+      running.add(submit_blocking_work(addr host, gated_work, int_complete, cast[pointer](i)).future)
+    var queued: seq[Value] = @[]
+    for i in 1..2:
+      queued.add(submit_blocking_work(addr host, gated_work, releasing_complete, cast[pointer](i)).future)
+
+    var opener: Thread[int]
+    createThread(opener, open_gate_later, 100)
+    shutdown_blocking_pool()
+    joinThread(opener)
+
+    check released_user_data.load() == 2
+    for future in queued:
+      check future.ref.future.state == FsFailure
+    for future in running:
+      check settle_vm_future(future).state == FsSuccess
+
+suite "Extension event channels":
+  setup:
+    init_thread_pool()
+    init_app_and_vm()
+    init_stdlib()
+    channel_records.setLen(0)
+    channel_batches = 0
+
+  test "records from several producer threads arrive in batches":
+    channel_host = build_host()
+    let opened = open_extension_event_channel(addr channel_host, 256, NativeFn(channel_handler).to_value())
+    check opened.status == GeneExtOk
+    channel_under_test = opened.channel
+
+    var producers: array[2, system.Thread[int]]
+    for i in 0..<producers.len:
+      createThread(producers[i], channel_producer, i * ChannelRecordsPerProducer)
+    pump_channel(producers.len * ChannelRecordsPerProducer)
+    joinThreads(producers)
+
+    check channel_records.len == producers.len * ChannelRecordsPerProducer
+    var seen = newSeq[bool](channel_records.len)
+    for record in channel_records:
+      seen[record.to_int] = true
+    for flag in seen:
+      check flag
+    check channel_batches < channel_records.len
+    channel_host.event_channel_close_fn(channel_under_test)
+
+  test "byte records keep their contents and close drains what was pushed":
+    var host = build_host()
+    let opened = open_extension_event_channel(addr host, 128, NativeFn(channel_handler).to_value(),
+                                              EventChannelSingleProducer)
+    check opened.status == GeneExtOk
+    var payload: array[100, uint8]
+    for i in 0..<payload.len:
+      payload[i] = uint8(i)
+    for len in 0..<100:
+      check host.event_channel_push_bytes_fn(opened.channel, addr payload[0], uint32(len)) == int32(GeneExtOk)
+    host.event_channel_close_fn(opened.channel)
+    pump_channel(100)
+
+    check channel_records.len == 100
+    for len, record in channel_records:
+      check record.kind == VkBytes
+      check bytes_len(record) == len
+      if len > 0:
+        check bytes_at(record, len - 1) == uint8(len - 1)
+
+  test "a full ring is overloaded and unshared values are refused":
+    var host = build_host()
+    let opened = open_extension_event_channel(addr host, 2, NativeFn(channel_handler).to_value())
+    check opened.status == GeneExtOk
+    check host.event_channel_push_value_fn(opened.channel, 1.to_value()) == int32(GeneExtOk)
+    check host.event_channel_push_value_fn(opened.channel, 2.to_value()) == int32(GeneExtOk)
+    check host.event_channel_push_value_fn(opened.channel, 3.to_value()) == int32(GeneExtOverloaded)
+    check host.event_channel_push_value_fn(opened.channel, new_array_value()) == int32(GeneExtErr)
+    pump_channel(2)
+    check channel_records == @[1.to_value(), 2.to_value()]
+    host.event_channel_close_fn(opened.channel)
+
+  test "a retained producer is stopped after close":
+    var host = build_host()
+    let opened = open_extension_event_channel(addr host, 8, NativeFn(channel_handler).to_value())
+    check opened.status == GeneExtOk
+    host.event_channel_retain_fn(opened.channel)
+    check host.event_channel_push_value_fn(opened.channel, 1.to_value()) == int32(GeneExtOk)
+    host.event_channel_close_fn(opened.channel)
+    pump_channel(1)
+    check channel_records == @[1.to_value()]
+    # The owner has drained and freed the ring; the retained header still
+    # answers pushes.
+    for _ in 0..<10:
+      VM.event_loop_counter = 100
+      VM.poll_enabled = true
+      VM.poll_event_loop()
+    check host.event_channel_push_value_fn(opened.channel, 2.to_value()) == int32(GeneExtStopped)
+    host.event_channel_release_fn(opened.channel)
@@ -54,13 +54,291 @@ suite "LLM Mock Backend":
     let finish = map_data(response)["finish_reason".to_key()]
     check finish.kind == VkSymbol
     check finish.str == ":length"
+    check map_data(response)["token_count".to_key()].to_int() == 1
+    check not map_data(response).hasKey("tokens".to_key())
+    let perf = map_data(response)["perf".to_key()]
+    check map_data(perf)["prompt_tokens".to_key()].to_int() == 2
+
+  test "tokens are materialized on request":
+    let response = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {}))
+      (session .infer "ping pong" {^tokens true})
+    """)
+    let tokens = map_data(response)["tokens".to_key()]
+    check tokens.kind == VkArray
+    check array_data(tokens).len == 2
+    check array_data(tokens)[0].str == "ping"
+
+  test "infer_async resolves a future":
+    let response = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {}))
+      (await (session .infer_async "ping pong"))
+    """)
+    check response.kind == VkMap
+    check map_data(response)["text".to_key()].str == "ping pong [mock]"
+    check map_data(response)["finish_reason".to_key()].str == ":stop"
+
+  test "infer_streaming delivers pieces through the bridge":
+    let response = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {}))
+      (var pieces [])
+      (var completion (session .infer_streaming "ping pong" (fn [piece] (pieces .push piece))))
+      [pieces completion]
+    """)
+    let pieces = array_data(response)[0]
+    check array_data(pieces).len == 3
+    check array_data(pieces)[0].str == "ping"
+    check array_data(response)[1].kind == VkMap
+
+  test "stats count finished requests":
+    let stats = eval("""
+      (genex/llm/reset_stats)
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {}))
+      (session .infer "ping pong")
+      (session .infer "one two three" {^max_tokens 1})
+      (session .infer "skipped" {^max_tokens 0})
+      (genex/llm/stats)
+    """)
+    check stats.kind == VkMap
+    check map_data(stats)["requests".to_key()].to_int() == 3
+    check map_data(stats)["cancelled_requests".to_key()].to_int() == 1
+    check map_data(stats)["prompt_tokens".to_key()].to_int() == 5
+    check map_data(stats)["generated_tokens".to_key()].to_int() == 3
+
+  test "registry shares models loaded from the same path":
+    let before = eval("(genex/llm/registry_stats)")
+    let after = eval("""
+      (genex/llm/configure {^memory_budget_mb 512})
+      (var a (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var b (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (genex/llm/registry_stats)
+    """)
+    check after.kind == VkMap
+    let hits_before = map_data(before)["hits".to_key()].to_int()
+    check map_data(after)["hits".to_key()].to_int() - hits_before >= 1
+    check map_data(after)["budget_bytes".to_key()].to_int() == 512 * 1024 * 1024
+    check map_data(after)["in_use".to_key()].to_int() >= 1
+
+    expect Exception:
+      discard eval("(genex/llm/configure {^memory_budget_mb -1})")
+
+  test "configure validates threadpool options":
+    check eval("""(genex/llm/configure {^threads 2 ^cpus "0-1" ^thread_priority "high" ^poll 0})""").kind == VkNil
+    check eval("(genex/llm/configure {^reserve_cpus 0 ^strict_cpu true})").kind == VkNil
+    expect Exception:
+      discard eval("(genex/llm/configure {^threads -1})")
+    expect Exception:
+      discard eval("""(genex/llm/configure {^cpus "a-b"})""")
+    expect Exception:
+      discard eval("""(genex/llm/configure {^thread_priority "urgent"})""")
+    expect Exception:
+      discard eval("(genex/llm/configure {^poll 101})")
+
+  test "infer accepts grammar and json_schema options":
+    let reply = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {}))
+      (session .infer "a" {^grammar "gene-literal"})
+      (session .infer "b" {^grammar "root ::= \"yes\" | \"no\""})
+      (session .infer "c" {^json_schema {^type "object"
+                                         ^properties {^name {^type "string"}
+                                                      ^tags {^type "array" ^items {^type "string"}}
+                                                      ^kind {^enum ["a" "b"]}}
+                                         ^required ["name"]}})
+    """)
+    check reply.kind == VkMap
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        ((model .new_session {}) .infer "x" {^grammar "yaml"})
+      """)
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        ((model .new_session {}) .infer "x" {^json_schema {^type "tuple"}})
+      """)
+
+  test "tokenizer round-trips and counts":
+    let values = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var ids (model .tokenize "alpha beta alpha"))
+      (var session (model .new_session {}))
+      [ids (model .detokenize ids) (model .count_tokens ["a b" "c"]) (model .count_tokens "x y z")
+       (session .infer ids)]
+    """)
+    let items = array_data(values)
+    let ids = array_data(items[0])
+    check ids.len == 3
+    check ids[0].to_int() == ids[2].to_int()
+    check items[1].str == "alpha beta alpha"
+    check array_data(items[2])[0].to_int() == 2
+    check array_data(items[2])[1].to_int() == 1
+    check items[3].to_int() == 3
+    check map_data(items[4])["text".to_key()].str == "alpha beta alpha [mock]"
+
+  test "n option returns one completion per branch":
+    let branches = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {^max_branches 3}))
+      (session .infer "red green" {^n 3})
+    """)
+    check branches.kind == VkArray
+    check array_data(branches).len == 3
+    for branch in array_data(branches):
+      check map_data(branch)["text".to_key()].str == "red green [mock]"
+
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        (var session (model .new_session {}))
+        (session .infer "hi" {^n 0})
+      """)
+
+  test "session accepts KV cache and context shift options":
+    let response = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {^cache_type "q8_0" ^flash_attn true ^context_shift true ^keep_tokens 32}))
+      (session .infer "hi")
+    """)
+    check response.kind == VkMap
+
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        (model .new_session {^cache_type_k "q2_k"})
+      """)
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        (model .new_session {^cache_type_v "q4_0" ^flash_attn false})
+      """)
+
+  test "draft model decoding matches greedy decoding":
+    let results = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var draft (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var plain (model .new_session {^temperature 0}))
+      (var speculative (model .new_session {^temperature 0 ^draft draft ^draft_tokens 4}))
+      [(plain .infer "one two three" {^max_tokens 2}) (speculative .infer "one two three" {^max_tokens 2})]
+    """)
+    let plain = array_data(results)[0]
+    let speculative = array_data(results)[1]
+    check map_data(speculative)["text".to_key()].str == map_data(plain)["text".to_key()].str
+    check map_data(speculative)["token_count".to_key()].to_int() == 2
+    check map_data(speculative)["draft_tokens".to_key()].to_int() == 2
+    check map_data(speculative)["draft_accepted".to_key()].to_int() == 2
+    check not map_data(plain).hasKey("draft_tokens".to_key())
+
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        (model .new_session {^draft "not a model"})
+      """)
+
+  test "timeout option bounds inference":
+    let response = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var session (model .new_session {}))
+      (session .infer "hi" {^timeout_ms 1000})
+    """)
+    check response.kind == VkMap
+    check map_data(response)["finish_reason".to_key()].str == ":stop"
 
-  test "timeout option raises":
     expect Exception:
       discard eval("""
         (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
         (var session (model .new_session {}))
-        (session .infer "hi" {^timeout 1})
+        (session .infer "hi" {^timeout -1})
+      """)
+
+  test "embed packs float32 vectors into bytes":
+    let response = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (model .embed ["alpha" "beta" "alpha"])
+    """)
+    check response.kind == VkMap
+    let dim = map_data(response)["dim".to_key()].to_int()
+    check map_data(response)["count".to_key()].to_int() == 3
+    let data = map_data(response)["data".to_key()]
+    check data.kind == VkBytes
+    let bytes = data.ref.bytes_data
+    check bytes.len == 3 * dim * sizeof(float32)
+    let stride = dim * sizeof(float32)
+    check bytes[0 ..< stride] == bytes[2 * stride ..< 3 * stride]
+    check bytes[0 ..< stride] != bytes[stride ..< 2 * stride]
+
+  test "session state snapshots restore and keep decoding":
+    let state_dir = getTempDir() / "gene_llm_mock_state"
+    removeDir(state_dir)
+    let model_expr = "(genex/llm/load_model " & MockModelPathLiteral &
+      " {^allow_missing true ^state_cache \"" & state_dir & "\"})"
+    let results = eval("""
+      (var model """ & model_expr & """)
+      (var writer (model .new_session {}))
+      (var key (writer .save_state "alpha beta gamma"))
+      (var reader (model .new_session {}))
+      (var loaded (reader .load_state "alpha beta gamma"))
+      (var fresh (model .new_session {}))
+      [key loaded (reader .infer "alpha beta gamma delta") (fresh .infer "alpha beta gamma delta")
+       (fresh .load_state "never saved")]
+    """)
+    let key = array_data(results)[0].str
+    check array_data(results)[1].to_bool()
+    let restored = array_data(results)[2]
+    let cold = array_data(results)[3]
+    check map_data(restored)["text".to_key()].str == map_data(cold)["text".to_key()].str
+    check map_data(map_data(restored)["perf".to_key()])["cached_tokens".to_key()].to_int() == 3
+    check map_data(map_data(cold)["perf".to_key()])["cached_tokens".to_key()].to_int() == 0
+    check not array_data(results)[4].to_bool()
+
+    # A corrupt snapshot is a miss and leaves the session's own state alone.
+    writeFile(state_dir / key & ".state", "not a snapshot")
+    let after = eval("""
+      (var model """ & model_expr & """)
+      (var session (model .new_session {}))
+      (session .infer "one two")
+      [(session .load_state "alpha beta gamma") (session .infer "one two three")]
+    """)
+    check not array_data(after)[0].to_bool()
+    let perf = map_data(array_data(after)[1])["perf".to_key()]
+    check map_data(perf)["cached_tokens".to_key()].to_int() == 2
+
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        ((model .new_session {}) .save_state "alpha")
+      """)
+    removeDir(state_dir)
+
+  test "engine completes every batched request":
+    let results = eval("""
+      (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+      (var engine (model .new_engine {^max_sequences 2 ^max_tokens 8}))
+      (var first (engine .submit "alpha beta"))
+      (var second (engine .submit "gamma delta epsilon" {^max_tokens 2}))
+      (var results [(engine .poll first {^timeout_ms 1000}) (engine .poll second {^timeout_ms 1000})])
+      (engine .close)
+      (model .close)
+      results
+    """)
+    check results.kind == VkArray
+    check array_data(results).len == 2
+    let first = array_data(results)[0]
+    let second = array_data(results)[1]
+    check map_data(first)["text".to_key()].str == "alpha beta [mock]"
+    check map_data(first)["finish_reason".to_key()].str == ":stop"
+    check map_data(second)["token_count".to_key()].to_int() == 2
+    check map_data(second)["finish_reason".to_key()].str == ":length"
+
+    expect Exception:
+      discard eval("""
+        (var model (genex/llm/load_model """ & MockModelPathLiteral & """ {^allow_missing true}))
+        (var engine (model .new_engine {}))
+        (engine .poll 99)
       """)
 
   test "model close blocked while sessions open":
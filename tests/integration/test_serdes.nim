@@ -441,3 +441,62 @@ test "Serdes: malformed EnumValue records reject before constructing values":
     (EnumRef ^path "Identity/Box" ^module "$MODULE")
     ["wrong"]))
 """.replace("$MODULE", module_path), ["GENE_TYPE_MISMATCH", "Identity/Box.value"])
+
+test "Serdes: binary payloads roundtrip literal values":
+  init_all()
+  init_serdes()
+  let value = VM.exec(cleanup("""
+    {^name "wire" ^ids [1 -2 9007199254740991] ^ratio 0.25 ^tag `sym ^on true ^none nil
+     ^frozen #{^a "x"} ^node `(item ^a 1 "child" [2 3])}
+  """), "serdes_binary_source")
+  let encoded = serialize_binary(value)
+  check encoded[0] == '\xFF'
+  check binary_payload_len(cast[ptr UncheckedArray[uint8]](unsafeAddr encoded[0])) == encoded.len
+  let decoded = deserialize_binary(encoded)
+  check decoded.kind == VkMap
+  check serialize_literal(decoded).to_s() == serialize_literal(value).to_s()
+  check map_is_frozen(map_data(decoded)["frozen".to_key()])
+  check deserialize_bridge_payload(encoded).kind == VkMap
+  check deserialize_bridge_payload(serialize_literal(value).to_s()).kind == VkMap
+
+test "Serdes: binary payloads write each map key once":
+  init_all()
+  init_serdes()
+  let value = VM.exec(cleanup("""
+    [{^first_name "a"} {^first_name "b"} {^first_name "c"}]
+  """), "serdes_binary_keys_source")
+  check serialize_binary(value).count("first_name") == 1
+  let decoded = deserialize_binary(serialize_binary(value))
+  check map_data(array_data(decoded)[2])["first_name".to_key()].str == "c"
+
+test "Serdes: binary payloads reject truncated input and newer versions":
+  init_all()
+  init_serdes()
+  let encoded = serialize_binary(VM.exec("[1 2 3]", "serdes_binary_truncated_source"))
+  var raised = false
+  try:
+    discard deserialize_binary(encoded[0 ..< encoded.len - 1])
+  except CatchableError as e:
+    raised = e.msg.contains("truncated")
+  check raised
+
+  var newer = encoded
+  newer[3] = char(GeneBinaryVersion + 1)
+  raised = false
+  try:
+    discard deserialize_binary(newer)
+  except CatchableError as e:
+    raised = e.msg.contains("version")
+  check raised
+
+test "Serdes: gene/serdes/to_bytes and from_bytes roundtrip":
+  init_all()
+  init_serdes()
+  let value = VM.exec(cleanup("""
+    (gene/serdes/from_bytes (gene/serdes/to_bytes {^a [1 "two" 3.5]}))
+  """), "serdes_binary_bytes_source")
+  check value.kind == VkMap
+  let items = array_data(map_data(value)["a".to_key()])
+  check items[0] == 1.to_value()
+  check items[1].str == "two"
+  check items[2].to_float() == 3.5
@@ -31,7 +31,8 @@ proc extension_file_path(base: string): string =
 
 proc eval_with_import(ext_base: string, code: string): Value =
   VM.exec("""
-    (import add multiply concat strlen is_even greet utf8_char from """" & ext_base & """" ^^native)
+    (import add multiply concat strlen is_even greet utf8_char
+            range_array rows sum_array adopted_bytes byte_sum scale from """" & ext_base & """" ^^native)
     """ & "\n" & code, "test_c_extension")
 
 suite "C Extension Support":
@@ -86,3 +87,35 @@ suite "C Extension Support":
     let result = eval_with_import(ext_base, "(utf8_char)")
     check result.kind == VkString
     check result.str == "你"
+
+  test "C extension - bulk array construction":
+    let ext_base = extension_base_path()
+    let result = eval_with_import(ext_base, "(range_array 1000)")
+    check result.kind == VkArray
+    check array_data(result).len == 1000
+    check array_data(result)[999] == 999.to_value()
+    check eval_with_import(ext_base, "(sum_array (range_array 100))") == 4950.to_value()
+
+  test "C extension - maps with pre-interned keys":
+    let ext_base = extension_base_path()
+    let result = eval_with_import(ext_base, "(rows 3)")
+    check result.kind == VkArray
+    check array_data(result).len == 3
+    let row = array_data(result)[2]
+    check row.kind == VkMap
+    check map_data(row)["id".to_key()] == 2.to_value()
+    check map_data(row)["name".to_key()].str == "row"
+
+  test "C extension - adopted bytes buffer":
+    let ext_base = extension_base_path()
+    let result = eval_with_import(ext_base, "(adopted_bytes 64)")
+    check result.kind == VkBytes
+    check bytes_len(result) == 64
+    check bytes_at(result, 63) == 63'u8
+    check eval_with_import(ext_base, "(byte_sum (adopted_bytes 64))") == 2016.to_value()
+    check eval_with_import(ext_base, "(byte_sum (adopted_bytes 4))") == 6.to_value()
+
+  test "C extension - typed native function":
+    let ext_base = extension_base_path()
+    check eval_with_import(ext_base, "(scale 3 0.5)") == 1.5.to_value()
+    check eval_with_import(ext_base, "(scale 4 2)") == 8.0.to_value()
@@ -3,6 +3,7 @@ import unittest
 import ../src/gene/vm
 import ./helpers
 import ../src/gene/types except Exception
+import ../src/gene/native/trampoline
 
 const TRAMPOLINE_OK = """
 (do
@@ -44,6 +45,25 @@ const MISSING_RETURN_ANNOTATION = """
   candidate)
 """
 
+const TYPED_NATIVE_CALLER = """
+(do
+  (fn caller [n: Int x: Float] -> Float
+    (mul_add n x))
+  caller)
+"""
+
+var typed_entry_calls = 0
+
+proc mul_add_typed(n: int64, x: float64): float64 {.cdecl.} =
+  typed_entry_calls.inc()
+  n.float64 * x + 1.0
+
+proc mul_add_boxed(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                   has_keyword_args: bool): Value {.gcsafe.} =
+  let n = get_positional_arg(args, 0, has_keyword_args)
+  let x = get_positional_arg(args, 1, has_keyword_args)
+  (n.to_int().float64 * x.to_float() + 1.0).to_value()
+
 test "native trampoline: typed helper call compiles natively":
   init_all()
   let prev = VM.native_code
@@ -183,3 +203,47 @@ test "native guarded tier deopts on runtime guard miss":
   check raised
   check f.native_ready
   check not f.native_failed
+
+test "native codegen: typed native fn is called through its C entry":
+  init_all()
+  let prev = VM.native_code
+  let prev_tier = VM.native_tier
+  defer:
+    VM.native_code = prev
+    VM.native_tier = prev_tier
+  VM.native_tier = NctGuarded
+  VM.native_code = true
+
+  let fn_value = VM.exec(TYPED_NATIVE_CALLER, "test_native_typed_entry")
+  check fn_value.kind == VkFunction
+  let f = fn_value.ref.fn
+  let mul_add = wrap_typed_native_fn(mul_add_boxed, cast[pointer](mul_add_typed),
+                                     @[CatInt64, CatFloat64], CrtFloat64)
+  f.ns["mul_add".to_key()] = mul_add
+
+  typed_entry_calls = 0
+  let result = VM.exec_function(fn_value, @[3.to_value(), 2.5.to_value()])
+  check result.to_float() == 8.5
+  check f.native_ready
+  check f.native_descriptors.len == 1
+  check f.native_descriptors[0].directEntry == cast[pointer](mul_add_typed)
+  check typed_entry_calls == 1
+
+  # The interpreter takes the same entry; mismatched arguments use the boxed fn.
+  App.app.global_ns.ns["mul_add".to_key()] = mul_add
+  check VM.exec("(mul_add 2 0.25)", "test_native_typed_entry_interp").to_float() == 1.5
+  check typed_entry_calls == 2
+  check VM.exec("(mul_add 2 1)", "test_native_typed_entry_interp_int").to_float() == 3.0
+  check typed_entry_calls == 3
+
+test "native trampoline: signature strings parse":
+  var arg_types: seq[CallArgType]
+  var return_type: CallReturnType
+  check parse_native_signature("i64,f64,string -> f64", arg_types, return_type)
+  check arg_types == @[CatInt64, CatFloat64, CatValue]
+  check return_type == CrtFloat64
+  check parse_native_signature("-> value", arg_types, return_type)
+  check arg_types.len == 0
+  check return_type == CrtValue
+  check not parse_native_signature("i64, bogus -> i64", arg_types, return_type)
+  check not parse_native_signature("i64", arg_types, return_type)
@@ -149,6 +149,10 @@ proc ordered_target_handler(vm: ptr VirtualMachine, args: ptr UncheckedArray[Val
     array_data(state).add(kind.to_value())
     sleep(200)
     state
+  of "slow":
+    array_data(state).add(kind.to_value())
+    sleep(100)
+    state
   of "get":
     {.cast(gcsafe).}:
       actor_reply_for_test(ctx, state)
@@ -168,6 +172,20 @@ proc order_forwarder_handler(vm: ptr VirtualMachine, args: ptr UncheckedArray[Va
     actor_reply_for_test(ctx, "parked".to_value())
   target
 
+proc order_pair_forwarder_handler(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
+                                  has_keyword_args: bool): Value {.gcsafe, nimcall.} =
+  discard arg_count
+  let ctx = get_positional_arg(args, 0, has_keyword_args)
+  let target = get_positional_arg(args, 2, has_keyword_args)
+
+  {.cast(gcsafe).}:
+    discard actor_send_value(vm, target, actor_message("first"))
+    # By now the target has popped a message and freed a mailbox slot.
+    sleep(250)
+    discard actor_send_value(vm, target, actor_message("second"))
+    actor_reply_for_test(ctx, "sent".to_value())
+  target
+
 suite "Phase 2 actor send tiers":
   test "primitive payloads route by value":
     let routed = prepare_actor_payload_for_send(42.to_value())
@@ -221,6 +239,42 @@ suite "Phase 2 actor send tiers":
     check (flags_of(cloned) and SharedBit) == 0'u8
     check (flags_of(left) and SharedBit) == 0'u8
 
+  test "transfer moves uniquely referenced graphs without copying":
+    reset_actor_send_tier_stats()
+    let shared_leaf = new_array_value("x".to_value())
+    let payload = new_map_value()
+    map_data(payload)["items".to_key()] = new_array_value(1.to_value(), 2.to_value())
+    map_data(payload)["body".to_key()] = "document body".to_value()
+    map_data(payload)["leaf".to_key()] = shared_leaf
+    # Read ids without taking references, which would make the nodes shared.
+    let items_id = raw_id(map_data(payload)["items".to_key()])
+    let body_id = raw_id(map_data(payload)["body".to_key()])
+
+    let routed = prepare_actor_payload_for_send(payload, transfer = true)
+    let moved = routed.value
+
+    check routed.tier == AstMovedUnique
+    check raw_id(moved) == raw_id(payload)
+    check raw_id(map_data(moved)["items".to_key()]) == items_id
+    check raw_id(map_data(moved)["body".to_key()]) == body_id
+    check raw_id(map_data(moved)["leaf".to_key()]) != raw_id(shared_leaf)
+    check (flags_of(moved) and SharedBit) != 0'u8
+    check (flags_of(map_data(moved)["items".to_key()]) and SharedBit) != 0'u8
+    check (flags_of(shared_leaf) and SharedBit) == 0'u8
+
+    var buffer = newSeq[uint8](4096)
+    let bytes = new_bytes_value(buffer)
+    check prepare_actor_payload_for_send(bytes, transfer = true).tier == AstMovedUnique
+
+    let aliased = new_array_value()
+    let holder = new_array_value(aliased)
+    check prepare_actor_payload_for_send(aliased, transfer = true).tier == AstClonedMutable
+    check array_data(holder).len == 1
+
+    let stats = actor_send_tier_stats()
+    check stats[AstMovedUnique] == 2
+    check stats[AstClonedMutable] == 1
+
   test "capability values fail clearly":
     proc native_stub(vm: ptr VirtualMachine, args: ptr UncheckedArray[Value], arg_count: int,
                      has_keyword_args: bool): Value {.gcsafe, nimcall.} =
@@ -335,6 +389,38 @@ suite "Phase 2 actor send tiers":
     check observed[1] == "external-queued".to_value()
     check observed[2] == "parked-one".to_value()
 
+  test "a parked actor send is not overtaken by the same actor's next send":
+    init_thread_pool()
+    init_app_and_vm()
+    init_stdlib()
+    init_actor_runtime()
+    set_actor_mailbox_limit_for_test(2)
+    actor_enable_for_test(2)
+
+    let target = actor_spawn_value(NativeFn(ordered_target_handler).to_value(), new_array_value())
+    let forwarder = actor_spawn_value(NativeFn(order_pair_forwarder_handler).to_value(), target)
+
+    discard actor_send_value(VM, target, actor_message("hold"))
+    sleep(50)
+    discard actor_send_value(VM, target, actor_message("slow"))
+    discard actor_send_value(VM, target, actor_message("slow"))
+
+    let forward_result = await_actor_future(
+      actor_send_value(VM, forwarder, actor_message("forward"), true)
+    )
+
+    check forward_result == "sent".to_value()
+
+    sleep(400)
+    let processed = await_actor_future(
+      actor_send_value(VM, target, actor_message("get"), true)
+    )
+    let observed = array_data(processed)
+
+    check observed.len == 5
+    check observed[3] == "first".to_value()
+    check observed[4] == "second".to_value()
+
   test "actor-originated sends fail fast when parked send queue is full":
     init_thread_pool()
     init_app_and_vm()
@@ -7,6 +7,8 @@ BUILD_DIR="$ROOT_DIR/build/llama"
 SHIM_SRC="$ROOT_DIR/src/genex/llm/shim/gene_llm.cpp"
 SERVER_DEFAULT_PARALLEL="${GENE_LLAMA_SERVER_PARALLEL:-4}"
 BUILD_SERVER="${GENE_LLAMA_BUILD_SERVER:-1}"
+BUILD_BENCH="${GENE_LLAMA_BUILD_BENCH:-1}"
+BENCH_SRC="$ROOT_DIR/benchmarks/llm/gene_llm_bench.cpp"
 
 # Auto-detect Apple Silicon and enable Metal support
 ARCH="$(uname -m)"
@@ -105,6 +107,29 @@ echo "✅ Llama runtime built successfully at $BUILD_DIR"
 echo "📁 Libraries: libllama.a $(ls -la "$BUILD_DIR/libllama.a" | awk '{print $5}' | numfmt --to=iec)"
 echo "📁 Shim: libgene_llm.a $(ls -la "$BUILD_DIR/libgene_llm.a" | awk '{print $5}' | numfmt --to=iec)"
 
+if [ "$BUILD_BENCH" = "1" ]; then
+  echo "⏱️  Building shim benchmark..."
+  declare -a BENCH_LIBS=("$BUILD_DIR/libgene_llm.a" "$BUILD_DIR/libllama.a")
+  while IFS= read -r lib; do
+    BENCH_LIBS+=("$lib")
+  done < <(find "$BUILD_DIR" -name "libggml*.a" -type f | sort -r)
+  declare -a BENCH_LDFLAGS=(-lpthread)
+  if [ "${GENE_LLAMA_METAL:-0}" = "1" ]; then
+    BENCH_LDFLAGS+=(-framework Metal -framework Foundation -framework MetalKit -framework Accelerate)
+  fi
+  if clang++ -std=c++17 -O2 \
+      -I"$ROOT_DIR/src/genex/llm/shim" \
+      -I"$LLAMA_DIR/include" \
+      -I"$LLAMA_DIR/ggml/include" \
+      "$BENCH_SRC" "${BENCH_LIBS[@]}" "${BENCH_LDFLAGS[@]}" \
+      -o "$BUILD_DIR/gene_llm_bench" \
+    && "$BUILD_DIR/gene_llm_bench" --make-model "$BUILD_DIR/bench-tiny.gguf"; then
+    echo "📁 Bench: $BUILD_DIR/gene_llm_bench (model: bench-tiny.gguf)"
+  else
+    echo "⚠️  Shim benchmark failed to build; the runtime libraries are still usable"
+  fi
+fi
+
 if [ "$BUILD_SERVER" = "1" ]; then
   SERVER_BIN="$BUILD_DIR/bin/llama-server"
   if [ ! -x "$SERVER_BIN" ] && [ -x "$BUILD_DIR/bin/Release/llama-server" ]; then